@@ -151,7 +151,7 @@ namespace TestProject
         [Ignore]    // ファイル名が一定ではないので一旦テスト対象外
         public void TestMethod4()
         {
-            Assert.AreEqual("int main() { 1+3++ }\r\n                   ^ 数ではありません\r\n", CompileError("int main() { 1+3++ }"));
+            Assert.AreEqual("int main() { 1+3+ + }\r\n                    ^ 数ではありません\r\n", CompileError("int main() { 1+3+ + }"));
             Assert.AreEqual("int main() { 1+3 2 }\r\n                 ^ ';'ではありません\r\n", CompileError("int main() { 1+3 2 }"));
             Assert.AreEqual("int main() { 1 + @ }\r\n                 ^ トークナイズできません\r\n", CompileError("int main() { 1 + @ }"));
         }
@@ -258,7 +258,7 @@ namespace TestProject
             Assert.AreEqual(10, Compile("int main() { int a; int i; a = 0; for (i = 0; i < 5; i = i + 1) a = a + i; return a; }"));
             Assert.AreEqual(5, Compile("int main() { int a; int i; a = 0; for (i = 1; a < 5;) a = a + i; return a; }"));
             Assert.AreEqual(10, Compile("int main() { int a; a = 0; for (; a < 10;) a = a + 1; return a; }"));
-            //TODO:breakを実装していないため、条件式を省略したら無限ループになってしまいテストができない
+            Assert.AreEqual(7, Compile("int main() { int a; a = 0; for (;;) { a = a + 1; if (a == 7) break; } return a; }"));
         }
 
         [TestMethod]
@@ -277,6 +277,7 @@ namespace TestProject
             Assert.AreEqual(52, Compile("int main() { return foo(10); } int foo(int a) { return a + 42; }"));
             Assert.AreEqual(13, Compile("int main() { return foo(2, 3); } int foo(int a, int b) { return (a * 5) + b; }"));
             Assert.AreEqual(32, Compile("int main() { return foo(1, 2, 3, 4); } int foo(int a, int b, int c, int d) { return (a * 5) + b - c + (d * 7); }"));
+            Assert.AreEqual(37, Compile("int f(int x) { return x * 2; } int g(int x) { return f(x) + 1; } int main() { return 10 + g(3) + 20; }"));
         }
 
         [TestMethod]
@@ -370,6 +371,79 @@ int main()
 }
 """));
         }
+
+        [TestMethod]
+        public void TestMethod27()
+        {
+            Assert.AreEqual(16, Compile("""
+#define N 4
+#define SQUARE(x) ((x) * (x))
+int main() { return SQUARE(N); }
+"""));
+            Assert.AreEqual(3, Compile("""
+#define ADD(a, b) ((a) + (b))
+#define CAT(a, b) a ## b
+int CAT(ma, in)() { return ADD(1, 2); }
+"""));
+            Assert.AreEqual(2, Compile("""
+#define LEVEL 2
+#if LEVEL == 1
+int main() { return 1; }
+#elif defined(LEVEL) && LEVEL * 2 == 4
+int main() { return 2; }
+#else
+int main() { return 3; }
+#endif
+"""));
+            Assert.AreEqual(36, Compile("""
+#define f(a) a*g
+#define g(a) f(a)
+int main() { int g; g = 2; return f(2)(9); }
+"""));
+        }
+
+        [TestMethod]
+        public void TestMethod28()
+        {
+            Assert.AreEqual(109, Compile("""
+int f(int x) { int r; r = 1; switch (x) { case 0: r = 3; break; case 1: r = 5; case 2: r = r + 7; break; case 3: case 4: r = 11; break; case 6: return 13; default: r = 17; } return r; }
+int main() { int i; int s; s = 0; for (i = -1; i < 8; i = i + 1) s = s + f(i); return s; }
+"""));
+            Assert.AreEqual(156, Compile("""
+int f(int x) { switch (x) { case -100: return 1; case 7: return 2; case 1000: return 3; case 70000: return 4; case -5: return 5; } return 6; }
+int main() { return f(-100) + f(7) * 10 + f(1000) * 20 + f(70000) + f(-5) + f(8) + f(-6) * 10; }
+"""));
+            Assert.AreEqual(155, Compile("int main() { int n; int i; n = 0; i = 0; while (1) { i = i + 1; switch (i) { case 1: n = n + 1; break; case 2: { switch (n) { case 1: n = n + 10; break; } break; } default: n = n + 100; } if (5 < i) break; } return n; }"));
+        }
+
+        [TestMethod]
+        public void TestMethod29()
+        {
+            Assert.AreEqual(5, Compile("int main() { return !0 + !5 * 2 + !!7 * 4; }"));
+            Assert.AreEqual(6, Compile("int main() { int a; a = 3; return (a && 0) + (a && 2) * 2 + (0 || a) * 4 + (0 || 0) * 8; }"));
+            Assert.AreEqual(40, Compile("""
+int n; int f(int x) { n = n + x; return x; }
+int main() { n = 0; if (f(0) && f(1)) n = n + 100; if (f(2) || f(4)) n = n + 10; if (!(f(0) || f(0)) && f(8)) n = n + 20; return n; }
+"""));
+            Assert.AreEqual(91, Compile("int main() { int i; int s; i = 0; s = 0; while (i < 10 && s < 20) { s = s + i; i = i + 1; } return i * 10 + s; }"));
+        }
+
+        [TestMethod]
+        public void TestMethod30()
+        {
+            Assert.AreEqual(184, Compile("int main() { int a; int b; a = 5; a += 3; a -= 1; a *= 4; a /= 2; b = a++; b = b * 10 + a--; return b + ++a + --a; }"));
+            Assert.AreEqual(105, Compile("int g; char c; int main() { g = 7; g *= 6; g /= 4; c = 100; c += 100; c++; return g * 10 + (c + 60); }"));
+            Assert.AreEqual(109, Compile("int a[5]; int main() { int *p; int i; for (i = 0; i < 5; i++) a[i] = i * 3; p = a; p += 2; p++; *p += 100; p -= 3; ++p; *p *= 5; return a[3] - a[1] + *p; }"));
+            Assert.AreEqual(157, Compile("int a[20]; int main() { int i; int s; int t; s = 0; t = 100; for (i = 0; i < 19; i++) a[i] = i * 2; for (i = 0; i < 19; ++i) { s += a[i]; t -= i; } return s - t; }"));
+        }
+
+        [TestMethod]
+        public void TestMethod31()
+        {
+            Assert.AreEqual(30, Compile("int main() { int a; a = 5; if (1) a = a + 10; else a = 99; if (0) a = 77; else a = a * 2; if (2 - 2) return 1; return a; }"));
+            Assert.AreEqual(23, Compile("int main() { int x; x = 0; switch (2) { case 1: x = 1; if (0) { case 2: x = 20; } x = x + 3; break; } return x; }"));
+            Assert.AreEqual(79, Compile("int main() { int r; r = 0; switch (7) { case 1: r = 1; break; case 7: r = 70; case 8: r = r + 8; break; default: r = 5; } switch (3) { case 1: r = 0; default: r = r + 1; } return r; }"));
+        }
     }
 
     [TestClass]
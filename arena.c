@@ -0,0 +1,77 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "thread.h"
+#include "error.h"
+
+// 1̃`N̊̑傫
+#define ARENA_CHUNK_SIZE    (64 * 1024)
+
+// mۂ̈̃ACg
+#define ARENA_ALIGN         (16)
+
+typedef struct ArenaChunk ArenaChunk;
+
+// A[i\郁̉
+struct ArenaChunk {
+    ArenaChunk* pNext;      // OɊmۂ`N
+    size_t size;            // mۂł̈̑傫
+    size_t used;            // mۍς݂̑傫
+    unsigned char* pData;   // mۂł̈̐擪iARENA_ALIGNɑĂj
+};
+
+// XbhƂ̃A[iiŌɊmۂ`Nj
+// ̃t@CɃRpCĂbNȂŊmۂł
+static THREAD_LOCAL ArenaChunk* s_pChunk;
+
+// ݂̃Xbh̃A[i[ꂽ̈mۂ
+// mۂ̈͌ʂɂ͉Aarena_release_allł܂Ƃ߂ĉ
+void* arena_calloc(size_t count, size_t size) {
+    const size_t len = (count * size + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+
+    if (s_pChunk == NULL || s_pChunk->size - s_pChunk->used < len) {
+        const size_t chunkSize = (len < ARENA_CHUNK_SIZE) ? ARENA_CHUNK_SIZE : len;
+        ArenaChunk* pChunk = malloc(sizeof(ArenaChunk) + ARENA_ALIGN + chunkSize);
+        if (pChunk == NULL) {
+            error("Internal Error. Out of memory.");
+        }
+        const uintptr_t dataAddr = (uintptr_t)(pChunk + 1);
+        pChunk->pData = (unsigned char*)((dataAddr + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN);
+        pChunk->pNext = s_pChunk;
+        pChunk->size = chunkSize;
+        pChunk->used = 0;
+        s_pChunk = pChunk;
+    }
+
+    void* p = s_pChunk->pData + s_pChunk->used;
+    s_pChunk->used += len;
+    memset(p, 0, len);
+    return p;
+}
+
+// ݂̃Xbh̃A[imۂ̈Sĉ
+void arena_release_all(void) {
+    const ArenaMark mark = { NULL, 0 };
+    arena_release_to(mark);
+}
+
+// ݂̃Xbh̃A[i̊mۈʒuԂ
+ArenaMark arena_mark(void) {
+    ArenaMark mark = { s_pChunk, s_pChunk ? s_pChunk->used : 0 };
+    return mark;
+}
+
+// ݂̃Xbh̃A[iAarena_markŎ擾ʒu܂Ŋ߂
+// ȍ~Ɋmۂ̈͑Sĉ
+void arena_release_to(ArenaMark mark) {
+    while (s_pChunk != mark.pChunk) {
+        ArenaChunk* pNext = s_pChunk->pNext;
+        free(s_pChunk);
+        s_pChunk = pNext;
+    }
+    if (s_pChunk) {
+        s_pChunk->used = mark.used;
+    }
+}
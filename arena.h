@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stddef.h>
+
+typedef struct ArenaMark ArenaMark;
+
+// A[i̊mۈʒuiarena_release_toŊ߂߂Ɏgj
+struct ArenaMark {
+    struct ArenaChunk* pChunk;  // ̎_ōŌɊmۂ`N
+    size_t used;                // ̃`N̊mۍς݂̑傫
+};
+
+// ݂̃Xbh̃A[i[ꂽ̈mۂ
+// mۂ̈͌ʂɂ͉Aarena_release_allł܂Ƃ߂ĉ
+void* arena_calloc(size_t count, size_t size);
+
+// ݂̃Xbh̃A[imۂ̈Sĉ
+void arena_release_all(void);
+
+// ݂̃Xbh̃A[i̊mۈʒuԂ
+ArenaMark arena_mark(void);
+
+// ݂̃Xbh̃A[iAarena_markŎ擾ʒu܂Ŋ߂
+// ȍ~Ɋmۂ̈͑Sĉ
+void arena_release_to(ArenaMark mark);
@@ -0,0 +1,1829 @@
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asm_encoder.h"
+#include "error.h"
+#include "strbuf.h"
+
+#define MAX_OPERANDS    (3)
+#define REG_NONE        (-1)
+#define REG_RIP         (16)
+
+typedef struct Operand Operand;
+typedef struct PendingRef PendingRef;
+typedef struct DebugLine DebugLine;
+typedef struct CfiInsn CfiInsn;
+typedef struct CfiProc CfiProc;
+typedef struct Assembler Assembler;
+
+// Iyh̎
+typedef enum {
+    OPD_NONE,   // IyhȂ
+    OPD_REG,    // WX^
+    OPD_IMM,    // l
+    OPD_MEM,    // Q
+    OPD_SYM,    // V{iWvEĂяoj
+} OperandKind;
+
+// ߂̃Iyh
+struct Operand {
+    OperandKind kind;       // Iyh̎
+    int size;               // TCYioCgAsȂ0j
+    int reg;                // OPD_REG̃WX^ԍ
+    int base;               // OPD_MEM̃x[XWX^ԍ
+    int index;              // OPD_MEM̃CfbNXWX^ԍ
+    int scale;              // OPD_MEM̃XP[
+    int64_t value;          // l܂̓fBXv[Xg
+    const char* sym;        // QƂV{iȂNULLj
+    int symLen;             // V{̒
+};
+
+// SĂ̍sIĂV{Q
+struct PendingRef {
+    int section;            // Qƌ̃ZNVԍ
+    size_t offset;          // ʒu
+    RelocKind kind;         // QƂ̎
+    int symbol;             // QƐV{̔ԍ
+    int64_t addend;         // 
+};
+
+// .locŎw肳ꂽ߂̈ʒuƃ\[X̍s̑Ή
+struct DebugLine {
+    int section;            // ߂̂ZNVԍ
+    size_t offset;          // ߂̈ʒu
+    int file;               // .fileŕtt@Cԍ
+    int line;               // sԍ
+};
+
+// .cfi_*Ŏw肳ꂽĂяot[̕ω
+struct CfiInsn {
+    size_t offset;          // ωʒuiO̖߂̒j
+    uint8_t bytes[12];      // Ăяot[߁iDW_CFA_*j
+    int len;                // Ăяot[߂̒
+};
+
+// .cfi_startproc.cfi_endproc܂ł͈̔
+struct CfiProc {
+    int section;            // ͈͂̂ZNVԍ
+    size_t start;           // ͈͂̐擪
+    size_t end;             // ͈̖͂
+    int firstInsn;          // ͈͓̍ŏ̌Ăяot[̕ὡԍ
+    int insnCount;          // ͈͓̌Ăяot[̕ω̐
+};
+
+// AZȕ
+struct Assembler {
+    ObjFile* pObj;          // o͐
+    int curSection;         // ݂̃ZNVԍ
+    PendingRef* pRefs;      // ̃V{Q
+    int refCount;           // ̃V{QƂ̐
+    int refCap;             // pRefs̊mۍςݗe
+    int* pSymHash;          // V{ԍnbV\i󂫂-1j
+    int symHashCap;         // nbV\̑傫i2̙pj
+    int symCap;             // V{\̊mۍςݗe
+    int lineNo;             // ̍sԍiG[\pj
+    char** ppDebugFiles;    // .filẽt@Cit@Cԍ-1̈ʒuj
+    int debugFileCount;     // .filẽt@C̐
+    int debugFileCap;       // ppDebugFiles̊mۍςݗe
+    DebugLine* pDebugLines; // .locŎw肳ꂽs̑Ήiw肳ꂽj
+    int debugLineCount;     // s̑Ή̐
+    int debugLineCap;       // pDebugLines̊mۍςݗe
+    CfiInsn* pCfiInsns;     // Ăяot[̕ωiw肳ꂽj
+    int cfiInsnCount;       // Ăяot[̕ω̐
+    int cfiInsnCap;         // pCfiInsns̊mۍςݗe
+    CfiProc* pCfiProcs;     // .cfi_startproc.cfi_endproc܂ł͈̔
+    int cfiProcCount;       // ͈͂̐
+    int cfiProcCap;         // pCfiProcs̊mۍςݗe
+    bool isInCfiProc;       // .cfi_startproc.cfi_endproc܂ł̊ԂȂtrue
+};
+
+static const struct {
+    const char* name;
+    int num;
+    int size;
+} REGISTERS[] = {
+    { "rax",  0, 8 }, { "rcx",  1, 8 }, { "rdx",  2, 8 }, { "rbx",  3, 8 },
+    { "rsp",  4, 8 }, { "rbp",  5, 8 }, { "rsi",  6, 8 }, { "rdi",  7, 8 },
+    { "r8",   8, 8 }, { "r9",   9, 8 }, { "r10", 10, 8 }, { "r11", 11, 8 },
+    { "r12", 12, 8 }, { "r13", 13, 8 }, { "r14", 14, 8 }, { "r15", 15, 8 },
+    { "eax",  0, 4 }, { "ecx",  1, 4 }, { "edx",  2, 4 }, { "ebx",  3, 4 },
+    { "esp",  4, 4 }, { "ebp",  5, 4 }, { "esi",  6, 4 }, { "edi",  7, 4 },
+    { "r8d",  8, 4 }, { "r9d",  9, 4 }, { "r10d",10, 4 }, { "r11d",11, 4 },
+    { "r12d",12, 4 }, { "r13d",13, 4 }, { "r14d",14, 4 }, { "r15d",15, 4 },
+    { "ax",   0, 2 }, { "cx",   1, 2 }, { "dx",   2, 2 }, { "bx",   3, 2 },
+    { "sp",   4, 2 }, { "bp",   5, 2 }, { "si",   6, 2 }, { "di",   7, 2 },
+    { "r8w",  8, 2 }, { "r9w",  9, 2 }, { "r10w",10, 2 }, { "r11w",11, 2 },
+    { "r12w",12, 2 }, { "r13w",13, 2 }, { "r14w",14, 2 }, { "r15w",15, 2 },
+    { "al",   0, 1 }, { "cl",   1, 1 }, { "dl",   2, 1 }, { "bl",   3, 1 },
+    { "spl",  4, 1 }, { "bpl",  5, 1 }, { "sil",  6, 1 }, { "dil",  7, 1 },
+    { "r8b",  8, 1 }, { "r9b",  9, 1 }, { "r10b",10, 1 }, { "r11b",11, 1 },
+    { "r12b",12, 1 }, { "r13b",13, 1 }, { "r14b",14, 1 }, { "r15b",15, 1 },
+    { "rip", REG_RIP, 8 },
+    { "xmm0",  0, 16 }, { "xmm1",  1, 16 }, { "xmm2",  2, 16 }, { "xmm3",  3, 16 },
+    { "xmm4",  4, 16 }, { "xmm5",  5, 16 }, { "xmm6",  6, 16 }, { "xmm7",  7, 16 },
+    { "xmm8",  8, 16 }, { "xmm9",  9, 16 }, { "xmm10",10, 16 }, { "xmm11",11, 16 },
+    { "xmm12",12, 16 }, { "xmm13",13, 16 }, { "xmm14",14, 16 }, { "xmm15",15, 16 },
+};
+
+// R[hijccEsetcc̖j
+static const struct {
+    const char* name;
+    int code;
+} CONDITION_CODES[] = {
+    { "o",  0 }, { "no", 1 }, { "b",  2 }, { "c",  2 }, { "nae", 2 },
+    { "ae", 3 }, { "nb", 3 }, { "nc", 3 }, { "e",  4 }, { "z",  4 },
+    { "ne", 5 }, { "nz", 5 }, { "be", 6 }, { "na", 6 }, { "a",  7 },
+    { "nbe",7 }, { "s",  8 }, { "ns", 9 }, { "p", 10 }, { "pe",10 },
+    { "np",11 }, { "po",11 }, { "l", 12 }, { "nge",12}, { "ge",13 },
+    { "nl",13 }, { "le",14 }, { "ng",14 }, { "g", 15 }, { "nle",15},
+};
+
+// ALU߁iModR/MregtB[hɓԍj
+static const struct {
+    const char* name;
+    int digit;
+} ALU_INSTRUCTIONS[] = {
+    { "add", 0 }, { "or",  1 }, { "adc", 2 }, { "sbb", 3 },
+    { "and", 4 }, { "sub", 5 }, { "xor", 6 }, { "cmp", 7 },
+};
+
+// PF6/F7n߁iModR/MregtB[hɓԍj
+static const struct {
+    const char* name;
+    int digit;
+} UNARY_INSTRUCTIONS[] = {
+    { "not", 2 }, { "neg", 3 }, { "mul", 4 }, { "div", 6 }, { "idiv", 7 },
+};
+
+// Vtg߁iModR/MregtB[hɓԍj
+static const struct {
+    const char* name;
+    int digit;
+} SHIFT_INSTRUCTIONS[] = {
+    { "shl", 4 }, { "sal", 4 }, { "shr", 5 }, { "sar", 7 },
+};
+
+// SSE2̐Z߁ixmmWX^, xmmWX^/j
+static const struct {
+    const char* name;
+    int prefix;     // K{vtBbNX
+    int opcode;     // 0x0FɑIyR[h
+} SSE_INSTRUCTIONS[] = {
+    { "movdqa",    0x66, 0x6F }, { "movdqu",    0xF3, 0x6F },
+    { "paddd",     0x66, 0xFE }, { "psubd",     0x66, 0xFA }, { "pmuludq",   0x66, 0xF4 },
+    { "pand",      0x66, 0xDB }, { "por",       0x66, 0xEB }, { "pxor",      0x66, 0xEF },
+    { "pcmpeqd",   0x66, 0x76 }, { "pcmpgtd",   0x66, 0x66 },
+    { "punpcklbw", 0x66, 0x60 }, { "punpcklwd", 0x66, 0x61 }, { "punpckldq", 0x66, 0x62 },
+    { "packssdw",  0x66, 0x6B }, { "packuswb",  0x66, 0x67 },
+};
+
+// SSE2̑lɂVtg߁i66 0F IyR[h /digit ibj
+static const struct {
+    const char* name;
+    int opcode;
+    int digit;
+} SSE_SHIFT_INSTRUCTIONS[] = {
+    { "psrld", 0x72, 2 }, { "psrad", 0x72, 4 }, { "pslld", 0x72, 6 },
+    { "psrlq", 0x73, 2 }, { "psllq", 0x73, 6 },
+};
+
+static void asm_error(const Assembler* pAsm, const char* fmt, ...) {
+    StrBuf message = { 0 };
+    va_list ap;
+    va_start(ap, fmt);
+    strbuf_vprintf(&message, fmt, ap);
+    va_end(ap);
+    error("Internal Error. asm line %d: %s", pAsm->lineNo, message.data);
+}
+
+static void* grow_array(void* pArray, int* pCap, int needCount, size_t elemSize) {
+    if (needCount <= *pCap) {
+        return pArray;
+    }
+
+    int newCap = *pCap ? *pCap : 16;
+    while (newCap < needCount) {
+        newCap *= 2;
+    }
+    pArray = realloc(pArray, newCap * elemSize);
+    if (pArray == NULL) {
+        error("Internal Error. Out of memory.");
+    }
+    *pCap = newCap;
+    return pArray;
+}
+
+static unsigned int hash_name(const char* name, int len) {
+    // FNV-1a
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < len; ++i) {
+        hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void rehash_symbols(Assembler* pAsm, int newCap) {
+    free(pAsm->pSymHash);
+    pAsm->pSymHash = malloc(newCap * sizeof(int));
+    pAsm->symHashCap = newCap;
+    for (int i = 0; i < newCap; ++i) {
+        pAsm->pSymHash[i] = -1;
+    }
+
+    for (int i = 0; i < pAsm->pObj->symbolCount; ++i) {
+        const ObjSymbol* pSym = &pAsm->pObj->pSymbols[i];
+        unsigned int pos = hash_name(pSym->name, (int)strlen(pSym->name)) & (newCap - 1);
+        while (pAsm->pSymHash[pos] != -1) {
+            pos = (pos + 1) & (newCap - 1);
+        }
+        pAsm->pSymHash[pos] = i;
+    }
+}
+
+// V{𖼑OŌA̔ԍԂBȂΖ`V{ƂĒǉB
+static int get_symbol(Assembler* pAsm, const char* name, int len) {
+    ObjFile* pObj = pAsm->pObj;
+
+    unsigned int pos = hash_name(name, len) & (pAsm->symHashCap - 1);
+    for (; pAsm->pSymHash[pos] != -1; pos = (pos + 1) & (pAsm->symHashCap - 1)) {
+        const ObjSymbol* pSym = &pObj->pSymbols[pAsm->pSymHash[pos]];
+        if (strncmp(pSym->name, name, len) == 0 && pSym->name[len] == '\0') {
+            return pAsm->pSymHash[pos];
+        }
+    }
+
+    pObj->pSymbols = grow_array(pObj->pSymbols, &pAsm->symCap, pObj->symbolCount + 1, sizeof(ObjSymbol));
+    ObjSymbol* pSym = &pObj->pSymbols[pObj->symbolCount];
+    memset(pSym, 0, sizeof(ObjSymbol));
+    pSym->name = calloc(len + 1, sizeof(char));
+    memcpy(pSym->name, name, len);
+    pSym->section = -1;
+    pAsm->pSymHash[pos] = pObj->symbolCount++;
+
+    // ח1/2𒴂\L
+    if (pAsm->symHashCap < pObj->symbolCount * 2) {
+        rehash_symbols(pAsm, pAsm->symHashCap * 2);
+    }
+    return pObj->symbolCount - 1;
+}
+
+// ZNV𖼑OŌA̔ԍԂBȂΒǉB
+static int get_section(Assembler* pAsm, const char* name, int len, unsigned int flags, bool isNoBits, size_t entSize) {
+    ObjFile* pObj = pAsm->pObj;
+
+    for (int i = 0; i < pObj->sectionCount; ++i) {
+        if (strncmp(pObj->pSections[i].name, name, len) == 0 && pObj->pSections[i].name[len] == '\0') {
+            return i;
+        }
+    }
+
+    pObj->pSections = realloc(pObj->pSections, (pObj->sectionCount + 1) * sizeof(ObjSection));
+    ObjSection* pSection = &pObj->pSections[pObj->sectionCount];
+    memset(pSection, 0, sizeof(ObjSection));
+    pSection->name = calloc(len + 1, sizeof(char));
+    memcpy(pSection->name, name, len);
+    pSection->flags = flags;
+    pSection->isNoBits = isNoBits;
+    pSection->align = 1;
+    pSection->entSize = entSize;
+    return pObj->sectionCount++;
+}
+
+static ObjSection* cur_section(Assembler* pAsm) {
+    return &pAsm->pObj->pSections[pAsm->curSection];
+}
+
+static void emit_bytes(Assembler* pAsm, const void* pBytes, size_t len) {
+    ObjSection* pSection = cur_section(pAsm);
+    if (pSection->isNoBits) {
+        asm_error(pAsm, "section '%s' cannot have contents", pSection->name);
+    }
+
+    if (pSection->cap < pSection->size + len) {
+        size_t newCap = pSection->cap ? pSection->cap : 256;
+        while (newCap < pSection->size + len) {
+            newCap *= 2;
+        }
+        pSection->data = realloc(pSection->data, newCap);
+        pSection->cap = newCap;
+    }
+    memcpy(pSection->data + pSection->size, pBytes, len);
+    pSection->size += len;
+}
+
+static void emit_byte(Assembler* pAsm, int b) {
+    uint8_t byte = (uint8_t)b;
+    emit_bytes(pAsm, &byte, 1);
+}
+
+// lgGfBAsizeoCgo͂
+static void emit_value(Assembler* pAsm, int64_t value, int size) {
+    uint8_t bytes[8];
+    for (int i = 0; i < size; ++i) {
+        bytes[i] = (uint8_t)(value >> (i * 8));
+    }
+    emit_bytes(pAsm, bytes, size);
+}
+
+// ݈ʒuɃV{QƂL^Ä̗̕i4oCgjmۂ
+static void emit_symbol_ref(Assembler* pAsm, RelocKind kind, const char* sym, int symLen, int64_t addend) {
+    pAsm->pRefs = grow_array(pAsm->pRefs, &pAsm->refCap, pAsm->refCount + 1, sizeof(PendingRef));
+    PendingRef* pRef = &pAsm->pRefs[pAsm->refCount++];
+    pRef->section = pAsm->curSection;
+    pRef->offset = cur_section(pAsm)->size;
+    pRef->kind = kind;
+    pRef->symbol = get_symbol(pAsm, sym, symLen);
+    pRef->addend = addend;
+
+    emit_value(pAsm, 0, kind == RELOC_ABS64 ? 8 : 4);
+}
+
+// lULEB128ŏ݁A̒Ԃ
+static int put_uleb128(uint8_t* p, uint64_t value) {
+    int len = 0;
+    do {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        if (value) byte |= 0x80;
+        p[len++] = byte;
+    } while (value);
+    return len;
+}
+
+// lSLEB128ŏ݁A̒Ԃ
+static int put_sleb128(uint8_t* p, int64_t value) {
+    int len = 0;
+    for (;;) {
+        const uint8_t byte = value & 0x7F;
+        value >>= 7;
+        if ((value == 0 && !(byte & 0x40)) || (value == -1 && (byte & 0x40))) {
+            p[len++] = byte;
+            return len;
+        }
+        p[len++] = byte | 0x80;
+    }
+}
+
+static void emit_uleb128(Assembler* pAsm, uint64_t value) {
+    uint8_t bytes[10];
+    emit_bytes(pAsm, bytes, put_uleb128(bytes, value));
+}
+
+static void emit_sleb128(Assembler* pAsm, int64_t value) {
+    uint8_t bytes[10];
+    emit_bytes(pAsm, bytes, put_sleb128(bytes, value));
+}
+
+// o͍ς݂̈ʒuɒlgGfBAsizeoCgށiȂǂォ疄߂j
+static void patch_value(Assembler* pAsm, size_t offset, int64_t value, int size) {
+    for (int i = 0; i < size; ++i) {
+        cur_section(pAsm)->data[offset + i] = (uint8_t)(value >> (i * 8));
+    }
+}
+
+// ݈ʒuɃZNV̐擪offseẗʒuւ̎QƂL^
+static void emit_section_ref(Assembler* pAsm, RelocKind kind, int section, size_t offset) {
+    // ZNV̐擪Ƀ[JxuAQƂiIuWFNgł̓ZNVV{̎QƂɂȂj
+    char name[32];
+    const int len = snprintf(name, sizeof(name), ".Lsection%d", section);
+    // get_symbol͋L\L邱Ƃ̂ŁAĂяoĂ\̗vfw
+    const int symbol = get_symbol(pAsm, name, len);
+    ObjSymbol* pSym = &pAsm->pObj->pSymbols[symbol];
+    pSym->section = section;
+    pSym->offset = 0;
+    emit_symbol_ref(pAsm, kind, name, len, (int64_t)offset);
+}
+
+static bool fits_int8(int64_t value) {
+    return -128 <= value && value <= 127;
+}
+
+static bool fits_int32(int64_t value) {
+    return INT32_MIN <= value && value <= INT32_MAX;
+}
+
+// REXvtBbNXtȂAHƉ߂Ă܂8rbgWX^
+static bool needs_rex_for_byte(const Operand* pOpd) {
+    return pOpd && pOpd->kind == OPD_REG && pOpd->size == 1 && 4 <= pOpd->reg && pOpd->reg <= 7;
+}
+
+// ModR/M𔺂߂o͂
+//     prefix   : K{vtBbNXiȂ0j
+//     opSize   : IyhTCYi2ȂIyhTCYvtBbNXA8ȂREX.Wj
+//     pReg     : regtB[hɓ郌WX^iNULLȂdigitj
+//     pRM      : r/mtB[hɓIyh
+//     immSize  : ߂̌ɑl̃oCgiRIP΂̕␳Ɏgj
+static void encode_modrm(Assembler* pAsm, int prefix, int opSize, const uint8_t* opcode, int opcodeLen, const Operand* pReg, int digit, const Operand* pRM, int immSize) {
+    const int regField = pReg ? pReg->reg : digit;
+    int rex = 0;
+
+    if (opSize == 8) rex |= 0x48;
+    if (regField & 8) rex |= 0x44;
+    if (needs_rex_for_byte(pReg) || needs_rex_for_byte(pRM)) rex |= 0x40;
+    if (pRM->kind == OPD_REG) {
+        if (pRM->reg & 8) rex |= 0x41;
+    }
+    else {
+        if (pRM->base != REG_NONE && pRM->base != REG_RIP && (pRM->base & 8)) rex |= 0x41;
+        if (pRM->index != REG_NONE && (pRM->index & 8)) rex |= 0x42;
+    }
+
+    if (opSize == 2) emit_byte(pAsm, 0x66);
+    if (prefix) emit_byte(pAsm, prefix);
+    if (rex) emit_byte(pAsm, rex);
+    emit_bytes(pAsm, opcode, opcodeLen);
+
+    if (pRM->kind == OPD_REG) {
+        emit_byte(pAsm, 0xC0 | ((regField & 7) << 3) | (pRM->reg & 7));
+        return;
+    }
+    if (pRM->kind != OPD_MEM) {
+        asm_error(pAsm, "invalid operand");
+    }
+
+    // RIP
+    if (pRM->base == REG_RIP) {
+        emit_byte(pAsm, 0x05 | ((regField & 7) << 3));
+        if (pRM->sym) {
+            // fBXv[Xǧɑlꍇ́A̕߂̈ʒu
+            emit_symbol_ref(pAsm, RELOC_PC32, pRM->sym, pRM->symLen, pRM->value - 4 - immSize);
+        }
+        else {
+            emit_value(pAsm, pRM->value, 4);
+        }
+        return;
+    }
+    if (pRM->sym) {
+        asm_error(pAsm, "absolute symbol reference is not supported");
+    }
+
+    int scaleBits = 0;
+    switch (pRM->scale) {
+    case 1: scaleBits = 0; break;
+    case 2: scaleBits = 1; break;
+    case 4: scaleBits = 2; break;
+    case 8: scaleBits = 3; break;
+    default: asm_error(pAsm, "invalid scale %d", pRM->scale);
+    }
+
+    // x[XWX^ȂifBXv[Xĝ݁j
+    if (pRM->base == REG_NONE) {
+        emit_byte(pAsm, 0x04 | ((regField & 7) << 3));
+        emit_byte(pAsm, (scaleBits << 6) | (((pRM->index != REG_NONE) ? pRM->index : 4) & 7) << 3 | 5);
+        emit_value(pAsm, pRM->value, 4);
+        return;
+    }
+
+    int mod;
+    if (pRM->value == 0 && (pRM->base & 7) != 5) {
+        mod = 0;
+    }
+    else if (fits_int8(pRM->value)) {
+        mod = 1;
+    }
+    else {
+        mod = 2;
+    }
+
+    // rspEr12x[XɂꍇƃCfbNXꍇSIBKv
+    if (pRM->index != REG_NONE || (pRM->base & 7) == 4) {
+        emit_byte(pAsm, (mod << 6) | ((regField & 7) << 3) | 4);
+        emit_byte(pAsm, (scaleBits << 6) | (((pRM->index != REG_NONE) ? pRM->index : 4) & 7) << 3 | (pRM->base & 7));
+    }
+    else {
+        emit_byte(pAsm, (mod << 6) | ((regField & 7) << 3) | (pRM->base & 7));
+    }
+
+    if (mod == 1) {
+        emit_value(pAsm, pRM->value, 1);
+    }
+    else if (mod == 2) {
+        emit_value(pAsm, pRM->value, 4);
+    }
+}
+
+static void encode_modrm1(Assembler* pAsm, int opSize, int opcode, const Operand* pReg, int digit, const Operand* pRM, int immSize) {
+    uint8_t op = (uint8_t)opcode;
+    encode_modrm(pAsm, 0, opSize, &op, 1, pReg, digit, pRM, immSize);
+}
+
+static void encode_modrm2(Assembler* pAsm, int opSize, int opcode1, int opcode2, const Operand* pReg, int digit, const Operand* pRM, int immSize) {
+    uint8_t op[2] = { (uint8_t)opcode1, (uint8_t)opcode2 };
+    encode_modrm(pAsm, 0, opSize, op, 2, pReg, digit, pRM, immSize);
+}
+
+static int find_register(const char* name, int len, int* pSize) {
+    for (int i = 0; i < sizeof(REGISTERS) / sizeof(REGISTERS[0]); ++i) {
+        if (strncmp(REGISTERS[i].name, name, len) == 0 && REGISTERS[i].name[len] == '\0') {
+            *pSize = REGISTERS[i].size;
+            return REGISTERS[i].num;
+        }
+    }
+    return REG_NONE;
+}
+
+static int find_condition_code(const char* name) {
+    for (int i = 0; i < sizeof(CONDITION_CODES) / sizeof(CONDITION_CODES[0]); ++i) {
+        if (strcmp(CONDITION_CODES[i].name, name) == 0) {
+            return CONDITION_CODES[i].code;
+        }
+    }
+    return -1;
+}
+
+static bool is_symbol_char(char c) {
+    return isalnum((unsigned char)c) || c == '_' || c == '.' || c == '$';
+}
+
+static char* skip_space(char* p) {
+    while (*p == ' ' || *p == '\t') p++;
+    return p;
+}
+
+static void trim_right(char* p) {
+    char* end = p + strlen(p);
+    while (p < end && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) {
+        *--end = '\0';
+    }
+}
+
+// QƂ̊ʓi"rbp-8""rdi+rax*4"Ȃǁj͂
+static void parse_mem_terms(Assembler* pAsm, char* p, Operand* pOpd) {
+    int sign = 1;
+
+    for (;;) {
+        p = skip_space(p);
+        if (*p == '\0') break;
+
+        if (*p == '+' || *p == '-') {
+            sign = (*p == '-') ? -1 : 1;
+            p++;
+            continue;
+        }
+
+        if (isdigit((unsigned char)*p)) {
+            char* pEnd;
+            pOpd->value += sign * strtoll(p, &pEnd, 0);
+            p = pEnd;
+            continue;
+        }
+
+        char* pStart = p;
+        while (is_symbol_char(*p)) p++;
+        if (p == pStart) {
+            asm_error(pAsm, "invalid memory operand");
+        }
+
+        int size;
+        int reg = find_register(pStart, (int)(p - pStart), &size);
+        if (reg == REG_NONE) {
+            pOpd->sym = pStart;
+            pOpd->symLen = (int)(p - pStart);
+            continue;
+        }
+
+        p = skip_space(p);
+        if (*p == '*') {
+            p++;
+            pOpd->index = reg;
+            pOpd->scale = (int)strtol(p, &p, 10);
+        }
+        else if (pOpd->base == REG_NONE) {
+            pOpd->base = reg;
+        }
+        else {
+            pOpd->index = reg;
+        }
+    }
+}
+
+static void parse_operand(Assembler* pAsm, char* p, Operand* pOpd) {
+    static const struct {
+        const char* prefix;
+        int size;
+    } PTR_PREFIXES[] = {
+        { "BYTE PTR", 1 }, { "WORD PTR", 2 }, { "DWORD PTR", 4 }, { "QWORD PTR", 8 }, { "XMMWORD PTR", 16 },
+    };
+
+    memset(pOpd, 0, sizeof(Operand));
+    pOpd->base = REG_NONE;
+    pOpd->index = REG_NONE;
+    pOpd->scale = 1;
+
+    p = skip_space(p);
+    trim_right(p);
+
+    for (int i = 0; i < sizeof(PTR_PREFIXES) / sizeof(PTR_PREFIXES[0]); ++i) {
+        size_t len = strlen(PTR_PREFIXES[i].prefix);
+        if (strncmp(p, PTR_PREFIXES[i].prefix, len) == 0) {
+            pOpd->size = PTR_PREFIXES[i].size;
+            p = skip_space(p + len);
+            break;
+        }
+    }
+
+    char* pBracket = strchr(p, '[');
+    if (pBracket) {
+        char* pClose = strchr(pBracket, ']');
+        if (!pClose) {
+            asm_error(pAsm, "']' is missing");
+        }
+        *pBracket = '\0';
+        *pClose = '\0';
+        pOpd->kind = OPD_MEM;
+        parse_mem_terms(pAsm, p, pOpd);
+        parse_mem_terms(pAsm, pBracket + 1, pOpd);
+        return;
+    }
+
+    if (pOpd->size) {
+        asm_error(pAsm, "'PTR' requires memory operand");
+    }
+
+    int size;
+    int reg = find_register(p, (int)strlen(p), &size);
+    if (reg != REG_NONE) {
+        pOpd->kind = OPD_REG;
+        pOpd->reg = reg;
+        pOpd->size = size;
+        return;
+    }
+
+    if (isdigit((unsigned char)*p) || (*p == '-' && isdigit((unsigned char)p[1]))) {
+        char* pEnd;
+        pOpd->kind = OPD_IMM;
+        pOpd->value = strtoll(p, &pEnd, 0);
+        if (*skip_space(pEnd) != '\0') {
+            asm_error(pAsm, "invalid immediate '%s'", p);
+        }
+        return;
+    }
+
+    char* pEnd = p;
+    while (is_symbol_char(*pEnd)) pEnd++;
+    if (pEnd == p || *skip_space(pEnd) != '\0') {
+        asm_error(pAsm, "invalid operand '%s'", p);
+    }
+    pOpd->kind = OPD_SYM;
+    pOpd->sym = p;
+    pOpd->symLen = (int)(pEnd - p);
+}
+
+// Iyh̃TCY߂BQƂŃTCYw肪ȂΑ̃Iyhɍ킹B
+static int operand_size(Assembler* pAsm, const Operand* pDst, const Operand* pSrc) {
+    if (pDst->size) {
+        if (pSrc && pSrc->kind == OPD_REG && pSrc->size != pDst->size) {
+            asm_error(pAsm, "operand size mismatch");
+        }
+        return pDst->size;
+    }
+    if (pSrc && pSrc->size) {
+        return pSrc->size;
+    }
+    asm_error(pAsm, "operand size is unknown");
+    return 0;
+}
+
+static void encode_alu(Assembler* pAsm, int digit, const Operand* pDst, const Operand* pSrc) {
+    const int size = operand_size(pAsm, pDst, (pSrc->kind == OPD_IMM) ? NULL : pSrc);
+
+    if (pSrc->kind == OPD_IMM) {
+        if (size == 1) {
+            encode_modrm1(pAsm, size, 0x80, NULL, digit, pDst, 1);
+            emit_value(pAsm, pSrc->value, 1);
+        }
+        else if (fits_int8(pSrc->value)) {
+            encode_modrm1(pAsm, size, 0x83, NULL, digit, pDst, 1);
+            emit_value(pAsm, pSrc->value, 1);
+        }
+        else {
+            const int immSize = (size == 2) ? 2 : 4;
+            encode_modrm1(pAsm, size, 0x81, NULL, digit, pDst, immSize);
+            emit_value(pAsm, pSrc->value, immSize);
+        }
+    }
+    else if (pSrc->kind == OPD_REG) {
+        encode_modrm1(pAsm, size, digit * 8 + ((size == 1) ? 0 : 1), pSrc, 0, pDst, 0);
+    }
+    else if (pDst->kind == OPD_REG && pSrc->kind == OPD_MEM) {
+        encode_modrm1(pAsm, size, digit * 8 + ((size == 1) ? 2 : 3), pDst, 0, pSrc, 0);
+    }
+    else {
+        asm_error(pAsm, "invalid operands");
+    }
+}
+
+static void encode_mov(Assembler* pAsm, const Operand* pDst, const Operand* pSrc) {
+    if (pSrc->kind == OPD_IMM) {
+        const int size = operand_size(pAsm, pDst, NULL);
+        if (size == 8 && !fits_int32(pSrc->value)) {
+            if (pDst->kind != OPD_REG) {
+                asm_error(pAsm, "64-bit immediate requires register operand");
+            }
+            emit_byte(pAsm, 0x48 | ((pDst->reg & 8) ? 1 : 0));
+            emit_byte(pAsm, 0xB8 + (pDst->reg & 7));
+            emit_value(pAsm, pSrc->value, 8);
+            return;
+        }
+
+        const int immSize = (size == 8) ? 4 : size;
+        encode_modrm1(pAsm, size, (size == 1) ? 0xC6 : 0xC7, NULL, 0, pDst, immSize);
+        emit_value(pAsm, pSrc->value, immSize);
+    }
+    else if (pSrc->kind == OPD_REG) {
+        const int size = operand_size(pAsm, pDst, pSrc);
+        encode_modrm1(pAsm, size, (size == 1) ? 0x88 : 0x89, pSrc, 0, pDst, 0);
+    }
+    else if (pDst->kind == OPD_REG && pSrc->kind == OPD_MEM) {
+        const int size = operand_size(pAsm, pDst, NULL);
+        encode_modrm1(pAsm, size, (size == 1) ? 0x8A : 0x8B, pDst, 0, pSrc, 0);
+    }
+    else {
+        asm_error(pAsm, "invalid operands");
+    }
+}
+
+// movsxEmovzximovzbmovzx̕ʖj
+static void encode_movx(Assembler* pAsm, bool isSigned, const Operand* pDst, const Operand* pSrc) {
+    if (pDst->kind != OPD_REG || (pSrc->kind != OPD_REG && pSrc->kind != OPD_MEM)) {
+        asm_error(pAsm, "invalid operands");
+    }
+
+    switch (pSrc->size) {
+    case 1:
+        encode_modrm2(pAsm, pDst->size, 0x0F, isSigned ? 0xBE : 0xB6, pDst, 0, pSrc, 0);
+        break;
+    case 2:
+        encode_modrm2(pAsm, pDst->size, 0x0F, isSigned ? 0xBF : 0xB7, pDst, 0, pSrc, 0);
+        break;
+    case 4:
+        if (!isSigned || pDst->size != 8) {
+            asm_error(pAsm, "invalid operand size");
+        }
+        // movsxd
+        encode_modrm1(pAsm, 8, 0x63, pDst, 0, pSrc, 0);
+        break;
+    default:
+        asm_error(pAsm, "operand size is unknown");
+    }
+}
+
+static void encode_imul(Assembler* pAsm, const Operand* pOpds, int opdCount) {
+    if (opdCount == 1) {
+        encode_modrm1(pAsm, operand_size(pAsm, &pOpds[0], NULL), 0xF7, NULL, 5, &pOpds[0], 0);
+        return;
+    }
+
+    const Operand* pDst = &pOpds[0];
+    const Operand* pSrc = (opdCount == 3 || pOpds[1].kind != OPD_IMM) ? &pOpds[1] : &pOpds[0];
+    const Operand* pImm = (opdCount == 3) ? &pOpds[2] : ((pOpds[1].kind == OPD_IMM) ? &pOpds[1] : NULL);
+
+    if (pDst->kind != OPD_REG) {
+        asm_error(pAsm, "invalid operands");
+    }
+
+    if (pImm == NULL) {
+        encode_modrm2(pAsm, pDst->size, 0x0F, 0xAF, pDst, 0, pSrc, 0);
+    }
+    else if (fits_int8(pImm->value)) {
+        encode_modrm1(pAsm, pDst->size, 0x6B, pDst, 0, pSrc, 1);
+        emit_value(pAsm, pImm->value, 1);
+    }
+    else {
+        const int immSize = (pDst->size == 2) ? 2 : 4;
+        encode_modrm1(pAsm, pDst->size, 0x69, pDst, 0, pSrc, immSize);
+        emit_value(pAsm, pImm->value, immSize);
+    }
+}
+
+static void encode_shift(Assembler* pAsm, int digit, const Operand* pDst, const Operand* pSrc) {
+    const int size = operand_size(pAsm, pDst, NULL);
+
+    if (pSrc->kind == OPD_REG && pSrc->reg == 1 && pSrc->size == 1) {
+        encode_modrm1(pAsm, size, (size == 1) ? 0xD2 : 0xD3, NULL, digit, pDst, 0);
+    }
+    else if (pSrc->kind == OPD_IMM && pSrc->value == 1) {
+        encode_modrm1(pAsm, size, (size == 1) ? 0xD0 : 0xD1, NULL, digit, pDst, 0);
+    }
+    else if (pSrc->kind == OPD_IMM) {
+        encode_modrm1(pAsm, size, (size == 1) ? 0xC0 : 0xC1, NULL, digit, pDst, 1);
+        emit_value(pAsm, pSrc->value, 1);
+    }
+    else {
+        asm_error(pAsm, "invalid operands");
+    }
+}
+
+static void encode_push_pop(Assembler* pAsm, bool isPush, const Operand* pOpd) {
+    switch (pOpd->kind) {
+    case OPD_REG:
+        if (pOpd->size != 8) {
+            asm_error(pAsm, "invalid operand size");
+        }
+        if (pOpd->reg & 8) emit_byte(pAsm, 0x41);
+        emit_byte(pAsm, (isPush ? 0x50 : 0x58) + (pOpd->reg & 7));
+        break;
+    case OPD_IMM:
+        if (!isPush) {
+            asm_error(pAsm, "invalid operands");
+        }
+        if (fits_int8(pOpd->value)) {
+            emit_byte(pAsm, 0x6A);
+            emit_value(pAsm, pOpd->value, 1);
+        }
+        else {
+            emit_byte(pAsm, 0x68);
+            emit_value(pAsm, pOpd->value, 4);
+        }
+        break;
+    case OPD_MEM:
+        // push/pop̃Iyh͊64rbg
+        encode_modrm1(pAsm, 0, isPush ? 0xFF : 0x8F, NULL, isPush ? 6 : 0, pOpd, 0);
+        break;
+    default:
+        asm_error(pAsm, "invalid operands");
+    }
+}
+
+// jmpEjccEcall
+//     xւ̕͏rel32ŕ
+static void encode_branch(Assembler* pAsm, const char* mnemonic, int cc, const Operand* pOpd) {
+    const bool isCall = strcmp(mnemonic, "call") == 0;
+
+    if (pOpd->kind == OPD_SYM) {
+        if (isCall) {
+            emit_byte(pAsm, 0xE8);
+            emit_symbol_ref(pAsm, RELOC_PLT32, pOpd->sym, pOpd->symLen, -4);
+        }
+        else if (cc < 0) {
+            emit_byte(pAsm, 0xE9);
+            emit_symbol_ref(pAsm, RELOC_PC32, pOpd->sym, pOpd->symLen, -4);
+        }
+        else {
+            emit_byte(pAsm, 0x0F);
+            emit_byte(pAsm, 0x80 + cc);
+            emit_symbol_ref(pAsm, RELOC_PC32, pOpd->sym, pOpd->symLen, -4);
+        }
+        return;
+    }
+
+    if (cc >= 0 || (pOpd->kind != OPD_REG && pOpd->kind != OPD_MEM)) {
+        asm_error(pAsm, "invalid operands");
+    }
+    // Ԑڕi64rbgj
+    encode_modrm1(pAsm, 0, 0xFF, NULL, isCall ? 2 : 4, pOpd, 0);
+}
+
+static bool match_name(const char* mnemonic, const char* name) {
+    return strcmp(mnemonic, name) == 0;
+}
+
+static bool is_xmm(const Operand* pOpd) {
+    return pOpd->kind == OPD_REG && pOpd->size == 16;
+}
+
+// SSE2̖߂o͂iSSE2̖߂łȂfalseԂj
+static bool encode_sse(Assembler* pAsm, const char* mnemonic, const Operand* pOpds, int opdCount) {
+    if (opdCount < 2) return false;
+    const Operand* pDst = &pOpds[0];
+    const Operand* pSrc = &pOpds[1];
+
+    for (int i = 0; i < sizeof(SSE_INSTRUCTIONS) / sizeof(SSE_INSTRUCTIONS[0]); ++i) {
+        if (!match_name(mnemonic, SSE_INSTRUCTIONS[i].name) || opdCount != 2) continue;
+
+        uint8_t opcode[2] = { 0x0F, (uint8_t)SSE_INSTRUCTIONS[i].opcode };
+        if (is_xmm(pDst) && (is_xmm(pSrc) || pSrc->kind == OPD_MEM)) {
+            encode_modrm(pAsm, SSE_INSTRUCTIONS[i].prefix, 0, opcode, 2, pDst, 0, pSrc, 0);
+        }
+        else if (opcode[1] == 0x6F && pDst->kind == OPD_MEM && is_xmm(pSrc)) {
+            // movdqa/movdqũւ̊i[
+            opcode[1] = 0x7F;
+            encode_modrm(pAsm, SSE_INSTRUCTIONS[i].prefix, 0, opcode, 2, pSrc, 0, pDst, 0);
+        }
+        else {
+            asm_error(pAsm, "invalid operands");
+        }
+        return true;
+    }
+
+    for (int i = 0; i < sizeof(SSE_SHIFT_INSTRUCTIONS) / sizeof(SSE_SHIFT_INSTRUCTIONS[0]); ++i) {
+        if (!match_name(mnemonic, SSE_SHIFT_INSTRUCTIONS[i].name) || opdCount != 2) continue;
+
+        if (!is_xmm(pDst) || pSrc->kind != OPD_IMM) {
+            asm_error(pAsm, "invalid operands");
+        }
+        const uint8_t opcode[2] = { 0x0F, (uint8_t)SSE_SHIFT_INSTRUCTIONS[i].opcode };
+        encode_modrm(pAsm, 0x66, 0, opcode, 2, NULL, SSE_SHIFT_INSTRUCTIONS[i].digit, pDst, 1);
+        emit_byte(pAsm, (int)pSrc->value);
+        return true;
+    }
+
+    if (match_name(mnemonic, "pshufd") && opdCount == 3) {
+        if (!is_xmm(pDst) || !(is_xmm(pSrc) || pSrc->kind == OPD_MEM) || pOpds[2].kind != OPD_IMM) {
+            asm_error(pAsm, "invalid operands");
+        }
+        const uint8_t opcode[2] = { 0x0F, 0x70 };
+        encode_modrm(pAsm, 0x66, 0, opcode, 2, pDst, 0, pSrc, 1);
+        emit_byte(pAsm, (int)pOpds[2].value);
+        return true;
+    }
+
+    if (match_name(mnemonic, "movd") && opdCount == 2) {
+        // xmmWX^32rbg̔ėpWX^/̊Ԃ̓]
+        uint8_t opcode[2] = { 0x0F, 0x6E };
+        if (is_xmm(pDst) && !is_xmm(pSrc) && (pSrc->kind == OPD_MEM || pSrc->size == 4)) {
+            encode_modrm(pAsm, 0x66, 0, opcode, 2, pDst, 0, pSrc, 0);
+        }
+        else if (is_xmm(pSrc) && !is_xmm(pDst) && (pDst->kind == OPD_MEM || pDst->size == 4)) {
+            opcode[1] = 0x7E;
+            encode_modrm(pAsm, 0x66, 0, opcode, 2, pSrc, 0, pDst, 0);
+        }
+        else {
+            asm_error(pAsm, "invalid operands");
+        }
+        return true;
+    }
+
+    return false;
+}
+
+static void encode_instruction(Assembler* pAsm, const char* mnemonic, Operand* pOpds, int opdCount) {
+    // IyhȂ̖
+    static const struct {
+        const char* name;
+        uint8_t bytes[2];
+        int len;
+    } NO_OPERAND_INSTRUCTIONS[] = {
+        { "ret",  { 0xC3 }, 1 },
+        { "leave",{ 0xC9 }, 1 },
+        { "nop",  { 0x90 }, 1 },
+        { "cqo",  { 0x48, 0x99 }, 2 },
+        { "cdq",  { 0x99 }, 1 },
+        { "cdqe", { 0x48, 0x98 }, 2 },
+    };
+
+    if (opdCount == 0) {
+        for (int i = 0; i < sizeof(NO_OPERAND_INSTRUCTIONS) / sizeof(NO_OPERAND_INSTRUCTIONS[0]); ++i) {
+            if (match_name(mnemonic, NO_OPERAND_INSTRUCTIONS[i].name)) {
+                emit_bytes(pAsm, NO_OPERAND_INSTRUCTIONS[i].bytes, NO_OPERAND_INSTRUCTIONS[i].len);
+                return;
+            }
+        }
+        asm_error(pAsm, "unsupported instruction '%s'", mnemonic);
+    }
+
+    for (int i = 0; i < sizeof(ALU_INSTRUCTIONS) / sizeof(ALU_INSTRUCTIONS[0]); ++i) {
+        if (match_name(mnemonic, ALU_INSTRUCTIONS[i].name) && opdCount == 2) {
+            encode_alu(pAsm, ALU_INSTRUCTIONS[i].digit, &pOpds[0], &pOpds[1]);
+            return;
+        }
+    }
+
+    for (int i = 0; i < sizeof(UNARY_INSTRUCTIONS) / sizeof(UNARY_INSTRUCTIONS[0]); ++i) {
+        if (match_name(mnemonic, UNARY_INSTRUCTIONS[i].name) && opdCount == 1) {
+            const int size = operand_size(pAsm, &pOpds[0], NULL);
+            encode_modrm1(pAsm, size, (size == 1) ? 0xF6 : 0xF7, NULL, UNARY_INSTRUCTIONS[i].digit, &pOpds[0], 0);
+            return;
+        }
+    }
+
+    for (int i = 0; i < sizeof(SHIFT_INSTRUCTIONS) / sizeof(SHIFT_INSTRUCTIONS[0]); ++i) {
+        if (match_name(mnemonic, SHIFT_INSTRUCTIONS[i].name) && opdCount == 2) {
+            encode_shift(pAsm, SHIFT_INSTRUCTIONS[i].digit, &pOpds[0], &pOpds[1]);
+            return;
+        }
+    }
+
+    if (encode_sse(pAsm, mnemonic, pOpds, opdCount)) {
+        return;
+    }
+
+    if (match_name(mnemonic, "mov") && opdCount == 2) {
+        encode_mov(pAsm, &pOpds[0], &pOpds[1]);
+    }
+    else if ((match_name(mnemonic, "movsx") || match_name(mnemonic, "movsxd")) && opdCount == 2) {
+        encode_movx(pAsm, true, &pOpds[0], &pOpds[1]);
+    }
+    else if ((match_name(mnemonic, "movzx") || match_name(mnemonic, "movzb")) && opdCount == 2) {
+        if (match_name(mnemonic, "movzb") && pOpds[1].size == 0) {
+            pOpds[1].size = 1;
+        }
+        encode_movx(pAsm, false, &pOpds[0], &pOpds[1]);
+    }
+    else if (match_name(mnemonic, "lea") && opdCount == 2) {
+        if (pOpds[0].kind != OPD_REG || pOpds[1].kind != OPD_MEM) {
+            asm_error(pAsm, "invalid operands");
+        }
+        encode_modrm1(pAsm, pOpds[0].size, 0x8D, &pOpds[0], 0, &pOpds[1], 0);
+    }
+    else if (match_name(mnemonic, "test") && opdCount == 2) {
+        const int size = operand_size(pAsm, &pOpds[0], (pOpds[1].kind == OPD_IMM) ? NULL : &pOpds[1]);
+        if (pOpds[1].kind == OPD_IMM) {
+            const int immSize = (size == 8) ? 4 : size;
+            encode_modrm1(pAsm, size, (size == 1) ? 0xF6 : 0xF7, NULL, 0, &pOpds[0], immSize);
+            emit_value(pAsm, pOpds[1].value, immSize);
+        }
+        else {
+            encode_modrm1(pAsm, size, (size == 1) ? 0x84 : 0x85, &pOpds[1], 0, &pOpds[0], 0);
+        }
+    }
+    else if (match_name(mnemonic, "imul")) {
+        encode_imul(pAsm, pOpds, opdCount);
+    }
+    else if ((match_name(mnemonic, "inc") || match_name(mnemonic, "dec")) && opdCount == 1) {
+        const int size = operand_size(pAsm, &pOpds[0], NULL);
+        encode_modrm1(pAsm, size, (size == 1) ? 0xFE : 0xFF, NULL, match_name(mnemonic, "inc") ? 0 : 1, &pOpds[0], 0);
+    }
+    else if ((match_name(mnemonic, "push") || match_name(mnemonic, "pop")) && opdCount == 1) {
+        encode_push_pop(pAsm, match_name(mnemonic, "push"), &pOpds[0]);
+    }
+    else if ((match_name(mnemonic, "jmp") || match_name(mnemonic, "call")) && opdCount == 1) {
+        encode_branch(pAsm, mnemonic, -1, &pOpds[0]);
+    }
+    else if (mnemonic[0] == 'j' && find_condition_code(mnemonic + 1) >= 0 && opdCount == 1) {
+        encode_branch(pAsm, mnemonic, find_condition_code(mnemonic + 1), &pOpds[0]);
+    }
+    else if (strncmp(mnemonic, "set", 3) == 0 && find_condition_code(mnemonic + 3) >= 0 && opdCount == 1) {
+        encode_modrm2(pAsm, 0, 0x0F, 0x90 + find_condition_code(mnemonic + 3), NULL, 0, &pOpds[0], 0);
+    }
+    else {
+        asm_error(pAsm, "unsupported instruction '%s'", mnemonic);
+    }
+}
+
+// _uNH[gň͂܂ꂽGXP[v߂pOutɒǉ
+static void parse_string(Assembler* pAsm, char* p, StrBuf* pOut) {
+    p = skip_space(p);
+    if (*p++ != '"') {
+        asm_error(pAsm, "string literal is expected");
+    }
+
+    while (*p != '"') {
+        if (*p == '\0') {
+            asm_error(pAsm, "unterminated string literal");
+        }
+        if (*p != '\\') {
+            strbuf_append(pOut, p++, 1);
+            continue;
+        }
+
+        char c;
+        p++;
+        switch (*p) {
+        case 'n': c = '\n'; p++; break;
+        case 't': c = '\t'; p++; break;
+        case 'r': c = '\r'; p++; break;
+        case 'a': c = '\a'; p++; break;
+        case 'b': c = '\b'; p++; break;
+        case 'f': c = '\f'; p++; break;
+        case 'v': c = '\v'; p++; break;
+        case 'x':
+            c = (char)strtol(p + 1, &p, 16);
+            break;
+        default:
+            if ('0' <= *p && *p <= '7') {
+                int value = 0;
+                for (int i = 0; i < 3 && '0' <= *p && *p <= '7'; ++i) {
+                    value = value * 8 + (*p++ - '0');
+                }
+                c = (char)value;
+            }
+            else {
+                c = *p++;
+            }
+            break;
+        }
+        strbuf_append(pOut, &c, 1);
+    }
+}
+
+// .string̃_uNH[gň͂܂ꂽGXP[v߂ďo͂
+static void emit_string(Assembler* pAsm, char* p, bool withNul) {
+    StrBuf str = { 0 };
+    parse_string(pAsm, p, &str);
+    if (str.len) {
+        emit_bytes(pAsm, str.data, str.len);
+    }
+    strbuf_free(&str);
+
+    if (withNul) {
+        emit_byte(pAsm, 0);
+    }
+}
+
+// ݂̃ZNV̈ʒuw肳ꂽEɑ
+static void align_section(Assembler* pAsm, size_t align) {
+    ObjSection* pSection = cur_section(pAsm);
+    if (align == 0 || (align & (align - 1)) != 0) {
+        asm_error(pAsm, "invalid alignment %zu", align);
+    }
+    if (pSection->align < align) {
+        pSection->align = align;
+    }
+
+    // R[hȂAsĂ߂̐Ȃςނ悤nopŖ߂
+    static const uint8_t NOPS[][9] = {
+        { 0x90 },
+        { 0x66, 0x90 },
+        { 0x0F, 0x1F, 0x00 },
+        { 0x0F, 0x1F, 0x40, 0x00 },
+        { 0x0F, 0x1F, 0x44, 0x00, 0x00 },
+        { 0x66, 0x0F, 0x1F, 0x44, 0x00, 0x00 },
+        { 0x0F, 0x1F, 0x80, 0x00, 0x00, 0x00, 0x00 },
+        { 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+        { 0x66, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+    };
+    const size_t maxNopLen = sizeof(NOPS) / sizeof(NOPS[0]);
+    while (pSection->size % align) {
+        if (pSection->isNoBits) {
+            pSection->size++;
+        }
+        else if (pSection->flags & SECTION_FLAG_EXEC) {
+            size_t len = align - pSection->size % align;
+            if (maxNopLen < len) len = maxNopLen;
+            for (size_t i = 0; i < len; ++i) {
+                emit_byte(pAsm, NOPS[len - 1][i]);
+            }
+        }
+        else {
+            emit_byte(pAsm, 0x00);
+        }
+    }
+}
+
+// .section̑i"ax"Ȃǁj߂
+static unsigned int parse_section_flags(const char* p) {
+    unsigned int flags = 0;
+    for (; *p && *p != '"'; ++p) {
+        switch (*p) {
+        case 'a': flags |= SECTION_FLAG_ALLOC; break;
+        case 'w': flags |= SECTION_FLAG_WRITE; break;
+        case 'x': flags |= SECTION_FLAG_EXEC; break;
+        case 'M': flags |= SECTION_FLAG_MERGE; break;
+        case 'S': flags |= SECTION_FLAG_STRINGS; break;
+        }
+    }
+    return flags;
+}
+
+// .file ԍ "t@C"
+// ԍ̖`̓V{\ɍڂt@CȂ̂ŁAsԍ̑Ήɂ͎gȂ
+static void process_file_directive(Assembler* pAsm, char* p) {
+    if (!isdigit((unsigned char)*p)) return;
+
+    char* pEnd;
+    const long fileNo = strtol(p, &pEnd, 10);
+    if (fileNo < 1 || pAsm->debugFileCount + 1 < fileNo) {
+        asm_error(pAsm, "file number %ld is out of order", fileNo);
+    }
+
+    StrBuf name = { 0 };
+    parse_string(pAsm, pEnd, &name);
+    char* pszName = calloc(name.len + 1, sizeof(char));
+    if (name.len) memcpy(pszName, name.data, name.len);
+    strbuf_free(&name);
+
+    if (fileNo <= pAsm->debugFileCount) {
+        free(pAsm->ppDebugFiles[fileNo - 1]);
+    }
+    else {
+        pAsm->ppDebugFiles = grow_array(pAsm->ppDebugFiles, &pAsm->debugFileCap, pAsm->debugFileCount + 1, sizeof(char*));
+        ++pAsm->debugFileCount;
+    }
+    pAsm->ppDebugFiles[fileNo - 1] = pszName;
+}
+
+// .loc t@Cԍ sԍ [ԍ]
+// ̖߂A.loc܂ł̍s̃R[hɂȂ
+static void process_loc_directive(Assembler* pAsm, char* p) {
+    char* pEnd;
+    const long fileNo = strtol(p, &pEnd, 10);
+    const long line = strtol(pEnd, NULL, 10);
+    if (fileNo < 1 || pAsm->debugFileCount < fileNo) {
+        asm_error(pAsm, "file number %ld is not defined", fileNo);
+    }
+    if (!(cur_section(pAsm)->flags & SECTION_FLAG_EXEC)) return;
+
+    pAsm->pDebugLines = grow_array(pAsm->pDebugLines, &pAsm->debugLineCap, pAsm->debugLineCount + 1, sizeof(DebugLine));
+    DebugLine* pLine = &pAsm->pDebugLines[pAsm->debugLineCount++];
+    pLine->section = pAsm->curSection;
+    pLine->offset = cur_section(pAsm)->size;
+    pLine->file = (int)fileNo;
+    pLine->line = (int)line;
+}
+
+// .cfi_*̃Iyh̃WX^ǂ݁ADWARF̃WX^ԍԂ
+static int parse_cfi_register(Assembler* pAsm, char** pp) {
+    // DWARF̃WX^ԍix86-64̃WX^ԍ̏j
+    static const uint8_t DWARF_REGISTERS[16] = { 0, 2, 1, 3, 7, 6, 4, 5, 8, 9, 10, 11, 12, 13, 14, 15 };
+
+    char* p = skip_space(*pp);
+    char* pEnd = p;
+    while (is_symbol_char(*pEnd)) pEnd++;
+    int size;
+    const int reg = find_register(p, (int)(pEnd - p), &size);
+    if (reg == REG_NONE || reg == REG_RIP || size != 8) {
+        asm_error(pAsm, "invalid register '%.*s'", (int)(pEnd - p), p);
+    }
+
+    p = skip_space(pEnd);
+    if (*p == ',') p++;
+    *pp = p;
+    return DWARF_REGISTERS[reg];
+}
+
+// .cfi_startprocA.cfi_endprocƁÅԂ̌Ăяot[̕ωL^
+// ֐̓łCFAiĂяorspjrsp+8ŁA߂AhXCFA-8ɂ̂Ƃ
+static void process_cfi_directive(Assembler* pAsm, const char* pName, int nameLen, char* pArgs) {
+#define IS_CFI_DIRECTIVE(name) (nameLen == (int)strlen(name) && strncmp(pName, name, nameLen) == 0)
+
+    if (IS_CFI_DIRECTIVE(".cfi_startproc")) {
+        if (pAsm->isInCfiProc) {
+            asm_error(pAsm, ".cfi_startproc is nested");
+        }
+        pAsm->pCfiProcs = grow_array(pAsm->pCfiProcs, &pAsm->cfiProcCap, pAsm->cfiProcCount + 1, sizeof(CfiProc));
+        CfiProc* pProc = &pAsm->pCfiProcs[pAsm->cfiProcCount++];
+        pProc->section = pAsm->curSection;
+        pProc->start = cur_section(pAsm)->size;
+        pProc->firstInsn = pAsm->cfiInsnCount;
+        pAsm->isInCfiProc = true;
+        return;
+    }
+
+    if (!pAsm->isInCfiProc) {
+        asm_error(pAsm, "'%.*s' without .cfi_startproc", nameLen, pName);
+    }
+    CfiProc* pProc = &pAsm->pCfiProcs[pAsm->cfiProcCount - 1];
+    if (pProc->section != pAsm->curSection) {
+        asm_error(pAsm, "'%.*s' is in a different section from .cfi_startproc", nameLen, pName);
+    }
+
+    if (IS_CFI_DIRECTIVE(".cfi_endproc")) {
+        pProc->end = cur_section(pAsm)->size;
+        pProc->insnCount = pAsm->cfiInsnCount - pProc->firstInsn;
+        pAsm->isInCfiProc = false;
+        return;
+    }
+
+    pAsm->pCfiInsns = grow_array(pAsm->pCfiInsns, &pAsm->cfiInsnCap, pAsm->cfiInsnCount + 1, sizeof(CfiInsn));
+    CfiInsn* pInsn = &pAsm->pCfiInsns[pAsm->cfiInsnCount++];
+    pInsn->offset = cur_section(pAsm)->size;
+    uint8_t* p = pInsn->bytes;
+
+    if (IS_CFI_DIRECTIVE(".cfi_def_cfa")) {
+        // DW_CFA_def_cfa WX^ ItZbg
+        const int reg = parse_cfi_register(pAsm, &pArgs);
+        *p++ = 0x0C;
+        p += put_uleb128(p, reg);
+        p += put_uleb128(p, strtoul(pArgs, NULL, 0));
+    }
+    else if (IS_CFI_DIRECTIVE(".cfi_def_cfa_offset")) {
+        // DW_CFA_def_cfa_offset ItZbg
+        *p++ = 0x0E;
+        p += put_uleb128(p, strtoul(pArgs, NULL, 0));
+    }
+    else if (IS_CFI_DIRECTIVE(".cfi_def_cfa_register")) {
+        // DW_CFA_def_cfa_register WX^
+        *p++ = 0x0D;
+        p += put_uleb128(p, parse_cfi_register(pAsm, &pArgs));
+    }
+    else if (IS_CFI_DIRECTIVE(".cfi_offset")) {
+        // DW_CFA_offset+WX^ ItZbg/f[^ACgi-8j
+        const int reg = parse_cfi_register(pAsm, &pArgs);
+        const long offset = strtol(pArgs, NULL, 0);
+        if (0 <= offset || offset % 8) {
+            asm_error(pAsm, "invalid offset %ld", offset);
+        }
+        *p++ = (uint8_t)(0x80 | reg);
+        p += put_uleb128(p, offset / -8);
+    }
+    else {
+        asm_error(pAsm, "unsupported directive '%.*s'", nameLen, pName);
+    }
+    pInsn->len = (int)(p - pInsn->bytes);
+
+#undef IS_CFI_DIRECTIVE
+}
+
+static void process_directive(Assembler* pAsm, char* p) {
+    char* pName = p;
+    while (*p && *p != ' ' && *p != '\t') p++;
+    const int nameLen = (int)(p - pName);
+    char* pArgs = skip_space(p);
+
+#define IS_DIRECTIVE(name) (nameLen == (int)strlen(name) && strncmp(pName, name, nameLen) == 0)
+
+    if (IS_DIRECTIVE(".text")) {
+        pAsm->curSection = get_section(pAsm, ".text", 5, SECTION_FLAG_ALLOC | SECTION_FLAG_EXEC, false, 0);
+    }
+    else if (IS_DIRECTIVE(".data")) {
+        pAsm->curSection = get_section(pAsm, ".data", 5, SECTION_FLAG_ALLOC | SECTION_FLAG_WRITE, false, 0);
+    }
+    else if (IS_DIRECTIVE(".bss")) {
+        pAsm->curSection = get_section(pAsm, ".bss", 4, SECTION_FLAG_ALLOC | SECTION_FLAG_WRITE, true, 0);
+    }
+    else if (IS_DIRECTIVE(".section")) {
+        // .section O[, ""[, @[, vfTCY]]]
+        char* pSecName = pArgs;
+        char* pEnd = pSecName;
+        while (*pEnd && *pEnd != ',' && *pEnd != ' ' && *pEnd != '\t') pEnd++;
+        const int secNameLen = (int)(pEnd - pSecName);
+
+        unsigned int flags = SECTION_FLAG_ALLOC;
+        bool isNoBits = false;
+        size_t entSize = 0;
+
+        char* pFlags = strchr(pEnd, '"');
+        if (pFlags) {
+            flags = parse_section_flags(pFlags + 1);
+            char* pType = strchr(pFlags + 1, '"');
+            pType = pType ? strchr(pType, ',') : NULL;
+            if (pType) {
+                pType = skip_space(pType + 1);
+                isNoBits = strncmp(pType, "@nobits", 7) == 0;
+                char* pEntSize = strchr(pType, ',');
+                if (pEntSize) {
+                    entSize = strtoul(pEntSize + 1, NULL, 0);
+                }
+            }
+        }
+        else if (strncmp(pSecName, ".bss", 4) == 0) {
+            flags |= SECTION_FLAG_WRITE;
+            isNoBits = true;
+        }
+
+        pAsm->curSection = get_section(pAsm, pSecName, secNameLen, flags, isNoBits, entSize);
+    }
+    else if (IS_DIRECTIVE(".globl") || IS_DIRECTIVE(".global")) {
+        char* pEnd = pArgs;
+        while (is_symbol_char(*pEnd)) pEnd++;
+        const int symbol = get_symbol(pAsm, pArgs, (int)(pEnd - pArgs));
+        pAsm->pObj->pSymbols[symbol].isGlobal = true;
+    }
+    else if (IS_DIRECTIVE(".string") || IS_DIRECTIVE(".asciz")) {
+        emit_string(pAsm, pArgs, true);
+    }
+    else if (IS_DIRECTIVE(".ascii")) {
+        emit_string(pAsm, pArgs, false);
+    }
+    else if (IS_DIRECTIVE(".zero")) {
+        const size_t size = strtoul(pArgs, NULL, 0);
+        if (cur_section(pAsm)->isNoBits) {
+            cur_section(pAsm)->size += size;
+        }
+        else {
+            for (size_t i = 0; i < size; ++i) {
+                emit_byte(pAsm, 0);
+            }
+        }
+    }
+    else if (IS_DIRECTIVE(".byte") || IS_DIRECTIVE(".short") || IS_DIRECTIVE(".long") || IS_DIRECTIVE(".quad")) {
+        const int size = IS_DIRECTIVE(".byte") ? 1 : IS_DIRECTIVE(".short") ? 2 : IS_DIRECTIVE(".long") ? 4 : 8;
+        if (isdigit((unsigned char)*pArgs) || *pArgs == '-') {
+            emit_value(pAsm, strtoll(pArgs, NULL, 0), size);
+        }
+        else if (size == 8) {
+            char* pEnd = pArgs;
+            while (is_symbol_char(*pEnd)) pEnd++;
+            emit_symbol_ref(pAsm, RELOC_ABS64, pArgs, (int)(pEnd - pArgs), 0);
+        }
+        else if (size == 4 && strchr(pArgs, '-')) {
+            // "V{ - x"iWve[u̗vfj́Ax݂̃ZNVŒ`ς݂Ȃ
+            // ݈ʒȗΎQƂɒiS - L = S + (P - L) - Pj
+            char* pEnd = pArgs;
+            while (is_symbol_char(*pEnd)) pEnd++;
+            char* pBase = skip_space(pEnd);
+            if (*pBase++ != '-') {
+                asm_error(pAsm, "unsupported data expression '%s'", pArgs);
+            }
+            pBase = skip_space(pBase);
+            char* pBaseEnd = pBase;
+            while (is_symbol_char(*pBaseEnd)) pBaseEnd++;
+            // get_symbol͋L\L邱Ƃ̂ŁAvf̒l͎QƂL^OɎoĂ
+            const int baseSymbol = get_symbol(pAsm, pBase, (int)(pBaseEnd - pBase));
+            const ObjSymbol* pBaseSym = &pAsm->pObj->pSymbols[baseSymbol];
+            if (pBaseEnd == pBase || pBaseSym->section != pAsm->curSection) {
+                asm_error(pAsm, "unsupported data expression '%s'", pArgs);
+            }
+            const int64_t addend = (int64_t)(cur_section(pAsm)->size - pBaseSym->offset);
+            emit_symbol_ref(pAsm, RELOC_PC32, pArgs, (int)(pEnd - pArgs), addend);
+        }
+        else {
+            asm_error(pAsm, "unsupported data expression '%s'", pArgs);
+        }
+    }
+    else if (IS_DIRECTIVE(".align") || IS_DIRECTIVE(".balign")) {
+        align_section(pAsm, strtoul(pArgs, NULL, 0));
+    }
+    else if (IS_DIRECTIVE(".p2align")) {
+        align_section(pAsm, (size_t)1 << strtoul(pArgs, NULL, 0));
+    }
+    else if (IS_DIRECTIVE(".file")) {
+        process_file_directive(pAsm, pArgs);
+    }
+    else if (IS_DIRECTIVE(".loc")) {
+        process_loc_directive(pAsm, pArgs);
+    }
+    else if (5 <= nameLen && strncmp(pName, ".cfi_", 5) == 0) {
+        process_cfi_directive(pAsm, pName, nameLen, pArgs);
+    }
+    else if (IS_DIRECTIVE(".intel_syntax") || IS_DIRECTIVE(".type") || IS_DIRECTIVE(".size") || IS_DIRECTIVE(".ident")) {
+        // @Bɂ͉eȂ
+    }
+    else {
+        asm_error(pAsm, "unsupported directive '%.*s'", nameLen, pName);
+    }
+
+#undef IS_DIRECTIVE
+}
+
+static void process_line(Assembler* pAsm, char* p) {
+    // Rg菜i񒆂'#'͏j
+    bool inString = false;
+    for (char* q = p; *q; ++q) {
+        if (*q == '"' && (q == p || q[-1] != '\\')) {
+            inString = !inString;
+        }
+        else if (*q == '#' && !inString) {
+            *q = '\0';
+            break;
+        }
+    }
+
+    p = skip_space(p);
+    trim_right(p);
+
+    // x`
+    char* pEnd = p;
+    while (is_symbol_char(*pEnd)) pEnd++;
+    if (pEnd != p && *pEnd == ':') {
+        const int symbol = get_symbol(pAsm, p, (int)(pEnd - p));
+        ObjSymbol* pSym = &pAsm->pObj->pSymbols[symbol];
+        if (pSym->section != -1) {
+            asm_error(pAsm, "symbol '%s' is already defined", pSym->name);
+        }
+        pSym->section = pAsm->curSection;
+        pSym->offset = cur_section(pAsm)->size;
+        p = skip_space(pEnd + 1);
+    }
+
+    if (*p == '\0') {
+        return;
+    }
+
+    if (*p == '.') {
+        process_directive(pAsm, p);
+        return;
+    }
+
+    // 
+    char mnemonic[16] = { 0 };
+    pEnd = p;
+    while (*pEnd && *pEnd != ' ' && *pEnd != '\t') pEnd++;
+    if (sizeof(mnemonic) <= (size_t)(pEnd - p)) {
+        asm_error(pAsm, "invalid instruction");
+    }
+    memcpy(mnemonic, p, pEnd - p);
+
+    Operand operands[MAX_OPERANDS];
+    int opdCount = 0;
+    p = skip_space(pEnd);
+    while (*p) {
+        if (MAX_OPERANDS <= opdCount) {
+            asm_error(pAsm, "too many operands");
+        }
+
+        char* pComma = strchr(p, ',');
+        if (pComma) *pComma = '\0';
+        parse_operand(pAsm, p, &operands[opdCount++]);
+        if (!pComma) break;
+        p = pComma + 1;
+    }
+
+    encode_instruction(pAsm, mnemonic, operands, opdCount);
+}
+
+// sԍvO̓ꖽ߂̐ݒis̑LINE_BASE..LINE_BASE+LINE_RANGE-1AhX̑ƍ킹1oCgŕ\j
+#define LINE_BASE       (-5)
+#define LINE_RANGE      (14)
+#define OPCODE_BASE     (13)
+
+// ZNV.locŎw肳ꂽs̑ΉtrueԂ
+static bool has_debug_lines(const Assembler* pAsm, int section) {
+    for (int i = 0; i < pAsm->debugLineCount; ++i) {
+        if (pAsm->pDebugLines[i].section == section) return true;
+    }
+    return false;
+}
+
+// .locŎw肳ꂽs̑Ή.debug_line̍sԍvO
+// ߂̂ZNVƂɁAAhX̗̏1
+static int emit_debug_line(Assembler* pAsm) {
+    static const uint8_t STANDARD_OPCODE_LENGTHS[OPCODE_BASE - 1] = { 0, 1, 1, 1, 1, 0, 0, 0, 1, 0, 0, 1 };
+    const int codeSectionCount = pAsm->pObj->sectionCount;
+
+    const int lineSection = get_section(pAsm, ".debug_line", 11, 0, false, 0);
+    pAsm->curSection = lineSection;
+    emit_value(pAsm, 0, 4);         // iŖ߂j
+    emit_value(pAsm, 3, 2);         // o[W
+    emit_value(pAsm, 0, 4);         // wb_[̒iŖ߂j
+    emit_byte(pAsm, 1);             // ߂̍ŏ̒
+    emit_byte(pAsm, 1);             // ̐擪ǂ̊l
+    emit_byte(pAsm, LINE_BASE);
+    emit_byte(pAsm, LINE_RANGE);
+    emit_byte(pAsm, OPCODE_BASE);
+    emit_bytes(pAsm, STANDARD_OPCODE_LENGTHS, sizeof(STANDARD_OPCODE_LENGTHS));
+    emit_byte(pAsm, 0);             // fBNg̈ꗗij
+    for (int i = 0; i < pAsm->debugFileCount; ++i) {
+        emit_bytes(pAsm, pAsm->ppDebugFiles[i], strlen(pAsm->ppDebugFiles[i]) + 1);
+        emit_uleb128(pAsm, 0);      // fBNgԍ
+        emit_uleb128(pAsm, 0);      // XV
+        emit_uleb128(pAsm, 0);      // t@C̑傫
+    }
+    emit_byte(pAsm, 0);
+    patch_value(pAsm, 6, (int64_t)cur_section(pAsm)->size - 10, 4);
+
+    for (int section = 0; section < codeSectionCount; ++section) {
+        if (!has_debug_lines(pAsm, section)) continue;
+
+        size_t address = 0;
+        int file = 1;
+        int line = 1;
+        bool isStarted = false;
+        for (int i = 0; i < pAsm->debugLineCount; ++i) {
+            const DebugLine* pLine = &pAsm->pDebugLines[i];
+            if (pLine->section != section) continue;
+
+            if (!isStarted) {
+                // DW_LNE_set_address
+                emit_byte(pAsm, 0);
+                emit_uleb128(pAsm, 9);
+                emit_byte(pAsm, 0x02);
+                emit_section_ref(pAsm, RELOC_ABS64, section, pLine->offset);
+                address = pLine->offset;
+                isStarted = true;
+            }
+            if (pLine->file != file) {
+                // DW_LNS_set_file
+                emit_byte(pAsm, 0x04);
+                emit_uleb128(pAsm, pLine->file);
+                file = pLine->file;
+            }
+
+            const int64_t addressDelta = (int64_t)(pLine->offset - address);
+            const int64_t lineDelta = pLine->line - line;
+            const int64_t special = (lineDelta - LINE_BASE) + LINE_RANGE * addressDelta + OPCODE_BASE;
+            if (LINE_BASE <= lineDelta && lineDelta < LINE_BASE + LINE_RANGE && special <= 255) {
+                emit_byte(pAsm, (int)special);
+            }
+            else {
+                if (addressDelta) {
+                    // DW_LNS_advance_pc
+                    emit_byte(pAsm, 0x02);
+                    emit_uleb128(pAsm, addressDelta);
+                }
+                if (lineDelta) {
+                    // DW_LNS_advance_line
+                    emit_byte(pAsm, 0x03);
+                    emit_sleb128(pAsm, lineDelta);
+                }
+                // DW_LNS_copy
+                emit_byte(pAsm, 0x01);
+            }
+            address = pLine->offset;
+            line = pLine->line;
+        }
+
+        // ZNV̖ŗIiDW_LNS_advance_pcADW_LNE_end_sequencej
+        emit_byte(pAsm, 0x02);
+        emit_uleb128(pAsm, pAsm->pObj->pSections[section].size - address);
+        emit_byte(pAsm, 0);
+        emit_uleb128(pAsm, 1);
+        emit_byte(pAsm, 0x01);
+    }
+    patch_value(pAsm, 0, (int64_t)cur_section(pAsm)->size - 4, 4);
+    return lineSection;
+}
+
+// sԍvOQƂRpCPʂ.debug_infoɒu
+// ֐̈ꕔ.text.unlikely֕邱Ƃ̂ŁAR[h͈̔͂̓ZNVƂ.debug_rangesŎ
+static void emit_debug_info(Assembler* pAsm, int lineSection) {
+    static const uint8_t ABBREV[] = {
+        1, 0x11, 0,     // 1: DW_TAG_compile_unitiqj
+        0x25, 0x08,     // DW_AT_producer: DW_FORM_string
+        0x13, 0x05,     // DW_AT_language: DW_FORM_data2
+        0x03, 0x08,     // DW_AT_name: DW_FORM_string
+        0x10, 0x06,     // DW_AT_stmt_list: DW_FORM_data4
+        0x11, 0x01,     // DW_AT_low_pc: DW_FORM_addr
+        0x55, 0x06,     // DW_AT_ranges: DW_FORM_data4
+        0, 0,
+        0,
+    };
+    const int codeSectionCount = pAsm->pObj->sectionCount;
+
+    const int rangesSection = get_section(pAsm, ".debug_ranges", 13, 0, false, 0);
+    pAsm->curSection = rangesSection;
+    for (int section = 0; section < codeSectionCount; ++section) {
+        if (!has_debug_lines(pAsm, section)) continue;
+        emit_section_ref(pAsm, RELOC_ABS64, section, 0);
+        emit_section_ref(pAsm, RELOC_ABS64, section, pAsm->pObj->pSections[section].size);
+    }
+    emit_value(pAsm, 0, 8);
+    emit_value(pAsm, 0, 8);
+
+    const int abbrevSection = get_section(pAsm, ".debug_abbrev", 13, 0, false, 0);
+    pAsm->curSection = abbrevSection;
+    emit_bytes(pAsm, ABBREV, sizeof(ABBREV));
+
+    pAsm->curSection = get_section(pAsm, ".debug_info", 11, 0, false, 0);
+    emit_value(pAsm, 0, 4);         // iŖ߂j
+    emit_value(pAsm, 3, 2);         // o[W
+    emit_section_ref(pAsm, RELOC_ABS32, abbrevSection, 0);
+    emit_byte(pAsm, 8);             // AhX̑傫
+    emit_uleb128(pAsm, 1);
+    emit_bytes(pAsm, "chibicc", 8);
+    emit_value(pAsm, 0x0001, 2);    // DW_LANG_C89
+    emit_bytes(pAsm, pAsm->ppDebugFiles[0], strlen(pAsm->ppDebugFiles[0]) + 1);
+    emit_section_ref(pAsm, RELOC_ABS32, lineSection, 0);
+    emit_value(pAsm, 0, 8);         // .debug_ranges̃AhX̊i΃AhXŏ̂0j
+    emit_section_ref(pAsm, RELOC_ABS32, rangesSection, 0);
+    patch_value(pAsm, 0, (int64_t)cur_section(pAsm)->size - 4, 4);
+}
+
+// CIEFDE̖DW_CFA_nopŖ߂8oCgɑA擪ɒ
+static void finish_cfi_entry(Assembler* pAsm, size_t start) {
+    while ((cur_section(pAsm)->size - start) % 8) {
+        emit_byte(pAsm, 0);
+    }
+    patch_value(pAsm, start, (int64_t)(cur_section(pAsm)->size - start - 4), 4);
+}
+
+// .cfi_startproc.cfi_endproc܂ł͈̔͂ƂɁA.eh_frame֊߂u
+// CIE͑SĂ͈̔͂ŋLA͈͂ƂFDEɂ͓̌Ăяot[̕ωׂ
+static void emit_eh_frame(Assembler* pAsm) {
+    static const uint8_t CIE[] = {
+        0, 0, 0, 0,     // CIE ID
+        1,              // o[W
+        'z', 'R', 0,    // giFDẼAhX̌`j
+        1,              // R[h̃ACg
+        0x78,           // f[^̃ACgi-8j
+        16,             // ߂AhX̗iripj
+        1,              // gf[^̒
+        0x1B,           // FDẼAhX̌`iDW_EH_PE_pcrel | DW_EH_PE_sdata4j
+        0x0C, 7, 8,     // DW_CFA_def_cfa rsp, 8
+        0x90, 1,        // DW_CFA_offset rip, CFA-8
+    };
+
+    pAsm->curSection = get_section(pAsm, ".eh_frame", 9, SECTION_FLAG_ALLOC, false, 0);
+    align_section(pAsm, 8);
+    const size_t cieStart = cur_section(pAsm)->size;
+    emit_value(pAsm, 0, 4);
+    emit_bytes(pAsm, CIE, sizeof(CIE));
+    finish_cfi_entry(pAsm, cieStart);
+
+    for (int i = 0; i < pAsm->cfiProcCount; ++i) {
+        const CfiProc* pProc = &pAsm->pCfiProcs[i];
+        const size_t fdeStart = cur_section(pAsm)->size;
+        emit_value(pAsm, 0, 4);
+        emit_value(pAsm, (int64_t)(cur_section(pAsm)->size - cieStart), 4);
+        emit_section_ref(pAsm, RELOC_PC32, pProc->section, pProc->start);
+        emit_value(pAsm, (int64_t)(pProc->end - pProc->start), 4);
+        emit_uleb128(pAsm, 0);
+
+        size_t offset = pProc->start;
+        for (int j = 0; j < pProc->insnCount; ++j) {
+            const CfiInsn* pInsn = &pAsm->pCfiInsns[pProc->firstInsn + j];
+            const size_t delta = pInsn->offset - offset;
+            if (delta == 0) {
+                // ʒuł̕ω͑ĕׂ
+            }
+            else if (delta < 0x40) {
+                emit_byte(pAsm, 0x40 | (int)delta);     // DW_CFA_advance_loc
+            }
+            else if (delta <= 0xFF) {
+                emit_byte(pAsm, 0x02);                  // DW_CFA_advance_loc1
+                emit_value(pAsm, (int64_t)delta, 1);
+            }
+            else if (delta <= 0xFFFF) {
+                emit_byte(pAsm, 0x03);                  // DW_CFA_advance_loc2
+                emit_value(pAsm, (int64_t)delta, 2);
+            }
+            else {
+                emit_byte(pAsm, 0x04);                  // DW_CFA_advance_loc4
+                emit_value(pAsm, (int64_t)delta, 4);
+            }
+            emit_bytes(pAsm, pInsn->bytes, pInsn->len);
+            offset = pInsn->offset;
+        }
+        finish_cfi_entry(pAsm, fdeStart);
+    }
+}
+
+static void add_reloc(ObjSection* pSection, const PendingRef* pRef) {
+    pSection->pRelocs = grow_array(pSection->pRelocs, &pSection->relocCap, pSection->relocCount + 1, sizeof(ObjReloc));
+    ObjReloc* pReloc = &pSection->pRelocs[pSection->relocCount++];
+    pReloc->offset = pRef->offset;
+    pReloc->kind = pRef->kind;
+    pReloc->symbol = pRef->symbol;
+    pReloc->addend = pRef->addend;
+}
+
+// ZNV̔JV{ւ̑ΎQƂ͂̏ŉAȊOĔzuɂ
+static void resolve_refs(Assembler* pAsm) {
+    ObjFile* pObj = pAsm->pObj;
+
+    for (int i = 0; i < pAsm->refCount; ++i) {
+        const PendingRef* pRef = &pAsm->pRefs[i];
+        const ObjSymbol* pSym = &pObj->pSymbols[pRef->symbol];
+        ObjSection* pSection = &pObj->pSections[pRef->section];
+
+        const bool isRelative = pRef->kind == RELOC_PC32 || pRef->kind == RELOC_PLT32;
+        if (pSym->section == pRef->section && !pSym->isGlobal && isRelative) {
+            const int64_t value = (int64_t)pSym->offset + pRef->addend - (int64_t)pRef->offset;
+            if (!fits_int32(value)) {
+                error("Internal Error. Branch target '%s' is out of range.", pSym->name);
+            }
+            for (int j = 0; j < 4; ++j) {
+                pSection->data[pRef->offset + j] = (uint8_t)(value >> (j * 8));
+            }
+        }
+        else {
+            add_reloc(pSection, pRef);
+        }
+    }
+}
+
+// IntelL@̃AZux86-64̋@Bɕϊ
+// ZNṼxQƂ͂ŉAȊO͍ĔzuƂĎc
+ObjFile* assemble(const char* pszAsm) {
+    Assembler assembler = { 0 };
+    assembler.pObj = calloc(1, sizeof(ObjFile));
+    rehash_symbols(&assembler, 256);
+
+    // ZNV̕тɂ邽߁ÃZNV͐ɍĂ
+    assembler.curSection = get_section(&assembler, ".text", 5, SECTION_FLAG_ALLOC | SECTION_FLAG_EXEC, false, 0);
+    get_section(&assembler, ".data", 5, SECTION_FLAG_ALLOC | SECTION_FLAG_WRITE, false, 0);
+    get_section(&assembler, ".bss", 4, SECTION_FLAG_ALLOC | SECTION_FLAG_WRITE, true, 0);
+
+    // sPʂŏȂ珈̂ŕĂ
+    const size_t len = strlen(pszAsm);
+    char* pText = malloc(len + 1);
+    memcpy(pText, pszAsm, len + 1);
+
+    char* p = pText;
+    while (*p) {
+        char* pEol = strchr(p, '\n');
+        if (pEol) *pEol = '\0';
+
+        ++assembler.lineNo;
+        process_line(&assembler, p);
+
+        if (!pEol) break;
+        p = pEol + 1;
+    }
+
+    // fobO̓R[h̃ZNV̑傫܂Ă
+    if (assembler.isInCfiProc) {
+        asm_error(&assembler, ".cfi_endproc is missing");
+    }
+    if (assembler.debugLineCount) {
+        emit_debug_info(&assembler, emit_debug_line(&assembler));
+    }
+    if (assembler.cfiProcCount) {
+        emit_eh_frame(&assembler);
+    }
+
+    resolve_refs(&assembler);
+
+    for (int i = 0; i < assembler.debugFileCount; ++i) {
+        free(assembler.ppDebugFiles[i]);
+    }
+    free(assembler.ppDebugFiles);
+    free(assembler.pDebugLines);
+    free(assembler.pCfiInsns);
+    free(assembler.pCfiProcs);
+    free(pText);
+    free(assembler.pRefs);
+    free(assembler.pSymHash);
+    return assembler.pObj;
+}
+
+// assembleԂĔzu\IuWFNg
+void free_obj(ObjFile* pObj) {
+    for (int i = 0; i < pObj->sectionCount; ++i) {
+        free(pObj->pSections[i].name);
+        free(pObj->pSections[i].data);
+        free(pObj->pSections[i].pRelocs);
+    }
+    for (int i = 0; i < pObj->symbolCount; ++i) {
+        free(pObj->pSymbols[i].name);
+    }
+    free(pObj->pSections);
+    free(pObj->pSymbols);
+    free(pObj);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ZNV̑iELFSHF_*Ɠlj
+#define SECTION_FLAG_WRITE      (0x1)
+#define SECTION_FLAG_ALLOC      (0x2)
+#define SECTION_FLAG_EXEC       (0x4)
+#define SECTION_FLAG_MERGE      (0x10)
+#define SECTION_FLAG_STRINGS    (0x20)
+
+// Ĕzu̎ށiELFR_X86_64_*Ɠlj
+typedef enum {
+    RELOC_ABS64 = 1,    // S + A
+    RELOC_PC32 = 2,     // S + A - P
+    RELOC_PLT32 = 4,    // L + A - Pi֐Ăяoj
+    RELOC_ABS32 = 10,   // S + AifobO񂩂瑼̃ZNVւ̃ItZbgj
+} RelocKind;
+
+typedef struct ObjReloc ObjReloc;
+typedef struct ObjSection ObjSection;
+typedef struct ObjSymbol ObjSymbol;
+typedef struct ObjFile ObjFile;
+
+// Ĕzu
+struct ObjReloc {
+    size_t offset;          // ʒuiZNV擪̃ItZbgj
+    RelocKind kind;         // Ĕzu̎
+    int symbol;             // QƐV{̔ԍ
+    int64_t addend;         // 
+};
+
+// ZNV
+struct ObjSection {
+    char* name;             // ZNV
+    unsigned int flags;     // SECTION_FLAG_*̑gݍ킹
+    bool isNoBits;          // eȂi.bssjȂtrue
+    uint8_t* data;          // eiisNoBitsȂNULLj
+    size_t size;            // e̒
+    size_t cap;             // datåmۍςݗe
+    size_t align;           // ACg
+    size_t entSize;         // }[W\ȃZNV̗vfTCY
+    ObjReloc* pRelocs;      // Ĕzu
+    int relocCount;         // Ĕzu̐
+    int relocCap;           // pRelocs̊mۍςݗe
+};
+
+// V{
+struct ObjSymbol {
+    char* name;             // V{
+    int section;            // `ĂZNV̔ԍi`Ȃ-1j
+    size_t offset;          // ZNV擪̃ItZbg
+    bool isGlobal;          // .globlŌJĂȂtrue
+};
+
+// Ĕzu\IuWFNg
+struct ObjFile {
+    ObjSection* pSections;  // ZNV
+    int sectionCount;       // ZNV̐
+    ObjSymbol* pSymbols;    // V{
+    int symbolCount;        // V{̐
+};
+
+// IntelL@̃AZux86-64̋@Bɕϊ
+// ZNṼxQƂ͂ŉAȊO͍ĔzuƂĎc
+// .file/.loc͍sԍ̑Ήi.debug_linejA.cfi_*͊߂i.eh_framej
+ObjFile* assemble(const char* pszAsm);
+
+// assembleԂĔzu\IuWFNg
+void free_obj(ObjFile* pObj);
@@ -1,6 +1,9 @@
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 #include <ctype.h>
+#include <setjmp.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -11,14 +14,50 @@
 #include "parser.h"
 #include "asm_gen.h"
 #include "error.h"
+#include "strbuf.h"
+#include "arena.h"
+#include "thread.h"
+#include "sha256.h"
+#include "incremental.h"
+#include "profile.h"
+#include "source.h"
+#include "time_trace.h"
 
 #define MAX_FUNC_NAME_LEN (64)
 
+// ֐`̐ȏ゠ƂA֐Ƃ̃R[hɍs
+#define PARALLEL_GEN_MIN_FUNCS (64)
+
+// ̎s񐔂̂̕1ȉȂA͊̕֐̖֒ǂo
+#define COLD_BRANCH_RATIO (16)
+
+// ֐̓ƃ[v̐擪𑵂鋫Ei2ׂ̂̎wj
+#define CODE_ALIGN_LOG2 (4)
+
+// switchcase̐ȉȂAlɔr
+#define SWITCH_CHAIN_MAX_CASES (3)
+
+// case̒l͈̔͂case̐̂̔{ȉȂAWve[uŕ򂷂
+#define SWITCH_TABLE_MAX_RATIO (4)
+
+// vʂo֐́AޔWX^艺Ɋmۂ̈̑傫
+// iWindowsł̓VhË32oCgɎgArsp16̔{ɂ낦镪8oCgj
+#define PROFILE_DUMP_FRAME_SIZE (40)
+
+#ifndef _STATIC_ASSERT
+#define _STATIC_ASSERT(expr) _Static_assert(expr, #expr)
+#endif
+
 typedef struct Type Type;
 typedef struct GVar GVar;
 typedef struct LVar LVar;
 typedef struct GlobalContext GlobalContext;
 typedef struct FuncContext FuncContext;
+typedef struct FuncJob FuncJob;
+typedef struct ArgState ArgState;
+typedef struct FuncInfo FuncInfo;
+typedef struct SwitchCase SwitchCase;
+typedef struct SwitchContext SwitchContext;
 
 struct Type {
     enum { TY_VOID, TY_CHAR, TY_INT, TY_PTR, TY_ARRAY } ty;
@@ -48,43 +87,162 @@ struct LVar {
     int offset;             // RBP̃ItZbg
 };
 
+// Ăяon̒li-fwhole-programŃvOŜ̌Ăяo𒲂ׂČ߂j
+struct ArgState {
+    enum { ARG_UNKNOWN, ARG_CONST, ARG_VARYING } kind; // ܂lnĂяo^SĂ̌Ăяoœ萔^ȊO
+    int val;                // kindARG_CONST̏ꍇA̒l
+};
+
+// ֐e[u̗vfiĂяoOt̒_j
+struct FuncInfo {
+    const Node* pNode;      // ֐`m[h
+    const Node* pBody;      // {́i萔̈΁A̒lœꉻ{́j
+    int index;              // \[XR[h̏ԁippFuncs̓Yj
+    int paramCount;         // ̐
+    ArgState args[4];       // Ƃ̒li萔̈͌ĂяoœnA{̂ł͒lɒuj
+    bool isExported;        // ̃IuWFNgĂ΂ꂤi.globltjȂtrue
+    bool isReachable;       // OĂ΂ꂤ֐ĂяoHē͂Ȃtruei͂ȂΏo͂Ȃj
+};
+
 // O[o̊
 struct GlobalContext {
-    int labelCount;
     GVar* pGVars;           // O[oϐe[u
-    //TODO:֐e[u
+    FuncInfo* pFuncInfos;   // ֐e[uiȌB-fwhole-programŌĂяoOtꍇj
+    int funcInfoCount;      // pFuncInfos̗vf
+    const Node** ppFuncs;   // ֐`m[hi\[XR[h̏j
+    int funcCount;          // ֐`̐
+    int funcCap;            // ppFuncs̊mۍςݗe
+    FuncCodeCache* pFuncCache; // O̊֐Ƃ̐ʁiCN^RpCȂȂNULLj
+    const ProfileOptions* pProfile; // vt@C̈igȂȂNULLj
+    bool isDebugInfo;       // .file/.loc.cfi_*o͂Ȃtrue
+    const SourceFile** ppDebugFiles; // .fileŔԍt\[Xiԍ-1̈ʒuj
+    int debugFileCount;     // .fileŔԍt\[X̐
+};
+
+// ֐1̃R[h
+struct FuncJob {
+    const Node* pNode;                      // ֐`m[h
+    const FuncInfo* pFunc;                  // ֐e[u̗vfiĂяoOtĂȂNULLj
+    const GlobalContext* pGlobalContext;    // O[o̊iǂݎpj
+    StrBuf out;                             // ̊֐̃AZu
+    StrBuf errors;                          // ̊֐̃R[hɕ񍐂ꂽG[
+    bool isFailed;                          // G[Ȃtrue
+    uint8_t fingerprint[SHA256_DIGEST_SIZE];// ֐̎wiCN^RpCpj
+    bool isReused;                          // O̐ʂėpȂtrue
+    int counterCount;                       // v_̐ivR[h𖄂ߍޏꍇj
+    char profileHash[PROFILE_HASH_LEN + 1]; // \nbVivR[h𖄂ߍޏꍇj
+};
+
+// switchcasex
+struct SwitchCase {
+    int val;                // case̒l
+    int labelId;            // x̔ԍ
+    const Node* pNode;      // casex̃m[h
+};
+
+// R[hswitch
+struct SwitchContext {
+    SwitchCase* pCases;     // casexil̏j
+    int caseCount;          // casex̐
+    int defaultLabelId;     // defaultx̔ԍi-1j
 };
 
 // ֐`̊
 struct FuncContext {
     LVar* pLVars;           // [Jϐe[uiWJj
+    const char* pszFuncName; // ֐ix̖Oԁj
+    int labelCount;         // ֐ŕox̐
+    bool isInstrumented;    // vR[h𖄂ߍނȂtrue
+    bool isProfileDumper;   // ߂ƂɌvʂo֐ivR[h𖄂ߍmainjȂtrue
+    const FuncProfile* pFuncProfile; // ̊֐̌vʁiA֐̌`ςĂNULLj
+    int counterCount;       // ֐ŕov_̐
+    StrBuf coldCode;        // őɎsȂi֐̖ɂ܂Ƃ߂ďo͂j
+    bool isEmittingCold;    // coldCode֏o͂ĂԂtrue
+    int locFileNo;          // Ō.locŏo͂t@Cԍio͐؂ւ0ɖ߂j
+    int locLine;            // Ō.locŏo͂sԍ
+    bool isIotaUsed;        // xNg[vŗUϐ̏lɑ萔i0, 1, 2, 3jgȂtrue
+    int breakLabelId;       // breakŔił̃[vswitchjendx̔ԍi-1j
+    const SwitchContext* pSwitch; // łswitchiNULLj
+    StrBuf jumpTables;      // switch̃Wve[ui֐̌.rodataƂĂ܂Ƃ߂ďo͂j
 };
 
 #define PARAM_REG_INDEX_64BIT  (3)
 #define PARAM_REG_INDEX_32BIT  (2)
 #define PARAM_REG_INDEX_16BIT  (1)
 #define PARAM_REG_INDEX_8BIT   (0)
+#ifdef _WIN32
+// Microsoft x64ĂяoK
 static const char PARAM_REG_NAME[][4][4] = {
     {  "cl",  "dl", "r8b", "r9b" },
     {  "cx",  "dx", "r8w", "r9w" },
     { "ecx", "edx", "r8d", "r9d" },
     { "rcx", "rdx", "r8" , "r9"  },
 };
+#else
+// System V AMD64 ABIĂяoK
+static const char PARAM_REG_NAME[][4][4] = {
+    { "dil", "sil",  "dl",  "cl" },
+    {  "di",  "si",  "dx",  "cx" },
+    { "edi", "esi", "edx", "ecx" },
+    { "rdi", "rsi", "rdx", "rcx" },
+};
+#endif
 _STATIC_ASSERT(sizeof(PARAM_REG_NAME[0]) / sizeof(PARAM_REG_NAME[0][0]) == sizeof(((Node*)0)->children) / sizeof(((Node*)0)->children[0]));
-
-static const Type* gen_left_expr(const Node* pNode, GlobalContext* pGlobalContext, const FuncContext* pContext);
-static void gen_if_stmt(const Node* pNode, GlobalContext* pGlobalContext, const FuncContext* pContext);
-static void gen_while_stmt(const Node* pNode, GlobalContext* pGlobalContext, const FuncContext* pContext);
-static void gen_for_stmt(const Node* pNode, GlobalContext* pGlobalContext, const FuncContext* pContext);
-static const Type* gen_invoke_expr(const Node* pNode, GlobalContext* pGlobalContext, const FuncContext* pContext);
+_STATIC_ASSERT(sizeof(((FuncInfo*)0)->args) / sizeof(((FuncInfo*)0)->args[0]) == sizeof(((Node*)0)->children) / sizeof(((Node*)0)->children[0]));
+
+static THREAD_LOCAL StrBuf* s_pOut;      // AZȕo͐
+static THREAD_LOCAL int s_suppressCount; // 0傫Ԃ͏o͂̂Ă
+
+static const Type* gen_left_expr(const Node* pNode, const GlobalContext* pGlobalContext, FuncContext* pContext);
+static void gen_if_stmt(const Node* pNode, const GlobalContext* pGlobalContext, FuncContext* pContext);
+static void gen_while_stmt(const Node* pNode, const GlobalContext* pGlobalContext, FuncContext* pContext);
+static void gen_for_stmt(const Node* pNode, const GlobalContext* pGlobalContext, FuncContext* pContext);
+static void gen_switch_stmt(const Node* pNode, const GlobalContext* pGlobalContext, FuncContext* pContext);
+static int collect_switch_cases(const Node* pNode, SwitchCase* pCases, int count, const Node** ppDefault);
+static const Type* gen_invoke_expr(const Node* pNode, const GlobalContext* pGlobalContext, FuncContext* pContext);
 static const Type* gen_add_expr(const Node* pNode, const Type* pLhsType, const Type* pRhsType);
 static const Type* gen_sub_expr(const Node* pNode, const Type* pLhsType, const Type* pRhsType);
 static const Type* gen_mul_expr(const Node* pNode, const Type* pLhsType, const Type* pRhsType);
 static const Type* gen_div_expr(const Node* pNode, const Type* pLhsType, const Type* pRhsType);
-static const Type* gen_local_node(const Node* pNode, GlobalContext* pGlobalContext, const FuncContext* pContext);
-static void gen_def_func(const Node* pNode, GlobalContext* pGlobalContext);
+static const Type* gen_local_node(const Node* pNode, const GlobalContext* pGlobalContext, FuncContext* pContext);
+static void gen_discarded_expr(const Node* pNode, const GlobalContext* pGlobalContext, FuncContext* pContext);
+static void gen_def_func(const Node* pNode, const GlobalContext* pGlobalContext, FuncJob* pJob);
 static void gen_global_node(const Node* pNode, GlobalContext* pGlobalContext);
 
+// AZu1so͂
+// printfƓ󂯎
+static void emit(const char* fmt, ...) {
+    if (0 < s_suppressCount) {
+        return;
+    }
+
+    va_list ap;
+    va_start(ap, fmt);
+    strbuf_vprintf(s_pOut, fmt, ap);
+    va_end(ap);
+}
+
+// -gȂAm[h̃g[Ns.locŏo͂iOɏo͂sƓȂȂj
+// .fileŔԍtĂȂ\[Xi}NWJōȂǁj̃g[Nł͏o͂Ȃ
+static void gen_loc(const Node* pNode, const GlobalContext* pGlobalContext, FuncContext* pContext) {
+    if (!pGlobalContext->isDebugInfo || 0 < s_suppressCount || pNode->pToken == NULL) return;
+    if (pNode->kind == ND_NOP || pNode->kind == ND_TYPE || pNode->kind == ND_DECL_VAR) return;   // R[ho͂Ȃm[h
+
+    const SourceFile* pFile = find_source_file(pNode->pToken->loc);
+    int fileNo = 0;
+    for (int i = 0; pFile && i < pGlobalContext->debugFileCount; ++i) {
+        if (pGlobalContext->ppDebugFiles[i] == pFile) fileNo = i + 1;
+    }
+    if (fileNo == 0) return;
+
+    const char* pLine;
+    const int line = get_source_line(pNode->pToken->loc, &pLine);
+    if (fileNo == pContext->locFileNo && line == pContext->locLine) return;
+    emit("  .loc %d %d\n", fileNo, line);
+    pContext->locFileNo = fileNo;
+    pContext->locLine = line;
+}
+
 // ϐ𖼑OŌBȂꍇNULLԂB
 static const LVar* find_lvar(const LVar* pLVarTop, const Node* pNode) {
     for (const LVar* pVar = pLVarTop; pVar; pVar = pVar->next) {
@@ -104,6 +262,27 @@ static const GVar* find_gvar(const GVar* pGVarTop, const Node* pNode) {
     return NULL;
 }
 
+// ֐ׂi֐e[u̕яj
+static int compare_func_name(const Token* pLhs, const Token* pRhs) {
+    const int result = memcmp(pLhs->str, pRhs->str, pLhs->len < pRhs->len ? pLhs->len : pRhs->len);
+    return result ? result : (pLhs->len > pRhs->len) - (pLhs->len < pRhs->len);
+}
+
+static int compare_func_info_by_name(const void* pKey, const void* pElem) {
+    return compare_func_name((const Token*)pKey, ((const FuncInfo*)pElem)->pNode->pToken);
+}
+
+// ֐e[u֐𖼑OŌBȂꍇie[uꍇjNULLԂB
+static const FuncInfo* find_func_info(const GlobalContext* pGlobalContext, const Token* pName) {
+    if (pGlobalContext->pFuncInfos == NULL) return NULL;
+    return bsearch(pName, pGlobalContext->pFuncInfos, pGlobalContext->funcInfoCount, sizeof(FuncInfo), compare_func_info_by_name);
+}
+
+// ֐indexԖڂ̈萔Ɍ܂ĂāAĂяoœnȂĂ悢Ȃtrue
+static bool is_const_arg(const FuncInfo* pFunc, int index) {
+    return pFunc && index < pFunc->paramCount && pFunc->args[index].kind == ARG_CONST;
+}
+
 static size_t get_type_size(const Type* pType) {
     switch (pType->ty) {
     case TY_CHAR:
@@ -123,13 +302,13 @@ static size_t get_type_size(const Type* pType) {
 static void eval_var(const Type* pType, const char* pszRegName) {
     switch (pType->ty) {
     case TY_CHAR:
-        printf("  movsx %s, BYTE PTR [%s]\n", pszRegName, pszRegName);
+        emit("  movsx %s, BYTE PTR [%s]\n", pszRegName, pszRegName);
         break;
     case TY_INT:
-        printf("  movsx %s, DWORD PTR [%s]\n", pszRegName, pszRegName);
+        emit("  movsx %s, DWORD PTR [%s]\n", pszRegName, pszRegName);
         break;
     case TY_PTR:
-        printf("  mov %s, [%s]\n", pszRegName, pszRegName);
+        emit("  mov %s, [%s]\n", pszRegName, pszRegName);
         break;
     case TY_ARRAY:
         //|C^^͂̎wɂloƂŕ]ƂȂ邪Az^͂̎wɂl[0]̗vf̂
@@ -141,10 +320,10 @@ static void eval_var(const Type* pType, const char* pszRegName) {
 }
 
 static Type* parse_type(const Node* pNode) {
-    Type* pType = calloc(1, sizeof(Type));
+    Type* pType = arena_calloc(1, sizeof(Type));
 
     if (pNode->kind != ND_TYPE) {
-        error_at(pNode->pToken->filename, pNode->pToken->user_input, pNode->pToken->str, "^Kvł");
+        error_at(pNode->pToken->loc, "^Kvł");
     }
 
     switch (pNode->pToken->kind) {
@@ -155,12 +334,12 @@ static Type* parse_type(const Node* pNode) {
         pType->ty = TY_INT;
         break;
     default:
-        error_at(pNode->pToken->filename, pNode->pToken->user_input, pNode->pToken->str, "`̌^ł");
+        error_at(pNode->pToken->loc, "`̌^ł");
     }
 
     const Node* pCurNode = pNode;
     while (pCurNode->rhs != NULL) {
-        Type* pNewType = calloc(1, sizeof(Type));
+        Type* pNewType = arena_calloc(1, sizeof(Type));
         pNewType->ptr_to = pType;
 
         switch (pCurNode->rhs->kind) {
@@ -186,10 +365,10 @@ static Type* parse_type(const Node* pNode) {
 static int resigter_lvars(FuncContext* pContext, const Node* pNode) {
     if (pNode->kind == ND_DECL_VAR) {
         if (find_lvar(pContext->pLVars, pNode) != NULL) {
-            error_at(pNode->pToken->filename, pNode->pToken->user_input, pNode->pToken->str, "[JϐdĂ܂");
+            error_at(pNode->pToken->loc, "[JϐdĂ܂");
         }
 
-        LVar* pVar = calloc(1, sizeof(LVar));
+        LVar* pVar = arena_calloc(1, sizeof(LVar));
         pVar->next = pContext->pLVars;
         pVar->pType = parse_type(pNode->lhs);
         pVar->pType->is_lvalue = true;
@@ -214,7 +393,7 @@ static int resigter_params(FuncContext* pContext, const Node* pNode) {
         if (pNode->children[paramNum] == NULL) break;
 
         if (find_lvar(pContext->pLVars, pNode->children[paramNum]) != NULL) {
-            error_at(pNode->children[paramNum]->pToken->filename, pNode->children[paramNum]->pToken->user_input, pNode->children[paramNum]->pToken->str, "dĂ܂");
+            error_at(pNode->children[paramNum]->pToken->loc, "dĂ܂");
         }
 
         resigter_lvars(pContext, pNode->children[paramNum]);
@@ -223,13 +402,100 @@ static int resigter_params(FuncContext* pContext, const Node* pNode) {
     return paramNum;
 }
 
-static const Type* gen_left_expr(const Node* pNode, GlobalContext* pGlobalContext, const FuncContext* pContext) {
+// v_𕥂oĂ̔ԍԂ
+// ԍ̓R[h̏ɐÛŁA֐̌`ȂvƗpňv
+static int new_counter(FuncContext* pContext) {
+    return pContext->counterCount++;
+}
+
+// vR[h𖄂ߍނȂAv_ʂ񐔂𐔂R[ho͂
+// tÔŁAubN̐擪ɒu
+static void gen_count(const FuncContext* pContext, int counterId) {
+    if (pContext->isInstrumented) {
+        emit("  inc QWORD PTR .L%s.prof%04d[rip]\n", pContext->pszFuncName, counterId);
+    }
+}
+
+// v_ʂ񐔂Ԃivʂ-1j
+static int64_t get_count(const FuncContext* pContext, int counterId) {
+    const FuncProfile* pFuncProfile = pContext->pFuncProfile;
+    if (pFuncProfile == NULL || pFuncProfile->counterCount <= counterId) return -1;
+    return (int64_t)pFuncProfile->pCounters[counterId];
+}
+
+// ̍ŌオreturnŁA֎si܂ȂȂtrueԂ
+static bool ends_with_return(const Node* pNode) {
+    while (pNode && pNode->kind == ND_BLOCK) {
+        if (pNode->rhs == NULL) return ends_with_return(pNode->lhs);
+        pNode = pNode->rhs;
+    }
+    return pNode && pNode->kind == ND_RETURN;
+}
+
+// s񐔂̕Ɣׂď\ɏȂA֐̖֒ǂoȂtrueԂ
+static bool is_cold_branch(const FuncContext* pContext, int64_t count, int64_t otherCount) {
+    // ǂołɒǂoƁAǂõubN̓rɕʂ̃ubN܂Ă܂
+    return !pContext->isEmittingCold && 0 <= count && 0 < otherCount && count * COLD_BRANCH_RATIO <= otherCount;
+}
+
+// 򂵂ẴubNo͂
+// ÕubN͗ĂȂ̂ŁA擪ɃxuAŌendx֐i
+// isColdȂ.text.unlikely֒ǂoA悭s鑤̃R[hl߂Ēu悤ɂ
+static void gen_branch_target(const Node* pBody, int counterId, const char* pszLabelKind, int labelId, int endLabelId, bool isCold,
+    const GlobalContext* pGlobalContext, FuncContext* pContext)
+{
+    StrBuf* pOldOut = s_pOut;
+    if (isCold) {
+        s_pOut = &pContext->coldCode;
+        pContext->isEmittingCold = true;
+        pContext->locFileNo = 0;
+    }
+    else {
+        emit("  jmp .L%s.end%04d\n", pContext->pszFuncName, endLabelId);
+    }
+
+    emit(".L%s.%s%04d:\n", pContext->pszFuncName, pszLabelKind, labelId);
+    gen_count(pContext, counterId);
+    if (pBody) gen_local_node(pBody, pGlobalContext, pContext);
+
+    if (isCold) {
+        if (!ends_with_return(pBody)) {
+            emit("  jmp .L%s.end%04d\n", pContext->pszFuncName, endLabelId);
+        }
+        pContext->isEmittingCold = false;
+        pContext->locFileNo = 0;
+        s_pOut = pOldOut;
+    }
+}
+
+// ֐߂R[ho͂i߂lraxɓĂj
+static void gen_return(const GlobalContext* pGlobalContext, const FuncContext* pContext) {
+    // vR[h𖄂ߍmainł́A߂OɌvʂo
+    if (pContext->isProfileDumper) {
+        emit("  push rax\n");
+        emit("  push r15\n");
+        emit("  mov  r15, rsp\n");
+        emit("  and  rsp, -16\n");
+        emit("  call .Lprof.dump\n");
+        emit("  mov  rsp, r15\n");
+        emit("  pop  r15\n");
+        emit("  pop  rax\n");
+    }
+    emit("  mov rsp, rbp\n");
+    emit("  pop rbp\n");
+    if (pGlobalContext->isDebugInfo) {
+        emit("  .cfi_def_cfa rsp, 8\n");
+    }
+    emit("  ret\n");
+}
+
+static const Type* gen_left_expr(const Node* pNode, const GlobalContext* pGlobalContext, FuncContext* pContext) {
     if (pNode->kind == ND_VAR) {
         const LVar* pLVar = find_lvar(pContext->pLVars, pNode);
         if (pLVar != NULL) {
-            printf("  mov rax, rbp\n");
-            printf("  sub rax, %d\n", pLVar->offset);
-            printf("  push rax\n");
+            emit("  mov rax, rbp\n");
+            emit("  sub rax, %d\n", pLVar->offset);
+            emit("  push rax\n");
             return pLVar->pType;
         }
 
@@ -237,26 +503,26 @@ static const Type* gen_left_expr(const Node* pNode, GlobalContext* pGlobalContex
         if (pGVar != NULL) {
             char pszFormat[64] = { 0 };
             snprintf(pszFormat, sizeof(pszFormat), "  lea rax, %%.%ds[rip]\n", pGVar->len);
-            printf(pszFormat, pGVar->name);
-            printf("  push rax\n");
+            emit(pszFormat, pGVar->name);
+            emit("  push rax\n");
             return pGVar->pType;
         }
 
-        error_at(pNode->pToken->filename, pNode->pToken->user_input, pNode->pToken->str, "`̕ϐł");
+        error_at(pNode->pToken->loc, "`̕ϐł");
         return NULL;
     }
     else if (pNode->kind == ND_DEREF) {
         // P*
         const Type* pType = gen_local_node(pNode->lhs, pGlobalContext, pContext);
         if (pType->ty != TY_PTR && pType->ty != TY_ARRAY) {
-            error_at(pNode->pToken->filename, pNode->pToken->user_input, pNode->pToken->str, "|C^^ł͂Ȃl̓ft@Xł܂");
+            error_at(pNode->pToken->loc, "|C^^ł͂Ȃl̓ft@Xł܂");
         }
 
         if (pType->ptr_to->is_lvalue) {
             return pType->ptr_to;
         }
         else {
-            Type* pResultType = calloc(1, sizeof(Type));
+            Type* pResultType = arena_calloc(1, sizeof(Type));
             memcpy(pResultType, pType->ptr_to, sizeof(Type));
             pResultType->is_lvalue = true;
             return pResultType;
@@ -266,69 +532,212 @@ static const Type* gen_left_expr(const Node* pNode, GlobalContext* pGlobalContex
         const Token* pCurToken = pNode->pToken;
         const Type* pType = gen_local_node(pNode, pGlobalContext, pContext);
         if (!pType->is_lvalue) {
-            error_at(pCurToken->filename, pCurToken->user_input, pCurToken->str, "ȍӒlł");
+            error_at(pCurToken->loc, "ȍӒlł");
         }
         return pType;
     }
 }
 
-static void gen_if_stmt(const Node* pNode, GlobalContext* pGlobalContext, const FuncContext* pContext) {
-    const int endLabelId = pGlobalContext->labelCount++;
+// r̃m[h̎ނɑΉAr藧Ƃ̕򖽗߂̏
+static const char* get_compare_cc(NodeKind kind, bool isNegated) {
+    switch (kind) {
+    case ND_EQ: return isNegated ? "ne" : "e";
+    case ND_NE: return isNegated ? "e" : "ne";
+    case ND_LT: return isNegated ? "ge" : "l";
+    case ND_LE: return isNegated ? "g" : "le";
+    default:
+        error("Internal Error. Invalid NodeKind '%d'.", kind);
+        return NULL;
+    }
+}
+
+// ]A^UisJumpIfTrueƈvpszLabelKindlabelId̃xփWvR[ho͂
+// vȂΌ֐i
+// &&A||A!Ɣr0/1̒l炸ɕ̘AȂɂA&&||͌ʂ̌܂_Ŏc]ɔ
+static void gen_cond_jump(const Node* pNode, bool isJumpIfTrue, const char* pszLabelKind, int labelId,
+    const GlobalContext* pGlobalContext, FuncContext* pContext)
+{
+    const char* pszFuncName = pContext->pszFuncName;
+
+    switch (pNode->kind) {
+    case ND_NUM:
+        // 萔Ȃ番򂷂邩ǂŌ܂iwhile (1)Ȃǁj
+        if ((pNode->pToken->val != 0) == isJumpIfTrue) {
+            emit("  jmp .L%s.%s%04d\n", pszFuncName, pszLabelKind, labelId);
+        }
+        return;
+    case ND_NOT:
+        gen_loc(pNode, pGlobalContext, pContext);
+        gen_cond_jump(pNode->lhs, !isJumpIfTrue, pszLabelKind, labelId, pGlobalContext, pContext);
+        return;
+    case ND_LOGAND:
+    case ND_LOGOR:
+        gen_loc(pNode, pGlobalContext, pContext);
+        if ((pNode->kind == ND_LOGAND) == isJumpIfTrue) {
+            // &&^i||UjɂȂɂ͗ӂƂ^iUjłȂ΂ȂȂ̂ŁA
+            // ӂŌ܂ȂΉEӂ]ɂ̎̌֔
+            const int skipLabelId = pContext->labelCount++;
+            gen_cond_jump(pNode->lhs, !isJumpIfTrue, "skip", skipLabelId, pGlobalContext, pContext);
+            gen_cond_jump(pNode->rhs, isJumpIfTrue, pszLabelKind, labelId, pGlobalContext, pContext);
+            emit(".L%s.skip%04d:\n", pszFuncName, skipLabelId);
+        }
+        else {
+            // &&Ui||^jɂȂɂ͂ǂ炩̕ӂUi^jł΂悢̂ŁAӂŕł
+            gen_cond_jump(pNode->lhs, isJumpIfTrue, pszLabelKind, labelId, pGlobalContext, pContext);
+            gen_cond_jump(pNode->rhs, isJumpIfTrue, pszLabelKind, labelId, pGlobalContext, pContext);
+        }
+        return;
+    case ND_EQ:
+    case ND_NE:
+    case ND_LT:
+    case ND_LE:
+        // řʂtÔ܂ܕɎg
+        gen_loc(pNode, pGlobalContext, pContext);
+        gen_local_node(pNode->lhs, pGlobalContext, pContext);
+        gen_local_node(pNode->rhs, pGlobalContext, pContext);
+        emit("  pop rdi\n");
+        emit("  pop rax\n");
+        emit("  cmp rax, rdi\n");
+        emit("  j%-2s .L%s.%s%04d\n", get_compare_cc(pNode->kind, !isJumpIfTrue), pszFuncName, pszLabelKind, labelId);
+        return;
+    default:
+        gen_local_node(pNode, pGlobalContext, pContext);
+        emit("  pop rax\n");
+        emit("  cmp rax, 0\n");
+        emit("  %s .L%s.%s%04d\n", isJumpIfTrue ? "jne" : "je ", pszFuncName, pszLabelKind, labelId);
+        return;
+    }
+}
+
+static void gen_if_stmt(const Node* pNode, const GlobalContext* pGlobalContext, FuncContext* pContext) {
+    // 萔i萔̈œꉻ֐ȂǁjȂAsȂ͏o͂Ȃ
+    // G[̕񍐂ςȂ悤AsȂo͂̂ĂȂR[h͍s
+    // sȂɂswitchcasex΁A֔э߂̂Œʏʂ萶
+    if (pNode->children[0]->kind == ND_NUM) {
+        const bool isThen = pNode->children[0]->pToken->val != 0;
+        const Node* pDeadBranch = isThen ? pNode->rhs : pNode->lhs;
+        const Node* pDefaultNode = NULL;
+        if (collect_switch_cases(pDeadBranch, NULL, 0, &pDefaultNode) == 0 && pDefaultNode == NULL) {
+            if (isThen) gen_local_node(pNode->lhs, pGlobalContext, pContext);
+            if (pDeadBranch) {
+                ++s_suppressCount;
+                gen_local_node(pDeadBranch, pGlobalContext, pContext);
+                --s_suppressCount;
+            }
+            if (!isThen && pNode->rhs) gen_local_node(pNode->rhs, pGlobalContext, pContext);
+            return;
+        }
+    }
+
+    const int endLabelId = pContext->labelCount++;
+    const int thenCounter = new_counter(pContext);
+    const int elseCounter = new_counter(pContext);
+    int64_t thenCount = get_count(pContext, thenCounter);
+    int64_t elseCount = get_count(pContext, elseCounter);
+
+    // vʂ΁AreturnŔ邾if-branchiG[̑^[Ȃǁj͖őɎsȂƌȂ
+    if (pContext->pFuncProfile == NULL && pNode->rhs == NULL && ends_with_return(pNode->lhs)) {
+        thenCount = 0;
+        elseCount = 1;
+    }
+
+    if (thenCount < elseCount) {
+        // else̕悭ŝŁAelse𕪊򂹂ɑĎsł悤ɒu
+        const int thenLabelId = pContext->labelCount++;
 
-    // ]
-    gen_local_node(pNode->children[0], pGlobalContext, pContext);
-    printf("  pop rax\n");
-    printf("  cmp rax, 0\n");
+        // ^(0ȊO)ȂthenxփWv
+        gen_cond_jump(pNode->children[0], true, "then", thenLabelId, pGlobalContext, pContext);
 
-    if (pNode->rhs) {
-        const int elseLabelId = pGlobalContext->labelCount++;
+        // UȂelse-branchs
+        gen_count(pContext, elseCounter);
+        if (pNode->rhs) gen_local_node(pNode->rhs, pGlobalContext, pContext);
+
+        // thenxłif-branchs
+        gen_branch_target(pNode->lhs, thenCounter, "then", thenLabelId, endLabelId,
+            is_cold_branch(pContext, thenCount, elseCount), pGlobalContext, pContext);
+    }
+    else if (pNode->rhs || pContext->isInstrumented) {
+        const int elseLabelId = pContext->labelCount++;
 
         // U(0)ȂelsexփWv
-        printf("  je  .Lelse%04d\n", elseLabelId);
+        gen_cond_jump(pNode->children[0], false, "else", elseLabelId, pGlobalContext, pContext);
 
-        // ^Ȃ(elsexփWvĂȂȂ)if-branch]AendxփWv
+        // ^Ȃ(elsexփWvĂȂȂ)if-branch]
+        gen_count(pContext, thenCounter);
         gen_local_node(pNode->lhs, pGlobalContext, pContext);
-        printf("  jmp .Lend%04d\n", endLabelId);
 
-        // elsexłelse-branchsiendxւ͎RƗ邽߃Wvsvj
-        printf(".Lelse%04d:\n", elseLabelId);
-        gen_local_node(pNode->rhs, pGlobalContext, pContext);
+        // elsexłelse-branchsielse-branchĂAvȂelseʂ񐔂𐔂j
+        gen_branch_target(pNode->rhs, elseCounter, "else", elseLabelId, endLabelId,
+            is_cold_branch(pContext, elseCount, thenCount), pGlobalContext, pContext);
     }
     else {
         // U(0)ȂendxփWv
-        printf("  je  .Lend%04d\n", endLabelId);
+        gen_cond_jump(pNode->children[0], false, "end", endLabelId, pGlobalContext, pContext);
 
         // ^Ȃ(elsexփWvĂȂȂ)if-branchs
         gen_local_node(pNode->lhs, pGlobalContext, pContext);
     }
 
-    printf(".Lend%04d:\n", endLabelId);
+    emit(".L%s.end%04d:\n", pContext->pszFuncName, endLabelId);
 }
 
-static void gen_while_stmt(const Node* pNode, GlobalContext* pGlobalContext, const FuncContext* pContext) {
-    const int beginLabelId = pGlobalContext->labelCount++;
-    const int endLabelId = pGlobalContext->labelCount++;
+// 𖖔ɒuׂA悭JԂ[vȂtrueԂ
+// vʂΕς1ȏJԂ[vAΑSẴ[v悭JԂƌȂ
+static bool is_hot_loop(const FuncContext* pContext, int64_t entryCount, int64_t bodyCount) {
+    if (pContext->pFuncProfile == NULL) return true;
+    return 0 < entryCount && entryCount <= bodyCount;
+}
+
+// [vΏۂ̕o͂ibreakendLabelIdendx֔j
+static void gen_loop_body(const Node* pBody, int endLabelId, const GlobalContext* pGlobalContext, FuncContext* pContext) {
+    const int oldBreakLabelId = pContext->breakLabelId;
+    pContext->breakLabelId = endLabelId;
+    gen_local_node(pBody, pGlobalContext, pContext);
+    pContext->breakLabelId = oldBreakLabelId;
+}
 
-    printf(".Lbegin%04d:\n", beginLabelId);
+static void gen_while_stmt(const Node* pNode, const GlobalContext* pGlobalContext, FuncContext* pContext) {
+    const int beginLabelId = pContext->labelCount++;
+    const int endLabelId = pContext->labelCount++;
+    const int entryCounter = new_counter(pContext);
+    const int bodyCounter = new_counter(pContext);
+    gen_count(pContext, entryCounter);
+
+    if (is_hot_loop(pContext, get_count(pContext, entryCounter), get_count(pContext, bodyCounter))) {
+        // 悭JԂ[v͏𖖔ɒuA1̌JԂł̃Wv1ɂ
+        const int condLabelId = pContext->labelCount++;
+        emit("  jmp .L%s.cond%04d\n", pContext->pszFuncName, condLabelId);
+
+        // [vΏۂ̕si擪͒ÕWv̌Ȃ̂ŁA邽߂nop͎sȂj
+        emit("  .p2align %d\n", CODE_ALIGN_LOG2);
+        emit(".L%s.begin%04d:\n", pContext->pszFuncName, beginLabelId);
+        gen_count(pContext, bodyCounter);
+        gen_loop_body(pNode->rhs, endLabelId, pGlobalContext, pContext);
+
+        // ^(0ȊO)ȂbeginxփWv
+        emit(".L%s.cond%04d:\n", pContext->pszFuncName, condLabelId);
+        gen_cond_jump(pNode->lhs, true, "begin", beginLabelId, pGlobalContext, pContext);
+
+        emit(".L%s.end%04d:\n", pContext->pszFuncName, endLabelId);
+        return;
+    }
 
-    // ]
-    gen_local_node(pNode->lhs, pGlobalContext, pContext);
-    printf("  pop rax\n");
-    printf("  cmp rax, 0\n");
+    emit(".L%s.begin%04d:\n", pContext->pszFuncName, beginLabelId);
 
     // U(0)ȂendxփWv
-    printf("  je  .Lend%04d\n", endLabelId);
+    gen_cond_jump(pNode->lhs, false, "end", endLabelId, pGlobalContext, pContext);
 
     // [vΏۂ̕s
-    gen_local_node(pNode->rhs, pGlobalContext, pContext);
+    gen_count(pContext, bodyCounter);
+    gen_loop_body(pNode->rhs, endLabelId, pGlobalContext, pContext);
 
     // [v邽߂beginx֖Wv
-    printf("  jmp .Lbegin%04d\n", beginLabelId);
+    emit("  jmp .L%s.begin%04d\n", pContext->pszFuncName, beginLabelId);
 
-    printf(".Lend%04d:\n", endLabelId);
+    emit(".L%s.end%04d:\n", pContext->pszFuncName, endLabelId);
 }
 
-static void gen_for_stmt(const Node* pNode, GlobalContext* pGlobalContext, const FuncContext* pContext) {
+static void gen_for_stmt(const Node* pNode, const GlobalContext* pGlobalContext, FuncContext* pContext) {
     /*
   ARpCR[h
 .LbeginXXX:
@@ -341,249 +750,1115 @@ static void gen_for_stmt(const Node* pNode, GlobalContext* pGlobalContext, const
   jmp .LbeginXXX
 .LendXXX:
     */
-    const int beginLabelId = pGlobalContext->labelCount++;
-    const int endLabelId = pGlobalContext->labelCount++;
+    const int beginLabelId = pContext->labelCount++;
+    const int endLabelId = pContext->labelCount++;
+    const int entryCounter = new_counter(pContext);
+    const int bodyCounter = new_counter(pContext);
 
     // ]
     if (pNode->children[0]) {
-        gen_local_node(pNode->children[0], pGlobalContext, pContext);
-        // ̕]ʂƂăX^bNɈ̒lcĂ
-        // ͂Ȃ̂ŁAX^bNȂ悤Ƀ|bvĂ
-        printf("  pop rax\n");
+        gen_discarded_expr(pNode->children[0], pGlobalContext, pContext);
     }
+    gen_count(pContext, entryCounter);
+
+    if (is_hot_loop(pContext, get_count(pContext, entryCounter), get_count(pContext, bodyCounter))) {
+        // 悭JԂ[v͏𖖔ɒuA1̌JԂł̃Wv1ɂ
+        const int condLabelId = pContext->labelCount++;
+        emit("  jmp .L%s.cond%04d\n", pContext->pszFuncName, condLabelId);
+
+        // [vΏۂ̕ƁA[vƂɕ]鎮s
+        emit("  .p2align %d\n", CODE_ALIGN_LOG2);
+        emit(".L%s.begin%04d:\n", pContext->pszFuncName, beginLabelId);
+        gen_count(pContext, bodyCounter);
+        gen_loop_body(pNode->rhs, endLabelId, pGlobalContext, pContext);
+        if (pNode->children[2]) {
+            gen_discarded_expr(pNode->children[2], pGlobalContext, pContext);
+        }
 
-    printf(".Lbegin%04d:\n", beginLabelId);
+        // ^(0ȊO)ȂbeginxփWviΏɃWvj
+        emit(".L%s.cond%04d:\n", pContext->pszFuncName, condLabelId);
+        if (pNode->children[1]) {
+            gen_cond_jump(pNode->children[1], true, "begin", beginLabelId, pGlobalContext, pContext);
+        }
+        else {
+            emit("  jmp .L%s.begin%04d\n", pContext->pszFuncName, beginLabelId);
+        }
 
-    // ]
-    if (pNode->children[1]) {
-        gen_local_node(pNode->children[1], pGlobalContext, pContext);
-        printf("  pop rax\n");
-        printf("  cmp rax, 0\n");
+        emit(".L%s.end%04d:\n", pContext->pszFuncName, endLabelId);
+        return;
+    }
 
-        // U(0)ȂendxփWv
-        printf("  je  .Lend%04d\n", endLabelId);
+    emit(".L%s.begin%04d:\n", pContext->pszFuncName, beginLabelId);
+
+    // U(0)ȂendxփWv
+    if (pNode->children[1]) {
+        gen_cond_jump(pNode->children[1], false, "end", endLabelId, pGlobalContext, pContext);
     }
 
     // [vΏۂ̕s
-    gen_local_node(pNode->rhs, pGlobalContext, pContext);
+    gen_count(pContext, bodyCounter);
+    gen_loop_body(pNode->rhs, endLabelId, pGlobalContext, pContext);
 
     // [vƂɕ]鎮]
     if (pNode->children[2]) {
-        gen_local_node(pNode->children[2], pGlobalContext, pContext);
-        // ̕]ʂƂăX^bNɈ̒lcĂ
-        // ͂Ȃ̂ŁAX^bNȂ悤Ƀ|bvĂ
-        printf("  pop rax\n");
+        gen_discarded_expr(pNode->children[2], pGlobalContext, pContext);
     }
 
     // [v邽߂beginx֖Wv
-    printf("  jmp .Lbegin%04d\n", beginLabelId);
+    emit("  jmp .L%s.begin%04d\n", pContext->pszFuncName, beginLabelId);
 
-    printf(".Lend%04d:\n", endLabelId);
+    emit(".L%s.end%04d:\n", pContext->pszFuncName, endLabelId);
 }
 
-static const Type* gen_invoke_expr(const Node* pNode, GlobalContext* pGlobalContext, const FuncContext* pContext) {
-    int i;
-    char funcName[MAX_FUNC_NAME_LEN + 1] = { 0 };
+// switch̖{̂炱switchcasexW߁A̐ԂipCasesNULLȂ琔邾j
+// qswitch̒̃x͂switcĥ̂Ȃ̂Ŋ܂߂Ȃ
+static int collect_switch_cases(const Node* pNode, SwitchCase* pCases, int count, const Node** ppDefault) {
+    if (pNode == NULL || pNode->kind == ND_SWITCH) return count;
 
-    if (MAX_FUNC_NAME_LEN <= pNode->pToken->len) {
-        error_at(pNode->pToken->filename, pNode->pToken->user_input, pNode->pToken->str, "֐%dȏ゠܂", MAX_FUNC_NAME_LEN);
+    if (pNode->kind == ND_CASE) {
+        if (pCases) {
+            pCases[count].val = pNode->children[0]->pToken->val;
+            pCases[count].pNode = pNode;
+        }
+        ++count;
     }
-    memcpy(funcName, pNode->pToken->str, pNode->pToken->len);
-
-    // ɕ]āAΉ郌WX^Ɋi[
-    for (i = 0; i < sizeof(pNode->children) / sizeof(pNode->children[0]); ++i) {
-        if (pNode->children[i] == NULL) break;
-
-        gen_local_node(pNode->children[i], pGlobalContext, pContext);
-        printf("  pop %s\n", PARAM_REG_NAME[PARAM_REG_INDEX_64BIT][i]);
+    else if (pNode->kind == ND_DEFAULT) {
+        if (*ppDefault) {
+            error_at(pNode->pToken->loc, "defaultxdĂ܂");
+        }
+        *ppDefault = pNode;
     }
+    count = collect_switch_cases(pNode->lhs, pCases, count, ppDefault);
+    return collect_switch_cases(pNode->rhs, pCases, count, ppDefault);
+}
 
-    // ĂяoraxŜ𗘗pƂ͌Ȃ̂Ń[NA
-    printf("  mov rax, 0\n");
-
-    // rsp16̔{ɂ낦ix86-64ABIɂ鐧j
-    //     rspr15ɑޔĂ
-    //     ʃoCg0߂16̔{ɂȂ
-    // TODO: rsp16̔{ɂ낦Ă͂AꂾƍpxňُlԂ邽߉ʃoCgׂĂ0߂ĂB
-    //       ̏ԂłُlԂ邱Ƃ邪Apx͉ĂB
-    //       炭͑Ɏׂ񂪂̂ƎvB
-    printf("  mov  r15, rsp\n");
-    printf("  mov  spl, 0\n");
+static int compare_switch_case(const void* pLhs, const void* pRhs) {
+    const int lhs = ((const SwitchCase*)pLhs)->val;
+    const int rhs = ((const SwitchCase*)pRhs)->val;
+    return (lhs > rhs) - (lhs < rhs);
+}
 
-    printf("  call %s\n", funcName);
+// leaxɂԂŁApCasescountcasêǂꂩ̃xփWvR[ho͂
+// ǂƂvȂpszMissKindmissLabelId̃xidefaultendjփWv
+// ȂΏɔrAlɕł΃Wve[uAłȂΓ񕪒T
+static void gen_switch_dispatch(const SwitchCase* pCases, int count, const char* pszMissKind, int missLabelId, FuncContext* pContext) {
+    const char* pszFuncName = pContext->pszFuncName;
 
-    printf("  mov  rsp, r15\n");
+    if (count <= SWITCH_CHAIN_MAX_CASES) {
+        for (int i = 0; i < count; ++i) {
+            emit("  cmp eax, %d\n", pCases[i].val);
+            emit("  je  .L%s.case%04d\n", pszFuncName, pCases[i].labelId);
+        }
+        emit("  jmp .L%s.%s%04d\n", pszFuncName, pszMissKind, missLabelId);
+        return;
+    }
 
-    // ߂lraxɊi[Ă̂łpush
-    printf("  push rax\n");
+    // l͏ɕł̂ŁA͈͂͐擪Ɩ̍ŕiintm̍Ȃ̂int64_tŋ߂j
+    const int minVal = pCases[0].val;
+    const int64_t range = (int64_t)pCases[count - 1].val - minVal + 1;
+    if (range <= (int64_t)count * SWITCH_TABLE_MAX_RATIO) {
+        // ŏll𕄍Ŕr΁A͈͂̉1̔rŊO
+        // 32rbg̉ZȂ̂ŁArax̏32rbg0ɂȂe[u̓Yɂ̂܂܎g
+        const int tableLabelId = pContext->labelCount++;
+        emit("  sub eax, %d\n", minVal);
+        emit("  cmp eax, %d\n", (int)(range - 1));
+        emit("  ja  .L%s.%s%04d\n", pszFuncName, pszMissKind, missLabelId);
+        emit("  lea rdi, .L%s.table%04d[rip]\n", pszFuncName, tableLabelId);
+        emit("  movsxd rax, DWORD PTR [rdi+rax*4]\n");
+        emit("  add rax, rdi\n");
+        emit("  jmp rax\n");
+
+        // e[uɂ̓e[u擪̑ΈʒuuAʒuƗɂ
+        StrBuf* pOldOut = s_pOut;
+        s_pOut = &pContext->jumpTables;
+        emit("  .p2align 2\n");
+        emit(".L%s.table%04d:\n", pszFuncName, tableLabelId);
+        for (int i = 0; i < count; ++i) {
+            // case̖l͂ǂƂvȂꍇ̍sŖ߂
+            for (int64_t val = (i == 0) ? minVal : (int64_t)pCases[i - 1].val + 1; val < pCases[i].val; ++val) {
+                emit("  .long .L%s.%s%04d - .L%s.table%04d\n", pszFuncName, pszMissKind, missLabelId, pszFuncName, tableLabelId);
+            }
+            emit("  .long .L%s.case%04d - .L%s.table%04d\n", pszFuncName, pCases[i].labelId, pszFuncName, tableLabelId);
+        }
+        s_pOut = pOldOut;
+        return;
+    }
 
-    // TODO: ֐e[ûŁAint^߂l̊֐ĂяoƉ肵Ă
-    return &INT_TYPE;
+    // ̒lƔrA͑āA傫̓x̐œ悤ɕ򂷂
+    const int mid = count / 2;
+    const int upperLabelId = pContext->labelCount++;
+    emit("  cmp eax, %d\n", pCases[mid].val);
+    emit("  je  .L%s.case%04d\n", pszFuncName, pCases[mid].labelId);
+    emit("  jg  .L%s.upper%04d\n", pszFuncName, upperLabelId);
+    gen_switch_dispatch(pCases, mid, pszMissKind, missLabelId, pContext);
+    emit(".L%s.upper%04d:\n", pszFuncName, upperLabelId);
+    gen_switch_dispatch(pCases + mid + 1, count - mid - 1, pszMissKind, missLabelId, pContext);
 }
 
-static const Type* gen_add_expr(const Node* pNode, const Type* pLhsType, const Type* pRhsType) {
-    const Type* pResultType = NULL;
+static void gen_switch_stmt(const Node* pNode, const GlobalContext* pGlobalContext, FuncContext* pContext) {
+    const int endLabelId = pContext->labelCount++;
+
+    // casexW߂Ēl̏ɕׁAꂼɃxU
+    SwitchContext sw = { 0 };
+    const Node* pDefaultNode = NULL;
+    sw.caseCount = collect_switch_cases(pNode->rhs, NULL, 0, &pDefaultNode);
+    sw.pCases = arena_calloc(sw.caseCount ? sw.caseCount : 1, sizeof(SwitchCase));
+    pDefaultNode = NULL;
+    collect_switch_cases(pNode->rhs, sw.pCases, 0, &pDefaultNode);
+    qsort(sw.pCases, sw.caseCount, sizeof(SwitchCase), compare_switch_case);
+    for (int i = 0; i < sw.caseCount; ++i) {
+        if (0 < i && sw.pCases[i - 1].val == sw.pCases[i].val) {
+            error_at(sw.pCases[i].pNode->pToken->loc, "case̒ldĂ܂");
+        }
+        sw.pCases[i].labelId = pContext->labelCount++;
+    }
+    sw.defaultLabelId = pDefaultNode ? pContext->labelCount++ : -1;
 
-    switch (pLhsType->ty) {
-    case TY_CHAR:
-    case TY_INT:
-        switch (pRhsType->ty) {
-        case TY_CHAR:
-        case TY_INT:
-            pResultType = &INT_TYPE;
-            break;
-        case TY_PTR:
-        case TY_ARRAY:
-            //Ӓl̐l|C^w̌^TCY{
-            printf("  imul rax, %zd\n", get_type_size(pRhsType->ptr_to));
-            pResultType = pRhsType;
-            break;
-        default:
-            error("Internal Error. Invalid Type '%d'.", pRhsType->ty);
+    // ]icase̒lƓint^ƂĔrj
+    const Type* pType = gen_local_node(pNode->lhs, pGlobalContext, pContext);
+    if (pType->ty != TY_INT && pType->ty != TY_CHAR) {
+        error_at(pNode->pToken->loc, "switch̏͐łȂ΂Ȃ܂");
+    }
+    emit("  pop rax\n");
+    if (pNode->lhs->kind == ND_NUM) {
+        // 萔i萔̈œꉻ֐ȂǁjȂAs̃x֒ڃWv
+        const SwitchCase key = { pNode->lhs->pToken->val };
+        const SwitchCase* pCase = bsearch(&key, sw.pCases, sw.caseCount, sizeof(SwitchCase), compare_switch_case);
+        if (pCase) {
+            emit("  jmp .L%s.case%04d\n", pContext->pszFuncName, pCase->labelId);
         }
-        break;
-    case TY_PTR:
-    case TY_ARRAY:
-        switch (pRhsType->ty) {
-        case TY_CHAR:
-        case TY_INT:
-            //EӒl̐l|C^w̌^TCY{
-            printf("  imul rdi, %zd\n", get_type_size(pLhsType->ptr_to));
-            pResultType = pLhsType;
-            break;
-        case TY_PTR:
-        case TY_ARRAY:
-            error_at(pNode->pToken->filename, pNode->pToken->user_input, pNode->pToken->str, "|C^m̉Z͂ł܂");
-        default:
-            error("Internal Error. Invalid Type '%d'.", pRhsType->ty);
+        else {
+            emit("  jmp .L%s.%s%04d\n", pContext->pszFuncName, pDefaultNode ? "case" : "end", pDefaultNode ? sw.defaultLabelId : endLabelId);
         }
-        break;
-    default:
-        error("Internal Error. Invalid Type '%d'.", pLhsType->ty);
+    }
+    else if (pDefaultNode) {
+        gen_switch_dispatch(sw.pCases, sw.caseCount, "case", sw.defaultLabelId, pContext);
+    }
+    else {
+        gen_switch_dispatch(sw.pCases, sw.caseCount, "end", endLabelId, pContext);
     }
 
-    printf("  add rax, rdi\n");
+    // {̂͂ǂ̃xւ̃WvŎn܂̂ŁA擪͎sȂ
+    const SwitchContext* pOldSwitch = pContext->pSwitch;
+    const int oldBreakLabelId = pContext->breakLabelId;
+    pContext->pSwitch = &sw;
+    pContext->breakLabelId = endLabelId;
+    gen_local_node(pNode->rhs, pGlobalContext, pContext);
+    pContext->pSwitch = pOldSwitch;
+    pContext->breakLabelId = oldBreakLabelId;
 
-    return pResultType;
+    emit(".L%s.end%04d:\n", pContext->pszFuncName, endLabelId);
 }
 
-static const Type* gen_sub_expr(const Node* pNode, const Type* pLhsType, const Type* pRhsType) {
-    const Type* pResultType = NULL;
+// xmmWX^1{ɓint̐
+#define VECTOR_LANES (4)
+
+#ifdef _WIN32
+// Microsoft x64ĂяoKłxmm6`xmm15rsi͌Ăяoŕۑ郌WX^Ȃ̂ŎgȂ
+#define VECTOR_XMM_COUNT (6)
+static const char VECTOR_BASE_REG_NAME[][4] = { "r8", "r9", "r10", "r11" };
+#else
+#define VECTOR_XMM_COUNT (16)
+static const char VECTOR_BASE_REG_NAME[][4] = { "r8", "r9", "r10", "r11", "rsi" };
+#endif
+#define VECTOR_MAX_ARRAYS ((int)(sizeof(VECTOR_BASE_REG_NAME) / sizeof(VECTOR_BASE_REG_NAME[0])))
+
+// xNgfor[v̏
+typedef struct VectorLoop VectorLoop;
+struct VectorLoop {
+    const Node* pIndex;                                 // Uϐi1int^̃[Jϐj
+    const Node* pBound;                                 // JԂ̏i[vŕςȂlj
+    bool isBoundInclusive;                              // <=Ȃtrue
+    const Node* ppArrays[VECTOR_MAX_ARRAYS];            // UϐYɂēǂݏz
+    const Type* ppArrayTypes[VECTOR_MAX_ARRAYS];        // z̗vf̌^
+    int arrayCount;                                     // z̐
+    const Node* ppInvariants[VECTOR_XMM_COUNT];         // [vŕςȂliND_NUMND_VARj
+    int invariantRegs[VECTOR_XMM_COUNT];                // SvfɒlׂxmmWX^̔ԍ
+    int invariantCount;                                 // [vŕςȂl̐
+    const Node* ppReductions[VECTOR_XMM_COUNT];         // JԂƂɒl𑫂ޕϐ
+    int reductionRegs[VECTOR_XMM_COUNT];                // vfƂ̕axmmWX^̔ԍ
+    int reductionCount;                                 // ޕϐ̐
+    bool isIndexUsed;                                   // ̒ŗUϐ̒lgȂtrue
+    bool isOnesUsed;                                    // Svf1xmmWX^gȂtrue
+    int indexReg;                                       // Uϐ̒lii, i+1, i+2, i+3jxmmWX^̔ԍ
+    int stepReg;                                        // SvfVECTOR_LANESxmmWX^̔ԍ
+    int onesReg;                                        // Svf1xmmWX^̔ԍ
+    unsigned int usedXmm;                               // gpxmmWX^irbgƁj
+    unsigned int fixedXmm;                              // [v̊ԂƒlۂxmmWX^irbgƁj
+    bool isFailed;                                      // xmmWX^ȂȂȂtrue
+};
 
-    switch (pLhsType->ty) {
-    case TY_CHAR:
-    case TY_INT:
-        switch (pRhsType->ty) {
-        case TY_CHAR:
-        case TY_INT:
-            pResultType = &INT_TYPE;
-            break;
-        case TY_PTR:
-        case TY_ARRAY:
-            error_at(pNode->pToken->filename, pNode->pToken->user_input, pNode->pToken->str, "l|C^̌Z͂ł܂");
-        default:
-            error("Internal Error. Invalid Type '%d'.", pRhsType->ty);
-        }
-        break;
-    case TY_PTR:
-    case TY_ARRAY:
-        switch (pRhsType->ty) {
-        case TY_CHAR:
-        case TY_INT:
-            //EӒl̐l|C^w̌^TCY{
-            printf("  imul rdi, %zd\n", get_type_size(pLhsType->ptr_to));
-            pResultType = pLhsType;
-            break;
-        case TY_PTR:
-        case TY_ARRAY:
-            //|C^m̌Zptrdiff_t^ɂȂ
-            if (pLhsType->ptr_to->ty != pRhsType->ptr_to->ty) {
-                error_at(pNode->pToken->filename, pNode->pToken->user_input, pNode->pToken->str, "Z|C^̌^vĂ܂");
-            }
-            printf("  sub rax, rdi\n");
+static bool is_same_var(const Node* pLhs, const Node* pRhs) {
+    return pLhs->kind == ND_VAR && pRhs->kind == ND_VAR &&
+        pLhs->pToken->len == pRhs->pToken->len && !memcmp(pLhs->pToken->str, pRhs->pToken->str, pLhs->pToken->len);
+}
 
-            //|C^w̌^TCYŏZ邱ƂŁA̔zvf̓Y̍ɂȂ
-            printf("  mov rdi, %zd\n", get_type_size(pLhsType->ptr_to));
-            printf("  cqo\n");
-            printf("  idiv rdi\n");
+// ϐ̌^Ԃi`ȂNULLj
+static const Type* find_var_type(const Node* pNode, const GlobalContext* pGlobalContext, const FuncContext* pContext) {
+    const LVar* pLVar = find_lvar(pContext->pLVars, pNode);
+    if (pLVar) return pLVar->pType;
+    const GVar* pGVar = find_gvar(pGlobalContext->pGVars, pNode);
+    return pGVar ? pGVar->pType : NULL;
+}
 
-            return &INT_TYPE;   // ZĂ㏈Œl̂ŁA|C^m̌Z͋ʏɂȂ
-        default:
-            error("Internal Error. Invalid Type '%d'.", pRhsType->ty);
+static bool is_integer_type(const Type* pType) {
+    return pType && (pType->ty == TY_INT || pType->ty == TY_CHAR);
+}
+
+// UϐYɂz̗vfia[i]jȂA̔zo^ĔԍԂiႦ-1j
+static int find_vector_array(const Node* pNode, VectorLoop* pLoop, const GlobalContext* pGlobalContext, const FuncContext* pContext) {
+    if (pNode->kind != ND_DEREF || pNode->lhs->kind != ND_ADD) return -1;
+    const Node* pBase = pNode->lhs->lhs;
+    if (pBase->kind != ND_VAR || !is_same_var(pNode->lhs->rhs, pLoop->pIndex)) return -1;
+
+    const Type* pType = find_var_type(pBase, pGlobalContext, pContext);
+    if (pType == NULL || pType->ty != TY_ARRAY || !is_integer_type(pType->ptr_to)) return -1;
+
+    for (int i = 0; i < pLoop->arrayCount; ++i) {
+        if (is_same_var(pLoop->ppArrays[i], pBase)) return i;
+    }
+    if (pLoop->arrayCount == VECTOR_MAX_ARRAYS) return -1;
+    pLoop->ppArrays[pLoop->arrayCount] = pBase;
+    pLoop->ppArrayTypes[pLoop->arrayCount] = pType->ptr_to;
+    return pLoop->arrayCount++;
+}
+
+// [vŕςȂlo^ĔԍԂio^Ȃ-1j
+static int find_vector_invariant(const Node* pNode, VectorLoop* pLoop) {
+    for (int i = 0; i < pLoop->invariantCount; ++i) {
+        const Node* pInvariant = pLoop->ppInvariants[i];
+        if (pNode->kind == ND_NUM ? (pInvariant->kind == ND_NUM && pInvariant->pToken->val == pNode->pToken->val) : is_same_var(pInvariant, pNode)) {
+            return i;
         }
-        break;
-    default:
-        error("Internal Error. Invalid Type '%d'.", pLhsType->ty);
     }
+    if (pLoop->invariantCount == VECTOR_XMM_COUNT) return -1;
+    pLoop->ppInvariants[pLoop->invariantCount] = pNode;
+    return pLoop->invariantCount++;
+}
 
-    printf("  sub rax, rdi\n");
+// 4vf܂Ƃ߂ČvZł鎮ȂtrueԂ
+// ĝ͗UϐYɂz̗vfAUϐA[vŕςȂlƁA+ - * < <= == != ̂
+static bool analyze_vector_expr(const Node* pNode, VectorLoop* pLoop, const GlobalContext* pGlobalContext, const FuncContext* pContext) {
+    switch (pNode->kind) {
+    case ND_NUM:
+        return 0 <= find_vector_invariant(pNode, pLoop);
+    case ND_VAR:
+        if (is_same_var(pNode, pLoop->pIndex)) {
+            pLoop->isIndexUsed = true;
+            return true;
+        }
+        return is_integer_type(find_var_type(pNode, pGlobalContext, pContext)) && 0 <= find_vector_invariant(pNode, pLoop);
+    case ND_DEREF:
+        return 0 <= find_vector_array(pNode, pLoop, pGlobalContext, pContext);
+    case ND_LE:
+    case ND_NE:
+        pLoop->isOnesUsed = true;
+        // fall through
+    case ND_ADD:
+    case ND_SUB:
+    case ND_MUL:
+    case ND_LT:
+    case ND_EQ:
+        return analyze_vector_expr(pNode->lhs, pLoop, pGlobalContext, pContext) && analyze_vector_expr(pNode->rhs, pLoop, pGlobalContext, pContext);
+    default:
+        return false;
+    }
+}
 
-    return pResultType;
+// ϐւ̑݁is +  -  ...A + sj̉Eӂ𒲂ׂ
+static bool analyze_vector_reduction(const Node* pNode, const Node* pVar, VectorLoop* pLoop, const GlobalContext* pGlobalContext, const FuncContext* pContext) {
+    if (is_same_var(pNode, pVar)) return true;
+    if (pNode->kind != ND_ADD && pNode->kind != ND_SUB) return false;
+    if (pNode->kind == ND_ADD && is_same_var(pNode->rhs, pVar)) {
+        return analyze_vector_expr(pNode->lhs, pLoop, pGlobalContext, pContext);
+    }
+    return analyze_vector_reduction(pNode->lhs, pVar, pLoop, pGlobalContext, pContext) && analyze_vector_expr(pNode->rhs, pLoop, pGlobalContext, pContext);
 }
 
-static const Type* gen_mul_expr(const Node* pNode, const Type* pLhsType, const Type* pRhsType) {
-    switch (pLhsType->ty) {
-    case TY_CHAR:
-    case TY_INT:
-        break;
-    case TY_PTR:
-    case TY_ARRAY:
-        error_at(pNode->pToken->filename, pNode->pToken->user_input, pNode->pToken->str, "|C^̏Z͂ł܂");
+// [v{̂̕𒲂ׂiz̗vfւ̑Aϐւ݂̑j
+static bool analyze_vector_stmt(const Node* pNode, VectorLoop* pLoop, const GlobalContext* pGlobalContext, const FuncContext* pContext) {
+    switch (pNode->kind) {
+    case ND_NOP:
+        return true;
+    case ND_BLOCK:
+        return analyze_vector_stmt(pNode->lhs, pLoop, pGlobalContext, pContext) &&
+            (pNode->rhs == NULL || analyze_vector_stmt(pNode->rhs, pLoop, pGlobalContext, pContext));
+    case ND_EXPR_STMT:
         break;
     default:
-        error("Internal Error. Invalid Type '%d'.", pLhsType->ty);
+        return false;
     }
 
-    switch (pRhsType->ty) {
+    const Node* pAssign = pNode->lhs;
+    if (pAssign->kind != ND_ASSIGN && pAssign->kind != ND_ADD_ASSIGN && pAssign->kind != ND_SUB_ASSIGN) return false;
+
+    // a[i] = 
+    if (pAssign->kind == ND_ASSIGN && 0 <= find_vector_array(pAssign->lhs, pLoop, pGlobalContext, pContext)) {
+        return analyze_vector_expr(pAssign->rhs, pLoop, pGlobalContext, pContext);
+    }
+
+    // s = s +  -  ...As =  + sAs += As -= 
+    const Node* pVar = pAssign->lhs;
+    if (pVar->kind != ND_VAR || is_same_var(pVar, pLoop->pIndex)) return false;
+    const Type* pVarType = find_var_type(pVar, pGlobalContext, pContext);
+    if (pVarType == NULL || pVarType->ty != TY_INT) return false;
+    if (pAssign->kind == ND_ASSIGN && pAssign->rhs->kind != ND_ADD && pAssign->rhs->kind != ND_SUB) return false;
+
+    if (pLoop->reductionCount == VECTOR_XMM_COUNT) return false;
+    pLoop->ppReductions[pLoop->reductionCount++] = pAssign;
+    if (pAssign->kind != ND_ASSIGN) {
+        return analyze_vector_expr(pAssign->rhs, pLoop, pGlobalContext, pContext);
+    }
+    return analyze_vector_reduction(pAssign->rhs, pVar, pLoop, pGlobalContext, pContext);
+}
+
+// for (i = l; i < ; i++) ̌`ŁA{̂4vf܂Ƃ߂ĎsłȂtrueԂ
+static bool analyze_vector_loop(const Node* pNode, VectorLoop* pLoop, const GlobalContext* pGlobalContext, const FuncContext* pContext) {
+    //  i <   i <= 
+    const Node* pCond = pNode->children[1];
+    if (pCond == NULL || (pCond->kind != ND_LT && pCond->kind != ND_LE) || pCond->lhs->kind != ND_VAR) return false;
+    const LVar* pIndexVar = find_lvar(pContext->pLVars, pCond->lhs);
+    if (pIndexVar == NULL || pIndexVar->pType->ty != TY_INT) return false;
+    pLoop->pIndex = pCond->lhs;
+    pLoop->pBound = pCond->rhs;
+    pLoop->isBoundInclusive = pCond->kind == ND_LE;
+
+    // ̓[vŕςȂl
+    if (pLoop->pBound->kind == ND_VAR) {
+        if (is_same_var(pLoop->pBound, pLoop->pIndex) || !is_integer_type(find_var_type(pLoop->pBound, pGlobalContext, pContext))) return false;
+    }
+    else if (pLoop->pBound->kind != ND_NUM) {
+        return false;
+    }
+
+    // XV i = i + 1Ai = 1 + iAi += 1A++iAi++ ̂ǂꂩ
+    const Node* pInc = pNode->children[2];
+    if (pInc == NULL || (pInc->kind != ND_ASSIGN && pInc->kind != ND_ADD_ASSIGN && pInc->kind != ND_POST_INC) ||
+        !is_same_var(pInc->lhs, pLoop->pIndex)) return false;
+    if (pInc->kind == ND_ASSIGN) {
+        if (pInc->rhs->kind != ND_ADD) return false;
+        const Node* pStep = is_same_var(pInc->rhs->lhs, pLoop->pIndex) ? pInc->rhs->rhs : is_same_var(pInc->rhs->rhs, pLoop->pIndex) ? pInc->rhs->lhs : NULL;
+        if (pStep == NULL || pStep->kind != ND_NUM || pStep->pToken->val != 1) return false;
+    }
+    else if (pInc->kind == ND_ADD_ASSIGN) {
+        if (pInc->rhs->kind != ND_NUM || pInc->rhs->pToken->val != 1) return false;
+    }
+
+    if (!analyze_vector_stmt(pNode->rhs, pLoop, pGlobalContext, pContext)) return false;
+
+    // ޕϐ̓[v̑̏ꏊł͎gȂiǂݏ̏ςĂʂɂȂj
+    for (int i = 0; i < pLoop->reductionCount; ++i) {
+        const Node* pVar = pLoop->ppReductions[i]->lhs;
+        if (is_same_var(pVar, pLoop->pBound)) return false;
+        for (int j = 0; j < pLoop->invariantCount; ++j) {
+            if (is_same_var(pVar, pLoop->ppInvariants[j])) return false;
+        }
+        for (int j = 0; j < i; ++j) {
+            if (is_same_var(pVar, pLoop->ppReductions[j]->lhs)) return false;
+        }
+    }
+    return true;
+}
+
+static int alloc_xmm(VectorLoop* pLoop) {
+    for (int i = 0; i < VECTOR_XMM_COUNT; ++i) {
+        if (!(pLoop->usedXmm & (1u << i))) {
+            pLoop->usedXmm |= 1u << i;
+            return i;
+        }
+    }
+    pLoop->isFailed = true;
+    return 0;
+}
+
+static int alloc_fixed_xmm(VectorLoop* pLoop) {
+    const int reg = alloc_xmm(pLoop);
+    pLoop->fixedXmm |= 1u << reg;
+    return reg;
+}
+
+// ̌vZpɊmۂWX^Ȃi[v̊ԂƒlۂWX^͂̂܂܁j
+static void free_xmm(VectorLoop* pLoop, int reg) {
+    if (!(pLoop->fixedXmm & (1u << reg))) {
+        pLoop->usedXmm &= ~(1u << reg);
+    }
+}
+
+// Ă悢WX^ɂi[v̊ԂƒlۂWX^Ȃ畡j
+static int own_xmm(VectorLoop* pLoop, int reg) {
+    if (!(pLoop->fixedXmm & (1u << reg))) return reg;
+    const int copyReg = alloc_xmm(pLoop);
+    emit("  movdqa xmm%d, xmm%d\n", copyReg, reg);
+    return copyReg;
+}
+
+// 4vf܂Ƃ߂ČvZAʂxmmWX^̔ԍԂ
+static int gen_vector_expr(const Node* pNode, VectorLoop* pLoop, const GlobalContext* pGlobalContext, const FuncContext* pContext) {
+    switch (pNode->kind) {
+    case ND_NUM:
+    case ND_VAR:
+        if (is_same_var(pNode, pLoop->pIndex)) return pLoop->indexReg;
+        return pLoop->invariantRegs[find_vector_invariant(pNode, pLoop)];
+    case ND_DEREF:
+        // a[i]`a[i+3]ǂݍށichar͕gintɑj
+        {
+            const int arrayId = find_vector_array(pNode, pLoop, pGlobalContext, pContext);
+            const int reg = alloc_xmm(pLoop);
+            if (pLoop->ppArrayTypes[arrayId]->ty == TY_CHAR) {
+                emit("  movd xmm%d, DWORD PTR [%s+rcx]\n", reg, VECTOR_BASE_REG_NAME[arrayId]);
+                emit("  punpcklbw xmm%d, xmm%d\n", reg, reg);
+                emit("  punpcklwd xmm%d, xmm%d\n", reg, reg);
+                emit("  psrad xmm%d, 24\n", reg);
+            }
+            else {
+                emit("  movdqu xmm%d, XMMWORD PTR [%s+rcx*4]\n", reg, VECTOR_BASE_REG_NAME[arrayId]);
+            }
+            return reg;
+        }
+    default:
+        break;
+    }
+
+    // 񍀉Zia < b  b > a ƂČvZj
+    const bool isSwapped = pNode->kind == ND_LT;
+    const int lhs = gen_vector_expr(isSwapped ? pNode->rhs : pNode->lhs, pLoop, pGlobalContext, pContext);
+    const int rhs = gen_vector_expr(isSwapped ? pNode->lhs : pNode->rhs, pLoop, pGlobalContext, pContext);
+    const int dst = own_xmm(pLoop, lhs);
+
+    switch (pNode->kind) {
+    case ND_ADD:
+        emit("  paddd xmm%d, xmm%d\n", dst, rhs);
+        break;
+    case ND_SUB:
+        emit("  psubd xmm%d, xmm%d\n", dst, rhs);
+        break;
+    case ND_MUL:
+        // SSE2ɂ32rbg̗vfƂ̏ẐŁAԖڂƊԖڂ̗vf64rbg̐ςŋ߂ĕג
+        {
+            const int oddLhs = alloc_xmm(pLoop);
+            const int oddRhs = alloc_xmm(pLoop);
+            emit("  movdqa xmm%d, xmm%d\n", oddLhs, dst);
+            emit("  movdqa xmm%d, xmm%d\n", oddRhs, rhs);
+            emit("  pmuludq xmm%d, xmm%d\n", dst, rhs);
+            emit("  psrlq xmm%d, 32\n", oddLhs);
+            emit("  psrlq xmm%d, 32\n", oddRhs);
+            emit("  pmuludq xmm%d, xmm%d\n", oddLhs, oddRhs);
+            emit("  pshufd xmm%d, xmm%d, 0x08\n", dst, dst);
+            emit("  pshufd xmm%d, xmm%d, 0x08\n", oddLhs, oddLhs);
+            emit("  punpckldq xmm%d, xmm%d\n", dst, oddLhs);
+            free_xmm(pLoop, oddLhs);
+            free_xmm(pLoop, oddRhs);
+        }
+        break;
+    case ND_LT:
+        // rʂ͐^ȂSrbg1Ȃ̂ŁAŏʃrbgc1ɂ
+        emit("  pcmpgtd xmm%d, xmm%d\n", dst, rhs);
+        emit("  psrld xmm%d, 31\n", dst);
+        break;
+    case ND_LE:
+        // a > b ̌ʁi^Ȃ-1j1𑫂
+        emit("  pcmpgtd xmm%d, xmm%d\n", dst, rhs);
+        emit("  paddd xmm%d, xmm%d\n", dst, pLoop->onesReg);
+        break;
+    case ND_EQ:
+        emit("  pcmpeqd xmm%d, xmm%d\n", dst, rhs);
+        emit("  psrld xmm%d, 31\n", dst);
+        break;
+    case ND_NE:
+        emit("  pcmpeqd xmm%d, xmm%d\n", dst, rhs);
+        emit("  paddd xmm%d, xmm%d\n", dst, pLoop->onesReg);
+        break;
+    default:
+        error("Internal Error. Invalid NodeKind '%d'.", pNode->kind);
+    }
+
+    free_xmm(pLoop, rhs);
+    return dst;
+}
+
+// ϐւ݂̑̉Eӂ̊eAvfƂ̕aɑ
+static void gen_vector_reduction(const Node* pNode, const Node* pVar, int accReg, VectorLoop* pLoop, const GlobalContext* pGlobalContext, const FuncContext* pContext) {
+    if (is_same_var(pNode, pVar)) return;
+
+    const Node* pTerm;
+    if (pNode->kind == ND_ADD && is_same_var(pNode->rhs, pVar)) {
+        pTerm = pNode->lhs;
+    }
+    else {
+        gen_vector_reduction(pNode->lhs, pVar, accReg, pLoop, pGlobalContext, pContext);
+        pTerm = pNode->rhs;
+    }
+    const int reg = gen_vector_expr(pTerm, pLoop, pGlobalContext, pContext);
+    emit("  %s xmm%d, xmm%d\n", pNode->kind == ND_SUB ? "psubd" : "paddd", accReg, reg);
+    free_xmm(pLoop, reg);
+}
+
+// [v{̂̕4vf܂Ƃ߂Ďs
+static void gen_vector_stmt(const Node* pNode, VectorLoop* pLoop, const GlobalContext* pGlobalContext, const FuncContext* pContext) {
+    if (pNode->kind == ND_NOP) return;
+    if (pNode->kind == ND_BLOCK) {
+        gen_vector_stmt(pNode->lhs, pLoop, pGlobalContext, pContext);
+        if (pNode->rhs) gen_vector_stmt(pNode->rhs, pLoop, pGlobalContext, pContext);
+        return;
+    }
+
+    const Node* pAssign = pNode->lhs;
+    for (int i = 0; i < pLoop->reductionCount; ++i) {
+        if (pLoop->ppReductions[i] != pAssign) continue;
+
+        if (pAssign->kind == ND_ASSIGN) {
+            gen_vector_reduction(pAssign->rhs, pAssign->lhs, pLoop->reductionRegs[i], pLoop, pGlobalContext, pContext);
+        }
+        else {
+            const int reg = gen_vector_expr(pAssign->rhs, pLoop, pGlobalContext, pContext);
+            emit("  %s xmm%d, xmm%d\n", pAssign->kind == ND_SUB_ASSIGN ? "psubd" : "paddd", pLoop->reductionRegs[i], reg);
+            free_xmm(pLoop, reg);
+        }
+        return;
+    }
+
+    // a[i]`a[i+3]ɏށichar͉8rbgl߂4oCgɂj
+    const int arrayId = find_vector_array(pAssign->lhs, pLoop, pGlobalContext, pContext);
+    const int reg = gen_vector_expr(pAssign->rhs, pLoop, pGlobalContext, pContext);
+    if (pLoop->ppArrayTypes[arrayId]->ty == TY_CHAR) {
+        const int byteReg = own_xmm(pLoop, reg);
+        emit("  pslld xmm%d, 24\n", byteReg);
+        emit("  psrld xmm%d, 24\n", byteReg);
+        emit("  packssdw xmm%d, xmm%d\n", byteReg, byteReg);
+        emit("  packuswb xmm%d, xmm%d\n", byteReg, byteReg);
+        emit("  movd DWORD PTR [%s+rcx], xmm%d\n", VECTOR_BASE_REG_NAME[arrayId], byteReg);
+        free_xmm(pLoop, byteReg);
+    }
+    else {
+        emit("  movdqu XMMWORD PTR [%s+rcx*4], xmm%d\n", VECTOR_BASE_REG_NAME[arrayId], reg);
+    }
+    free_xmm(pLoop, reg);
+}
+
+// PȐグfor[vASSE24vf܂Ƃ߂ĎsR[ho͂
+// 4vfɖȂčJԂ́Aďo͂錳̃[vŎs
+// xNgłȂ`̃[vȂfalseԂAo͂Ȃ
+static bool try_gen_vector_loop(const Node* pNode, const GlobalContext* pGlobalContext, FuncContext* pContext) {
+    VectorLoop loop = { 0 };
+    if (0 < s_suppressCount || !analyze_vector_loop(pNode, &loop, pGlobalContext, pContext)) return false;
+
+    // xmmWX^ȂΏo͂悤AUʂ̃obt@ɏo͂
+    StrBuf code = { 0 };
+    StrBuf* pOldOut = s_pOut;
+    const FuncContext oldContext = *pContext;
+    s_pOut = &code;
+
+    // ]
+    if (pNode->children[0]) {
+        gen_discarded_expr(pNode->children[0], pGlobalContext, pContext);
+    }
+
+    // z̐擪AhXA[vŕςȂlAAUϐWX^ɒu
+    for (int i = 0; i < loop.arrayCount; ++i) {
+        gen_left_expr(loop.ppArrays[i], pGlobalContext, pContext);
+        emit("  pop %s\n", VECTOR_BASE_REG_NAME[i]);
+    }
+    for (int i = 0; i < loop.invariantCount; ++i) {
+        const int reg = loop.invariantRegs[i] = alloc_fixed_xmm(&loop);
+        gen_local_node(loop.ppInvariants[i], pGlobalContext, pContext);
+        emit("  pop rax\n");
+        emit("  movd xmm%d, eax\n", reg);
+        emit("  pshufd xmm%d, xmm%d, 0\n", reg, reg);
+    }
+    if (loop.isOnesUsed) {
+        loop.onesReg = alloc_fixed_xmm(&loop);
+        emit("  pcmpeqd xmm%d, xmm%d\n", loop.onesReg, loop.onesReg);
+        emit("  psrld xmm%d, 31\n", loop.onesReg);
+    }
+    for (int i = 0; i < loop.reductionCount; ++i) {
+        loop.reductionRegs[i] = alloc_fixed_xmm(&loop);
+        emit("  pxor xmm%d, xmm%d\n", loop.reductionRegs[i], loop.reductionRegs[i]);
+    }
+    gen_local_node(loop.pBound, pGlobalContext, pContext);
+    emit("  pop rdx\n");
+    if (loop.isBoundInclusive) emit("  add rdx, 1\n");
+    gen_local_node(loop.pIndex, pGlobalContext, pContext);
+    emit("  pop rcx\n");
+    if (loop.isIndexUsed) {
+        loop.indexReg = alloc_fixed_xmm(&loop);
+        loop.stepReg = alloc_fixed_xmm(&loop);
+        emit("  movd xmm%d, ecx\n", loop.indexReg);
+        emit("  pshufd xmm%d, xmm%d, 0\n", loop.indexReg, loop.indexReg);
+        emit("  movdqu xmm%d, XMMWORD PTR .L%s.iota[rip]\n", loop.stepReg, pContext->pszFuncName);
+        emit("  paddd xmm%d, xmm%d\n", loop.indexReg, loop.stepReg);
+        emit("  pcmpeqd xmm%d, xmm%d\n", loop.stepReg, loop.stepReg);
+        emit("  psrld xmm%d, 31\n", loop.stepReg);
+        emit("  pslld xmm%d, 2\n", loop.stepReg);
+        pContext->isIotaUsed = true;
+    }
+
+    // 4vf̌JԂcĂԂ
+    const int bodyLabelId = pContext->labelCount++;
+    const int endLabelId = pContext->labelCount++;
+    emit("  lea rax, [rcx+%d]\n", VECTOR_LANES);
+    emit("  cmp rax, rdx\n");
+    emit("  jg .L%s.vend%04d\n", pContext->pszFuncName, endLabelId);
+    emit("  .p2align %d\n", CODE_ALIGN_LOG2);
+    emit(".L%s.vbody%04d:\n", pContext->pszFuncName, bodyLabelId);
+    gen_vector_stmt(pNode->rhs, &loop, pGlobalContext, pContext);
+    if (loop.isIndexUsed) emit("  paddd xmm%d, xmm%d\n", loop.indexReg, loop.stepReg);
+    emit("  add rcx, %d\n", VECTOR_LANES);
+    emit("  lea rax, [rcx+%d]\n", VECTOR_LANES);
+    emit("  cmp rax, rdx\n");
+    emit("  jle .L%s.vbody%04d\n", pContext->pszFuncName, bodyLabelId);
+    emit(".L%s.vend%04d:\n", pContext->pszFuncName, endLabelId);
+
+    // Uϐ߂Aavĕϐɑ
+    gen_left_expr(loop.pIndex, pGlobalContext, pContext);
+    emit("  pop rax\n");
+    emit("  mov DWORD PTR [rax], ecx\n");
+    for (int i = 0; i < loop.reductionCount; ++i) {
+        const int reg = loop.reductionRegs[i];
+        const int tmpReg = alloc_xmm(&loop);
+        emit("  pshufd xmm%d, xmm%d, 0x4E\n", tmpReg, reg);
+        emit("  paddd xmm%d, xmm%d\n", reg, tmpReg);
+        emit("  pshufd xmm%d, xmm%d, 0xB1\n", tmpReg, reg);
+        emit("  paddd xmm%d, xmm%d\n", reg, tmpReg);
+        emit("  movd edi, xmm%d\n", reg);
+        free_xmm(&loop, tmpReg);
+        gen_left_expr(loop.ppReductions[i]->lhs, pGlobalContext, pContext);
+        emit("  pop rax\n");
+        emit("  add DWORD PTR [rax], edi\n");
+    }
+
+    s_pOut = pOldOut;
+    if (loop.isFailed) {
+        *pContext = oldContext;
+        strbuf_free(&code);
+        return false;
+    }
+    strbuf_append(s_pOut, code.data, code.len);
+    strbuf_free(&code);
+
+    // čJԂi͕]ς݁j
+    Node restNode = *pNode;
+    restNode.children[0] = NULL;
+    gen_for_stmt(&restNode, pGlobalContext, pContext);
+    return true;
+}
+
+static const Type* gen_invoke_expr(const Node* pNode, const GlobalContext* pGlobalContext, FuncContext* pContext) {
+    int i;
+    char funcName[MAX_FUNC_NAME_LEN + 1] = { 0 };
+
+    if (MAX_FUNC_NAME_LEN <= pNode->pToken->len) {
+        error_at(pNode->pToken->loc, "֐%dȏ゠܂", MAX_FUNC_NAME_LEN);
+    }
+    memcpy(funcName, pNode->pToken->str, pNode->pToken->len);
+
+    // Ăяo悪萔̈œꉻĂ΁Ä͕]󂯓nȂ
+    // i萔ƌ܂́Aǂ̌Ăяołp̖œlɂȂĂj
+    const FuncInfo* pCallee = find_func_info(pGlobalContext, pNode->pToken);
+
+    // ɕ]ăX^bNɐς
+    // i㑱̈̕]ňWX^j󂳂Ȃ悤ASĕ]IĂ烌WX^Ɋi[j
+    for (i = 0; i < sizeof(pNode->children) / sizeof(pNode->children[0]); ++i) {
+        if (pNode->children[i] == NULL) break;
+        if (is_const_arg(pCallee, i)) continue;
+
+        gen_local_node(pNode->children[i], pGlobalContext, pContext);
+    }
+
+    // ς񂾏ƋtɎoāAΉ郌WX^Ɋi[
+    while (0 < i--) {
+        if (is_const_arg(pCallee, i)) continue;
+        emit("  pop %s\n", PARAM_REG_NAME[PARAM_REG_INDEX_64BIT][i]);
+    }
+
+    // ĂяoraxŜ𗘗pƂ͌Ȃ̂Ń[NA
+    emit("  mov rax, 0\n");
+
+    // rsp16̔{ɂ낦ix86-64ABIɂ鐧j
+    //     낦Orspr15ɑޔĂ
+    //     Ăяo̊֐r15𓯂prɎgď̂ŁAr15g̒l̓X^bNɑޔ
+    //     iȑO͂̑ޔAq̌Ăяo߂ƌĂяorspĂj
+    emit("  push r15\n");
+    emit("  mov  r15, rsp\n");
+    emit("  and  rsp, -16\n");
+
+    emit("  call %s\n", funcName);
+
+    emit("  mov  rsp, r15\n");
+    emit("  pop  r15\n");
+
+    // ߂lraxɊi[Ă̂łpush
+    emit("  push rax\n");
+
+    // TODO: ֐e[ûŁAint^߂l̊֐ĂяoƉ肵Ă
+    return &INT_TYPE;
+}
+
+static const Type* gen_add_expr(const Node* pNode, const Type* pLhsType, const Type* pRhsType) {
+    const Type* pResultType = NULL;
+
+    switch (pLhsType->ty) {
     case TY_CHAR:
     case TY_INT:
+        switch (pRhsType->ty) {
+        case TY_CHAR:
+        case TY_INT:
+            pResultType = &INT_TYPE;
+            break;
+        case TY_PTR:
+        case TY_ARRAY:
+            //Ӓl̐l|C^w̌^TCY{
+            emit("  imul rax, %zd\n", get_type_size(pRhsType->ptr_to));
+            pResultType = pRhsType;
+            break;
+        default:
+            error("Internal Error. Invalid Type '%d'.", pRhsType->ty);
+        }
         break;
     case TY_PTR:
     case TY_ARRAY:
-        error_at(pNode->pToken->filename, pNode->pToken->user_input, pNode->pToken->str, "|C^̏Z͂ł܂");
+        switch (pRhsType->ty) {
+        case TY_CHAR:
+        case TY_INT:
+            //EӒl̐l|C^w̌^TCY{
+            emit("  imul rdi, %zd\n", get_type_size(pLhsType->ptr_to));
+            pResultType = pLhsType;
+            break;
+        case TY_PTR:
+        case TY_ARRAY:
+            error_at(pNode->pToken->loc, "|C^m̉Z͂ł܂");
+        default:
+            error("Internal Error. Invalid Type '%d'.", pRhsType->ty);
+        }
+        break;
+    default:
+        error("Internal Error. Invalid Type '%d'.", pLhsType->ty);
+    }
+
+    emit("  add rax, rdi\n");
+
+    return pResultType;
+}
+
+static const Type* gen_sub_expr(const Node* pNode, const Type* pLhsType, const Type* pRhsType) {
+    const Type* pResultType = NULL;
+
+    switch (pLhsType->ty) {
+    case TY_CHAR:
+    case TY_INT:
+        switch (pRhsType->ty) {
+        case TY_CHAR:
+        case TY_INT:
+            pResultType = &INT_TYPE;
+            break;
+        case TY_PTR:
+        case TY_ARRAY:
+            error_at(pNode->pToken->loc, "l|C^̌Z͂ł܂");
+        default:
+            error("Internal Error. Invalid Type '%d'.", pRhsType->ty);
+        }
+        break;
+    case TY_PTR:
+    case TY_ARRAY:
+        switch (pRhsType->ty) {
+        case TY_CHAR:
+        case TY_INT:
+            //EӒl̐l|C^w̌^TCY{
+            emit("  imul rdi, %zd\n", get_type_size(pLhsType->ptr_to));
+            pResultType = pLhsType;
+            break;
+        case TY_PTR:
+        case TY_ARRAY:
+            //|C^m̌Zptrdiff_t^ɂȂ
+            if (pLhsType->ptr_to->ty != pRhsType->ptr_to->ty) {
+                error_at(pNode->pToken->loc, "Z|C^̌^vĂ܂");
+            }
+            emit("  sub rax, rdi\n");
+
+            //|C^w̌^TCYŏZ邱ƂŁA̔zvf̓Y̍ɂȂ
+            emit("  mov rdi, %zd\n", get_type_size(pLhsType->ptr_to));
+            emit("  cqo\n");
+            emit("  idiv rdi\n");
+
+            return &INT_TYPE;   // ZĂ㏈Œl̂ŁA|C^m̌Z͋ʏɂȂ
+        default:
+            error("Internal Error. Invalid Type '%d'.", pRhsType->ty);
+        }
+        break;
+    default:
+        error("Internal Error. Invalid Type '%d'.", pLhsType->ty);
+    }
+
+    emit("  sub rax, rdi\n");
+
+    return pResultType;
+}
+
+static const Type* gen_mul_expr(const Node* pNode, const Type* pLhsType, const Type* pRhsType) {
+    switch (pLhsType->ty) {
+    case TY_CHAR:
+    case TY_INT:
+        break;
+    case TY_PTR:
+    case TY_ARRAY:
+        error_at(pNode->pToken->loc, "|C^̏Z͂ł܂");
+        break;
+    default:
+        error("Internal Error. Invalid Type '%d'.", pLhsType->ty);
+    }
+
+    switch (pRhsType->ty) {
+    case TY_CHAR:
+    case TY_INT:
+        break;
+    case TY_PTR:
+    case TY_ARRAY:
+        error_at(pNode->pToken->loc, "|C^̏Z͂ł܂");
         break;
     default:
         error("Internal Error. Invalid Type '%d'.", pRhsType->ty);
     }
 
-    printf("  imul rax, rdi\n");
+    emit("  imul rax, rdi\n");
     return &INT_TYPE;
 }
 
-static const Type* gen_div_expr(const Node* pNode, const Type* pLhsType, const Type* pRhsType) {
-    switch (pLhsType->ty) {
-    case TY_CHAR:
-    case TY_INT:
-        break;
-    case TY_PTR:
-    case TY_ARRAY:
-        error_at(pNode->pToken->filename, pNode->pToken->user_input, pNode->pToken->str, "|C^̏Z͂ł܂");
-        break;
+static const Type* gen_div_expr(const Node* pNode, const Type* pLhsType, const Type* pRhsType) {
+    switch (pLhsType->ty) {
+    case TY_CHAR:
+    case TY_INT:
+        break;
+    case TY_PTR:
+    case TY_ARRAY:
+        error_at(pNode->pToken->loc, "|C^̏Z͂ł܂");
+        break;
+    default:
+        error("Internal Error. Invalid Type '%d'.", pLhsType->ty);
+    }
+
+    switch (pRhsType->ty) {
+    case TY_CHAR:
+    case TY_INT:
+        break;
+    case TY_PTR:
+    case TY_ARRAY:
+        error_at(pNode->pToken->loc, "|C^̏Z͂ł܂");
+        break;
+    default:
+        error("Internal Error. Invalid Type '%d'.", pRhsType->ty);
+    }
+
+    emit("  cqo\n");
+    emit("  idiv rdi\n");
+    return &INT_TYPE;
+}
+
+// CNgœǂݏ鍶Ӓl̃Iyh
+typedef struct MemOperand MemOperand;
+struct MemOperand {
+    char szOperand[MAX_FUNC_NAME_LEN + 32]; // Iyh̕i"DWORD PTR [rbp-8]"Ȃǁj
+    bool isAddrPushed;                      // AhXvZăX^bNɐς񂾂ȂtrueirsiɎoĂgj
+    const Type* pType;                      // Ӓľ^
+};
+
+// ^̑傫̃Iyh̏Cq
+static const char* get_ptr_size_name(const Type* pType) {
+    switch (pType->ty) {
+    case TY_CHAR:
+        return "BYTE PTR";
+    case TY_INT:
+        return "DWORD PTR";
+    case TY_PTR:
+        return "QWORD PTR";
+    default:
+        error("Internal Error. Invalid Type '%d'.", pType->ty);
+        return NULL;
+    }
+}
+
+// ^̑傫ɍ킹WX^̖OirdiraxɑΉ́j
+static const char* get_sized_reg_name(const Type* pType, bool isRdi) {
+    switch (pType->ty) {
+    case TY_CHAR:
+        return isRdi ? "dil" : "al";
+    case TY_INT:
+        return isRdi ? "edi" : "eax";
+    case TY_PTR:
+        return isRdi ? "rdi" : "rax";
+    default:
+        error("Internal Error. Invalid Type '%d'.", pType->ty);
+        return NULL;
+    }
+}
+
+// CNg̍Ӓl̃Iyh
+// ϐ̓AhXIyhɒڏ̂ŌvZȂ
+// ȊO̓AhXxvZăX^bNɐς݁AEӂ̕]rsi֎o[rsi]œǂݏ
+static void gen_mem_operand(const Node* pUpdateNode, MemOperand* pMem, const GlobalContext* pGlobalContext, FuncContext* pContext) {
+    const Node* pNode = pUpdateNode->lhs;
+    if (pNode->kind != ND_VAR && pNode->kind != ND_DEREF) {
+        error_at(pUpdateNode->pToken->loc, "ȍӒlł");
+    }
+
+    const char* pszAddr = NULL;
+    char szAddr[MAX_FUNC_NAME_LEN + 16] = { 0 };
+
+    if (pNode->kind == ND_VAR) {
+        const LVar* pLVar = find_lvar(pContext->pLVars, pNode);
+        const GVar* pGVar = pLVar ? NULL : find_gvar(pGlobalContext->pGVars, pNode);
+        if (pLVar != NULL) {
+            snprintf(szAddr, sizeof(szAddr), "[rbp-%d]", pLVar->offset);
+            pszAddr = szAddr;
+            pMem->pType = pLVar->pType;
+        }
+        else if (pGVar != NULL && pGVar->len <= MAX_FUNC_NAME_LEN) {
+            snprintf(szAddr, sizeof(szAddr), "%.*s[rip]", pGVar->len, pGVar->name);
+            pszAddr = szAddr;
+            pMem->pType = pGVar->pType;
+        }
+    }
+
+    pMem->isAddrPushed = pszAddr == NULL;
+    if (pMem->isAddrPushed) {
+        pMem->pType = gen_left_expr(pNode, pGlobalContext, pContext);
+        pszAddr = "[rsi]";
+    }
+
+    if (pMem->pType->ty == TY_ARRAY) {
+        error_at(pUpdateNode->pToken->loc, "zɂ͑ł܂");
+    }
+    snprintf(pMem->szOperand, sizeof(pMem->szOperand), "%s %s", get_ptr_size_name(pMem->pType), pszAddr);
+}
+
+// Iyh̒l𕄍graxɓǂݍ
+static void gen_load_mem(const MemOperand* pMem) {
+    if (pMem->pType->ty == TY_PTR) {
+        emit("  mov rax, %s\n", pMem->szOperand);
+    }
+    else {
+        emit("  movsx rax, %s\n", pMem->szOperand);
+    }
+}
+
+// i+=A-=A*=A/=jƌuCNgEfNgo͂
+// ӂ̃AhX͈xvZAZ̓IyhɒڍsiEӂ萔Ȃ瑦lŁj
+// isResultUsedfalseȂlX^bNɐς܂A1̉Zinc/decɂ
+static const Type* gen_update_expr(const Node* pNode, bool isResultUsed, const GlobalContext* pGlobalContext, FuncContext* pContext) {
+    const bool isPost = pNode->kind == ND_POST_INC || pNode->kind == ND_POST_DEC;
+    const bool isAdd = pNode->kind == ND_ADD_ASSIGN || pNode->kind == ND_POST_INC;
+    const bool isSub = pNode->kind == ND_SUB_ASSIGN || pNode->kind == ND_POST_DEC;
+
+    MemOperand mem;
+    gen_mem_operand(pNode, &mem, pGlobalContext, pContext);
+    const Type* pType = mem.pType;
+
+    if (pType->ty == TY_PTR && (pNode->kind == ND_MUL_ASSIGN || pNode->kind == ND_DIV_ASSIGN)) {
+        error_at(pNode->pToken->loc, pNode->kind == ND_MUL_ASSIGN ? "|C^̏Z͂ł܂" : "|C^̏Z͂ł܂");
+    }
+
+    // EӁiuȂ1j𑦒lrdiɗpӂ
+    const bool isImm = isPost || pNode->rhs->kind == ND_NUM;
+    int64_t imm = isPost ? 1 : isImm ? pNode->rhs->pToken->val : 0;
+    if (!isImm) {
+        const Type* pRhsType = gen_local_node(pNode->rhs, pGlobalContext, pContext);
+        if (pRhsType->ty == TY_PTR || pRhsType->ty == TY_ARRAY) {
+            error_at(pNode->pToken->loc, "̉EӂɃ|C^͎g܂");
+        }
+        emit("  pop rdi\n");
+    }
+    if (mem.isAddrPushed) {
+        emit("  pop rsi\n");
+    }
+
+    if (isAdd || isSub) {
+        // |C^̉Z͎w̌^TCY{
+        if (pType->ty == TY_PTR) {
+            const size_t size = get_type_size(pType->ptr_to);
+            if (isImm) {
+                imm *= (int64_t)size;
+            }
+            else {
+                emit("  imul rdi, %zd\n", size);
+            }
+        }
+
+        if (isPost && isResultUsed) {
+            gen_load_mem(&mem);
+        }
+        if (isImm && imm == 1 && !isResultUsed) {
+            emit("  %s %s\n", isAdd ? "inc" : "dec", mem.szOperand);
+        }
+        else if (isImm) {
+            emit("  %s %s, %lld\n", isAdd ? "add" : "sub", mem.szOperand, (long long)imm);
+        }
+        else {
+            emit("  %s %s, %s\n", isAdd ? "add" : "sub", mem.szOperand, get_sized_reg_name(pType, true));
+        }
+        if (!isPost && isResultUsed) {
+            gen_load_mem(&mem);
+        }
+    }
+    else {
+        // 揜Z̓IyhɒڍsȂ̂ŁAǂݍŌvZĂ珑߂
+        gen_load_mem(&mem);
+        if (pNode->kind == ND_MUL_ASSIGN) {
+            if (isImm) {
+                emit("  imul rax, rax, %lld\n", (long long)imm);
+            }
+            else {
+                emit("  imul rax, rdi\n");
+            }
+        }
+        else {
+            if (isImm) {
+                emit("  mov rdi, %lld\n", (long long)imm);
+            }
+            emit("  cqo\n");
+            emit("  idiv rdi\n");
+        }
+        emit("  mov %s, %s\n", mem.szOperand, get_sized_reg_name(pType, false));
+        if (isResultUsed) {
+            gen_load_mem(&mem);
+        }
+    }
+
+    if (isResultUsed) {
+        emit("  push rax\n");
+    }
+
+    Type* pResultType = arena_calloc(1, sizeof(Type));
+    memcpy(pResultType, pType, sizeof(Type));
+    pResultType->is_lvalue = false;
+    return pResultType;
+}
+
+// lgȂo͂ifoȑEXVj
+// ƃCNgEfNg͒lς܂ɍς܂
+static void gen_discarded_expr(const Node* pNode, const GlobalContext* pGlobalContext, FuncContext* pContext) {
+    switch (pNode->kind) {
+    case ND_ADD_ASSIGN:
+    case ND_SUB_ASSIGN:
+    case ND_MUL_ASSIGN:
+    case ND_DIV_ASSIGN:
+    case ND_POST_INC:
+    case ND_POST_DEC:
+        gen_loc(pNode, pGlobalContext, pContext);
+        gen_update_expr(pNode, false, pGlobalContext, pContext);
+        return;
     default:
-        error("Internal Error. Invalid Type '%d'.", pLhsType->ty);
-    }
+        gen_local_node(pNode, pGlobalContext, pContext);
 
-    switch (pRhsType->ty) {
-    case TY_CHAR:
-    case TY_INT:
-        break;
-    case TY_PTR:
-    case TY_ARRAY:
-        error_at(pNode->pToken->filename, pNode->pToken->user_input, pNode->pToken->str, "|C^̏Z͂ł܂");
-        break;
-    default:
-        error("Internal Error. Invalid Type '%d'.", pRhsType->ty);
+        // ̕]ʂƂăX^bNɈ̒lcĂ
+        // ͂Ȃ̂ŁAX^bNȂ悤Ƀ|bvĂ
+        emit("  pop rax\n");
+        return;
     }
-
-    printf("  cqo\n");
-    printf("  idiv rdi\n");
-    return &INT_TYPE;
 }
 
-static const Type* gen_local_node(const Node* pNode, GlobalContext* pGlobalContext, const FuncContext* pContext) {
+static const Type* gen_local_node(const Node* pNode, const GlobalContext* pGlobalContext, FuncContext* pContext) {
     if (!pNode) {
         error("Internal Error. Node is NULL.");
     }
+    gen_loc(pNode, pGlobalContext, pContext);
 
     switch (pNode->kind) {
     case ND_NOP:
@@ -597,22 +1872,22 @@ static const Type* gen_local_node(const Node* pNode, GlobalContext* pGlobalConte
         return &VOID_TYPE;
     case ND_NUM:
         // le
-        printf("  push %d\n", pNode->pToken->val);
+        emit("  push %d\n", pNode->pToken->val);
         return &INT_TYPE;
     case ND_STRING:
         // 񃊃e
-        printf("  lea rax, .LC%04d[rip]\n", pNode->pToken->val);
-        printf("  push rax\n");
+        emit("  lea rax, .LC%04d[rip]\n", pNode->pToken->val);
+        emit("  push rax\n");
         return &CHAR_PTR_TYPE;
     case ND_VAR:
         // ϐ
         {
             const Type* pType = gen_left_expr(pNode, pGlobalContext, pContext);
-            printf("  pop rax\n");
+            emit("  pop rax\n");
             eval_var(pType, "rax");
-            printf("  push rax\n");
+            emit("  push rax\n");
 
-            Type* pResultType = calloc(1, sizeof(Type));
+            Type* pResultType = arena_calloc(1, sizeof(Type));
             memcpy(pResultType, pType, sizeof(Type));
             pResultType->is_lvalue = false;
             return pResultType;
@@ -620,7 +1895,7 @@ static const Type* gen_local_node(const Node* pNode, GlobalContext* pGlobalConte
     case ND_ADDR:
         // P&
         {
-            Type* pResultType = calloc(1, sizeof(Type));
+            Type* pResultType = arena_calloc(1, sizeof(Type));
             pResultType->ty = TY_PTR;
             pResultType->ptr_to = gen_left_expr(pNode->lhs, pGlobalContext, pContext);
             return pResultType;
@@ -630,28 +1905,22 @@ static const Type* gen_local_node(const Node* pNode, GlobalContext* pGlobalConte
         {
             const Type* pResultType = gen_local_node(pNode->lhs, pGlobalContext, pContext);
             if (pResultType->ty != TY_PTR && pResultType->ty != TY_ARRAY) {
-                error_at(pNode->pToken->filename, pNode->pToken->user_input, pNode->pToken->str, "|C^^ł͂Ȃl̓ft@Xł܂");
+                error_at(pNode->pToken->loc, "|C^^ł͂Ȃl̓ft@Xł܂");
             }
-            printf("  pop rax\n");
+            emit("  pop rax\n");
             eval_var(pResultType->ptr_to, "rax");
-            printf("  push rax\n");
+            emit("  push rax\n");
             return pResultType->ptr_to;
         }
     case ND_SIZEOF:
         // sizeof
         {
-            // ꎞIɕWo͂؂邱ƂŔ퉉Zq̕]𖳌ɂ
-            FILE* backup_stdout = GetStdHandle(STD_OUTPUT_HANDLE);
-            FILE* hNull = CreateFileA("NUL", GENERIC_WRITE, FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-            SetStdHandle(STD_OUTPUT_HANDLE, hNull);
-
+            // ꎞIɏo͂̂Ă邱ƂŔ퉉Zq̕]𖳌ɂ
+            ++s_suppressCount;
             const size_t size = get_type_size(gen_local_node(pNode->lhs, pGlobalContext, pContext));
+            --s_suppressCount;
 
-            // Wo͂ɖ߂
-            SetStdHandle(STD_OUTPUT_HANDLE, backup_stdout);
-            CloseHandle(hNull);
-
-            printf("  push %zd\n", size);
+            emit("  push %zd\n", size);
             return &INT_TYPE;
         }
     case ND_INVOKE:
@@ -665,29 +1934,37 @@ static const Type* gen_local_node(const Node* pNode, GlobalContext* pGlobalConte
 
             switch (pLhsType->ty) {
             case TY_CHAR:
-                printf("  pop rax\n");
-                printf("  movsx rdi, al\n");
-                printf("  pop rax\n");
-                printf("  mov [rax], dil\n");
+                emit("  pop rax\n");
+                emit("  movsx rdi, al\n");
+                emit("  pop rax\n");
+                emit("  mov [rax], dil\n");
                 break;
             case TY_INT:
-                printf("  pop rax\n");
-                printf("  movsx rdi, eax\n");
-                printf("  pop rax\n");
-                printf("  mov [rax], edi\n");
+                emit("  pop rax\n");
+                emit("  movsx rdi, eax\n");
+                emit("  pop rax\n");
+                emit("  mov [rax], edi\n");
                 break;
             case TY_PTR:
             case TY_ARRAY:
-                printf("  pop rdi\n");
-                printf("  pop rax\n");
-                printf("  mov [rax], rdi\n");
+                emit("  pop rdi\n");
+                emit("  pop rax\n");
+                emit("  mov [rax], rdi\n");
                 break;
             default:
                 error("Internal Error. Invalid Type '%d'.", pLhsType->ty);
             }
-            printf("  push rdi\n");
+            emit("  push rdi\n");
             return pRhsType;
         }
+    case ND_ADD_ASSIGN:
+    case ND_SUB_ASSIGN:
+    case ND_MUL_ASSIGN:
+    case ND_DIV_ASSIGN:
+    case ND_POST_INC:
+    case ND_POST_DEC:
+        // ƃCNgEfNg
+        return gen_update_expr(pNode, true, pGlobalContext, pContext);
     case ND_BLOCK:
         // ubN
         gen_local_node(pNode->lhs, pGlobalContext, pContext);
@@ -697,19 +1974,14 @@ static const Type* gen_local_node(const Node* pNode, GlobalContext* pGlobalConte
         return &VOID_TYPE;
     case ND_EXPR_STMT:
         // 
-        gen_local_node(pNode->lhs, pGlobalContext, pContext);
-
-        // ̕]ʂƂăX^bNɈ̒lcĂ
-        // ͂Ȃ̂ŁAX^bNȂ悤Ƀ|bvĂ
-        printf("  pop rax\n");
+        gen_discarded_expr(pNode->lhs, pGlobalContext, pContext);
         return &VOID_TYPE;
     case ND_RETURN:
         // return
+        // Gs[O͊֐̖ŋL
         gen_local_node(pNode->lhs, pGlobalContext, pContext);
-        printf("  pop rax\n");
-        printf("  mov rsp, rbp\n");
-        printf("  pop rbp\n");
-        printf("  ret\n");
+        emit("  pop rax\n");
+        emit("  jmp .L%s.return\n", pContext->pszFuncName);
         return &VOID_TYPE;
     case ND_IF:
         // if
@@ -720,17 +1992,76 @@ static const Type* gen_local_node(const Node* pNode, GlobalContext* pGlobalConte
         gen_while_stmt(pNode, pGlobalContext, pContext);
         return &VOID_TYPE;
     case ND_FOR:
-        // for
-        gen_for_stmt(pNode, pGlobalContext, pContext);
+        // foriPȐグ̃[v̓xNgj
+        if (!try_gen_vector_loop(pNode, pGlobalContext, pContext)) {
+            gen_for_stmt(pNode, pGlobalContext, pContext);
+        }
+        return &VOID_TYPE;
+    case ND_NOT:
+        // _ےi0Ȃ1AȊOȂ0j
+        gen_local_node(pNode->lhs, pGlobalContext, pContext);
+        emit("  pop rax\n");
+        emit("  cmp rax, 0\n");
+        emit("  sete al\n");
+        emit("  movzb rax, al\n");
+        emit("  push rax\n");
+        return &INT_TYPE;
+    case ND_LOGAND:
+    case ND_LOGOR:
+        // lƂĎg&&||́A̘AȂ̍s01ς
+        {
+            const int falseLabelId = pContext->labelCount++;
+            const int endLabelId = pContext->labelCount++;
+            gen_cond_jump(pNode, false, "false", falseLabelId, pGlobalContext, pContext);
+            emit("  push 1\n");
+            emit("  jmp .L%s.end%04d\n", pContext->pszFuncName, endLabelId);
+            emit(".L%s.false%04d:\n", pContext->pszFuncName, falseLabelId);
+            emit("  push 0\n");
+            emit(".L%s.end%04d:\n", pContext->pszFuncName, endLabelId);
+        }
+        return &INT_TYPE;
+    case ND_SWITCH:
+        // switch
+        gen_switch_stmt(pNode, pGlobalContext, pContext);
+        return &VOID_TYPE;
+    case ND_CASE:
+        // casexiswitch̐擪ł̃x֕򂵂Ăj
+        {
+            const SwitchCase key = { pNode->children[0]->pToken->val };
+            const SwitchCase* pCase = pContext->pSwitch ?
+                bsearch(&key, pContext->pSwitch->pCases, pContext->pSwitch->caseCount, sizeof(SwitchCase), compare_switch_case) : NULL;
+            if (pCase == NULL) {
+                error_at(pNode->pToken->loc, "switch̊Ocasex܂");
+            }
+            emit(".L%s.case%04d:\n", pContext->pszFuncName, pCase->labelId);
+            gen_local_node(pNode->lhs, pGlobalContext, pContext);
+        }
+        return &VOID_TYPE;
+    case ND_DEFAULT:
+        // defaultx
+        if (pContext->pSwitch == NULL) {
+            error_at(pNode->pToken->loc, "switch̊Odefaultx܂");
+        }
+        emit(".L%s.case%04d:\n", pContext->pszFuncName, pContext->pSwitch->defaultLabelId);
+        gen_local_node(pNode->lhs, pGlobalContext, pContext);
+        return &VOID_TYPE;
+    case ND_BREAK:
+        // breakił̃[vswitcȟ֔j
+        if (pContext->breakLabelId < 0) {
+            error_at(pNode->pToken->loc, "[vswitch̊Ołbreakg܂");
+        }
+        emit("  jmp .L%s.end%04d\n", pContext->pszFuncName, pContext->breakLabelId);
         return &VOID_TYPE;
+    default:
+        break;
     }
 
     // 񍀉Z
     const Type* pLhsType = gen_local_node(pNode->lhs, pGlobalContext, pContext);
     const Type* pRhsType = gen_local_node(pNode->rhs, pGlobalContext, pContext);
     const Type* pResultType = NULL;
-    printf("  pop rdi\n");
-    printf("  pop rax\n");
+    emit("  pop rdi\n");
+    emit("  pop rax\n");
 
     switch (pNode->kind) {
     case ND_ADD: // +
@@ -746,77 +2077,140 @@ static const Type* gen_local_node(const Node* pNode, GlobalContext* pGlobalConte
         pResultType = gen_div_expr(pNode, pLhsType, pRhsType);
         break;
     case ND_EQ:  // ==
-        printf("  cmp rax, rdi\n");
-        printf("  sete al\n");
-        printf("  movzb rax, al\n");
+        emit("  cmp rax, rdi\n");
+        emit("  sete al\n");
+        emit("  movzb rax, al\n");
         pResultType = &INT_TYPE;
         break;
     case ND_NE:  // !=
-        printf("  cmp rax, rdi\n");
-        printf("  setne al\n");
-        printf("  movzb rax, al\n");
+        emit("  cmp rax, rdi\n");
+        emit("  setne al\n");
+        emit("  movzb rax, al\n");
         pResultType = &INT_TYPE;
         break;
     case ND_LT:  // <
-        printf("  cmp rax, rdi\n");
-        printf("  setl al\n");
-        printf("  movzb rax, al\n");
+        emit("  cmp rax, rdi\n");
+        emit("  setl al\n");
+        emit("  movzb rax, al\n");
         pResultType = &INT_TYPE;
         break;
     case ND_LE:  // <=
-        printf("  cmp rax, rdi\n");
-        printf("  setle al\n");
-        printf("  movzb rax, al\n");
+        emit("  cmp rax, rdi\n");
+        emit("  setle al\n");
+        emit("  movzb rax, al\n");
         pResultType = &INT_TYPE;
         break;
     default:
         error("Internal Error. Invalid NodeKind '%d'.", pNode->kind);
     }
 
-    printf("  push rax\n");
+    emit("  push rax\n");
     return pResultType;
 }
 
-static void gen_def_func(const Node* pNode, GlobalContext* pGlobalContext) {
+// vR[h𖄂ߍފ֐̓ŁÃt@Čvʂ̕\vOŜ̈ꗗɌq
+// ꗗ̐擪main̂t@CŒ`Amain߂ƂɈꗗ̑SĂ̕\o
+static void gen_profile_register(const FuncContext* pContext) {
+    emit("  cmp QWORD PTR .Lprof.registered[rip], 0\n");
+    emit("  jne .L%s.profreg\n", pContext->pszFuncName);
+    emit("  mov QWORD PTR .Lprof.registered[rip], 1\n");
+    emit("  mov rax, QWORD PTR __chibicc_profile_head[rip]\n");
+    emit("  mov QWORD PTR .Lprof.table[rip], rax\n");
+    emit("  lea rax, .Lprof.table[rip]\n");
+    emit("  mov QWORD PTR __chibicc_profile_head[rip], rax\n");
+    emit(".L%s.profreg:\n", pContext->pszFuncName);
+}
+
+static void gen_def_func(const Node* pNode, const GlobalContext* pGlobalContext, FuncJob* pJob) {
     int i;
     FuncContext context = { 0 };
     char funcName[MAX_FUNC_NAME_LEN + 1] = { 0 };
+    context.breakLabelId = -1;
 
     if (MAX_FUNC_NAME_LEN <= pNode->pToken->len) {
-        error_at(pNode->pToken->filename, pNode->pToken->user_input, pNode->pToken->str, "֐%dȏ゠܂", MAX_FUNC_NAME_LEN);
+        error_at(pNode->pToken->loc, "֐%dȏ゠܂", MAX_FUNC_NAME_LEN);
     }
     memcpy(funcName, pNode->pToken->str, pNode->pToken->len);
+    context.pszFuncName = funcName;
+
+    // {̂̍\͂񂵂ɂĂ΁Aōs
+    // ĂяoOtꍇ͉͍ς݂ŁA萔̈΂̒lœꉻĂ
+    Node funcNode = *pNode;
+    if (pJob->pFunc) {
+        funcNode.rhs = pJob->pFunc->pBody;
+    }
+    else if (funcNode.rhs->kind == ND_DEFERRED_BODY) {
+        funcNode.rhs = parse_func_body(pNode);
+    }
+    pNode = &funcNode;
+
+    // vt@C͊֐ƍ\nbVőΉt
+    const ProfileOptions* pProfile = pGlobalContext->pProfile;
+    if (pProfile && (pProfile->pszGenerateFile || pProfile->pUseData)) {
+        hash_func_structure(pNode, pNode->rhs, pJob->profileHash);
+        context.isInstrumented = pProfile->pszGenerateFile != NULL;
+        context.isProfileDumper = context.isInstrumented && strcmp(funcName, "main") == 0;
+        if (pProfile->pUseData) {
+            context.pFuncProfile = find_func_profile(pProfile->pUseData, funcName, pJob->profileHash);
+        }
+    }
 
     int paramNum = resigter_params(&context, pNode);
     const LVar* pParamTop = context.pLVars;
 
     const int stack_size = resigter_lvars(&context, pNode);
 
-    printf("%s:\n", funcName);
+    // ֐͊OȂ̂ŁÃIuWFNgĂׂ悤ɂ
+    // -fwhole-programȂ瑼̃IuWFNgĂ΂̂mainȂ̂ŁAȊO͂̃t@Cɕ
+    emit("  .p2align %d\n", CODE_ALIGN_LOG2);
+    if (pJob->pFunc == NULL || pJob->pFunc->isExported) {
+        emit(".globl %s\n", funcName);
+    }
+    emit("%s:\n", funcName);
 
     // v[O
     // [JϐKvƂ镪̗̈mۂ
-    printf("  push rbp\n");
-    printf("  mov rbp, rsp\n");
-    printf("  sub rsp, %d\n", stack_size);
+    // -gȂArbpςłrbpɌĂяõt[H邱Ƃ.cfi_*Ŏ
+    const bool isDebugInfo = pGlobalContext->isDebugInfo;
+    gen_loc(pNode, pGlobalContext, &context);
+    if (isDebugInfo) emit("  .cfi_startproc\n");
+    emit("  push rbp\n");
+    if (isDebugInfo) {
+        emit("  .cfi_def_cfa_offset 16\n");
+        emit("  .cfi_offset rbp, -16\n");
+    }
+    emit("  mov rbp, rsp\n");
+    if (isDebugInfo) emit("  .cfi_def_cfa_register rbp\n");
+    emit("  sub rsp, %d\n", stack_size);
+
+    // ֐Ă΂ꂽ񐔂𐔂
+    if (context.isInstrumented) {
+        gen_profile_register(&context);
+    }
+    gen_count(&context, new_counter(&context));
 
     // Ή郍[JϐɓWJ
     for (i = 0; i < paramNum; ++i) {
         if (pParamTop == NULL) {
             error("Internal Error. Param node is NULL.");
         }
-        printf("  mov rax, rbp\n");
-        printf("  sub rax, %d\n", pParamTop->offset);
+        // 萔̈͌ĂяoœnꂸA{̂łlɒuĂ̂œWJȂ
+        if (is_const_arg(pJob->pFunc, paramNum - i - 1)) {
+            pParamTop = pParamTop->next;
+            continue;
+        }
+        emit("  mov rax, rbp\n");
+        emit("  sub rax, %d\n", pParamTop->offset);
         switch (pParamTop->pType->ty) {
         case TY_CHAR:
-            printf("  mov [rax], %s\n", PARAM_REG_NAME[PARAM_REG_INDEX_8BIT][paramNum - i - 1]);
+            emit("  mov [rax], %s\n", PARAM_REG_NAME[PARAM_REG_INDEX_8BIT][paramNum - i - 1]);
             break;
         case TY_INT:
-            printf("  mov [rax], %s\n", PARAM_REG_NAME[PARAM_REG_INDEX_32BIT][paramNum - i - 1]);
+            emit("  mov [rax], %s\n", PARAM_REG_NAME[PARAM_REG_INDEX_32BIT][paramNum - i - 1]);
             break;
         case TY_PTR:
         case TY_ARRAY:
-            printf("  mov [rax], %s\n", PARAM_REG_NAME[PARAM_REG_INDEX_64BIT][paramNum - i - 1]);
+            emit("  mov [rax], %s\n", PARAM_REG_NAME[PARAM_REG_INDEX_64BIT][paramNum - i - 1]);
             break;
         default:
             error("Internal Error. Invalid Type '%d'.", pParamTop->pType->ty);
@@ -827,11 +2221,66 @@ static void gen_def_func(const Node* pNode, GlobalContext* pGlobalContext) {
     // em[h̉͂sAZuo͂
     gen_local_node(pNode->rhs, pGlobalContext, &context);
 
-    // Gs[O
+    // Gs[OiSĂreturnŋLj
     // Ō̎̌ʂRAXɎcĂ̂łꂪԂlɂȂ
-    printf("  mov rsp, rbp\n");
-    printf("  pop rbp\n");
-    printf("  ret\n");
+    // Ō̕returnȂÃGs[Oւ̃Wv͗vȂ
+    StrBuf jumpToReturn = { 0 };
+    strbuf_printf(&jumpToReturn, "  jmp .L%s.return\n", funcName);
+    if (s_suppressCount == 0 && jumpToReturn.len <= s_pOut->len &&
+        memcmp(s_pOut->data + s_pOut->len - jumpToReturn.len, jumpToReturn.data, jumpToReturn.len) == 0)
+    {
+        s_pOut->len -= jumpToReturn.len;
+        s_pOut->data[s_pOut->len] = '\0';
+    }
+    strbuf_free(&jumpToReturn);
+    emit(".L%s.return:\n", funcName);
+    gen_return(pGlobalContext, &context);
+    if (pGlobalContext->isDebugInfo) {
+        emit("  .cfi_endproc\n");
+    }
+
+    // őɎsȂ́A悭sR[hi-cache荇Ȃ悤ʂ̃ZNVɒu
+    // ǂoR[h̓v[Ǒ̏ԂŎŝŁAʂ͈̔͂ƂĂ̏Ԃn߂
+    if (context.coldCode.len) {
+        emit(".section .text.unlikely,\"ax\",@progbits\n");
+        if (isDebugInfo) {
+            emit("  .cfi_startproc\n");
+            emit("  .cfi_def_cfa rbp, 16\n");
+            emit("  .cfi_offset rbp, -16\n");
+        }
+        strbuf_append(s_pOut, context.coldCode.data, context.coldCode.len);
+        if (isDebugInfo) emit("  .cfi_endproc\n");
+        emit(".text\n");
+    }
+    strbuf_free(&context.coldCode);
+
+    // v_Ƃ̃JE^
+    if (context.isInstrumented) {
+        emit(".bss\n");
+        for (i = 0; i < context.counterCount; ++i) {
+            emit(".L%s.prof%04d:\n", funcName, i);
+            emit("  .zero 8\n");
+        }
+        emit(".text\n");
+    }
+    // xNg[vŗUϐ̊evf̏lɑ萔
+    if (context.isIotaUsed) {
+        emit(".section .rodata\n");
+        emit("  .p2align 4\n");
+        emit(".L%s.iota:\n", funcName);
+        for (i = 0; i < VECTOR_LANES; ++i) {
+            emit("  .long %d\n", i);
+        }
+        emit(".text\n");
+    }
+    // switch̃Wve[u
+    if (context.jumpTables.len) {
+        emit(".section .rodata\n");
+        strbuf_append(s_pOut, context.jumpTables.data, context.jumpTables.len);
+        emit(".text\n");
+    }
+    strbuf_free(&context.jumpTables);
+    pJob->counterCount = context.counterCount;
 }
 
 static void gen_global_node(const Node* pNode, GlobalContext* pGlobalContext) {
@@ -852,8 +2301,12 @@ static void gen_global_node(const Node* pNode, GlobalContext* pGlobalContext) {
         if (pNode->rhs) gen_global_node(pNode->rhs, pGlobalContext);
         return;
     case ND_DEF_FUNC:
-        // ֐`
-        gen_def_func(pNode, pGlobalContext);
+        // ֐`i֐ǂ͓ƗĂ̂ŁAł܂Ƃ߂ĕɐj
+        if (pGlobalContext->funcCap <= pGlobalContext->funcCount) {
+            pGlobalContext->funcCap = pGlobalContext->funcCap ? pGlobalContext->funcCap * 2 : 64;
+            pGlobalContext->ppFuncs = realloc(pGlobalContext->ppFuncs, pGlobalContext->funcCap * sizeof(Node*));
+        }
+        pGlobalContext->ppFuncs[pGlobalContext->funcCount++] = pNode;
         return;
     case ND_DECL_VAR:
         // O[oϐ錾iOɓo^ς݁j
@@ -864,6 +2317,633 @@ static void gen_global_node(const Node* pNode, GlobalContext* pGlobalContext) {
     }
 }
 
+// ֐e[u̕яiȌBȂ\[XR[h̏j
+static int compare_func_info(const void* pLhs, const void* pRhs) {
+    const FuncInfo* pLhsFunc = (const FuncInfo*)pLhs;
+    const FuncInfo* pRhsFunc = (const FuncInfo*)pRhs;
+    const int result = compare_func_name(pLhsFunc->pNode->pToken, pRhsFunc->pNode->pToken);
+    return result ? result : pLhsFunc->index - pRhsFunc->index;
+}
+
+// ϐ֐̉Ԗڂ̈ԂiłȂ-1j
+static int find_param_index(const FuncInfo* pFunc, const Node* pVarNode) {
+    for (int i = 0; i < pFunc->paramCount; ++i) {
+        const Token* pName = pFunc->pNode->children[i]->pToken;
+        if (pName->len == pVarNode->pToken->len && !memcmp(pName->str, pVarNode->pToken->str, pName->len)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// {̂ŏAhX肵ẮAĂяo̒l̂܂܂Ƃ͌Ȃ̂Œ萔ɂȂ
+static void mark_modified_params(const Node* pNode, FuncInfo* pFunc) {
+    if (pNode == NULL) return;
+
+    switch (pNode->kind) {
+    case ND_ASSIGN:
+    case ND_ADD_ASSIGN:
+    case ND_SUB_ASSIGN:
+    case ND_MUL_ASSIGN:
+    case ND_DIV_ASSIGN:
+    case ND_POST_INC:
+    case ND_POST_DEC:
+    case ND_ADDR:
+        if (pNode->lhs->kind == ND_VAR) {
+            const int index = find_param_index(pFunc, pNode->lhs);
+            if (0 <= index) pFunc->args[index].kind = ARG_VARYING;
+        }
+        break;
+    default:
+        break;
+    }
+
+    mark_modified_params(pNode->lhs, pFunc);
+    mark_modified_params(pNode->rhs, pFunc);
+    for (int i = 0; i < sizeof(pNode->children) / sizeof(pNode->children[0]); ++i) {
+        mark_modified_params(pNode->children[i], pFunc);
+    }
+}
+
+// ֐ĂяoTA܂͂ĂȂĂяo͂ƂɂăL[ɐς
+static void mark_reachable_callees(const Node* pNode, GlobalContext* pGlobalContext, FuncInfo** ppQueue, int* pQueueCount) {
+    if (pNode == NULL) return;
+
+    if (pNode->kind == ND_INVOKE) {
+        FuncInfo* pCallee = (FuncInfo*)find_func_info(pGlobalContext, pNode->pToken);
+        if (pCallee && !pCallee->isReachable) {
+            pCallee->isReachable = true;
+            ppQueue[(*pQueueCount)++] = pCallee;
+        }
+    }
+
+    mark_reachable_callees(pNode->lhs, pGlobalContext, ppQueue, pQueueCount);
+    mark_reachable_callees(pNode->rhs, pGlobalContext, ppQueue, pQueueCount);
+    for (int i = 0; i < sizeof(pNode->children) / sizeof(pNode->children[0]); ++i) {
+        mark_reachable_callees(pNode->children[i], pGlobalContext, ppQueue, pQueueCount);
+    }
+}
+
+// 萔ǂ̉Zݍ
+// sƓ64rbgŌvZAʂint^Ɏ܂Ȃꍇ0Z̏ꍇ͏ݍ܂falseԂ
+static bool fold_const_expr(NodeKind kind, int lhs, int rhs, int* pVal) {
+    int64_t val;
+    switch (kind) {
+    case ND_ADD:    val = (int64_t)lhs + rhs; break;
+    case ND_SUB:    val = (int64_t)lhs - rhs; break;
+    case ND_MUL:    val = (int64_t)lhs * rhs; break;
+    case ND_DIV:
+        if (rhs == 0) return false;
+        val = (int64_t)lhs / rhs;
+        break;
+    case ND_EQ:     val = lhs == rhs; break;
+    case ND_NE:     val = lhs != rhs; break;
+    case ND_LT:     val = lhs < rhs; break;
+    case ND_LE:     val = lhs <= rhs; break;
+    case ND_LOGAND: val = lhs && rhs; break;
+    case ND_LOGOR:  val = lhs || rhs; break;
+    default:
+        return false;
+    }
+    if (val < INT32_MIN || INT32_MAX < val) return false;
+
+    *pVal = (int)val;
+    return true;
+}
+
+// ĂяopCaller̈̒lgāA̎̒l߂
+// ƈ畛pȂɋ܂鎮Al̕ȂgĂARG_UNKNOWNAȊOARG_VARYINGɂȂ
+static ArgState eval_arg_expr(const Node* pNode, const FuncInfo* pCaller) {
+    ArgState result = { ARG_VARYING, 0 };
+
+    switch (pNode->kind) {
+    case ND_NUM:
+        result.kind = ARG_CONST;
+        result.val = pNode->pToken->val;
+        return result;
+    case ND_VAR: {
+        const int index = find_param_index(pCaller, pNode);
+        return (0 <= index) ? pCaller->args[index] : result;
+    }
+    case ND_NOT:
+        result = eval_arg_expr(pNode->lhs, pCaller);
+        if (result.kind == ARG_CONST) result.val = !result.val;
+        return result;
+    case ND_ADD:
+    case ND_SUB:
+    case ND_MUL:
+    case ND_DIV:
+    case ND_EQ:
+    case ND_NE:
+    case ND_LT:
+    case ND_LE:
+    case ND_LOGAND:
+    case ND_LOGOR: {
+        const ArgState lhs = eval_arg_expr(pNode->lhs, pCaller);
+        const ArgState rhs = eval_arg_expr(pNode->rhs, pCaller);
+        if (lhs.kind == ARG_VARYING || rhs.kind == ARG_VARYING) return result;
+        if (lhs.kind == ARG_UNKNOWN || rhs.kind == ARG_UNKNOWN) {
+            result.kind = ARG_UNKNOWN;
+            return result;
+        }
+        if (fold_const_expr(pNode->kind, lhs.val, rhs.val, &result.val)) {
+            result.kind = ARG_CONST;
+        }
+        return result;
+    }
+    default:
+        return result;
+    }
+}
+
+// Ăяoœnl̒lɍ킹iARG_UNKNOWNARG_CONSTARG_VARYING̏ɂςȂj
+// lςȂtrueԂ
+static bool meet_arg_state(ArgState* pState, ArgState arg, bool isCharParam) {
+    if (pState->kind == ARG_VARYING || arg.kind == ARG_UNKNOWN) return false;
+
+    // char^͉̈8rbgn̂ŁA̒lŔׂ
+    if (arg.kind == ARG_CONST && isCharParam) arg.val = (signed char)arg.val;
+
+    if (pState->kind == ARG_UNKNOWN) {
+        *pState = arg;
+        return true;
+    }
+    if (arg.kind == ARG_CONST && arg.val == pState->val) return false;
+
+    pState->kind = ARG_VARYING;
+    return true;
+}
+
+// ֐ĂяoTAĂяopCallerŕĂlĂяö̒lXV
+// lςtrueԂ
+static bool propagate_call_args(const Node* pNode, const FuncInfo* pCaller, GlobalContext* pGlobalContext) {
+    if (pNode == NULL) return false;
+
+    bool isChanged = false;
+    if (pNode->kind == ND_INVOKE) {
+        FuncInfo* pCallee = (FuncInfo*)find_func_info(pGlobalContext, pNode->pToken);
+        for (int i = 0; pCallee && i < pCallee->paramCount; ++i) {
+            const ArgState varying = { ARG_VARYING, 0 };
+            const Node* pArg = pNode->children[i];
+            const bool isCharParam = pCallee->pNode->children[i]->lhs->pToken->kind == TK_CHAR;
+            isChanged |= meet_arg_state(&pCallee->args[i], pArg ? eval_arg_expr(pArg, pCaller) : varying, isCharParam);
+        }
+    }
+
+    isChanged |= propagate_call_args(pNode->lhs, pCaller, pGlobalContext);
+    isChanged |= propagate_call_args(pNode->rhs, pCaller, pGlobalContext);
+    for (int i = 0; i < sizeof(pNode->children) / sizeof(pNode->children[0]); ++i) {
+        isChanged |= propagate_call_args(pNode->children[i], pCaller, pGlobalContext);
+    }
+    return isChanged;
+}
+
+// lval̐m[hiʒupNodẽg[N̂̂gj
+static const Node* new_const_node(const Node* pNode, int val) {
+    Token* pToken = arena_calloc(1, sizeof(Token));
+    *pToken = *pNode->pToken;
+    pToken->kind = TK_NUM;
+    pToken->val = val;
+
+    Node* pNewNode = arena_calloc(1, sizeof(Node));
+    pNewNode->kind = ND_NUM;
+    pNewNode->pToken = pToken;
+    return pNewNode;
+}
+
+// 萔̈lɒuAǂ̉Zݍ񂾍\؂
+// sizeof͕̒]ꂸ^Ӗ̂ŒuȂ
+static const Node* specialize_node(const Node* pNode, const FuncInfo* pFunc) {
+    if (pNode == NULL || pNode->kind == ND_SIZEOF || pNode->kind == ND_DECL_VAR || pNode->kind == ND_TYPE) return pNode;
+
+    if (pNode->kind == ND_VAR) {
+        const int index = find_param_index(pFunc, pNode);
+        return (0 <= index && pFunc->args[index].kind == ARG_CONST) ? new_const_node(pNode, pFunc->args[index].val) : pNode;
+    }
+
+    Node* pNewNode = arena_calloc(1, sizeof(Node));
+    *pNewNode = *pNode;
+    pNewNode->lhs = specialize_node(pNode->lhs, pFunc);
+    pNewNode->rhs = specialize_node(pNode->rhs, pFunc);
+    for (int i = 0; i < sizeof(pNode->children) / sizeof(pNode->children[0]); ++i) {
+        pNewNode->children[i] = specialize_node(pNode->children[i], pFunc);
+    }
+
+    int val;
+    if (pNewNode->kind == ND_NOT && pNewNode->lhs->kind == ND_NUM) {
+        return new_const_node(pNode, !pNewNode->lhs->pToken->val);
+    }
+    if (pNewNode->lhs && pNewNode->lhs->kind == ND_NUM && pNewNode->rhs && pNewNode->rhs->kind == ND_NUM &&
+        fold_const_expr(pNewNode->kind, pNewNode->lhs->pToken->val, pNewNode->rhs->pToken->val, &val))
+    {
+        return new_const_node(pNode, val);
+    }
+    return pNewNode;
+}
+
+// vOŜ̌ĂяoOtAmain͂֐ƁA萔n߂i-fwhole-programj
+// |PʂvOŜȂ̂ŁAOĂ΂ꂤ̂mainŁAȊO̊֐̌Ăяo͑SĂ̒ɂ
+//   1. ֐e[u𖼑Ȍɍi͂Ȃ֐G[͕񍐂̂ŁASĂ̖{̂ō\͂j
+//   2. main֐ĂяoHA͂֐Ɉt
+//   3. ͂֐̒̌ĂяoœnlAςȂȂ܂ŌĂяöɓ`
+//      iĂяö̒l邽тɌĂяo֓`̂ŁA萔ǐĂяoʂē͂j
+//   4. 萔Ɍ܂̂֐́A̒lœꉻ{̂
+static void build_call_graph(GlobalContext* pGlobalContext) {
+    const int funcCount = pGlobalContext->funcCount;
+    FuncInfo* pFuncs = arena_calloc(funcCount ? funcCount : 1, sizeof(FuncInfo));
+    int i;
+
+    for (i = 0; i < funcCount; ++i) {
+        FuncInfo* pFunc = &pFuncs[i];
+        const Node* pNode = pGlobalContext->ppFuncs[i];
+        pFunc->pNode = pNode;
+        pFunc->pBody = (pNode->rhs->kind == ND_DEFERRED_BODY) ? parse_func_body(pNode) : pNode->rhs;
+        pFunc->index = i;
+        pFunc->isExported = pNode->pToken->len == 4 && memcmp(pNode->pToken->str, "main", 4) == 0;
+
+        // OĂ΂֐̈ƁAłȂ͒l߂Ȃ
+        while (pFunc->paramCount < sizeof(pNode->children) / sizeof(pNode->children[0]) && pNode->children[pFunc->paramCount]) {
+            const Node* pTypeNode = pNode->children[pFunc->paramCount]->lhs;
+            const bool isInteger = (pTypeNode->pToken->kind == TK_INT || pTypeNode->pToken->kind == TK_CHAR) && pTypeNode->rhs == NULL;
+            pFunc->args[pFunc->paramCount++].kind = (pFunc->isExported || !isInteger) ? ARG_VARYING : ARG_UNKNOWN;
+        }
+        mark_modified_params(pFunc->pBody, pFunc);
+    }
+
+    qsort(pFuncs, funcCount, sizeof(FuncInfo), compare_func_info);
+    for (i = 1; i < funcCount; ++i) {
+        if (compare_func_name(pFuncs[i - 1].pNode->pToken, pFuncs[i].pNode->pToken) == 0) {
+            error_at(pFuncs[i].pNode->pToken->loc, "֐dĂ܂");
+        }
+    }
+    pGlobalContext->pFuncInfos = pFuncs;
+    pGlobalContext->funcInfoCount = funcCount;
+
+    // ͂֐͈xL[ɐςނ̂ŁAL[̑傫͊֐̐ő
+    FuncInfo** ppQueue = arena_calloc(funcCount ? funcCount : 1, sizeof(FuncInfo*));
+    int queueCount = 0;
+    for (i = 0; i < funcCount; ++i) {
+        if (pFuncs[i].isExported) {
+            pFuncs[i].isReachable = true;
+            ppQueue[queueCount++] = &pFuncs[i];
+        }
+    }
+    for (i = 0; i < queueCount; ++i) {
+        mark_reachable_callees(ppQueue[i]->pBody, pGlobalContext, ppQueue, &queueCount);
+    }
+
+    // ̒lARG_UNKNOWNARG_CONSTARG_VARYING̏ɂςȂ̂ŁAK~܂
+    bool isChanged = true;
+    while (isChanged) {
+        isChanged = false;
+        for (i = 0; i < queueCount; ++i) {
+            isChanged |= propagate_call_args(ppQueue[i]->pBody, ppQueue[i], pGlobalContext);
+        }
+    }
+
+    for (i = 0; i < funcCount; ++i) {
+        FuncInfo* pFunc = &pFuncs[i];
+        bool isSpecialized = false;
+        for (int j = 0; j < pFunc->paramCount; ++j) {
+            // ͂Ȃ֐AlnĂяo͒萔ɂȂ
+            if (!pFunc->isReachable || pFunc->args[j].kind == ARG_UNKNOWN) {
+                pFunc->args[j].kind = ARG_VARYING;
+            }
+            isSpecialized |= pFunc->args[j].kind == ARG_CONST;
+        }
+        if (isSpecialized) {
+            pFunc->pBody = specialize_node(pFunc->pBody, pFunc);
+        }
+    }
+}
+
+// ֐̎w߂
+// ֐`̃\[XR[hi߂ľ^{̂'}'܂ŁjɉāAQƂĂO[oϐ̌^܂߂
+// }NWJōꂽg[N⑼̃t@C痈g[ŃA̕܂߂
+// x͊֐ŋʂĂ̂ŁÅ֐ǉE폜Ăw͕ςȂ
+static void fingerprint_func(const Node* pNode, const GlobalContext* pGlobalContext, uint8_t digest[SHA256_DIGEST_SIZE]) {
+    const Token* pStartToken = pNode->lhs->pToken;
+    const Token* pEndToken = pNode->rhs->lhs->pToken;
+    Sha256 ctx;
+    sha256_init(&ctx);
+
+    // 擪Ɩt@C̃g[NȂÅԂ̃\[XR[h܂Ƃ߂Ċ܂߂
+    const SourceFile* pFile = find_source_file(pStartToken->loc);
+    const bool isContiguous = pFile && source_file_contains(pFile, pEndToken->loc) && pStartToken->loc <= pEndToken->loc &&
+        !pStartToken->pHideSet && !pEndToken->pHideSet;
+    if (isContiguous) {
+        sha256_update(&ctx, pStartToken->str, (pEndToken->str + pEndToken->len) - pStartToken->str);
+    }
+
+    for (const Token* pToken = pStartToken; pToken; pToken = pToken->next) {
+        if (!isContiguous || pToken->pHideSet || !source_file_contains(pFile, pToken->loc)) {
+            sha256_update(&ctx, pToken->str, pToken->len);
+            sha256_update(&ctx, " ", 1);
+        }
+
+        // 񃊃e̓t@CŜł̒ʂԍ̃xŎQƂ
+        if (pToken->kind == TK_STRING) {
+            sha256_update(&ctx, &pToken->val, sizeof(pToken->val));
+        }
+
+        // ̃[JϐŉBĂꍇ܂߂Ă܂AĐ邾ŊQ͂Ȃ
+        if (pToken->kind == TK_IDENT) {
+            for (const GVar* pVar = pGlobalContext->pGVars; pVar; pVar = pVar->next) {
+                if (pVar->len != pToken->len || memcmp(pVar->name, pToken->str, pToken->len) != 0) continue;
+
+                for (const Type* pType = pVar->pType; pType; pType = pType->ptr_to) {
+                    sha256_update(&ctx, &pType->ty, sizeof(pType->ty));
+                    sha256_update(&ctx, &pType->array_size, sizeof(pType->array_size));
+                }
+            }
+
+            // ĂяoOtꍇ́Å֐ƌĂяo̒萔̈ɂĐʂς
+            const FuncInfo* pFunc = find_func_info(pGlobalContext, pToken);
+            if (pFunc) {
+                sha256_update(&ctx, &pFunc->isExported, sizeof(pFunc->isExported));
+                for (int i = 0; i < pFunc->paramCount; ++i) {
+                    const int val = (pFunc->args[i].kind == ARG_CONST) ? pFunc->args[i].val : 0;
+                    sha256_update(&ctx, &pFunc->args[i].kind, sizeof(pFunc->args[i].kind));
+                    sha256_update(&ctx, &val, sizeof(val));
+                }
+            }
+        }
+
+        if (pToken == pEndToken) break;
+    }
+
+    sha256_final(&ctx, digest);
+}
+
+// [J[XbhŊ֐1̃AZu𐶐
+// o͐ƃG[̕񍐐͊֐ƂɕAx͊֐ŋʂ̂
+// ǂ̃XbhŐĂɐꍇƓeɂȂ
+static void gen_func_job(void* pContext, int index) {
+    FuncJob* pJob = (FuncJob*)pContext + index;
+
+    TimeSpan span;
+    time_trace_begin(&span, "function", pJob->pNode->pToken->str, pJob->pNode->pToken->len);
+
+    // O񂩂ςĂȂ֐́A{̂̍\͂ɑǑʂg
+    if (pJob->pGlobalContext->pFuncCache) {
+        fingerprint_func(pJob->pNode, pJob->pGlobalContext, pJob->fingerprint);
+
+        const FuncCodeEntry* pEntry = find_func_code(pJob->pGlobalContext->pFuncCache, pJob->fingerprint);
+        if (pEntry) {
+            strbuf_append(&pJob->out, pEntry->code, pEntry->len);
+            pJob->isReused = true;
+            time_trace_end(&span);
+            return;
+        }
+    }
+
+    // ĂяõXbh[J[ɂȂ̂ŁAo͐G[̕񍐐͌ɖ߂
+    StrBuf* pOldOut = s_pOut;
+    jmp_buf* pOldJmpBuf;
+    StrBuf* pOldErrorOut;
+    get_error_handler(&pOldJmpBuf, &pOldErrorOut);
+
+    // ^⃍[Jϐ̏͂̊֐̒łgȂ̂ŁAɉ
+    const ArenaMark mark = arena_mark();
+
+    jmp_buf jmpBuf;
+    if (setjmp(jmpBuf) == 0) {
+        set_error_handler(&jmpBuf, &pJob->errors);
+        s_pOut = &pJob->out;
+        s_suppressCount = 0;
+        gen_def_func(pJob->pNode, pJob->pGlobalContext, pJob);
+    }
+    else {
+        pJob->isFailed = true;
+    }
+
+    arena_release_to(mark);
+    set_error_handler(pOldJmpBuf, pOldErrorOut);
+    s_pOut = pOldOut;
+    time_trace_end(&span);
+}
+
+// vʂo֐o͂imain̂t@Cɂuj
+// ꗗɌq\ƂɁA֐Ƃ"֐ \nbV JE^̐ JE^..."̍st@C֒ǋL
+//     \̌`: ̕\ւ̃|C^A֐̕\ւ̃|C^A֐̐
+//     ֐̕\̗vf: "֐ \nbV"̕ւ̃|C^AJE^̐AJE^̔zւ̃|C^
+static void gen_profile_dumper(const char* pszPath) {
+    const char (*ppArgRegs)[4] = PARAM_REG_NAME[PARAM_REG_INDEX_64BIT];
+
+    emit(".bss\n");
+    emit(".globl __chibicc_profile_head\n");
+    emit("__chibicc_profile_head:\n");
+    emit("  .zero 8\n");
+
+    // õt@ĆApX̋؂ȂǂGXP[vĖߍ
+    emit(".data\n");
+    emit(".Lprof.path:\n");
+    emit("  .string \"");
+    for (const char* p = pszPath; *p; ++p) {
+        if (*p == '\\' || *p == '"') emit("\\");
+        emit("%c", *p);
+    }
+    emit("\"\n");
+    emit(".Lprof.mode:\n");
+    emit("  .string \"a\"\n");
+    emit(".Lprof.fmt_func:\n");
+    emit("  .string \"%%s %%lld\"\n");
+    emit(".Lprof.fmt_count:\n");
+    emit("  .string \" %%lld\"\n");
+    emit(".Lprof.fmt_eol:\n");
+    emit("  .string \"\\n\"\n");
+
+    emit(".text\n");
+    emit(".Lprof.dump:\n");
+    emit("  push rbp\n");
+    emit("  mov rbp, rsp\n");
+    emit("  push rbx\n");
+    emit("  push r12\n");
+    emit("  push r13\n");
+    emit("  push r14\n");
+    emit("  push r15\n");
+    emit("  sub rsp, %d\n", PROFILE_DUMP_FRAME_SIZE);
+    emit("  lea %s, .Lprof.path[rip]\n", ppArgRegs[0]);
+    emit("  lea %s, .Lprof.mode[rip]\n", ppArgRegs[1]);
+    emit("  call fopen\n");
+    emit("  cmp rax, 0\n");
+    emit("  je  .Lprof.dump.end\n");
+    emit("  mov r15, rax\n");
+
+    // r12: \Ar13: ֐̕\̗vfAr14: c̊֐̐Arbx: JE^̔ԍ
+    emit("  mov r12, QWORD PTR __chibicc_profile_head[rip]\n");
+    emit(".Lprof.dump.table:\n");
+    emit("  cmp r12, 0\n");
+    emit("  je  .Lprof.dump.close\n");
+    emit("  mov r13, QWORD PTR [r12+8]\n");
+    emit("  mov r14, QWORD PTR [r12+16]\n");
+    emit(".Lprof.dump.func:\n");
+    emit("  cmp r14, 0\n");
+    emit("  je  .Lprof.dump.next\n");
+    emit("  mov %s, r15\n", ppArgRegs[0]);
+    emit("  lea %s, .Lprof.fmt_func[rip]\n", ppArgRegs[1]);
+    emit("  mov %s, QWORD PTR [r13]\n", ppArgRegs[2]);
+    emit("  mov %s, QWORD PTR [r13+8]\n", ppArgRegs[3]);
+    emit("  mov rax, 0\n");
+    emit("  call fprintf\n");
+    emit("  mov rbx, 0\n");
+    emit(".Lprof.dump.count:\n");
+    emit("  cmp rbx, QWORD PTR [r13+8]\n");
+    emit("  jge .Lprof.dump.eol\n");
+    emit("  mov %s, r15\n", ppArgRegs[0]);
+    emit("  lea %s, .Lprof.fmt_count[rip]\n", ppArgRegs[1]);
+    emit("  mov rax, QWORD PTR [r13+16]\n");
+    emit("  mov %s, QWORD PTR [rax+rbx*8]\n", ppArgRegs[2]);
+    emit("  mov rax, 0\n");
+    emit("  call fprintf\n");
+    emit("  inc rbx\n");
+    emit("  jmp .Lprof.dump.count\n");
+    emit(".Lprof.dump.eol:\n");
+    emit("  mov %s, r15\n", ppArgRegs[0]);
+    emit("  lea %s, .Lprof.fmt_eol[rip]\n", ppArgRegs[1]);
+    emit("  mov rax, 0\n");
+    emit("  call fprintf\n");
+    emit("  add r13, 24\n");
+    emit("  dec r14\n");
+    emit("  jmp .Lprof.dump.func\n");
+    emit(".Lprof.dump.next:\n");
+    emit("  mov r12, QWORD PTR [r12]\n");
+    emit("  jmp .Lprof.dump.table\n");
+    emit(".Lprof.dump.close:\n");
+    emit("  mov %s, r15\n", ppArgRegs[0]);
+    emit("  call fclose\n");
+    emit(".Lprof.dump.end:\n");
+    emit("  add rsp, %d\n", PROFILE_DUMP_FRAME_SIZE);
+    emit("  pop r15\n");
+    emit("  pop r14\n");
+    emit("  pop r13\n");
+    emit("  pop r12\n");
+    emit("  pop rbx\n");
+    emit("  pop rbp\n");
+    emit("  ret\n");
+}
+
+// ĂяoOtłǂ͂Ao͂Ȃ֐Ȃtrue
+static bool is_dropped_func(const FuncJob* pJob) {
+    return pJob->pFunc && !pJob->pFunc->isReachable;
+}
+
+// ̃t@Čvʂ̕\o͂i`gen_profile_dumperQƁj
+// o͂ȂiĂяoOtłǂ͂Ȃj֐͕\Ɋ܂߂Ȃ
+static void gen_profile_table(const FuncJob* pJobs, int funcCount) {
+    int tableCount = 0;
+    for (int i = 0; i < funcCount; ++i) {
+        if (!is_dropped_func(&pJobs[i])) ++tableCount;
+    }
+
+    emit(".data\n");
+    emit(".Lprof.registered:\n");
+    emit("  .quad 0\n");
+    emit(".Lprof.table:\n");
+    emit("  .quad 0\n");
+    emit("  .quad .Lprof.funcs\n");
+    emit("  .quad %d\n", tableCount);
+    emit(".Lprof.funcs:\n");
+    for (int i = 0; i < funcCount; ++i) {
+        if (is_dropped_func(&pJobs[i])) continue;
+        const Token* pName = pJobs[i].pNode->pToken;
+        emit("  .quad .Lprof.name%04d\n", i);
+        emit("  .quad %d\n", pJobs[i].counterCount);
+        emit("  .quad .L%.*s.prof0000\n", pName->len, pName->str);
+    }
+    for (int i = 0; i < funcCount; ++i) {
+        if (is_dropped_func(&pJobs[i])) continue;
+        const Token* pName = pJobs[i].pNode->pToken;
+        emit(".Lprof.name%04d:\n", i);
+        emit("  .string \"%.*s %s\"\n", pName->len, pName->str, pJobs[i].profileHash);
+    }
+    emit(".text\n");
+}
+
+// SĂ̊֐̃AZuthreadCount̃XbhŕɐA\[XR[h̏ɏo͂
+static void gen_funcs(const GlobalContext* pGlobalContext, int threadCount) {
+    if (pGlobalContext->funcCount <= 0) return;
+
+    FuncJob* pJobs = calloc((size_t)pGlobalContext->funcCount, sizeof(FuncJob));
+    int i;
+
+    for (i = 0; i < pGlobalContext->funcCount; ++i) {
+        pJobs[i].pNode = pGlobalContext->ppFuncs[i];
+        pJobs[i].pGlobalContext = pGlobalContext;
+    }
+    for (i = 0; i < pGlobalContext->funcInfoCount; ++i) {
+        pJobs[pGlobalContext->pFuncInfos[i].index].pFunc = &pGlobalContext->pFuncInfos[i];
+    }
+
+    // ֐Ȃ΃Xbh̂ŁAĂяõXbhŐ
+    if (pGlobalContext->funcCount < PARALLEL_GEN_MIN_FUNCS) {
+        threadCount = 1;
+    }
+    run_jobs(gen_func_job, pJobs, pGlobalContext->funcCount, threadCount);
+
+    // ɐꍇƓAŏɃG[N֐̃G[񍐂
+    for (i = 0; i < pGlobalContext->funcCount; ++i) {
+        if (pJobs[i].isFailed) {
+            StrBuf* pErrors = &pJobs[i].errors;
+            error("%.*s", (int)(pErrors->len ? pErrors->len - 1 : 0), pErrors->data);
+        }
+    }
+
+    // ǂ͂Ȃ֐AG[񍐂邽߂ɃR[h͍sAo͎͂̂Ă
+    for (i = 0; i < pGlobalContext->funcCount; ++i) {
+        if (is_dropped_func(&pJobs[i])) {
+            strbuf_free(&pJobs[i].out);
+            strbuf_free(&pJobs[i].errors);
+            continue;
+        }
+        if (pJobs[i].out.len) {
+            strbuf_append(s_pOut, pJobs[i].out.data, pJobs[i].out.len);
+        }
+        if (pGlobalContext->pFuncCache) {
+            add_func_code(pGlobalContext->pFuncCache, pJobs[i].fingerprint, pJobs[i].out.data ? pJobs[i].out.data : "", pJobs[i].out.len);
+            if (pJobs[i].isReused) ++pGlobalContext->pFuncCache->reusedCount;
+        }
+        strbuf_free(&pJobs[i].out);
+        strbuf_free(&pJobs[i].errors);
+    }
+
+    // vR[h𖄂ߍ񂾂ȂAvʂ̕\ƁAmainΏo֐u
+    const ProfileOptions* pProfile = pGlobalContext->pProfile;
+    if (pProfile && pProfile->pszGenerateFile && pGlobalContext->funcCount) {
+        gen_profile_table(pJobs, pGlobalContext->funcCount);
+        for (i = 0; i < pGlobalContext->funcCount; ++i) {
+            const Token* pName = pJobs[i].pNode->pToken;
+            if (pName->len == 4 && memcmp(pName->str, "main", 4) == 0) {
+                gen_profile_dumper(pProfile->pszGenerateFile);
+            }
+        }
+    }
+    free(pJobs);
+}
+
+// O[oϐ1o^
+static void resigter_gvar(GlobalContext* pGlobalContext, const Node* pNode) {
+    if (find_gvar(pGlobalContext->pGVars, pNode) != NULL) {
+        error_at(pNode->pToken->loc, "O[oϐdĂ܂");
+    }
+
+    GVar* pVar = arena_calloc(1, sizeof(GVar));
+    pVar->next = pGlobalContext->pGVars;
+    pVar->pType = parse_type(pNode->lhs);
+    pVar->pType->is_lvalue = true;
+    pVar->name = pNode->pToken->str;
+    pVar->len = pNode->pToken->len;
+    pGlobalContext->pGVars = pVar;
+}
+
+// O[oϐ̗̈o͂i.bssɐ؂ւĂĂԁj
+static void gen_gvar_storage(const GVar* pVar) {
+    char pszFormat[64] = { 0 };
+    snprintf(pszFormat, sizeof(pszFormat), "%%.%ds:\n", pVar->len);
+    emit(pszFormat, pVar->name);
+    emit("  .zero %zd\n", get_type_size(pVar->pType));
+}
+
 // O[oϐo^
 static void resigter_gvars(GlobalContext* pGlobalContext, const Node* pNode) {
     if (!pNode) return;
@@ -874,54 +2954,171 @@ static void resigter_gvars(GlobalContext* pGlobalContext, const Node* pNode) {
         resigter_gvars(pGlobalContext, pNode->rhs);
         break;
     case ND_DECL_VAR:
-        {
-            if (find_gvar(pGlobalContext->pGVars, pNode) != NULL) {
-                error_at(pNode->pToken->filename, pNode->pToken->user_input, pNode->pToken->str, "O[oϐdĂ܂");
-            }
+        resigter_gvar(pGlobalContext, pNode);
+        gen_gvar_storage(pGlobalContext->pGVars);
+        break;
+    default:
+        break;
+    }
+}
 
-            GVar* pVar = calloc(1, sizeof(GVar));
-            pVar->next = pGlobalContext->pGVars;
-            pVar->pType = parse_type(pNode->lhs);
-            pVar->pType->is_lvalue = true;
-            pVar->name = pNode->pToken->str;
-            pVar->len = pNode->pToken->len;
-            pGlobalContext->pGVars = pVar;
+// ֐`̂\[XɁA\[X̏ɔԍt.fileŏo͂
+// ֐Ƃ̃R[h͕ɍŝŁAԍ͐n߂OɂŌ߂Ă
+static void gen_debug_files(GlobalContext* pGlobalContext) {
+    pGlobalContext->ppDebugFiles = calloc(pGlobalContext->funcCount + 1, sizeof(SourceFile*));
+    for (int i = 0; i < pGlobalContext->funcCount; ++i) {
+        const SourceFile* pFile = find_source_file(pGlobalContext->ppFuncs[i]->pToken->loc);
+        bool isNumbered = pFile == NULL;
+        for (int j = 0; !isNumbered && j < pGlobalContext->debugFileCount; ++j) {
+            isNumbered = pGlobalContext->ppDebugFiles[j] == pFile;
+        }
+        if (isNumbered) continue;
 
-            char pszFormat[64] = { 0 };
-            snprintf(pszFormat, sizeof(pszFormat), "%%.%ds:\n", pVar->len);
-            printf(pszFormat, pVar->name);
-            printf("  .zero %zd\n", get_type_size(pVar->pType));
+        pGlobalContext->ppDebugFiles[pGlobalContext->debugFileCount++] = pFile;
+        emit(".file %d \"", pGlobalContext->debugFileCount);
+        for (const char* p = pFile->pszName; *p; ++p) {
+            emit((*p == '\\' || *p == '"') ? "\\%c" : "%c", *p);
         }
-        break;
+        emit("\"\n");
+    }
+}
+
+// 񃊃er'\0'܂݂Ȃtrueil̃GXP[vΊ܂ނƌȂj
+static bool may_contain_nul(const StringLiteral* pStrLiteral) {
+    for (int i = 0; i < pStrLiteral->len - 1; ++i) {
+        if (pStrLiteral->str[i] != '\\') continue;
+
+        const char c = pStrLiteral->str[++i];
+        if (isdigit((unsigned char)c) || c == 'x') return true;
     }
+    return false;
 }
 
+// 񃊃eǂݎp̃ZNVɏo͂
+// r'\0'܂܂Ȃ̂́AJ̃IuWFNg̓Ƃ܂Ƃ߂悤\ȃZNVɒu
+// i\ȃZNVł'\0'܂ł1̗vfɂȂ̂ŁAr'\0'ƌ낪ʂ̕Ƃ܂Ƃ߂Ă܂j
 void resigter_str_literals(const StringLiteral* pStrLiterals) {
-    int i = 0;
-    while (pStrLiterals) {
-        printf(".LC%04d:\n", i++);
-        printf("  .string %s\n", pStrLiterals->pszText);
-        pStrLiterals = pStrLiterals->pNext;
+    for (int pass = 0; pass < 2; ++pass) {
+        const bool isMergeablePass = (pass == 0);
+        bool isSectionStarted = false;
+        int i = 0;
+        for (const StringLiteral* pCur = pStrLiterals; pCur; pCur = pCur->pNext, ++i) {
+            if (may_contain_nul(pCur) == isMergeablePass) continue;
+
+            if (!isSectionStarted) {
+                emit(isMergeablePass ? ".section .rodata.str1.1,\"aMS\",@progbits,1\n" : ".section .rodata\n");
+                isSectionStarted = true;
+            }
+            emit(".LC%04d:\n", i);
+            emit("  .string %.*s\n", pCur->len, pCur->str);
+        }
     }
 }
 
-void gen(const Node* pNode, const StringLiteral* pStrLiterals) {
+void gen(const Node* pNode, const StringLiteral* pStrLiterals, StrBuf* pOut, int threadCount, FuncCodeCache* pFuncCache, const ProfileOptions* pProfile, bool isDebugInfo, bool isWholeProgram) {
     GlobalContext globalContext = { 0 };
+    globalContext.pFuncCache = pFuncCache;
+    globalContext.pProfile = pProfile;
+    globalContext.isDebugInfo = isDebugInfo;
+    s_pOut = pOut;
 
     // AZȗOo
-    printf(".intel_syntax noprefix\n");
+    emit(".intel_syntax noprefix\n");
 
     // 񃊃e̓o^
-    printf(".data\n");
     resigter_str_literals(pStrLiterals);
 
     // O[oϐ̓o^
-    printf(".bss\n");
+    TimeSpan span;
+    time_trace_begin(&span, "resigter_gvars", NULL, 0);
+    emit(".bss\n");
     resigter_gvars(&globalContext, pNode);
+    time_trace_end(&span);
 
-    printf(".text\n");
-    printf(".globl main\n");
+    emit(".text\n");
 
-    // em[h̉͂sAZuo͂
+    // em[h̉͂sA֐Ƃ̃AZuo͂
+    time_trace_begin(&span, "codegen", NULL, 0);
     gen_global_node(pNode, &globalContext);
+    if (isWholeProgram) {
+        TimeSpan graphSpan;
+        time_trace_begin(&graphSpan, "call_graph", NULL, 0);
+        build_call_graph(&globalContext);
+        time_trace_end(&graphSpan);
+    }
+    if (isDebugInfo) {
+        gen_debug_files(&globalContext);
+    }
+    gen_funcs(&globalContext, threadCount);
+    free(globalContext.ppFuncs);
+    free(globalContext.ppDebugFiles);
+    time_trace_end(&span);
+
+#ifndef _WIN32
+    // s\X^bNvȂƂJɓ`
+    emit(".section .note.GNU-stack,\"\",@progbits\n");
+#endif
+}
+
+// o^iXgƂ͋tjɃO[oϐ̗̈o͂
+static void gen_gvar_storages(const GVar* pVar) {
+    if (pVar == NULL) return;
+    gen_gvar_storages(pVar->next);
+    gen_gvar_storage(pVar);
+}
+
+// g[Ngbvx̐錾1\͂A֐`͂̏ŃAZuɕϊpOutɒǉ
+// ֐̍\؂^A[Jϐ͎̏̐錾֐iޑOɉ̂ŁA
+// Ɨ̈̓t@CŜł͂Ȃł傫֐̕ōς
+// O[oϐ̗̈ƕ񃊃éASĂ̊֐̌ɂ܂Ƃ߂ďo͂
+// fpNULLłȂ΁A֐1o͂邲ƂpOut̓efp֏oċɂ
+void gen_stream(Token* pToken, const StringLiteral* pStrLiterals, StrBuf* pOut, FILE* fp, const ProfileOptions* pProfile) {
+    GlobalContext globalContext = { 0 };
+    globalContext.pProfile = pProfile;
+    s_pOut = pOut;
+
+    emit(".intel_syntax noprefix\n");
+    emit(".text\n");
+
+    int errorCount = 0;
+    for (;;) {
+        const ArenaMark mark = arena_mark();
+        const Node* pNode = parse_top_level(&pToken, &errorCount);
+        if (pNode == NULL) break;
+
+        // O[oϐ͈ȍ~̊֐QƂ̂ŁAo^͉̂Ȃ
+        if (pNode->kind == ND_DECL_VAR) {
+            resigter_gvar(&globalContext, pNode);
+            continue;
+        }
+
+        // \G[΍Ō܂ō\͂ăG[񍐂邾ŁAȍ~͐Ȃ
+        if (errorCount == 0) {
+            TimeSpan span;
+            time_trace_begin(&span, "function", pNode->pToken->str, pNode->pToken->len);
+            FuncJob job = { 0 };
+            job.pNode = pNode;
+            job.pGlobalContext = &globalContext;
+            gen_def_func(pNode, &globalContext, &job);
+            time_trace_end(&span);
+        }
+        arena_release_to(mark);
+
+        if (fp && pOut->len) {
+            fwrite(pOut->data, 1, pOut->len, fp);
+            pOut->len = 0;
+        }
+    }
+
+    resigter_str_literals(pStrLiterals);
+    emit(".bss\n");
+    gen_gvar_storages(globalContext.pGVars);
+
+#ifndef _WIN32
+    emit(".section .note.GNU-stack,\"\",@progbits\n");
+#endif
+    if (fp && pOut->len) {
+        fwrite(pOut->data, 1, pOut->len, fp);
+        pOut->len = 0;
+    }
 }
@@ -1,3 +1,24 @@
 #pragma once
 
-void gen(const Node* pNode, const StringLiteral* pStrLiterals);
+#include <stdbool.h>
+#include <stdio.h>
+
+typedef struct StrBuf StrBuf;
+typedef struct Token Token;
+typedef struct FuncCodeCache FuncCodeCache;
+typedef struct ProfileOptions ProfileOptions;
+
+// \؂AZu𐶐pOutɒǉ
+// ֐`ꍇ́A֐Ƃ̃AZuthreadCount̃Xbhŕɐ
+// pFuncCacheNULLłȂ΁AO񂩂ςĂȂ֐͑ǑʂgǍʂǉ
+// pProfileNULLłȂ΁AvR[h𖄂ߍނAvʂɏ]ĕ̌ubN̔zu߂
+// isDebugInfoȂA\[X̍sƂ̑Ήi.file/.locjƌĂяot[̏i.cfi_*jo͂
+// isWholeProgramȂA̖|PʂvOŜƌȂāi-fwhole-programjAmainĂяoHȂ֐͏o͂A
+// SĂ̌Ăяoœ萔ńAĂяoœnɊ֐{̂̒lœꉻ
+void gen(const Node* pNode, const StringLiteral* pStrLiterals, StrBuf* pOut, int threadCount, FuncCodeCache* pFuncCache, const ProfileOptions* pProfile, bool isDebugInfo, bool isWholeProgram);
+
+// g[Ngbvx̐錾1\͂A֐`͂̏ŃAZuɕϊpOutɒǉi-streamj
+// ֐̍\؂Ȃǂ͎̐錾֐iޑOɉAO[oϐƕ񃊃e͖ɂ܂Ƃ߂ďo͂
+// fpNULLłȂ΁A֐1o͂邲ƂpOut̓efp֏oċɂ
+// vR[h̖ߍ݂-gɂ͑ΉȂipProfile͌vʂgꍇwłj
+void gen_stream(Token* pToken, const StringLiteral* pStrLiterals, StrBuf* pOut, FILE* fp, const ProfileOptions* pProfile);
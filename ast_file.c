@@ -0,0 +1,612 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lexer.h"
+#include "parser.h"
+#include "ast_file.h"
+#include "cache.h"
+#include "strbuf.h"
+#include "arena.h"
+#include "error.h"
+
+// \؂̃t@C̐擪̎ʎqƏ̔
+#define AST_MAGIC           "CAST"
+#define AST_VERSION         (1)
+
+// t@C̏il͑SăgGfBAAʒu̓t@C擪̃oCgj
+//     wb_[         ʎqAŁAm[h̎ނ̐Ag[N̎ނ̐AAstField̊el
+//     m[h\         iށAlhsArhsAchildren[4]Ag[Nj~m[h̐
+//     g[N\       iށAobt@AʒuAAlj~g[N̐
+//     obt@\       it@CAej~obt@̐
+//     񃊃e\ iej~񃊃e̐
+//     \         '\0'I[ׂ́̕i̕\̃t@Ce͂̈ʒuŕ\j
+// m[hEg[NEobt@1n܂ԍŎQƂA0NULL\
+// |C^܂܂Ȃ̂ŁAʂ̃vZXʂ̃}Vł̂܂ܓǂݏo
+typedef enum {
+    AST_FIELD_ROOT_NODE,
+    AST_FIELD_NODE_COUNT,
+    AST_FIELD_NODE_OFFSET,
+    AST_FIELD_TOKEN_COUNT,
+    AST_FIELD_TOKEN_OFFSET,
+    AST_FIELD_BUFFER_COUNT,
+    AST_FIELD_BUFFER_OFFSET,
+    AST_FIELD_STR_LITERAL_COUNT,
+    AST_FIELD_STR_LITERAL_OFFSET,
+    AST_FIELD_POOL_SIZE,
+    AST_FIELD_POOL_OFFSET,
+    AST_FIELD_COUNT,
+} AstField;
+
+#define AST_FIELDS_OFFSET           (4 * 4)
+#define AST_HEADER_SIZE             (AST_FIELDS_OFFSET + 4 * AST_FIELD_COUNT)
+#define AST_NODE_RECORD_SIZE        (4 * 8)
+#define AST_TOKEN_RECORD_SIZE       (4 * 5)
+#define AST_BUFFER_RECORD_SIZE      (4 * 2)
+#define AST_STR_LITERAL_RECORD_SIZE (4)
+
+// OƂĂm[hƃg[N̎ނ̐i񋓌^ςÂt@C͓ǂ܂Ȃj
+// ND_DEFERRED_BODY͏oȂ̂ŁAm[h̎ނɂ͊܂߂Ȃ
+#define AST_NODE_KIND_COUNT     (ND_POST_DEC + 1)
+#define AST_TOKEN_KIND_COUNT    (TK_EOF + 1)
+
+typedef struct PtrIndexMap PtrIndexMap;
+typedef struct PtrIndexSlot PtrIndexSlot;
+typedef struct AstWriter AstWriter;
+
+// |C^ԍ߂̃nbV\̗vf
+struct PtrIndexSlot {
+    const void* pKey;
+    uint32_t index;
+};
+
+// |C^ԍ߂̃nbV\̖{
+struct PtrIndexMap {
+    PtrIndexSlot* pSlots;   // vfi傫2ׂ̂j
+    uint32_t slotCount;     // pSlots̑傫
+    uint32_t count;         // o^ς݂̐
+};
+
+// \؂̏ȍ
+struct AstWriter {
+    PtrIndexMap nodeMap;        // m[h̔ԍ
+    const Node** ppNodes;       // ԍ̃m[h
+    PtrIndexMap tokenMap;       // g[N̔ԍ
+    PtrIndexMap bufferMap;      // obt@ig[Nw̌j̔ԍ
+    StrBuf tokens;              // g[N\̓e
+    StrBuf buffers;             // obt@\̓e
+    StrBuf pool;                // \̓e
+};
+
+// J\؂̃t@C
+struct AstFile {
+    const uint8_t* pData;   // }bve
+    size_t size;            // ȇ傫
+    uint32_t fields[AST_FIELD_COUNT]; // wb_[̊el
+};
+
+static void append_u32(StrBuf* pBuf, uint32_t value) {
+    strbuf_append(pBuf, (const char*)&value, sizeof(value));
+}
+
+static uint32_t read_u32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t hash_ptr(const void* p, uint32_t slotCount) {
+    return (uint32_t)((uintptr_t)p >> 4) & (slotCount - 1);
+}
+
+// |C^̔ԍԂio^Ȃ0j
+static uint32_t find_index(const PtrIndexMap* pMap, const void* pKey) {
+    if (pMap->slotCount == 0) return 0;
+    for (uint32_t i = hash_ptr(pKey, pMap->slotCount); pMap->pSlots[i].pKey; i = (i + 1) & (pMap->slotCount - 1)) {
+        if (pMap->pSlots[i].pKey == pKey) return pMap->pSlots[i].index;
+    }
+    return 0;
+}
+
+// o^̃|C^Ɏ̔ԍi1n܂jUĕԂ
+static uint32_t add_index(PtrIndexMap* pMap, const void* pKey) {
+    if (pMap->slotCount <= pMap->count * 2) {
+        // \Lē꒼
+        const uint32_t newCount = pMap->slotCount ? pMap->slotCount * 2 : 256;
+        PtrIndexSlot* pNewSlots = calloc(newCount, sizeof(PtrIndexSlot));
+        for (uint32_t i = 0; i < pMap->slotCount; ++i) {
+            if (pMap->pSlots[i].pKey == NULL) continue;
+            uint32_t j = hash_ptr(pMap->pSlots[i].pKey, newCount);
+            while (pNewSlots[j].pKey) j = (j + 1) & (newCount - 1);
+            pNewSlots[j] = pMap->pSlots[i];
+        }
+        free(pMap->pSlots);
+        pMap->pSlots = pNewSlots;
+        pMap->slotCount = newCount;
+    }
+
+    uint32_t i = hash_ptr(pKey, pMap->slotCount);
+    while (pMap->pSlots[i].pKey) i = (i + 1) & (pMap->slotCount - 1);
+    pMap->pSlots[i].pKey = pKey;
+    pMap->pSlots[i].index = ++pMap->count;
+    return pMap->count;
+}
+
+// \ɕǉÄʒuԂ
+static uint32_t add_pool_string(AstWriter* pWriter, const char* str, size_t len) {
+    const uint32_t offset = (uint32_t)pWriter->pool.len;
+    strbuf_append(&pWriter->pool, str, len);
+    strbuf_append(&pWriter->pool, "", 1);
+    return offset;
+}
+
+// \؂̃m[hɔԍUieq̔ԍ傫Ȃj
+static void number_nodes(AstWriter* pWriter, const Node* pNode) {
+    if (pNode == NULL || find_index(&pWriter->nodeMap, pNode)) return;
+    if (pNode->kind == ND_DEFERRED_BODY) {
+        error("Internal Error. {̂ŉ͂֐`͏o܂");
+    }
+
+    const uint32_t index = add_index(&pWriter->nodeMap, pNode);
+    pWriter->ppNodes = realloc(pWriter->ppNodes, (index + 1) * sizeof(const Node*));
+    pWriter->ppNodes[index] = pNode;
+
+    number_nodes(pWriter, pNode->lhs);
+    number_nodes(pWriter, pNode->rhs);
+    for (int i = 0; i < 4; ++i) {
+        number_nodes(pWriter, pNode->children[i]);
+    }
+}
+
+// g[Ň̕ɂȂobt@̔ԍԂi߂Ẵobt@Ȃobt@\ɒǉj
+static uint32_t get_buffer_index(AstWriter* pWriter, const SourceFile* pFile) {
+    uint32_t index = find_index(&pWriter->bufferMap, pFile);
+    if (index) return index;
+
+    index = add_index(&pWriter->bufferMap, pFile);
+    append_u32(&pWriter->buffers, add_pool_string(pWriter, pFile->pszName, strlen(pFile->pszName)));
+    append_u32(&pWriter->buffers, add_pool_string(pWriter, pFile->pText, pFile->size));
+    return index;
+}
+
+// g[N̔ԍԂi߂Ẵg[NȂg[N\ɒǉj
+// \͂ōꂽl̃g[N̂悤ɁA̕Ȃg[N
+static uint32_t get_token_index(AstWriter* pWriter, const Token* pToken) {
+    if (pToken == NULL) return 0;
+    uint32_t index = find_index(&pWriter->tokenMap, pToken);
+    if (index) return index;
+
+    uint32_t buffer = 0;
+    uint32_t offset = 0;
+    if (pToken->str) {
+        const SourceFile* pFile = find_source_file(pToken->loc);
+        if (pFile == NULL || pFile->size < (pToken->loc - pFile->base) + pToken->len) {
+            error("Internal Error. g[N̊̕OwĂ܂");
+        }
+        buffer = get_buffer_index(pWriter, pFile);
+        offset = pToken->loc - pFile->base;
+    }
+
+    index = add_index(&pWriter->tokenMap, pToken);
+    append_u32(&pWriter->tokens, (uint32_t)pToken->kind);
+    append_u32(&pWriter->tokens, buffer);
+    append_u32(&pWriter->tokens, offset);
+    append_u32(&pWriter->tokens, pToken->str ? (uint32_t)pToken->len : 0);
+    append_u32(&pWriter->tokens, (uint32_t)pToken->val);
+    return index;
+}
+
+// \؂ƕ񃊃eA|C^܂܂Ȃ`ɂpOutɏo
+// ֐{̂̍\͂񂵂ɂ\؂͏oȂ
+void dump_ast(const Node* pNode, const StringLiteral* pStrLiterals, StrBuf* pOut) {
+    AstWriter writer = { 0 };
+    StrBuf nodes = { 0 };
+    StrBuf strLiterals = { 0 };
+    uint32_t strLiteralCount = 0;
+
+    number_nodes(&writer, pNode);
+    for (uint32_t i = 1; i <= writer.nodeMap.count; ++i) {
+        const Node* pCurNode = writer.ppNodes[i];
+        append_u32(&nodes, (uint32_t)pCurNode->kind);
+        append_u32(&nodes, find_index(&writer.nodeMap, pCurNode->lhs));
+        append_u32(&nodes, find_index(&writer.nodeMap, pCurNode->rhs));
+        for (int j = 0; j < 4; ++j) {
+            append_u32(&nodes, find_index(&writer.nodeMap, pCurNode->children[j]));
+        }
+        append_u32(&nodes, get_token_index(&writer, pCurNode->pToken));
+    }
+
+    for (const StringLiteral* pCur = pStrLiterals; pCur; pCur = pCur->pNext) {
+        append_u32(&strLiterals, add_pool_string(&writer, pCur->str, pCur->len));
+        ++strLiteralCount;
+    }
+
+    // e\̈ʒu߂ăwb_[
+    uint32_t fields[AST_FIELD_COUNT];
+    fields[AST_FIELD_ROOT_NODE] = find_index(&writer.nodeMap, pNode);
+    fields[AST_FIELD_NODE_COUNT] = writer.nodeMap.count;
+    fields[AST_FIELD_NODE_OFFSET] = AST_HEADER_SIZE;
+    fields[AST_FIELD_TOKEN_COUNT] = writer.tokenMap.count;
+    fields[AST_FIELD_TOKEN_OFFSET] = fields[AST_FIELD_NODE_OFFSET] + (uint32_t)nodes.len;
+    fields[AST_FIELD_BUFFER_COUNT] = writer.bufferMap.count;
+    fields[AST_FIELD_BUFFER_OFFSET] = fields[AST_FIELD_TOKEN_OFFSET] + (uint32_t)writer.tokens.len;
+    fields[AST_FIELD_STR_LITERAL_COUNT] = strLiteralCount;
+    fields[AST_FIELD_STR_LITERAL_OFFSET] = fields[AST_FIELD_BUFFER_OFFSET] + (uint32_t)writer.buffers.len;
+    fields[AST_FIELD_POOL_SIZE] = (uint32_t)writer.pool.len;
+    fields[AST_FIELD_POOL_OFFSET] = fields[AST_FIELD_STR_LITERAL_OFFSET] + (uint32_t)strLiterals.len;
+
+    strbuf_append(pOut, AST_MAGIC, 4);
+    append_u32(pOut, AST_VERSION);
+    append_u32(pOut, AST_NODE_KIND_COUNT);
+    append_u32(pOut, AST_TOKEN_KIND_COUNT);
+    for (int i = 0; i < AST_FIELD_COUNT; ++i) {
+        append_u32(pOut, fields[i]);
+    }
+
+    strbuf_append(pOut, nodes.data, nodes.len);
+    strbuf_append(pOut, writer.tokens.data, writer.tokens.len);
+    strbuf_append(pOut, writer.buffers.data, writer.buffers.len);
+    strbuf_append(pOut, strLiterals.data, strLiterals.len);
+    strbuf_append(pOut, writer.pool.data, writer.pool.len);
+
+    strbuf_free(&nodes);
+    strbuf_free(&strLiterals);
+    strbuf_free(&writer.tokens);
+    strbuf_free(&writer.buffers);
+    strbuf_free(&writer.pool);
+    free(writer.nodeMap.pSlots);
+    free(writer.tokenMap.pSlots);
+    free(writer.bufferMap.pSlots);
+    free(writer.ppNodes);
+}
+
+// m[huĂʒuɋ߂`
+// ẽm[h̎ނƎq̈ʒuŌ܂Aނ̃m[hłʒuɂČ`Ⴄi^'*'Ǝ'*'Ȃǁj
+typedef enum {
+    AST_ROLE_NONE,          // quȂʒuiNULLłȂ΂ȂȂj
+    AST_ROLE_TOP_LEVEL,     // gbvx̕
+    AST_ROLE_DEF,           // ֐`O[oϐ̐錾
+    AST_ROLE_PARAM,         // ̐錾
+    AST_ROLE_TYPE,          // ^
+    AST_ROLE_TYPE_SUFFIX,   // ^ɑ|C^z̑傫
+    AST_ROLE_ARRAY_SUFFIX,  // z̑傫
+    AST_ROLE_STMT,          // 
+    AST_ROLE_BLOCK,         // ubN̑
+    AST_ROLE_EXPR,          // 
+    AST_ROLE_NUM,           // case̒l
+} AstRole;
+
+// qȗłʒu͂̃rbg𗧂Ă
+#define AST_ROLE_OPTIONAL   (0x80)
+
+// m[h̎ނ̈ʒuɒuȂtrueԂAq̊eʒuɋ߂`pChildRolesɓ
+// pChildRoles[0]lhsA[1]rhsA[2]`[5]children[0]`[3]
+static bool get_child_roles(AstRole role, NodeKind kind, uint8_t* pChildRoles) {
+    memset(pChildRoles, AST_ROLE_NONE, 6);
+
+    // ^'*'Ɣz̑傫́A̒PZq␔lƂ͕ʂ̌`ɂȂ
+    if (role == AST_ROLE_TYPE_SUFFIX || role == AST_ROLE_ARRAY_SUFFIX) {
+        if (kind == ND_NUM) {
+            pChildRoles[1] = AST_ROLE_OPTIONAL | AST_ROLE_ARRAY_SUFFIX;
+            return true;
+        }
+        pChildRoles[1] = AST_ROLE_OPTIONAL | AST_ROLE_TYPE_SUFFIX;
+        return kind == ND_DEREF && role == AST_ROLE_TYPE_SUFFIX;
+    }
+
+    switch (kind) {
+    case ND_TOP_LEVEL:
+        pChildRoles[0] = AST_ROLE_DEF;
+        pChildRoles[1] = AST_ROLE_OPTIONAL | AST_ROLE_TOP_LEVEL;
+        return role == AST_ROLE_TOP_LEVEL;
+    case ND_DEF_FUNC:
+        pChildRoles[0] = AST_ROLE_TYPE;
+        pChildRoles[1] = AST_ROLE_STMT;
+        for (int i = 2; i < 6; ++i) {
+            pChildRoles[i] = AST_ROLE_OPTIONAL | AST_ROLE_PARAM;
+        }
+        return role == AST_ROLE_DEF;
+    case ND_DECL_VAR:
+        pChildRoles[0] = AST_ROLE_TYPE;
+        return role == AST_ROLE_DEF || role == AST_ROLE_PARAM || role == AST_ROLE_STMT;
+    case ND_TYPE:
+        pChildRoles[1] = AST_ROLE_OPTIONAL | AST_ROLE_TYPE_SUFFIX;
+        return role == AST_ROLE_TYPE;
+    case ND_BLOCK:
+        pChildRoles[0] = AST_ROLE_STMT;
+        pChildRoles[1] = AST_ROLE_OPTIONAL | AST_ROLE_BLOCK;
+        return role == AST_ROLE_STMT || role == AST_ROLE_BLOCK;
+    case ND_NOP:
+    case ND_BREAK:
+        return role == AST_ROLE_STMT;
+    case ND_EXPR_STMT:
+    case ND_RETURN:
+        pChildRoles[0] = AST_ROLE_EXPR;
+        return role == AST_ROLE_STMT;
+    case ND_IF:
+        pChildRoles[0] = AST_ROLE_STMT;
+        pChildRoles[1] = AST_ROLE_OPTIONAL | AST_ROLE_STMT;
+        pChildRoles[2] = AST_ROLE_EXPR;
+        return role == AST_ROLE_STMT;
+    case ND_WHILE:
+    case ND_SWITCH:
+        pChildRoles[0] = AST_ROLE_EXPR;
+        pChildRoles[1] = AST_ROLE_STMT;
+        return role == AST_ROLE_STMT;
+    case ND_FOR:
+        pChildRoles[1] = AST_ROLE_STMT;
+        for (int i = 2; i < 5; ++i) {
+            pChildRoles[i] = AST_ROLE_OPTIONAL | AST_ROLE_EXPR;
+        }
+        return role == AST_ROLE_STMT;
+    case ND_CASE:
+        pChildRoles[0] = AST_ROLE_STMT;
+        pChildRoles[2] = AST_ROLE_NUM;
+        return role == AST_ROLE_STMT;
+    case ND_DEFAULT:
+        pChildRoles[0] = AST_ROLE_STMT;
+        return role == AST_ROLE_STMT;
+    case ND_NUM:
+        return role == AST_ROLE_EXPR || role == AST_ROLE_NUM;
+    case ND_VAR:
+    case ND_STRING:
+        return role == AST_ROLE_EXPR;
+    case ND_INVOKE:
+        for (int i = 2; i < 6; ++i) {
+            pChildRoles[i] = AST_ROLE_OPTIONAL | AST_ROLE_EXPR;
+        }
+        return role == AST_ROLE_EXPR;
+    case ND_ADDR:
+    case ND_DEREF:
+    case ND_NOT:
+    case ND_SIZEOF:
+    case ND_POST_INC:
+    case ND_POST_DEC:
+        pChildRoles[0] = AST_ROLE_EXPR;
+        return role == AST_ROLE_EXPR;
+    case ND_ADD:
+    case ND_SUB:
+    case ND_MUL:
+    case ND_DIV:
+    case ND_EQ:
+    case ND_NE:
+    case ND_LT:
+    case ND_LE:
+    case ND_LOGAND:
+    case ND_LOGOR:
+    case ND_ASSIGN:
+    case ND_ADD_ASSIGN:
+    case ND_SUB_ASSIGN:
+    case ND_MUL_ASSIGN:
+    case ND_DIV_ASSIGN:
+        pChildRoles[0] = AST_ROLE_EXPR;
+        pChildRoles[1] = AST_ROLE_EXPR;
+        return role == AST_ROLE_EXPR;
+    default:
+        return false;
+    }
+}
+
+// m[hg[NȂ΂ȂȂȂtrueԂ
+// O\g[N͌̕Ȃ΂ȂȂ̂ŁApIsNamedŒm点
+static bool is_token_required(NodeKind kind, bool* pIsNamed) {
+    *pIsNamed = false;
+    switch (kind) {
+    case ND_NOP:
+    case ND_TOP_LEVEL:
+    case ND_BLOCK:
+    case ND_EXPR_STMT:
+    case ND_RETURN:
+        return false;
+    case ND_DEF_FUNC:
+    case ND_DECL_VAR:
+    case ND_INVOKE:
+    case ND_VAR:
+    case ND_STRING:
+        *pIsNamed = true;
+        return true;
+    default:
+        return true;
+    }
+}
+
+// [gHm[h\͂̍`ɂȂĂtrueԂ
+// oƂ͐eɔԍt̂ŁAq̔ԍ͕Ke傫A1̃m[h2wƂ
+// ԍ1x邾ŁAeqɋ߂`m߂ȂAcwւ⋤Le
+static bool validate_nodes(const AstFile* pAst) {
+    const uint32_t* fields = pAst->fields;
+    const uint32_t nodeCount = fields[AST_FIELD_NODE_COUNT];
+    uint8_t* pRoles = calloc(nodeCount + 1, 1);
+    pRoles[fields[AST_FIELD_ROOT_NODE]] = AST_ROLE_TOP_LEVEL;
+
+    bool isValid = true;
+    const uint8_t* p = pAst->pData + fields[AST_FIELD_NODE_OFFSET];
+    for (uint32_t i = 1; i <= nodeCount && isValid; ++i, p += AST_NODE_RECORD_SIZE) {
+        const uint32_t kind = read_u32(p);
+        const uint32_t token = read_u32(p + 28);
+        if (AST_NODE_KIND_COUNT <= kind || fields[AST_FIELD_TOKEN_COUNT] < token) {
+            isValid = false;
+            break;
+        }
+        for (int j = 1; j <= 6; ++j) {
+            if (nodeCount < read_u32(p + 4 * j)) isValid = false;
+        }
+
+        // [gHȂm[h͕ĂgȂ̂ŁA`͊m߂Ȃ
+        if (pRoles[i] == AST_ROLE_NONE) continue;
+
+        uint8_t childRoles[6];
+        if (!get_child_roles((AstRole)pRoles[i], (NodeKind)kind, childRoles)) {
+            isValid = false;
+            break;
+        }
+
+        bool isNamed;
+        if (is_token_required((NodeKind)kind, &isNamed)) {
+            // g[N̒0łȂ΁A̕Ƃ͊m߂Ă
+            const uint8_t* pToken = pAst->pData + fields[AST_FIELD_TOKEN_OFFSET] + (token - 1) * AST_TOKEN_RECORD_SIZE;
+            if (token == 0 || (isNamed && read_u32(pToken + 12) == 0)) isValid = false;
+        }
+
+        for (int j = 0; j < 6; ++j) {
+            const uint32_t child = read_u32(p + 4 + 4 * j);
+            const uint8_t role = childRoles[j] & ~AST_ROLE_OPTIONAL;
+            if (child == 0) {
+                if (role != AST_ROLE_NONE && !(childRoles[j] & AST_ROLE_OPTIONAL)) isValid = false;
+            }
+            else if (role == AST_ROLE_NONE || child <= i || nodeCount < child || pRoles[child] != AST_ROLE_NONE) {
+                isValid = false;
+            }
+            else {
+                pRoles[child] = role;
+            }
+        }
+    }
+
+    free(pRoles);
+    return isValid;
+}
+
+// \e͈̔͂Ɏ܂ĂtrueԂ
+static bool is_in_range(const AstFile* pAst, uint32_t offset, uint32_t count, uint32_t recordSize) {
+    return offset <= pAst->size && count <= (pAst->size - offset) / recordSize;
+}
+
+// o\؂Ƀ}bvĊJ
+AstFile* open_ast(const char* pszPath) {
+    AstFile* pAst = calloc(1, sizeof(AstFile));
+    pAst->pData = map_file(pszPath, &pAst->size);
+    if (pAst->pData == NULL) {
+        error("cannot open %s", pszPath);
+    }
+
+    const uint8_t* pData = pAst->pData;
+    if (pAst->size < AST_HEADER_SIZE || memcmp(pData, AST_MAGIC, 4) != 0 || read_u32(pData + 4) != AST_VERSION ||
+        read_u32(pData + 8) != AST_NODE_KIND_COUNT || read_u32(pData + 12) != AST_TOKEN_KIND_COUNT)
+    {
+        error("̃RpCœǂ߂-dump-ast̏o͂ł͂܂: %s", pszPath);
+    }
+
+    uint32_t* fields = pAst->fields;
+    for (int i = 0; i < AST_FIELD_COUNT; ++i) {
+        fields[i] = read_u32(pData + AST_FIELDS_OFFSET + 4 * i);
+    }
+
+    // \͈͓ɂA\'\0'ŏIĂ邱Ƃm߂
+    const uint32_t poolSize = fields[AST_FIELD_POOL_SIZE];
+    if (!is_in_range(pAst, fields[AST_FIELD_NODE_OFFSET], fields[AST_FIELD_NODE_COUNT], AST_NODE_RECORD_SIZE) ||
+        !is_in_range(pAst, fields[AST_FIELD_TOKEN_OFFSET], fields[AST_FIELD_TOKEN_COUNT], AST_TOKEN_RECORD_SIZE) ||
+        !is_in_range(pAst, fields[AST_FIELD_BUFFER_OFFSET], fields[AST_FIELD_BUFFER_COUNT], AST_BUFFER_RECORD_SIZE) ||
+        !is_in_range(pAst, fields[AST_FIELD_STR_LITERAL_OFFSET], fields[AST_FIELD_STR_LITERAL_COUNT], AST_STR_LITERAL_RECORD_SIZE) ||
+        !is_in_range(pAst, fields[AST_FIELD_POOL_OFFSET], poolSize, 1) || poolSize == 0 ||
+        pData[fields[AST_FIELD_POOL_OFFSET] + poolSize - 1] != '\0' ||
+        fields[AST_FIELD_ROOT_NODE] == 0 || fields[AST_FIELD_NODE_COUNT] < fields[AST_FIELD_ROOT_NODE])
+    {
+        error("-dump-ast̏o͂Ă܂: %s", pszPath);
+    }
+
+    // ԍʒu͈͓ɂ邱ƂƁAm[ȟ`SĊm߂ĂAƂR[hł͊m߂Ȃ
+    const uint32_t bufferCount = fields[AST_FIELD_BUFFER_COUNT];
+    uint32_t* pBufferLens = calloc(bufferCount + 1, sizeof(uint32_t));
+    const uint8_t* p = pData + fields[AST_FIELD_BUFFER_OFFSET];
+    for (uint32_t i = 1; i <= bufferCount; ++i, p += AST_BUFFER_RECORD_SIZE) {
+        if (poolSize <= read_u32(p) || poolSize <= read_u32(p + 4)) {
+            error("-dump-ast̏o͂Ă܂: %s", pszPath);
+        }
+        pBufferLens[i] = (uint32_t)strlen((const char*)pData + fields[AST_FIELD_POOL_OFFSET] + read_u32(p + 4));
+    }
+
+    p = pData + fields[AST_FIELD_TOKEN_OFFSET];
+    for (uint32_t i = 0; i < fields[AST_FIELD_TOKEN_COUNT]; ++i, p += AST_TOKEN_RECORD_SIZE) {
+        const uint32_t buffer = read_u32(p + 4);
+        const uint32_t offset = read_u32(p + 8);
+        const uint32_t len = read_u32(p + 12);
+        // ̕Ȃg[ŃAʒu0ɂȂ
+        if (AST_TOKEN_KIND_COUNT <= read_u32(p) || bufferCount < buffer || pBufferLens[buffer] < offset || pBufferLens[buffer] - offset < len ||
+            (buffer == 0 && (offset != 0 || len != 0)))
+        {
+            error("-dump-ast̏o͂Ă܂: %s", pszPath);
+        }
+    }
+    free(pBufferLens);
+
+    p = pData + fields[AST_FIELD_STR_LITERAL_OFFSET];
+    for (uint32_t i = 0; i < fields[AST_FIELD_STR_LITERAL_COUNT]; ++i, p += AST_STR_LITERAL_RECORD_SIZE) {
+        if (poolSize <= read_u32(p)) {
+            error("-dump-ast̏o͂Ă܂: %s", pszPath);
+        }
+    }
+
+    if (!validate_nodes(pAst)) {
+        error("-dump-ast̏o͂Ă܂: %s", pszPath);
+    }
+
+    return pAst;
+}
+
+// \؂̃t@C
+void close_ast(AstFile* pAst) {
+    unmap_file(pAst->pData, pAst->size);
+    free(pAst);
+}
+
+// \؂ƕ񃊃ëꗗ𕜌i\͂͂Ȃj
+// g[N̓̕}bvê܂܎ŵŁAgI܂Ńt@CȂ
+Node* load_ast(const AstFile* pAst, StringLiteral** ppStrLiterals) {
+    const uint32_t* fields = pAst->fields;
+    const char* pPool = (const char*)pAst->pData + fields[AST_FIELD_POOL_OFFSET];
+
+    // ԍ0NULL\̂ŁAz̐擪͎gȂ
+    // }bvê܂܃\[XƂēo^is̕\̓G[񍐂Ƃɍj
+    SourceFile** ppFiles = arena_calloc(fields[AST_FIELD_BUFFER_COUNT] + 1, sizeof(SourceFile*));
+    const uint8_t* p = pAst->pData + fields[AST_FIELD_BUFFER_OFFSET];
+    for (uint32_t i = 1; i <= fields[AST_FIELD_BUFFER_COUNT]; ++i, p += AST_BUFFER_RECORD_SIZE) {
+        ppFiles[i] = add_source_file(pPool + read_u32(p), pPool + read_u32(p + 4), false);
+    }
+
+    Token* pTokens = arena_calloc(fields[AST_FIELD_TOKEN_COUNT] + 1, sizeof(Token));
+    p = pAst->pData + fields[AST_FIELD_TOKEN_OFFSET];
+    for (uint32_t i = 1; i <= fields[AST_FIELD_TOKEN_COUNT]; ++i, p += AST_TOKEN_RECORD_SIZE) {
+        Token* pToken = &pTokens[i];
+        const uint32_t buffer = read_u32(p + 4);
+        pToken->kind = (TokenKind)read_u32(p);
+        if (buffer) {
+            const uint32_t offset = read_u32(p + 8);
+            pToken->loc = ppFiles[buffer]->base + offset;
+            pToken->str = ppFiles[buffer]->pText + offset;
+        }
+        pToken->len = (int)read_u32(p + 12);
+        pToken->val = (int)read_u32(p + 16);
+    }
+
+    Node* pNodes = arena_calloc(fields[AST_FIELD_NODE_COUNT] + 1, sizeof(Node));
+    p = pAst->pData + fields[AST_FIELD_NODE_OFFSET];
+    for (uint32_t i = 1; i <= fields[AST_FIELD_NODE_COUNT]; ++i, p += AST_NODE_RECORD_SIZE) {
+        Node* pNode = &pNodes[i];
+        uint32_t index;
+        pNode->kind = (NodeKind)read_u32(p);
+        pNode->lhs = (index = read_u32(p + 4)) ? &pNodes[index] : NULL;
+        pNode->rhs = (index = read_u32(p + 8)) ? &pNodes[index] : NULL;
+        for (int j = 0; j < 4; ++j) {
+            pNode->children[j] = (index = read_u32(p + 12 + 4 * j)) ? &pNodes[index] : NULL;
+        }
+        pNode->pToken = (index = read_u32(p + 28)) ? &pTokens[index] : NULL;
+    }
+
+    // 񃊃e͌̏ԂɌq
+    StringLiteral* pHead = NULL;
+    StringLiteral** ppTail = &pHead;
+    p = pAst->pData + fields[AST_FIELD_STR_LITERAL_OFFSET];
+    for (uint32_t i = 0; i < fields[AST_FIELD_STR_LITERAL_COUNT]; ++i, p += AST_STR_LITERAL_RECORD_SIZE) {
+        StringLiteral* pStrLiteral = arena_calloc(1, sizeof(StringLiteral));
+        pStrLiteral->str = pPool + read_u32(p);
+        pStrLiteral->len = (int)strlen(pStrLiteral->str);
+        *ppTail = pStrLiteral;
+        ppTail = &pStrLiteral->pNext;
+    }
+    *ppStrLiterals = pHead;
+
+    return &pNodes[fields[AST_FIELD_ROOT_NODE]];
+}
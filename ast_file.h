@@ -0,0 +1,21 @@
+#pragma once
+
+typedef struct Node Node;
+typedef struct StringLiteral StringLiteral;
+typedef struct StrBuf StrBuf;
+typedef struct AstFile AstFile;
+
+// \؂ƕ񃊃eA|C^܂܂Ȃ`ɂpOutɏo
+// ֐{̂̍\͂񂵂ɂ\؂͏oȂ
+void dump_ast(const Node* pNode, const StringLiteral* pStrLiterals, StrBuf* pOut);
+
+// o\؂Ƀ}bvĊJ
+// ԍʒu͈̔͂ƁAem[hׂg[Nqm߁AĂ΃G[ɂ
+AstFile* open_ast(const char* pszPath);
+
+// \؂̃t@C
+void close_ast(AstFile* pAst);
+
+// \؂ƕ񃊃ëꗗ𕜌i\͂͂Ȃj
+// g[N̓̕}bvê܂܎ŵŁAgI܂Ńt@CȂ
+Node* load_ast(const AstFile* pAst, StringLiteral** ppStrLiterals);
@@ -0,0 +1,190 @@
+// コンパイラの各段階の処理速度を計測する
+//
+// 使い方: bench [-n 回数] [-j スレッド数] file.c...
+// 各ファイルを指定回数だけコンパイルし、段階ごとの時間（最小・中央値・平均・標準偏差）と
+// 中央値から求めた処理速度（トークン/秒、ノード/秒、アセンブリのバイト数/秒）を表示する
+// コンパイラ本体のmain.c以外と一緒にビルドし、ドライバを介さず各段階の関数を直接呼ぶ
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lexer.h"
+#include "preprocess.h"
+#include "parser.h"
+#include "asm_gen.h"
+#include "strbuf.h"
+#include "arena.h"
+
+// 計測する段階
+typedef enum {
+    PHASE_TOKENIZE,     // ファイルの読み込みと字句解析
+    PHASE_PREPROCESS,   // プリプロセス
+    PHASE_PARSE,        // 文字列リテラルの収集と構文解析
+    PHASE_GEN,          // グローバル変数の登録とアセンブリ生成
+    PHASE_TOTAL,        // 全体
+    PHASE_COUNT,
+} Phase;
+
+static const char* s_phaseNames[PHASE_COUNT] = { "tokenize", "preprocess", "parse", "gen", "total" };
+
+// 1つのファイルの計測結果
+typedef struct BenchResult BenchResult;
+struct BenchResult {
+    double* pTimes[PHASE_COUNT];    // 段階ごとの各回の時間（秒）
+    size_t tokenCount;              // 字句解析で作られたトークンの数
+    size_t ppTokenCount;            // プリプロセス後のトークンの数
+    size_t nodeCount;               // 構文木のノードの数
+    size_t asmBytes;                // 生成したアセンブリのバイト数
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static size_t count_tokens(const Token* pToken) {
+    size_t count = 0;
+    for (; pToken && pToken->kind != TK_EOF; pToken = pToken->next) {
+        ++count;
+    }
+    return count;
+}
+
+static size_t count_nodes(const Node* pNode) {
+    if (pNode == NULL) return 0;
+    size_t count = 1 + count_nodes(pNode->lhs) + count_nodes(pNode->rhs);
+    for (int i = 0; i < 4; ++i) {
+        count += count_nodes(pNode->children[i]);
+    }
+    return count;
+}
+
+static int compare_double(const void* a, const void* b) {
+    const double x = *(const double*)a;
+    const double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// 1つのファイルをrunCount回コンパイルして各段階の時間を計る
+static void bench_file(const char* pszPath, int runCount, int threadCount, const PreprocessOptions* pOptions, BenchResult* pResult) {
+    for (int phase = 0; phase < PHASE_COUNT; ++phase) {
+        pResult->pTimes[phase] = calloc(runCount, sizeof(double));
+    }
+
+    for (int run = 0; run < runCount; ++run) {
+        const ArenaMark mark = arena_mark();
+        StrBuf asmText = { 0 };
+
+        const double t0 = now_seconds();
+        Token* pToken = tokenize(pszPath);
+        const double t1 = now_seconds();
+        Token* pPPToken = preprocess(pToken, pOptions, NULL);
+        const double t2 = now_seconds();
+        StringLiteral* pStrLiterals = collect_string_literals(pPPToken);
+        Node* pNode = parse(pPPToken, pStrLiterals, false);
+        const double t3 = now_seconds();
+        gen(pNode, pStrLiterals, &asmText, threadCount, NULL, NULL, false, false);
+        const double t4 = now_seconds();
+
+        pResult->pTimes[PHASE_TOKENIZE][run] = t1 - t0;
+        pResult->pTimes[PHASE_PREPROCESS][run] = t2 - t1;
+        pResult->pTimes[PHASE_PARSE][run] = t3 - t2;
+        pResult->pTimes[PHASE_GEN][run] = t4 - t3;
+        pResult->pTimes[PHASE_TOTAL][run] = t4 - t0;
+
+        // 数を数える時間は計測に含めない
+        if (run == 0) {
+            pResult->tokenCount = count_tokens(pToken);
+            pResult->ppTokenCount = count_tokens(pPPToken);
+            pResult->nodeCount = count_nodes(pNode);
+            pResult->asmBytes = asmText.len;
+        }
+
+        strbuf_free(&asmText);
+        arena_release_to(mark);
+        release_source_files();
+    }
+}
+
+// 1つのファイルの計測結果を表示する
+static void print_result(const char* pszPath, int runCount, BenchResult* pResult) {
+    printf("%s: %zu tokens, %zu tokens after preprocess, %zu nodes, %zu bytes of asm, %d runs\n",
+        pszPath, pResult->tokenCount, pResult->ppTokenCount, pResult->nodeCount, pResult->asmBytes, runCount);
+    printf("  %-10s %10s %10s %10s %10s   %s\n", "phase", "min(ms)", "median(ms)", "mean(ms)", "stddev(ms)", "throughput (median)");
+
+    for (int phase = 0; phase < PHASE_COUNT; ++phase) {
+        double* pTimes = pResult->pTimes[phase];
+        qsort(pTimes, runCount, sizeof(double), compare_double);
+
+        double sum = 0;
+        for (int i = 0; i < runCount; ++i) sum += pTimes[i];
+        const double mean = sum / runCount;
+        double variance = 0;
+        for (int i = 0; i < runCount; ++i) variance += (pTimes[i] - mean) * (pTimes[i] - mean);
+        const double stddev = (1 < runCount) ? sqrt(variance / (runCount - 1)) : 0;
+        const double median = (runCount % 2) ? pTimes[runCount / 2] : (pTimes[runCount / 2 - 1] + pTimes[runCount / 2]) / 2;
+
+        // 各段階の処理速度は、その段階が扱う単位（入力トークン・ノード・出力バイト）で表す
+        char throughput[64] = "";
+        const double safeMedian = median > 0 ? median : 1e-9;
+        switch (phase) {
+        case PHASE_TOKENIZE:
+        case PHASE_PREPROCESS:
+        case PHASE_TOTAL:
+            snprintf(throughput, sizeof(throughput), "%.0f tokens/s", pResult->tokenCount / safeMedian);
+            break;
+        case PHASE_PARSE:
+            snprintf(throughput, sizeof(throughput), "%.0f nodes/s", pResult->nodeCount / safeMedian);
+            break;
+        case PHASE_GEN:
+            snprintf(throughput, sizeof(throughput), "%.0f bytes/s", pResult->asmBytes / safeMedian);
+            break;
+        }
+
+        printf("  %-10s %10.3f %10.3f %10.3f %10.3f   %s\n",
+            s_phaseNames[phase], pTimes[0] * 1e3, median * 1e3, mean * 1e3, stddev * 1e3, throughput);
+        free(pTimes);
+    }
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: bench [-n runs] [-j threads] file.c...\n");
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    int runCount = 10;
+    int threadCount = 1;
+    int firstFile = argc;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0) {
+            if (argc <= ++i || (runCount = atoi(argv[i])) <= 0) usage();
+        }
+        else if (strcmp(argv[i], "-j") == 0) {
+            if (argc <= ++i || (threadCount = atoi(argv[i])) <= 0) usage();
+        }
+        else if (argv[i][0] == '-') {
+            usage();
+        }
+        else {
+            firstFile = i;
+            break;
+        }
+    }
+    if (argc <= firstFile) usage();
+
+    PreprocessOptions options = { 0 };
+    options.pHeaderCache = create_header_cache();
+
+    for (int i = firstFile; i < argc; ++i) {
+        BenchResult result = { 0 };
+        bench_file(argv[i], runCount, threadCount, &options, &result);
+        print_result(argv[i], runCount, &result);
+    }
+    return 0;
+}
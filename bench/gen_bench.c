@@ -0,0 +1,294 @@
+// コンパイル速度の計測用に、chibiccが受け付ける範囲のC言語のプログラムを生成する
+//
+// 使い方: gen_bench [-functions N] [-locals N] [-depth N] [-strings N] [-globals N] [-stmts N] [-seed N] [-o file]
+//   -functions  関数定義の数（mainを除く）
+//   -locals     関数ごとのローカル変数の数
+//   -depth      式の入れ子の深さ
+//   -strings    文字列リテラルの総数（各関数に順に割り振る）
+//   -globals    グローバル変数の数
+//   -stmts      ブロックごとの文の数
+//   -seed       乱数の種（同じ引数なら常に同じプログラムを生成する）
+//
+// 生成したプログラムはコンパイルできるだけでなく実行もでき、終了コードは引数だけで決まる
+// 関数は自分より前の関数だけを呼び、ループの中では呼ばないので、実行時間は関数の数に比例する
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct GenOptions GenOptions;
+typedef struct Generator Generator;
+
+// 生成するプログラムの規模
+struct GenOptions {
+    int functionCount;
+    int localCount;
+    int exprDepth;
+    int stringCount;
+    int globalCount;
+    int stmtCount;
+    uint64_t seed;
+};
+
+// 生成中の状態
+struct Generator {
+    const GenOptions* pOptions;
+    FILE* fp;
+    uint64_t random;        // xorshiftの状態
+    int funcIndex;          // 生成中の関数の番号
+    int paramCount;         // 生成中の関数の引数の数
+    int* pParamCounts;      // 生成済みの関数の引数の数
+    int nextString;         // 次に使う文字列リテラルの番号
+    int indent;             // 字下げの深さ
+};
+
+static uint32_t next_random(Generator* pGen) {
+    uint64_t x = pGen->random;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    pGen->random = x;
+    return (uint32_t)(x >> 16);
+}
+
+// 0以上n未満の乱数を返す
+static int random_below(Generator* pGen, int n) {
+    return n <= 0 ? 0 : (int)(next_random(pGen) % (uint32_t)n);
+}
+
+static void out(Generator* pGen, const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(pGen->fp, fmt, ap);
+    va_end(ap);
+}
+
+static void out_indent(Generator* pGen) {
+    for (int i = 0; i < pGen->indent; ++i) {
+        fputs("    ", pGen->fp);
+    }
+}
+
+// 葉になる式（数値、引数、ローカル変数、グローバル変数）を出力する
+static void gen_leaf(Generator* pGen) {
+    const GenOptions* pOptions = pGen->pOptions;
+    switch (random_below(pGen, 4)) {
+    case 0:
+        out(pGen, "%d", random_below(pGen, 100));
+        break;
+    case 1:
+        if (pGen->paramCount) {
+            out(pGen, "p%d", random_below(pGen, pGen->paramCount));
+            break;
+        }
+        // fallthrough
+    case 2:
+        if (pOptions->localCount) {
+            out(pGen, "l%d", random_below(pGen, pOptions->localCount));
+            break;
+        }
+        // fallthrough
+    default:
+        if (pOptions->globalCount) {
+            out(pGen, "g%d", random_below(pGen, pOptions->globalCount));
+        }
+        else {
+            out(pGen, "%d", random_below(pGen, 100));
+        }
+        break;
+    }
+}
+
+// 深さdepthの式を出力する（0除算が起きないよう、除算は使わない）
+static void gen_expr(Generator* pGen, int depth) {
+    static const char* s_ops[] = { "+", "-", "*", "<", "<=", "==", "!=", "+", "-" };
+    if (depth <= 0) {
+        gen_leaf(pGen);
+        return;
+    }
+
+    // 値が大きくなりすぎないよう、乗算の右辺は小さい数値に限る
+    const char* pszOp = s_ops[random_below(pGen, sizeof(s_ops) / sizeof(s_ops[0]))];
+    out(pGen, "(");
+    gen_expr(pGen, depth - 1);
+    if (strcmp(pszOp, "*") == 0) {
+        out(pGen, " * %d)", random_below(pGen, 3));
+    }
+    else {
+        out(pGen, " %s ", pszOp);
+        gen_expr(pGen, depth - 1 - random_below(pGen, 2));
+        out(pGen, ")");
+    }
+}
+
+// 代入文を1つ出力する
+static void gen_assign(Generator* pGen) {
+    const GenOptions* pOptions = pGen->pOptions;
+    out_indent(pGen);
+    if (pOptions->globalCount && random_below(pGen, 4) == 0) {
+        out(pGen, "g%d = ", random_below(pGen, pOptions->globalCount));
+    }
+    else if (pOptions->localCount) {
+        out(pGen, "l%d = ", random_below(pGen, pOptions->localCount));
+    }
+    else {
+        out(pGen, "acc = ");
+    }
+    gen_expr(pGen, pOptions->exprDepth);
+    out(pGen, ";\n");
+}
+
+// ブロックの中身をcount個の文で出力する（nestが0ならif文やfor文を入れ子にしない）
+static void gen_stmts(Generator* pGen, int count, int nest) {
+    const GenOptions* pOptions = pGen->pOptions;
+    for (int i = 0; i < count; ++i) {
+        const int kind = nest ? random_below(pGen, 6) : 0;
+        if (kind == 4) {
+            out_indent(pGen);
+            out(pGen, "if (");
+            gen_expr(pGen, pOptions->exprDepth);
+            out(pGen, ") {\n");
+            ++pGen->indent;
+            gen_stmts(pGen, pOptions->stmtCount / 2, nest - 1);
+            --pGen->indent;
+            out_indent(pGen);
+            out(pGen, "}\n");
+            out_indent(pGen);
+            out(pGen, "else {\n");
+            ++pGen->indent;
+            gen_stmts(pGen, pOptions->stmtCount / 2, nest - 1);
+            --pGen->indent;
+            out_indent(pGen);
+            out(pGen, "}\n");
+        }
+        else if (kind == 5) {
+            // 繰り返し回数は固定にして、実行時間が入力で変わらないようにする
+            out_indent(pGen);
+            out(pGen, "for (i = 0; i < %d; i = i + 1) {\n", 1 + random_below(pGen, 4));
+            ++pGen->indent;
+            gen_stmts(pGen, pOptions->stmtCount / 2, nest - 1);
+            --pGen->indent;
+            out_indent(pGen);
+            out(pGen, "}\n");
+        }
+        else {
+            gen_assign(pGen);
+        }
+    }
+}
+
+// 関数定義を1つ出力する
+static void gen_function(Generator* pGen) {
+    const GenOptions* pOptions = pGen->pOptions;
+    const int index = pGen->funcIndex;
+
+    pGen->paramCount = random_below(pGen, 4);
+    pGen->pParamCounts[index] = pGen->paramCount;
+    out(pGen, "int f%d(", index);
+    for (int i = 0; i < pGen->paramCount; ++i) {
+        out(pGen, i ? ", int p%d" : "int p%d", i);
+    }
+    out(pGen, ") {\n");
+    pGen->indent = 1;
+
+    out(pGen, "    int i;\n    int acc;\n    char* s;\n");
+    for (int i = 0; i < pOptions->localCount; ++i) {
+        out(pGen, "    int l%d;\n", i);
+    }
+    out(pGen, "    acc = 0;\n");
+    for (int i = 0; i < pOptions->localCount; ++i) {
+        out(pGen, "    l%d = %d;\n", i, i);
+    }
+
+    // 文字列リテラルは関数に順に割り振る
+    const int stringsPerFunc = pOptions->functionCount ? pOptions->stringCount / pOptions->functionCount : 0;
+    const int extraStrings = pOptions->functionCount ? pOptions->stringCount % pOptions->functionCount : 0;
+    const int stringCount = stringsPerFunc + (index < extraStrings ? 1 : 0);
+
+    gen_stmts(pGen, pOptions->stmtCount, 1);
+
+    // 文字列リテラルの先頭の文字を足し込む
+    for (int i = 0; i < stringCount; ++i) {
+        out(pGen, "    s = \"str%d_%d\";\n", pGen->nextString++, random_below(pGen, 1000));
+        out(pGen, "    acc = acc + *s;\n");
+    }
+
+    // 1つ前の関数だけを呼ぶので、mainから辿っても各関数は1回しか呼ばれない
+    if (0 < index) {
+        out(pGen, "    acc = acc + f%d(", index - 1);
+        for (int i = 0; i < pGen->pParamCounts[index - 1]; ++i) {
+            if (i) out(pGen, ", ");
+            gen_expr(pGen, 1);
+        }
+        out(pGen, ");\n");
+    }
+
+    out(pGen, "    return (acc");
+    for (int i = 0; i < pOptions->localCount && i < 4; ++i) {
+        out(pGen, " + l%d", i);
+    }
+    out(pGen, ") * 0 + %d;\n}\n\n", index % 7);
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: gen_bench [-functions N] [-locals N] [-depth N] [-strings N] [-globals N] [-stmts N] [-seed N] [-o file]\n");
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    GenOptions options = { 100, 8, 4, 100, 16, 20, 1 };
+    const char* pszOutput = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (argc <= i + 1) usage();
+        const char* pszName = argv[i];
+        const char* pszValue = argv[++i];
+        const int value = atoi(pszValue);
+        if (value < 0) usage();
+
+        if (strcmp(pszName, "-functions") == 0) options.functionCount = value;
+        else if (strcmp(pszName, "-locals") == 0) options.localCount = value;
+        else if (strcmp(pszName, "-depth") == 0) options.exprDepth = value;
+        else if (strcmp(pszName, "-strings") == 0) options.stringCount = value;
+        else if (strcmp(pszName, "-globals") == 0) options.globalCount = value;
+        else if (strcmp(pszName, "-stmts") == 0) options.stmtCount = value;
+        else if (strcmp(pszName, "-seed") == 0) options.seed = (uint64_t)value;
+        else if (strcmp(pszName, "-o") == 0) pszOutput = pszValue;
+        else usage();
+    }
+
+    Generator gen = { 0 };
+    gen.pOptions = &options;
+    gen.random = options.seed * 0x9E3779B97F4A7C15ull + 1;
+    gen.pParamCounts = calloc(options.functionCount + 1, sizeof(int));
+    gen.fp = pszOutput ? fopen(pszOutput, "w") : stdout;
+    if (!gen.fp) {
+        fprintf(stderr, "cannot open %s\n", pszOutput);
+        return 1;
+    }
+
+    for (int i = 0; i < options.globalCount; ++i) {
+        out(&gen, "int g%d;\n", i);
+    }
+    out(&gen, "\n");
+
+    for (gen.funcIndex = 0; gen.funcIndex < options.functionCount; ++gen.funcIndex) {
+        gen_function(&gen);
+    }
+
+    // 終了コードは最後の関数の番号だけで決まる
+    gen.paramCount = 0;
+    if (options.functionCount) {
+        static const char* s_args[] = { "", "1", "1, 2", "1, 2, 3" };
+        out(&gen, "int main() {\n    return f%d(%s) * 0 + %d;\n}\n", options.functionCount - 1,
+            s_args[gen.pParamCounts[options.functionCount - 1]], (options.functionCount - 1) % 7);
+    }
+    else {
+        out(&gen, "int main() {\n    return 0;\n}\n");
+    }
+
+    if (pszOutput) fclose(gen.fp);
+    free(gen.pParamCounts);
+    return 0;
+}
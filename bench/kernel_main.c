@@ -0,0 +1,81 @@
+// 生成コードの実行速度を計測する
+//
+// 使い方: kernel_main カーネル名 コンパイラ名 [最小計測時間(秒)]
+// kernels/*.cのいずれか1つをコンパイルしたオブジェクトとリンクして使う
+// カーネルは次の関数を定義する
+//     int setup()     データを初期化する
+//     int run()       1回分の処理を行い、検算用の値を返す
+//     int elements()  1回分の処理で扱う要素の数
+// 1回ごとの時間を計り、要素あたりのサイクル数と時間を中央値と最小値で1行のJSONとして出力する
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <x86intrin.h>
+
+int setup();
+int run();
+int elements();
+
+// 計測回数の上限と下限
+#define MIN_ITERATIONS  (5)
+#define MAX_ITERATIONS  (100000)
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare_u64(const void* a, const void* b) {
+    const uint64_t x = *(const uint64_t*)a;
+    const uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_double(const void* a, const void* b) {
+    const double x = *(const double*)a;
+    const double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: kernel_main kernel compiler [min-seconds]\n");
+        return 1;
+    }
+    const double minSeconds = (4 <= argc) ? atof(argv[3]) : 0.5;
+
+    // 検算用の値は最初の1回で取る（データを書き換えるカーネルがあるため）
+    setup();
+    const int checksum = run();
+    const int elementCount = elements();
+
+    uint64_t* pCycles = calloc(MAX_ITERATIONS, sizeof(uint64_t));
+    double* pSeconds = calloc(MAX_ITERATIONS, sizeof(double));
+    int iterations = 0;
+    const double startTime = now_seconds();
+    while (iterations < MIN_ITERATIONS || (iterations < MAX_ITERATIONS && now_seconds() - startTime < minSeconds)) {
+        const double t0 = now_seconds();
+        const uint64_t c0 = __rdtsc();
+        run();
+        const uint64_t c1 = __rdtsc();
+        const double t1 = now_seconds();
+        pCycles[iterations] = c1 - c0;
+        pSeconds[iterations] = t1 - t0;
+        ++iterations;
+    }
+
+    qsort(pCycles, iterations, sizeof(uint64_t), compare_u64);
+    qsort(pSeconds, iterations, sizeof(double), compare_double);
+
+    printf("{\"kernel\":\"%s\",\"compiler\":\"%s\",\"checksum\":%d,\"elements\":%d,\"iterations\":%d,"
+        "\"cycles_per_element\":%.3f,\"min_cycles_per_element\":%.3f,\"ns_per_element\":%.3f,\"min_ns_per_element\":%.3f}\n",
+        argv[1], argv[2], checksum, elementCount, iterations,
+        (double)pCycles[iterations / 2] / elementCount, (double)pCycles[0] / elementCount,
+        pSeconds[iterations / 2] * 1e9 / elementCount, pSeconds[0] * 1e9 / elementCount);
+
+    free(pCycles);
+    free(pSeconds);
+    return 0;
+}
@@ -0,0 +1,26 @@
+// 配列の総和
+// chibiccとgccの両方でコンパイルできるよう、使う関数は使う前に定義する
+
+int data[65536];
+
+int elements() {
+    return 65536;
+}
+
+int setup() {
+    int i;
+    for (i = 0; i < 65536; i = i + 1) {
+        data[i] = i * 7 - 3;
+    }
+    return 0;
+}
+
+int run() {
+    int i;
+    int sum;
+    sum = 0;
+    for (i = 0; i < 65536; i = i + 1) {
+        sum = sum + data[i];
+    }
+    return sum;
+}
@@ -0,0 +1,21 @@
+// 再帰呼び出し（関数呼び出しのオーバーヘッド）
+// 要素数はfib(24)を求めるときの呼び出し回数
+
+int fib(int n) {
+    if (n < 2) {
+        return n;
+    }
+    return fib(n - 1) + fib(n - 2);
+}
+
+int elements() {
+    return 150049;
+}
+
+int setup() {
+    return 0;
+}
+
+int run() {
+    return fib(24);
+}
@@ -0,0 +1,39 @@
+// 64x64の行列の積（要素数は積和の回数）
+// 多次元配列は使えないので、a[i][j]はa[i * 64 + j]で表す
+
+int a[4096];
+int b[4096];
+int c[4096];
+
+int elements() {
+    return 64 * 64 * 64;
+}
+
+int setup() {
+    int i;
+    for (i = 0; i < 4096; i = i + 1) {
+        a[i] = i - i / 7 * 7;
+        b[i] = i - i / 5 * 5 - 2;
+    }
+    return 0;
+}
+
+int run() {
+    int i;
+    int j;
+    int k;
+    int sum;
+    int trace;
+    trace = 0;
+    for (i = 0; i < 64; i = i + 1) {
+        for (j = 0; j < 64; j = j + 1) {
+            sum = 0;
+            for (k = 0; k < 64; k = k + 1) {
+                sum = sum + a[i * 64 + k] * b[k * 64 + j];
+            }
+            c[i * 64 + j] = sum;
+        }
+        trace = trace + c[i * 64 + i];
+    }
+    return trace;
+}
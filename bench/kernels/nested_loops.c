@@ -0,0 +1,22 @@
+// 二重ループ（ループの制御と整数演算）
+
+int elements() {
+    return 256 * 256;
+}
+
+int setup() {
+    return 0;
+}
+
+int run() {
+    int i;
+    int j;
+    int acc;
+    acc = 0;
+    for (i = 0; i < 256; i = i + 1) {
+        for (j = 0; j < 256; j = j + 1) {
+            acc = acc + i * j - (i < j);
+        }
+    }
+    return acc;
+}
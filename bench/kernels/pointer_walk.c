@@ -0,0 +1,30 @@
+// ポインタを進めながらの読み書き
+
+int data[65536];
+
+int elements() {
+    return 65536;
+}
+
+int setup() {
+    int i;
+    for (i = 0; i < 65536; i = i + 1) {
+        data[i] = i;
+    }
+    return 0;
+}
+
+int run() {
+    int* p;
+    int* end;
+    int sum;
+    sum = 0;
+    p = data;
+    end = data + 65536;
+    while (p < end) {
+        *p = *p + 1;
+        sum = sum + *p;
+        p = p + 1;
+    }
+    return sum;
+}
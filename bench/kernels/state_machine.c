@@ -0,0 +1,71 @@
+// switch文による状態機械（caseの多い分岐のディスパッチ）
+// 数字・英字・空白・記号を読んで、数値と識別子の個数を数える字句解析器
+
+char text[65537];
+
+int elements() {
+    return 65536;
+}
+
+int setup() {
+    int i;
+    int r;
+    r = 1;
+    for (i = 0; i < 65536; i = i + 1) {
+        r = r * 1103 + 12345;
+        r = r - r / 65536 * 65536;
+        text[i] = 32 + r / 16 - r / 16 / 95 * 95;
+    }
+    text[65536] = 0;
+    return 0;
+}
+
+int run() {
+    char* p;
+    int state;
+    int count;
+    state = 0;
+    count = 0;
+    for (p = text; *p; p = p + 1) {
+        switch (state) {
+        case 0:
+            switch (*p) {
+            case 48: case 49: case 50: case 51: case 52:
+            case 53: case 54: case 55: case 56: case 57:
+                state = 1;
+                break;
+            case 95:
+                state = 2;
+                break;
+            case 34:
+                state = 3;
+                break;
+            case 32: case 9: case 10:
+                break;
+            default:
+                if (65 <= *p) state = 2;
+            }
+            break;
+        case 1:
+            switch (*p) {
+            case 48: case 49: case 50: case 51: case 52:
+            case 53: case 54: case 55: case 56: case 57:
+                break;
+            default:
+                count = count + 1;
+                state = 0;
+            }
+            break;
+        case 2:
+            if (*p < 48) {
+                count = count + 256;
+                state = 0;
+            }
+            break;
+        case 3:
+            if (*p == 34) state = 0;
+            break;
+        }
+    }
+    return count;
+}
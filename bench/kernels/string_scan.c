@@ -0,0 +1,30 @@
+// char型のポインタによる文字列の走査
+
+char text[65537];
+
+int elements() {
+    return 65536;
+}
+
+int setup() {
+    int i;
+    for (i = 0; i < 65536; i = i + 1) {
+        text[i] = 97 + (i * 13) - (i * 13) / 26 * 26;
+    }
+    text[65536] = 0;
+    return 0;
+}
+
+int run() {
+    char* p;
+    int count;
+    count = 0;
+    p = text;
+    while (*p) {
+        if (*p == 101) {
+            count = count + 1;
+        }
+        p = p + 1;
+    }
+    return count;
+}
@@ -0,0 +1,80 @@
+#!/bin/sh
+# 生成コードの実行速度を、同じカーネルをgcc -O0/-O2でコンパイルした場合と比べる
+#
+# 使い方: run_kernels.sh chibiccのパス 出力するJSON [比較元のJSON]
+#   比較元を指定すると、chibiccでの要素あたりのサイクル数（最小値。中央値より揺れが小さい）がTHRESHOLD倍（既定1.10倍）を
+#   超えて増えたカーネルを報告して失敗とする
+#   検算用の値がgcc -O0と一致しないカーネルは、速度に関係なく失敗とする
+# 環境変数: CC（参照に使うコンパイラ）、MIN_SECONDS（1つの計測に使う最小時間）、THRESHOLD
+set -e
+
+if [ $# -lt 2 ]; then
+    echo "usage: run_kernels.sh chibicc output.json [baseline.json]" >&2
+    exit 1
+fi
+CHIBICC=$1
+OUTPUT=$2
+BASELINE=$3
+CC=${CC:-gcc}
+MIN_SECONDS=${MIN_SECONDS:-0.5}
+THRESHOLD=${THRESHOLD:-1.10}
+
+DIR=$(dirname "$0")
+WORK=$(dirname "$OUTPUT")/kernels
+mkdir -p "$WORK"
+: > "$WORK/results.txt"
+
+# JSONの1行からnumberの値を取り出す
+get_field() {
+    echo "$1" | sed -n "s/.*\"$2\":\(-\{0,1\}[0-9.]*\).*/\1/p"
+}
+
+"$CC" -O2 -c "$DIR/kernel_main.c" -o "$WORK/kernel_main.o"
+
+status=0
+printf "%-14s %14s %14s %14s %10s\n" "kernel" "chibicc" "gcc -O0" "gcc -O2" "vs -O0"
+for src in "$DIR"/kernels/*.c; do
+    name=$(basename "$src" .c)
+    for compiler in chibicc gcc-O0 gcc-O2; do
+        obj="$WORK/$name.$compiler.o"
+        case $compiler in
+        chibicc) "$CHIBICC" -c "$src" -o "$obj" ;;
+        gcc-O0) "$CC" -O0 -c "$src" -o "$obj" ;;
+        gcc-O2) "$CC" -O2 -c "$src" -o "$obj" ;;
+        esac
+        "$CC" "$WORK/kernel_main.o" "$obj" -o "$WORK/$name.$compiler"
+        "$WORK/$name.$compiler" "$name" "$compiler" "$MIN_SECONDS" >> "$WORK/results.txt"
+    done
+
+    chibicc=$(grep "\"kernel\":\"$name\",\"compiler\":\"chibicc\"" "$WORK/results.txt")
+    o0=$(grep "\"kernel\":\"$name\",\"compiler\":\"gcc-O0\"" "$WORK/results.txt")
+    o2=$(grep "\"kernel\":\"$name\",\"compiler\":\"gcc-O2\"" "$WORK/results.txt")
+    cycles=$(get_field "$chibicc" cycles_per_element)
+    o0Cycles=$(get_field "$o0" cycles_per_element)
+    o2Cycles=$(get_field "$o2" cycles_per_element)
+    printf "%-14s %14s %14s %14s %9.2fx\n" "$name" "$cycles" "$o0Cycles" "$o2Cycles" \
+        "$(awk -v a="$cycles" -v b="$o0Cycles" 'BEGIN { print (b > 0) ? a / b : 0 }')"
+
+    if [ "$(get_field "$chibicc" checksum)" != "$(get_field "$o0" checksum)" ]; then
+        echo "  $name: 検算用の値がgcc -O0と一致しません" >&2
+        status=1
+    fi
+
+    if [ -n "$BASELINE" ]; then
+        minCycles=$(get_field "$chibicc" min_cycles_per_element)
+        old=$(get_field "$(grep "\"kernel\":\"$name\",\"compiler\":\"chibicc\"" "$BASELINE" || true)" min_cycles_per_element)
+        if [ -n "$old" ] && awk -v a="$minCycles" -v b="$old" -v t="$THRESHOLD" 'BEGIN { exit !(a > b * t) }'; then
+            echo "  $name: 要素あたりのサイクル数（最小値）が$old から$minCycles に増えています" >&2
+            status=1
+        fi
+    fi
+done
+
+# 1行に1つの結果を並べる（比較元として読むときにgrepで取り出せるように）
+{
+    echo "{\"results\":["
+    sed '$!s/$/,/' "$WORK/results.txt"
+    echo "]}"
+} > "$OUTPUT"
+
+exit $status
@@ -0,0 +1,569 @@
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#include <process.h>
+#include <sys/utime.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+#include "strbuf.h"
+#include "thread.h"
+#include "error.h"
+
+// LbVt@C̊gqƐ擪̎ʎq
+#define CACHE_FILE_EXT      ".ccz"
+#define CACHE_FILE_MAGIC    "CCZ1"
+
+// qbgE~XL^t@CiŒ蒷CacheStatsȀŏj
+#define CACHE_STATS_FILE    "stats"
+
+// 𒴂Ƃ́Å܂Ō炵ĕpɂɍ폜NȂ悤ɂ
+#define CACHE_EVICT_RATIO   (0.9)
+
+// kňvTnbV\̑傫irbgjƁAQƂł鋗̏
+#define LZ_HASH_BITS        (14)
+#define LZ_MAX_OFFSET       (65535)
+#define LZ_MIN_MATCH        (4)
+
+typedef struct CacheEntry CacheEntry;
+
+// 폜̃LbVt@C
+struct CacheEntry {
+    char* pszPath;          // t@C̃pX
+    uint64_t size;          // t@C̑傫
+    int64_t lastUsed;       // ŌɎgꂽiXVj
+};
+
+static void append_byte(StrBuf* pOut, int b) {
+    const char c = (char)b;
+    strbuf_append(pOut, &c, 1);
+}
+
+// 15ȏ̒́AoCg255ď
+static void append_length(StrBuf* pOut, size_t len) {
+    while (255 <= len) {
+        append_byte(pOut, 255);
+        len -= 255;
+    }
+    append_byte(pOut, (int)len);
+}
+
+// eƈvimatchLen0Ȃ疳j1
+static void lz_append_sequence(StrBuf* pOut, const uint8_t* pLiterals, size_t literalLen, size_t offset, size_t matchLen) {
+    const size_t matchCode = matchLen ? matchLen - LZ_MIN_MATCH : 0;
+    append_byte(pOut, (int)(((literalLen < 15 ? literalLen : 15) << 4) | (matchCode < 15 ? matchCode : 15)));
+    if (15 <= literalLen) append_length(pOut, literalLen - 15);
+    strbuf_append(pOut, (const char*)pLiterals, literalLen);
+
+    if (matchLen) {
+        append_byte(pOut, (int)(offset & 0xFF));
+        append_byte(pOut, (int)(offset >> 8));
+        if (15 <= matchCode) append_length(pOut, matchCode - 15);
+    }
+}
+
+static uint32_t read_u32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// LZ77n̊ȒPȕňk
+// ́ug[Ni4rbgeA4rbgv-4jAeAi2oCgjv̌JԂ
+static void lz_compress(const uint8_t* pSrc, size_t len, StrBuf* pOut) {
+    int32_t* pTable = malloc(sizeof(int32_t) << LZ_HASH_BITS);
+    memset(pTable, 0xFF, sizeof(int32_t) << LZ_HASH_BITS);
+
+    size_t anchor = 0;
+    size_t pos = 0;
+    while (pos + LZ_MIN_MATCH <= len) {
+        const uint32_t seq = read_u32(pSrc + pos);
+        const uint32_t hash = (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+        const int32_t candidate = pTable[hash];
+        pTable[hash] = (int32_t)pos;
+
+        if (0 <= candidate && pos - candidate <= LZ_MAX_OFFSET && read_u32(pSrc + candidate) == seq) {
+            size_t matchLen = LZ_MIN_MATCH;
+            while (pos + matchLen < len && pSrc[candidate + matchLen] == pSrc[pos + matchLen]) {
+                ++matchLen;
+            }
+            lz_append_sequence(pOut, pSrc + anchor, pos - anchor, pos - candidate, matchLen);
+            pos += matchLen;
+            anchor = pos;
+        }
+        else {
+            ++pos;
+        }
+    }
+
+    // c̓eƂď
+    lz_append_sequence(pOut, pSrc + anchor, len - anchor, 0, 0);
+    free(pTable);
+}
+
+// 15ȏ̒̑ǂ
+static bool read_length(const uint8_t** pp, const uint8_t* pEnd, size_t* pLen) {
+    int b;
+    do {
+        if (*pp == pEnd) return false;
+        b = *(*pp)++;
+        *pLen += b;
+    } while (b == 255);
+    return true;
+}
+
+// lz_compressňkf[^WJ
+// ꂽf[^ȂfalseԂ
+static bool lz_decompress(const uint8_t* p, size_t len, uint8_t* pDst, size_t dstLen) {
+    const uint8_t* pEnd = p + len;
+    size_t pos = 0;
+
+    while (p < pEnd) {
+        const int token = *p++;
+
+        size_t literalLen = token >> 4;
+        if (literalLen == 15 && !read_length(&p, pEnd, &literalLen)) return false;
+        if ((size_t)(pEnd - p) < literalLen || dstLen - pos < literalLen) return false;
+        memcpy(pDst + pos, p, literalLen);
+        p += literalLen;
+        pos += literalLen;
+
+        // Ō̃eɂ͈vȂ
+        if (p == pEnd) break;
+
+        if (pEnd - p < 2) return false;
+        const size_t offset = p[0] | (p[1] << 8);
+        p += 2;
+
+        size_t matchLen = token & 0xF;
+        if (matchLen == 15 && !read_length(&p, pEnd, &matchLen)) return false;
+        matchLen += LZ_MIN_MATCH;
+
+        if (offset == 0 || pos < offset || dstLen - pos < matchLen) return false;
+
+        // dȂ蓾̂1oCgʂ
+        for (size_t i = 0; i < matchLen; ++i, ++pos) {
+            pDst[pos] = pDst[pos - offset];
+        }
+    }
+    return pos == dstLen;
+}
+
+// t@C̓eSēǂݍpDataɒǉ
+// ǂݍ߂ȂfalseԂ
+bool read_binary_file(const char* pszPath, StrBuf* pData) {
+    FILE* fp = fopen(pszPath, "rb");
+    if (!fp) {
+        return false;
+    }
+
+    char buf[64 * 1024];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) != 0) {
+        strbuf_append(pData, buf, n);
+    }
+    const bool isOk = !ferror(fp);
+    fclose(fp);
+    return isOk;
+}
+
+// t@C̑傫ƍXV𒲂ׂit@C΋UԂj
+// 1bȓɏĂCt悤AXV͕bׂPʂŕԂ
+bool get_file_stamp(const char* pszPath, uint64_t* pSize, uint64_t* pMTime) {
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(pszPath, GetFileExInfoStandard, &data) || (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+        return false;
+    }
+    *pSize = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    *pMTime = ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+    return true;
+#else
+    struct stat st;
+    if (stat(pszPath, &st) != 0 || S_ISDIR(st.st_mode)) {
+        return false;
+    }
+    *pSize = (uint64_t)st.st_size;
+    *pMTime = (uint64_t)st.st_mtim.tv_sec * 1000000000u + (uint64_t)st.st_mtim.tv_nsec;
+    return true;
+#endif
+}
+
+// t@CǂݎpŃɃ}bvA̐擪Ԃ
+// JȂꍇ̃t@CNULLԂ
+const uint8_t* map_file(const char* pszPath, size_t* pSize) {
+#ifdef _WIN32
+    HANDLE hFile = CreateFileA(pszPath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) return NULL;
+
+    LARGE_INTEGER size;
+    const uint8_t* pData = NULL;
+    if (GetFileSizeEx(hFile, &size) && 0 < size.QuadPart) {
+        HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (hMapping) {
+            pData = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(hMapping);
+        }
+        *pSize = (size_t)size.QuadPart;
+    }
+    CloseHandle(hFile);
+    return pData;
+#else
+    const int fd = open(pszPath, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    const uint8_t* pData = NULL;
+    if (fstat(fd, &st) == 0 && 0 < st.st_size) {
+        void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) pData = p;
+        *pSize = (size_t)st.st_size;
+    }
+    close(fd);
+    return pData;
+#endif
+}
+
+// map_fileŃ}bvt@C
+void unmap_file(const uint8_t* pData, size_t size) {
+#ifdef _WIN32
+    UnmapViewOfFile(pData);
+#else
+    munmap((void*)pData, size);
+#endif
+}
+
+// t@C̖OςāÃt@Cu
+// u͈xɍŝŁÃvZX̓e邱Ƃ͂Ȃ
+bool replace_file(const char* pszFrom, const char* pszTo) {
+#ifdef _WIN32
+    return MoveFileExA(pszFrom, pszTo, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(pszFrom, pszTo) == 0;
+#endif
+}
+
+// LbVfBNg̃t@C̃pX
+static char* make_cache_path(const CompileCache* pCache, const char* pszName, const char* pszExt) {
+    StrBuf path = { 0 };
+    strbuf_printf(&path, "%s/%s%s", pCache->pszDir, pszName, pszExt);
+    return path.data;
+}
+
+// vt@C̒g
+typedef struct CacheStats {
+    uint64_t hits;
+    uint64_t misses;
+} CacheStats;
+
+// vt@C̃qbg~X1₷
+// ɓĂ鑼̃vZXƐRꂪoȂ悤At@CbNĂǂݏ
+static void count_stat(const CompileCache* pCache, bool isHit) {
+    char* pszPath = make_cache_path(pCache, CACHE_STATS_FILE, "");
+    CacheStats stats = { 0 };
+#ifdef _WIN32
+    HANDLE hFile = CreateFileA(pszPath, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile != INVALID_HANDLE_VALUE) {
+        OVERLAPPED overlapped = { 0 };
+        if (LockFileEx(hFile, LOCKFILE_EXCLUSIVE_LOCK, 0, sizeof(CacheStats), 0, &overlapped)) {
+            DWORD len;
+            if (!ReadFile(hFile, &stats, sizeof(stats), &len, NULL) || len != sizeof(stats)) memset(&stats, 0, sizeof(stats));
+            if (isHit) ++stats.hits;
+            else ++stats.misses;
+            SetFilePointer(hFile, 0, NULL, FILE_BEGIN);
+            WriteFile(hFile, &stats, sizeof(stats), &len, NULL);
+            UnlockFileEx(hFile, 0, sizeof(CacheStats), 0, &overlapped);
+        }
+        CloseHandle(hFile);
+    }
+#else
+    const int fd = open(pszPath, O_RDWR | O_CREAT, 0644);
+    if (0 <= fd) {
+        struct flock lock = { 0 };
+        lock.l_type = F_WRLCK;
+        lock.l_whence = SEEK_SET;
+        if (fcntl(fd, F_SETLKW, &lock) == 0) {
+            if (pread(fd, &stats, sizeof(stats), 0) != (ssize_t)sizeof(stats)) memset(&stats, 0, sizeof(stats));
+            if (isHit) ++stats.hits;
+            else ++stats.misses;
+            if (pwrite(fd, &stats, sizeof(stats), 0) != (ssize_t)sizeof(stats)) {
+                // v͎Ă\Ȃ
+            }
+        }
+        // closeŃbNO
+        close(fd);
+    }
+#endif
+    free(pszPath);
+}
+
+// s̃RpCg̎st@C̃nbVl߂
+// RpC蒼ƃnbVlς̂ŁAÂRpČʂg邱Ƃ͂Ȃ
+// T[o[Ƃď풓Ăꍇɖǂݍ܂Ȃ悤Ax߂oĂ
+void get_compiler_id(uint8_t digest[SHA256_DIGEST_SIZE]) {
+    static bool s_isHashed;
+    static uint8_t s_digest[SHA256_DIGEST_SIZE];
+    if (s_isHashed) {
+        memcpy(digest, s_digest, SHA256_DIGEST_SIZE);
+        return;
+    }
+
+    char path[4096] = { 0 };
+#ifdef _WIN32
+    GetModuleFileNameA(NULL, path, sizeof(path) - 1);
+#else
+    if (readlink("/proc/self/exe", path, sizeof(path) - 1) < 0) path[0] = '\0';
+#endif
+
+    StrBuf exe = { 0 };
+    if (!read_binary_file(path, &exe)) {
+        error("RpC̎st@Cǂݍ߂܂: %s", path);
+    }
+
+    Sha256 ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, exe.data, exe.len);
+    sha256_final(&ctx, s_digest);
+    strbuf_free(&exe);
+
+    s_isHashed = true;
+    memcpy(digest, s_digest, SHA256_DIGEST_SIZE);
+}
+
+// LbVfBNgpӂ
+void cache_open(CompileCache* pCache, const char* pszDir, uint64_t maxSize) {
+    const size_t len = strlen(pszDir);
+    pCache->pszDir = calloc(len + 1, sizeof(char));
+    memcpy(pCache->pszDir, pszDir, len);
+    pCache->maxSize = maxSize;
+    get_compiler_id(pCache->compilerId);
+
+    // ɑ݂ꍇ͎s邪Ȃ
+#ifdef _WIN32
+    _mkdir(pszDir);
+#else
+    mkdir(pszDir, 0777);
+#endif
+}
+
+// vvZX̃\[XR[hARpCgAo͂ɉeIvVLbVL[߂
+// CN[ht@C-D̓eWJς݂Ȃ̂ŁA炪ς΃L[ς
+// pszKeyɂCACHE_KEY_LEN+1oCgȏ̗̈悪Kv
+void cache_make_key(const CompileCache* pCache, const char* pSource, size_t sourceLen, const char* pszFlags, char* pszKey) {
+    // ؂'\0'܂߂āAA̎dŕʂ̓͂ƓɂȂȂ悤ɂ
+    Sha256 ctx;
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    sha256_init(&ctx);
+    sha256_update(&ctx, pCache->compilerId, sizeof(pCache->compilerId));
+    sha256_update(&ctx, pszFlags, strlen(pszFlags) + 1);
+    sha256_update(&ctx, pSource, sourceLen);
+    sha256_final(&ctx, digest);
+    sha256_to_hex(digest, pszKey);
+}
+
+// LbVRpCʂopDataɒǉ
+// ȂfalseԂ
+bool cache_load(const CompileCache* pCache, const char* pszKey, StrBuf* pData) {
+    char* pszPath = make_cache_path(pCache, pszKey, CACHE_FILE_EXT);
+    StrBuf file = { 0 };
+    bool isHit = false;
+
+    // 擪͎ʎqƓWJ̑傫ǍɈkf[^
+    if (read_binary_file(pszPath, &file) && 8 <= file.len && memcmp(file.data, CACHE_FILE_MAGIC, 4) == 0) {
+        const uint32_t size = read_u32((const uint8_t*)file.data + 4);
+        uint8_t* pDst = malloc(size ? size : 1);
+        if (lz_decompress((const uint8_t*)file.data + 8, file.len - 8, pDst, size)) {
+            strbuf_append(pData, (const char*)pDst, size);
+            isHit = true;
+        }
+        free(pDst);
+    }
+
+    // ŋߎgƂXVŋL^iLRUō폜鏇ԂɂȂj
+    if (isHit) {
+#ifdef _WIN32
+        _utime(pszPath, NULL);
+#else
+        utime(pszPath, NULL);
+#endif
+    }
+
+    count_stat(pCache, isHit);
+    strbuf_free(&file);
+    free(pszPath);
+    return isHit;
+}
+
+// RpCʂLbVɕۑ
+// L[𕡐̃vZXɕۑĂAǂݏo̓e邱Ƃ͂Ȃ
+void cache_store(const CompileCache* pCache, const char* pszKey, const void* pData, size_t len) {
+    static THREAD_LOCAL int s_threadMarker;
+    StrBuf file = { 0 };
+    const uint32_t size = (uint32_t)len;
+
+    strbuf_append(&file, CACHE_FILE_MAGIC, 4);
+    strbuf_append(&file, (const char*)&size, 4);
+    lz_compress(pData, len, &file);
+
+    // vZXƃXbhƂɕʂ̈ꎞt@CɏłAOςĒu
+    char* pszPath = make_cache_path(pCache, pszKey, CACHE_FILE_EXT);
+    StrBuf tmpPath = { 0 };
+#ifdef _WIN32
+    strbuf_printf(&tmpPath, "%s.%d.%p.tmp", pszPath, _getpid(), (void*)&s_threadMarker);
+#else
+    strbuf_printf(&tmpPath, "%s.%d.%p.tmp", pszPath, (int)getpid(), (void*)&s_threadMarker);
+#endif
+
+    FILE* fp = fopen(tmpPath.data, "wb");
+    if (fp) {
+        const bool isWritten = fwrite(file.data, 1, file.len, fp) == file.len;
+        if (fclose(fp) == 0 && isWritten) {
+            replace_file(tmpPath.data, pszPath);
+        }
+        remove(tmpPath.data);
+    }
+
+    strbuf_free(&tmpPath);
+    strbuf_free(&file);
+    free(pszPath);
+}
+
+// LbVt@C̈ꗗ
+static CacheEntry* list_entries(const CompileCache* pCache, int* pCount) {
+    CacheEntry* pEntries = NULL;
+    int count = 0;
+    int cap = 0;
+
+#ifdef _WIN32
+    char* pszPattern = make_cache_path(pCache, "*", CACHE_FILE_EXT);
+    WIN32_FIND_DATAA data;
+    HANDLE hFind = FindFirstFileA(pszPattern, &data);
+    free(pszPattern);
+    if (hFind == INVALID_HANDLE_VALUE) {
+        *pCount = 0;
+        return NULL;
+    }
+    do {
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+        if (cap <= count) {
+            cap = cap ? cap * 2 : 64;
+            pEntries = realloc(pEntries, cap * sizeof(CacheEntry));
+        }
+        pEntries[count].pszPath = make_cache_path(pCache, data.cFileName, "");
+        pEntries[count].size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+        pEntries[count].lastUsed = ((int64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+        ++count;
+    } while (FindNextFileA(hFind, &data));
+    FindClose(hFind);
+#else
+    DIR* pDir = opendir(pCache->pszDir);
+    if (pDir == NULL) {
+        *pCount = 0;
+        return NULL;
+    }
+    struct dirent* pEnt;
+    while ((pEnt = readdir(pDir)) != NULL) {
+        const size_t nameLen = strlen(pEnt->d_name);
+        const size_t extLen = strlen(CACHE_FILE_EXT);
+        if (nameLen <= extLen || strcmp(pEnt->d_name + nameLen - extLen, CACHE_FILE_EXT) != 0) continue;
+
+        char* pszPath = make_cache_path(pCache, pEnt->d_name, "");
+        struct stat st;
+        if (stat(pszPath, &st) != 0) {
+            free(pszPath);
+            continue;
+        }
+        if (cap <= count) {
+            cap = cap ? cap * 2 : 64;
+            pEntries = realloc(pEntries, cap * sizeof(CacheEntry));
+        }
+        pEntries[count].pszPath = pszPath;
+        pEntries[count].size = (uint64_t)st.st_size;
+        pEntries[count].lastUsed = (int64_t)st.st_mtime;
+        ++count;
+    }
+    closedir(pDir);
+#endif
+
+    *pCount = count;
+    return pEntries;
+}
+
+static void free_entries(CacheEntry* pEntries, int count) {
+    for (int i = 0; i < count; ++i) {
+        free(pEntries[i].pszPath);
+    }
+    free(pEntries);
+}
+
+static int compare_entry_last_used(const void* pLhs, const void* pRhs) {
+    const CacheEntry* pL = pLhs;
+    const CacheEntry* pR = pRhs;
+    return (pL->lastUsed > pR->lastUsed) - (pL->lastUsed < pR->lastUsed);
+}
+
+// LbVŜ̑傫𒴂ĂAŋߎgĂȂ̂폜
+void cache_evict(const CompileCache* pCache) {
+    int count;
+    CacheEntry* pEntries = list_entries(pCache, &count);
+
+    uint64_t totalSize = 0;
+    for (int i = 0; i < count; ++i) {
+        totalSize += pEntries[i].size;
+    }
+
+    if (pCache->maxSize < totalSize) {
+        const uint64_t targetSize = (uint64_t)(pCache->maxSize * CACHE_EVICT_RATIO);
+        qsort(pEntries, count, sizeof(CacheEntry), compare_entry_last_used);
+
+        // ̃vZXɍ폜ĂĂ\Ȃ
+        for (int i = 0; i < count && targetSize < totalSize; ++i) {
+            remove(pEntries[i].pszPath);
+            totalSize -= pEntries[i].size;
+        }
+    }
+    free_entries(pEntries, count);
+}
+
+// LbV̓vpOutɒǉ
+void cache_print_stats(const CompileCache* pCache, StrBuf* pOut) {
+    int count;
+    CacheEntry* pEntries = list_entries(pCache, &count);
+
+    uint64_t totalSize = 0;
+    for (int i = 0; i < count; ++i) {
+        totalSize += pEntries[i].size;
+    }
+    free_entries(pEntries, count);
+
+    CacheStats stats = { 0 };
+    char* pszStatsPath = make_cache_path(pCache, CACHE_STATS_FILE, "");
+    StrBuf file = { 0 };
+    if (read_binary_file(pszStatsPath, &file) && file.len == sizeof(stats)) {
+        memcpy(&stats, file.data, sizeof(stats));
+    }
+    strbuf_free(&file);
+    free(pszStatsPath);
+    const uint64_t hits = stats.hits;
+    const uint64_t misses = stats.misses;
+
+    strbuf_printf(pOut, "cache directory: %s\n", pCache->pszDir);
+    strbuf_printf(pOut, "entries:         %d\n", count);
+    strbuf_printf(pOut, "size:            %llu / %llu bytes\n", (unsigned long long)totalSize, (unsigned long long)pCache->maxSize);
+    strbuf_printf(pOut, "hits:            %llu\n", (unsigned long long)hits);
+    strbuf_printf(pOut, "misses:          %llu\n", (unsigned long long)misses);
+    strbuf_printf(pOut, "hit rate:        %.1f%%\n", (hits + misses) ? hits * 100.0 / (hits + misses) : 0.0);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sha256.h"
+
+typedef struct StrBuf StrBuf;
+typedef struct CompileCache CompileCache;
+
+// LbVL[iSHA-25616i\Lj̒
+#define CACHE_KEY_LEN   (SHA256_DIGEST_SIZE * 2)
+
+// RpCʂ̃LbV
+// ͂̓e狁߂L[t@CƂAkRpCʂۑ
+struct CompileCache {
+    char* pszDir;                           // LbVfBNg
+    uint64_t maxSize;                       // LbVŜ̑傫̏ioCgj
+    uint8_t compilerId[SHA256_DIGEST_SIZE]; // RpCg̎st@C̃nbVl
+};
+
+// LbVfBNgpӂ
+void cache_open(CompileCache* pCache, const char* pszDir, uint64_t maxSize);
+
+// vvZX̃\[XR[hARpCgAo͂ɉeIvVLbVL[߂
+// pszKeyɂCACHE_KEY_LEN+1oCgȏ̗̈悪Kv
+void cache_make_key(const CompileCache* pCache, const char* pSource, size_t sourceLen, const char* pszFlags, char* pszKey);
+
+// LbVRpCʂopDataɒǉ
+// ȂfalseԂ
+bool cache_load(const CompileCache* pCache, const char* pszKey, StrBuf* pData);
+
+// RpCʂLbVɕۑ
+// L[𕡐̃vZXɕۑĂAǂݏo̓e邱Ƃ͂Ȃ
+void cache_store(const CompileCache* pCache, const char* pszKey, const void* pData, size_t len);
+
+// LbVŜ̑傫𒴂ĂAŋߎgĂȂ̂폜
+void cache_evict(const CompileCache* pCache);
+
+// LbV̓vpOutɒǉ
+void cache_print_stats(const CompileCache* pCache, StrBuf* pOut);
+
+// s̃RpCg̎st@C̃nbVl߂
+// RpC蒼ƃnbVlς̂ŁAÂRpČʂg邱Ƃ͂Ȃ
+void get_compiler_id(uint8_t digest[SHA256_DIGEST_SIZE]);
+
+// t@C̓eSēǂݍpDataɒǉ
+// ǂݍ߂ȂfalseԂ
+bool read_binary_file(const char* pszPath, StrBuf* pData);
+
+// t@C̑傫ƍXV𒲂ׂit@C΋UԂj
+bool get_file_stamp(const char* pszPath, uint64_t* pSize, uint64_t* pMTime);
+
+// t@CǂݎpŃɃ}bvA̐擪Ԃ
+// JȂꍇ̃t@CNULLԂ
+const uint8_t* map_file(const char* pszPath, size_t* pSize);
+
+// map_fileŃ}bvt@C
+void unmap_file(const uint8_t* pData, size_t size);
+
+// t@C̖OςāÃt@Cu
+// u͈xɍŝŁÃvZX̓e邱Ƃ͂Ȃ
+bool replace_file(const char* pszFrom, const char* pszTo);
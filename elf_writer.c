@@ -0,0 +1,317 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asm_encoder.h"
+#include "elf_writer.h"
+#include "error.h"
+#include "strbuf.h"
+
+// Windowsło悤A<elf.h>ɂ͗炸KvȒ`
+#define ELF_SHT_PROGBITS    (1)
+#define ELF_SHT_SYMTAB      (2)
+#define ELF_SHT_STRTAB      (3)
+#define ELF_SHT_RELA        (4)
+#define ELF_SHT_NOBITS      (8)
+#define ELF_SHF_INFO_LINK   (0x40)
+#define ELF_STB_LOCAL       (0)
+#define ELF_STB_GLOBAL      (1)
+#define ELF_STT_NOTYPE      (0)
+#define ELF_STT_SECTION     (3)
+
+typedef struct {
+    uint8_t  e_ident[16];
+    uint16_t e_type;
+    uint16_t e_machine;
+    uint32_t e_version;
+    uint64_t e_entry;
+    uint64_t e_phoff;
+    uint64_t e_shoff;
+    uint32_t e_flags;
+    uint16_t e_ehsize;
+    uint16_t e_phentsize;
+    uint16_t e_phnum;
+    uint16_t e_shentsize;
+    uint16_t e_shnum;
+    uint16_t e_shstrndx;
+} ElfHeader;
+
+typedef struct {
+    uint32_t sh_name;
+    uint32_t sh_type;
+    uint64_t sh_flags;
+    uint64_t sh_addr;
+    uint64_t sh_offset;
+    uint64_t sh_size;
+    uint32_t sh_link;
+    uint32_t sh_info;
+    uint64_t sh_addralign;
+    uint64_t sh_entsize;
+} ElfSectionHeader;
+
+typedef struct {
+    uint32_t st_name;
+    uint8_t  st_info;
+    uint8_t  st_other;
+    uint16_t st_shndx;
+    uint64_t st_value;
+    uint64_t st_size;
+} ElfSymbol;
+
+typedef struct {
+    uint64_t r_offset;
+    uint64_t r_info;
+    int64_t  r_addend;
+} ElfRela;
+
+// \ɕǉÄʒuԂ
+static uint32_t add_string(StrBuf* pStrTab, const char* str) {
+    const uint32_t offset = (uint32_t)pStrTab->len;
+    strbuf_append(pStrTab, str, strlen(str) + 1);
+    return offset;
+}
+
+// [Jxi.L`j̓V{\ɍڂȂ
+static bool is_local_label(const ObjSymbol* pSym) {
+    return strncmp(pSym->name, ".L", 2) == 0;
+}
+
+// \ȃZNVi.rodata.str1.1Ȃǁjɒ`ꂽV{Ȃtrue
+// J͂̃ZNV̒gvfƂɈړ̂ŁAQƂ̓ZNV̑΂łȂV{ɑ΂čs
+static bool is_in_merge_section(const ObjFile* pObj, const ObjSymbol* pSym) {
+    return pSym->section >= 0 && (pObj->pSections[pSym->section].flags & SECTION_FLAG_MERGE);
+}
+
+// t@C̈ʒu𑵂邽߂̋lߕo͂
+static void write_padding(FILE* fp, uint64_t* pPos, uint64_t align) {
+    while (*pPos % align) {
+        fputc(0, fp);
+        ++*pPos;
+    }
+}
+
+// Ĕzu\IuWFNgELF64`ix86-64jŏo
+//
+// ZNV̕
+//     [0]                  NULLZNV
+//     [1 .. n]             ObjFilẽZNV
+//     [n+1 .. ]            ĔzuZNVƂ.rela`
+//     ȍ~                 (.note.GNU-stack), .symtab, .strtab, .shstrtab
+void write_elf(const ObjFile* pObj, FILE* fp) {
+    StrBuf shStrTab = { 0 };
+    StrBuf strTab = { 0 };
+    int i;
+
+    add_string(&shStrTab, "");
+    add_string(&strTab, "");
+
+    // V{\
+    //     [JV{iNULLEZNVEOt[JjɁAO[oV{ɕׂ
+    int* pSymIndex = calloc(pObj->symbolCount + 1, sizeof(int));
+    ElfSymbol* pElfSyms = calloc(1 + pObj->sectionCount + pObj->symbolCount, sizeof(ElfSymbol));
+    int elfSymCount = 1;
+
+    for (i = 0; i < pObj->sectionCount; ++i) {
+        ElfSymbol* pElfSym = &pElfSyms[elfSymCount++];
+        pElfSym->st_info = (ELF_STB_LOCAL << 4) | ELF_STT_SECTION;
+        pElfSym->st_shndx = (uint16_t)(i + 1);
+    }
+
+    for (int pass = 0; pass < 2; ++pass) {
+        const bool isGlobalPass = (pass == 1);
+        if (isGlobalPass) {
+            // sh_infoɂ͍ŏ̃O[oV{̔ԍ
+            pSymIndex[pObj->symbolCount] = elfSymCount;
+        }
+
+        for (i = 0; i < pObj->symbolCount; ++i) {
+            const ObjSymbol* pSym = &pObj->pSymbols[i];
+            // `V{͊OQƂȂ̂ŃO[o
+            const bool isGlobal = pSym->isGlobal || pSym->section < 0;
+            if (isGlobal != isGlobalPass || (!isGlobal && is_local_label(pSym) && !is_in_merge_section(pObj, pSym))) {
+                continue;
+            }
+
+            ElfSymbol* pElfSym = &pElfSyms[elfSymCount];
+            pElfSym->st_name = add_string(&strTab, pSym->name);
+            pElfSym->st_info = ((isGlobal ? ELF_STB_GLOBAL : ELF_STB_LOCAL) << 4) | ELF_STT_NOTYPE;
+            pElfSym->st_shndx = (uint16_t)(pSym->section + 1);
+            pElfSym->st_value = pSym->offset;
+            pSymIndex[i] = elfSymCount++;
+        }
+    }
+    const int firstGlobal = pSymIndex[pObj->symbolCount];
+
+    // ZNVwb_̔ԍ߂
+    int relaCount = 0;
+    for (i = 0; i < pObj->sectionCount; ++i) {
+        if (pObj->pSections[i].relocCount) ++relaCount;
+    }
+    // AZu.note.GNU-stack錾ĂȂΕ₤
+    bool hasNote = false;
+    for (i = 0; i < pObj->sectionCount; ++i) {
+        if (strcmp(pObj->pSections[i].name, ".note.GNU-stack") == 0) hasNote = true;
+    }
+
+    const int firstRela = 1 + pObj->sectionCount;
+    const int noteIndex = firstRela + relaCount;
+    const int symTabIndex = noteIndex + (hasNote ? 0 : 1);
+    const int strTabIndex = symTabIndex + 1;
+    const int shStrTabIndex = strTabIndex + 1;
+    const int shNum = shStrTabIndex + 1;
+
+    ElfSectionHeader* pHeaders = calloc(shNum, sizeof(ElfSectionHeader));
+    uint64_t pos = sizeof(ElfHeader);
+
+    // t@C̔zu߂ȂZNVwb_𖄂߂
+    for (i = 0; i < pObj->sectionCount; ++i) {
+        const ObjSection* pSection = &pObj->pSections[i];
+        ElfSectionHeader* pHeader = &pHeaders[1 + i];
+
+        if (!pSection->isNoBits) {
+            pos = (pos + pSection->align - 1) / pSection->align * pSection->align;
+        }
+        pHeader->sh_name = add_string(&shStrTab, pSection->name);
+        pHeader->sh_type = pSection->isNoBits ? ELF_SHT_NOBITS : ELF_SHT_PROGBITS;
+        pHeader->sh_flags = pSection->flags;
+        pHeader->sh_offset = pos;
+        pHeader->sh_size = pSection->size;
+        pHeader->sh_addralign = pSection->align;
+        pHeader->sh_entsize = pSection->entSize;
+        if (!pSection->isNoBits) pos += pSection->size;
+    }
+
+    int relaIndex = firstRela;
+    for (i = 0; i < pObj->sectionCount; ++i) {
+        const ObjSection* pSection = &pObj->pSections[i];
+        if (!pSection->relocCount) continue;
+
+        char name[256];
+        snprintf(name, sizeof(name), ".rela%s", pSection->name);
+
+        ElfSectionHeader* pHeader = &pHeaders[relaIndex++];
+        pos = (pos + 7) / 8 * 8;
+        pHeader->sh_name = add_string(&shStrTab, name);
+        pHeader->sh_type = ELF_SHT_RELA;
+        pHeader->sh_flags = ELF_SHF_INFO_LINK;
+        pHeader->sh_offset = pos;
+        pHeader->sh_size = pSection->relocCount * sizeof(ElfRela);
+        pHeader->sh_link = symTabIndex;
+        pHeader->sh_info = 1 + i;
+        pHeader->sh_addralign = 8;
+        pHeader->sh_entsize = sizeof(ElfRela);
+        pos += pHeader->sh_size;
+    }
+
+    // s\X^bNvȂƂJɓ`
+    if (!hasNote) {
+        pHeaders[noteIndex].sh_name = add_string(&shStrTab, ".note.GNU-stack");
+        pHeaders[noteIndex].sh_type = ELF_SHT_PROGBITS;
+        pHeaders[noteIndex].sh_offset = pos;
+        pHeaders[noteIndex].sh_addralign = 1;
+    }
+
+    pos = (pos + 7) / 8 * 8;
+    pHeaders[symTabIndex].sh_name = add_string(&shStrTab, ".symtab");
+    pHeaders[symTabIndex].sh_type = ELF_SHT_SYMTAB;
+    pHeaders[symTabIndex].sh_offset = pos;
+    pHeaders[symTabIndex].sh_size = elfSymCount * sizeof(ElfSymbol);
+    pHeaders[symTabIndex].sh_link = strTabIndex;
+    pHeaders[symTabIndex].sh_info = firstGlobal;
+    pHeaders[symTabIndex].sh_addralign = 8;
+    pHeaders[symTabIndex].sh_entsize = sizeof(ElfSymbol);
+    pos += pHeaders[symTabIndex].sh_size;
+
+    pHeaders[strTabIndex].sh_name = add_string(&shStrTab, ".strtab");
+    pHeaders[strTabIndex].sh_type = ELF_SHT_STRTAB;
+    pHeaders[strTabIndex].sh_offset = pos;
+    pHeaders[strTabIndex].sh_size = strTab.len;
+    pHeaders[strTabIndex].sh_addralign = 1;
+    pos += strTab.len;
+
+    // .shstrtabg̖OǉĂ傫m肷
+    pHeaders[shStrTabIndex].sh_name = add_string(&shStrTab, ".shstrtab");
+    pHeaders[shStrTabIndex].sh_type = ELF_SHT_STRTAB;
+    pHeaders[shStrTabIndex].sh_offset = pos;
+    pHeaders[shStrTabIndex].sh_size = shStrTab.len;
+    pHeaders[shStrTabIndex].sh_addralign = 1;
+    pos += shStrTab.len;
+
+    pos = (pos + 7) / 8 * 8;
+
+    ElfHeader header = { 0 };
+    memcpy(header.e_ident, "\x7f" "ELF", 4);
+    header.e_ident[4] = 2;  // ELFCLASS64
+    header.e_ident[5] = 1;  // ELFDATA2LSB
+    header.e_ident[6] = 1;  // EV_CURRENT
+    header.e_type = 1;      // ET_REL
+    header.e_machine = 62;  // EM_X86_64
+    header.e_version = 1;
+    header.e_shoff = pos;
+    header.e_ehsize = sizeof(ElfHeader);
+    header.e_shentsize = sizeof(ElfSectionHeader);
+    header.e_shnum = (uint16_t)shNum;
+    header.e_shstrndx = (uint16_t)shStrTabIndex;
+
+    // ߂zu̒ʂɏo
+    uint64_t writePos = 0;
+    fwrite(&header, sizeof(header), 1, fp);
+    writePos += sizeof(header);
+
+    for (i = 0; i < pObj->sectionCount; ++i) {
+        const ObjSection* pSection = &pObj->pSections[i];
+        if (pSection->isNoBits) continue;
+
+        write_padding(fp, &writePos, pSection->align);
+        if (pSection->size) fwrite(pSection->data, 1, pSection->size, fp);
+        writePos += pSection->size;
+    }
+
+    for (i = 0; i < pObj->sectionCount; ++i) {
+        const ObjSection* pSection = &pObj->pSections[i];
+        if (!pSection->relocCount) continue;
+
+        write_padding(fp, &writePos, 8);
+        for (int j = 0; j < pSection->relocCount; ++j) {
+            const ObjReloc* pReloc = &pSection->pRelocs[j];
+            const ObjSymbol* pSym = &pObj->pSymbols[pReloc->symbol];
+            ElfRela rela = { 0 };
+
+            rela.r_offset = pReloc->offset;
+            rela.r_addend = pReloc->addend;
+            if (pSym->section >= 0 && !pSym->isGlobal && !is_in_merge_section(pObj, pSym)) {
+                // [JV{ւ̎QƂ̓ZNVV{̑΂ɂ
+                rela.r_info = ((uint64_t)(1 + pSym->section) << 32) | pReloc->kind;
+                rela.r_addend += pSym->offset;
+            }
+            else {
+                rela.r_info = ((uint64_t)pSymIndex[pReloc->symbol] << 32) | pReloc->kind;
+            }
+            fwrite(&rela, sizeof(rela), 1, fp);
+            writePos += sizeof(rela);
+        }
+    }
+
+    write_padding(fp, &writePos, 8);
+    fwrite(pElfSyms, sizeof(ElfSymbol), elfSymCount, fp);
+    writePos += elfSymCount * sizeof(ElfSymbol);
+
+    fwrite(strTab.data, 1, strTab.len, fp);
+    writePos += strTab.len;
+    fwrite(shStrTab.data, 1, shStrTab.len, fp);
+    writePos += shStrTab.len;
+
+    write_padding(fp, &writePos, 8);
+    if (writePos != pos) {
+        error("Internal Error. ELF layout mismatch.");
+    }
+    fwrite(pHeaders, sizeof(ElfSectionHeader), shNum, fp);
+
+    free(pHeaders);
+    free(pElfSyms);
+    free(pSymIndex);
+    strbuf_free(&strTab);
+    strbuf_free(&shStrTab);
+}
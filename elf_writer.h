@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stdio.h>
+
+typedef struct ObjFile ObjFile;
+
+// Ĕzu\IuWFNgELF64`ix86-64jŏo
+void write_elf(const ObjFile* pObj, FILE* fp);
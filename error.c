@@ -6,15 +6,63 @@
 #include <string.h>
 
 #include "errno.h"
+#include "error.h"
+#include "strbuf.h"
+#include "thread.h"
+
+static THREAD_LOCAL jmp_buf* s_pJmpBuf;     // G[̖߂iNULLȂvZXIj
+static THREAD_LOCAL StrBuf* s_pErrorOut;    // bZ[W̏o͐iNULLȂWG[ój
+
+// ݂̃XbhŃG[NƂ̓؂ւ
+// pJmpBufNULLłȂ΁AvZXIlongjmpsetjmp̈ʒu֖߂
+// pOutNULLłȂ΁AbZ[WWG[o͂̑pOut֏
+void set_error_handler(jmp_buf* pJmpBuf, StrBuf* pOut) {
+    s_pJmpBuf = pJmpBuf;
+    s_pErrorOut = pOut;
+}
+
+// ݂̃XbhŃG[NƂ̓擾iꎞIɐ؂ւČɖ߂߂Ɏgj
+void get_error_handler(jmp_buf** ppJmpBuf, StrBuf** ppOut) {
+    *ppJmpBuf = s_pJmpBuf;
+    *ppOut = s_pErrorOut;
+}
+
+// bZ[Wo͂Ao͂Ԃ
+static int report_v(const char* fmt, va_list ap) {
+    if (s_pErrorOut) {
+        const size_t oldLen = s_pErrorOut->len;
+        strbuf_vprintf(s_pErrorOut, fmt, ap);
+        return (int)(s_pErrorOut->len - oldLen);
+    }
+    return vfprintf(stderr, fmt, ap);
+}
+
+static int report(const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    const int len = report_v(fmt, ap);
+    va_end(ap);
+    return len;
+}
+
+// G[񍐂Ɠ悤ɁARpC𒆎~
+// ߂悪΂֖߂AȂ΃vZXI
+void abort_compile(void) {
+    if (s_pJmpBuf) {
+        longjmp(*s_pJmpBuf, 1);
+    }
+    exit(1);
+}
 
 // G[񍐂邽߂̊֐
 // printfƓ
 void error(char* fmt, ...) {
     va_list ap;
     va_start(ap, fmt);
-    vfprintf(stderr, fmt, ap);
-    fprintf(stderr, "\n");
-    exit(1);
+    report_v(fmt, ap);
+    report("\n");
+    va_end(ap);
+    abort_compile();
 }
 
 // G[̋Nꏊ񍐂邽߂̊֐
@@ -22,34 +70,37 @@ void error(char* fmt, ...) {
 //
 // foo.c:10: x = y + + 5;
 //                   ^ ł͂܂
-void error_at(const char* filename, const char* user_input, const char* loc, char* fmt, ...) {
+void error_at(SourceLoc loc, char* fmt, ...) {
     va_list ap;
     va_start(ap, fmt);
 
-    // loc܂܂Ăs̊Jnn_ƏIn_擾
-    char* line = loc;
-    while (user_input < line && line[-1] != '\n')
-        line--;
+    // ʒu̖g[NȂ烁bZ[W\
+    const SourceFile* pFile = find_source_file(loc);
+    if (pFile == NULL) {
+        report_v(fmt, ap);
+        report("\n");
+        va_end(ap);
+        abort_compile();
+    }
 
-    char* end = loc;
-    while (*end != '\n')
+    // loc܂܂Ăs̔ԍƊJnn_s̕\狁߁AIn_T
+    const char* line = NULL;
+    const int line_num = get_source_line(loc, &line);
+    const char* pLoc = pFile->pText + (loc - pFile->base);
+    const char* end = pLoc;
+    while (*end && *end != '\n')
         end++;
 
-    // sŜ̉sڂȂ̂𒲂ׂ
-    int line_num = 1;
-    for (char* p = user_input; p < line; p++)
-        if (*p == '\n')
-            line_num++;
-
     // sAt@Cƍsԍƈꏏɕ\
-    int indent = fprintf(stderr, "%s:%d: ", filename, line_num);
-    fprintf(stderr, "%.*s\n", (int)(end - line), line);
+    int indent = report("%s:%d: ", pFile->pszName, line_num);
+    report("%.*s\n", (int)(end - line), line);
 
     // G[ӏ"^"ŎwāAG[bZ[W\
-    int pos = loc - line + indent;
-    fprintf(stderr, "%*s", pos, ""); // pos̋󔒂o
-    fprintf(stderr, "^ ");
-    vfprintf(stderr, fmt, ap);
-    fprintf(stderr, "\n");
-    exit(1);
-}
\ No newline at end of file
+    int pos = (int)(pLoc - line) + indent;
+    report("%*s", pos, ""); // pos̋󔒂o
+    report("^ ");
+    report_v(fmt, ap);
+    report("\n");
+    va_end(ap);
+    abort_compile();
+}
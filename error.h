@@ -1,8 +1,26 @@
 #pragma once
 
+#include <setjmp.h>
+
+#include "source.h"
+
+typedef struct StrBuf StrBuf;
+
 // G[񍐂邽߂̊֐
 // printfƓ
 void error(char* fmt, ...);
 
 // G[ӏ񍐂
-void error_at(const char* filename, const char* user_input, const char* loc, char* fmt, ...);
+void error_at(SourceLoc loc, char* fmt, ...);
+
+// G[񍐂Ɠ悤ɁARpC𒆎~
+// iG[񕜂ĉ͂𑱂A񍐍ς݂̃G[𗝗Rɒ~邽߂Ɏgj
+void abort_compile(void);
+
+// ݂̃XbhŃG[NƂ̓؂ւ
+// pJmpBufNULLłȂ΁AvZXIlongjmpsetjmp̈ʒu֖߂
+// pOutNULLłȂ΁AbZ[WWG[o͂̑pOut֏
+void set_error_handler(jmp_buf* pJmpBuf, StrBuf* pOut);
+
+// ݂̃XbhŃG[NƂ̓擾iꎞIɐ؂ւČɖ߂߂Ɏgj
+void get_error_handler(jmp_buf** ppJmpBuf, StrBuf** ppOut);
\ No newline at end of file
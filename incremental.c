@@ -0,0 +1,143 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "incremental.h"
+#include "cache.h"
+#include "strbuf.h"
+
+// ԃt@C̐擪̎ʎq
+// : ʎqARpC̃nbVlA֐̐AiwAAZu̒AAZuj~֐̐
+#define FUNC_STATE_MAGIC    "CFS1"
+
+static int compare_entry_fingerprint(const void* pLhs, const void* pRhs) {
+    return memcmp(((const FuncCodeEntry*)pLhs)->fingerprint, ((const FuncCodeEntry*)pRhs)->fingerprint, SHA256_DIGEST_SIZE);
+}
+
+// ǂݍ񂾓e琔l1o
+static bool read_u32_at(const StrBuf* pData, size_t* pPos, uint32_t* pValue) {
+    if (pData->len - *pPos < sizeof(uint32_t)) return false;
+    memcpy(pValue, pData->data + *pPos, sizeof(uint32_t));
+    *pPos += sizeof(uint32_t);
+    return true;
+}
+
+// ԃt@CǑʂǂݍ
+// t@CAĂAʂ̃RpCōꂽꍇ͋̏ԂɂȂ
+void load_func_code_cache(FuncCodeCache* pCache, const char* pszPath) {
+    memset(pCache, 0, sizeof(FuncCodeCache));
+
+    StrBuf data = { 0 };
+    uint8_t compilerId[SHA256_DIGEST_SIZE];
+    get_compiler_id(compilerId);
+
+    const size_t headerLen = 4 + SHA256_DIGEST_SIZE;
+    if (!read_binary_file(pszPath, &data) || data.len < headerLen
+        || memcmp(data.data, FUNC_STATE_MAGIC, 4) != 0
+        || memcmp(data.data + 4, compilerId, SHA256_DIGEST_SIZE) != 0) {
+        strbuf_free(&data);
+        return;
+    }
+
+    size_t pos = headerLen;
+    uint32_t count;
+    if (!read_u32_at(&data, &pos, &count) || (data.len - pos) / (SHA256_DIGEST_SIZE + 4) < count) {
+        strbuf_free(&data);
+        return;
+    }
+
+    pCache->pPrevEntries = calloc(count ? count : 1, sizeof(FuncCodeEntry));
+    for (uint32_t i = 0; i < count; ++i) {
+        FuncCodeEntry* pEntry = &pCache->pPrevEntries[i];
+        uint32_t len;
+        if (data.len - pos < SHA256_DIGEST_SIZE) break;
+        memcpy(pEntry->fingerprint, data.data + pos, SHA256_DIGEST_SIZE);
+        pos += SHA256_DIGEST_SIZE;
+        if (!read_u32_at(&data, &pos, &len) || data.len - pos < len) break;
+
+        // ʂAǂݍ񂾓ê܂܎w
+        pEntry->code = data.data + pos;
+        pEntry->len = len;
+        pos += len;
+        pCache->prevCount = i + 1;
+    }
+    pCache->pPrevData = data.data;
+
+    // rŉĂꍇ͉MpȂ
+    if (pCache->prevCount != (int)count) {
+        free_func_code_cache(pCache);
+    }
+    else {
+        qsort(pCache->pPrevEntries, pCache->prevCount, sizeof(FuncCodeEntry), compare_entry_fingerprint);
+    }
+}
+
+// w䂪vǑʂTiNULLj
+const FuncCodeEntry* find_func_code(const FuncCodeCache* pCache, const uint8_t fingerprint[SHA256_DIGEST_SIZE]) {
+    FuncCodeEntry key;
+    if (pCache->prevCount == 0) return NULL;
+
+    memcpy(key.fingerprint, fingerprint, SHA256_DIGEST_SIZE);
+    return bsearch(&key, pCache->pPrevEntries, pCache->prevCount, sizeof(FuncCodeEntry), compare_entry_fingerprint);
+}
+
+// ̌ʂǉ
+void add_func_code(FuncCodeCache* pCache, const uint8_t fingerprint[SHA256_DIGEST_SIZE], const char* code, size_t len) {
+    if (pCache->nextCap <= pCache->nextCount) {
+        pCache->nextCap = pCache->nextCap ? pCache->nextCap * 2 : 64;
+        pCache->pNextEntries = realloc(pCache->pNextEntries, pCache->nextCap * sizeof(FuncCodeEntry));
+    }
+
+    FuncCodeEntry* pEntry = &pCache->pNextEntries[pCache->nextCount++];
+    memcpy(pEntry->fingerprint, fingerprint, SHA256_DIGEST_SIZE);
+    pEntry->code = malloc(len + 1);
+    memcpy(pEntry->code, code, len);
+    pEntry->code[len] = '\0';
+    pEntry->len = len;
+}
+
+// ̌ʂԃt@Cɏ
+void save_func_code_cache(const FuncCodeCache* pCache, const char* pszPath) {
+    StrBuf data = { 0 };
+    uint8_t compilerId[SHA256_DIGEST_SIZE];
+    get_compiler_id(compilerId);
+
+    const uint32_t count = (uint32_t)pCache->nextCount;
+    strbuf_append(&data, FUNC_STATE_MAGIC, 4);
+    strbuf_append(&data, (const char*)compilerId, SHA256_DIGEST_SIZE);
+    strbuf_append(&data, (const char*)&count, sizeof(count));
+    for (int i = 0; i < pCache->nextCount; ++i) {
+        const FuncCodeEntry* pEntry = &pCache->pNextEntries[i];
+        const uint32_t len = (uint32_t)pEntry->len;
+        strbuf_append(&data, (const char*)pEntry->fingerprint, SHA256_DIGEST_SIZE);
+        strbuf_append(&data, (const char*)&len, sizeof(len));
+        strbuf_append(&data, pEntry->code, pEntry->len);
+    }
+
+    // ̏ԃt@Cɓǂ܂Ȃ悤Aꎞt@Cu
+    StrBuf tmpPath = { 0 };
+    strbuf_printf(&tmpPath, "%s.tmp", pszPath);
+    FILE* fp = fopen(tmpPath.data, "wb");
+    if (fp) {
+        const bool isWritten = fwrite(data.data, 1, data.len, fp) == data.len;
+        if (fclose(fp) == 0 && isWritten) {
+            replace_file(tmpPath.data, pszPath);
+        }
+        remove(tmpPath.data);
+    }
+    strbuf_free(&tmpPath);
+    strbuf_free(&data);
+}
+
+// ԂmۂĂ郁
+void free_func_code_cache(FuncCodeCache* pCache) {
+    for (int i = 0; i < pCache->nextCount; ++i) {
+        free(pCache->pNextEntries[i].code);
+    }
+    free(pCache->pNextEntries);
+    free(pCache->pPrevEntries);
+    free(pCache->pPrevData);
+    memset(pCache, 0, sizeof(FuncCodeCache));
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sha256.h"
+
+typedef struct FuncCodeEntry FuncCodeEntry;
+typedef struct FuncCodeCache FuncCodeCache;
+
+// ֐1̃R[h
+struct FuncCodeEntry {
+    uint8_t fingerprint[SHA256_DIGEST_SIZE];    // ֐̎wig[NƎQƂĂO[o錾̃nbVlj
+    char* code;                                 // AZu
+    size_t len;                                 // AZu̒
+};
+
+// ֐Ƃ̃R[hʂ̕ۑԁiCN^RpCpj
+// Ǒʂwň悤ɂǍʂ͎̂߂ɕʂɏW߂
+struct FuncCodeCache {
+    char* pPrevData;                // ԃt@C̓eiǑʂ̃AZu͂̒wj
+    FuncCodeEntry* pPrevEntries;    // Ǒʁiw̏ɕׂĂj
+    int prevCount;                  // Ǒʂ̐
+    FuncCodeEntry* pNextEntries;    // ̌ʁi\[XR[h̏j
+    int nextCount;                  // ̌ʂ̐
+    int nextCap;                    // pNextEntries̊mۍςݗe
+    int reusedCount;                // Ǒʂėp֐̐
+};
+
+// ԃt@CǑʂǂݍ
+// t@CAĂAʂ̃RpCōꂽꍇ͋̏ԂɂȂ
+void load_func_code_cache(FuncCodeCache* pCache, const char* pszPath);
+
+// w䂪vǑʂTiNULLj
+const FuncCodeEntry* find_func_code(const FuncCodeCache* pCache, const uint8_t fingerprint[SHA256_DIGEST_SIZE]);
+
+// ̌ʂǉ
+void add_func_code(FuncCodeCache* pCache, const uint8_t fingerprint[SHA256_DIGEST_SIZE], const char* code, size_t len);
+
+// ̌ʂԃt@Cɏ
+void save_func_code_cache(const FuncCodeCache* pCache, const char* pszPath);
+
+// ԂmۂĂ郁
+void free_func_code_cache(FuncCodeCache* pCache);
@@ -0,0 +1,249 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asm_encoder.h"
+#include "jit.h"
+#include "error.h"
+
+// O֐Ăяo߂̒pR[h̑傫
+//     jmp QWORD PTR [rip+0]    FF 25 00 00 00 00
+//     .quad Ăяo         (8oCg)
+#define JIT_STUB_SIZE   (16)
+
+// main֐Ăяo߂̒pR[h
+//     R[hrdiȂǂޔɏ邽߁AĂяoĩvZXj
+//     callee-savedWX^SđޔEĂĂяo
+//     8oCgmain֐̃AhX
+static const uint8_t JIT_ENTRY_CODE[] = {
+    0x53,                           // push rbx
+    0x55,                           // push rbp
+    0x57,                           // push rdi
+    0x56,                           // push rsi
+    0x41, 0x54,                     // push r12
+    0x41, 0x55,                     // push r13
+    0x41, 0x56,                     // push r14
+    0x41, 0x57,                     // push r15
+    0x48, 0x83, 0xEC, 0x28,         // sub rsp, 40iACgWindows̃VhËj
+    0xFF, 0x15, 0x12, 0x00, 0x00, 0x00, // call QWORD PTR [rip+18]
+    0x48, 0x83, 0xC4, 0x28,         // add rsp, 40
+    0x41, 0x5F,                     // pop r15
+    0x41, 0x5E,                     // pop r14
+    0x41, 0x5D,                     // pop r13
+    0x41, 0x5C,                     // pop r12
+    0x5E,                           // pop rsi
+    0x5F,                           // pop rdi
+    0x5D,                           // pop rbp
+    0x5B,                           // pop rbx
+    0xC3,                           // ret
+};
+
+typedef int (*JitMainFunc)(int argc, char** argv);
+
+static size_t align_to(size_t n, size_t align) {
+    return (n + align - 1) / align * align;
+}
+
+static size_t get_page_size(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+// ݉\ȃmۂ
+static uint8_t* alloc_memory(size_t size) {
+#ifdef _WIN32
+    return VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+    void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return (p == MAP_FAILED) ? NULL : p;
+#endif
+}
+
+// w肵͈͂s\iݕsjɂ
+static bool make_executable(uint8_t* p, size_t size) {
+#ifdef _WIN32
+    DWORD oldProtect;
+    return VirtualProtect(p, size, PAGE_EXECUTE_READ, &oldProtect) != 0;
+#else
+    return mprotect(p, size, PROT_READ | PROT_EXEC) == 0;
+#endif
+}
+
+static void free_memory(uint8_t* p, size_t size) {
+#ifdef _WIN32
+    VirtualFree(p, 0, MEM_RELEASE);
+#else
+    munmap(p, size);
+#endif
+}
+
+// s̃vZXOV{̃AhXT
+static void* find_external_symbol(const char* name) {
+#ifdef _WIN32
+    static const char* const MODULES[] = { "ucrtbase.dll", "msvcrt.dll", "kernel32.dll" };
+    void* p = (void*)GetProcAddress(GetModuleHandleA(NULL), name);
+    for (int i = 0; !p && i < sizeof(MODULES) / sizeof(MODULES[0]); ++i) {
+        HMODULE hModule = LoadLibraryA(MODULES[i]);
+        if (hModule) p = (void*)GetProcAddress(hModule, name);
+    }
+    return p;
+#else
+    return dlsym(RTLD_DEFAULT, name);
+#endif
+}
+
+// Ĕzu\IuWFNgs\ɓWJAmain֐ĂяoĂ̖߂lԂ
+// `V{͎s̃vZXɓǂݍ܂Ă郉CuT
+//
+// ̔zu
+//     [s\̈]   s\ZNVAO֐̒pR[hAmain̒pR[h
+//     [f[^̈]     ȊÕZNViy[WEJnj
+int jit_run(const ObjFile* pObj, int argc, char** argv) {
+    const size_t pageSize = get_page_size();
+    size_t* pSectionOffsets = calloc(pObj->sectionCount, sizeof(size_t));
+    size_t* pStubOffsets = calloc(pObj->symbolCount, sizeof(size_t));
+    int i;
+
+    // s\ZNVׂ
+    size_t execSize = 0;
+    for (i = 0; i < pObj->sectionCount; ++i) {
+        const ObjSection* pSection = &pObj->pSections[i];
+        if (!(pSection->flags & SECTION_FLAG_ALLOC) || !(pSection->flags & SECTION_FLAG_EXEC)) continue;
+
+        execSize = align_to(execSize, pSection->align);
+        pSectionOffsets[i] = execSize;
+        execSize += pSection->size;
+    }
+
+    // `V{ƂɒpR[h̏ꏊmۂ
+    execSize = align_to(execSize, JIT_STUB_SIZE);
+    for (i = 0; i < pObj->symbolCount; ++i) {
+        if (pObj->pSymbols[i].section >= 0) continue;
+
+        pStubOffsets[i] = execSize;
+        execSize += JIT_STUB_SIZE;
+    }
+
+    const size_t entryOffset = execSize;
+    execSize += align_to(sizeof(JIT_ENTRY_CODE), 8) + 8;
+    execSize = align_to(execSize, pageSize);
+
+    // ȊÕZNVׂ
+    size_t totalSize = execSize;
+    for (i = 0; i < pObj->sectionCount; ++i) {
+        const ObjSection* pSection = &pObj->pSections[i];
+        if (!(pSection->flags & SECTION_FLAG_ALLOC) || (pSection->flags & SECTION_FLAG_EXEC)) continue;
+
+        totalSize = align_to(totalSize, pSection->align);
+        pSectionOffsets[i] = totalSize;
+        totalSize += pSection->size;
+    }
+    totalSize = align_to(totalSize ? totalSize : 1, pageSize);
+
+    uint8_t* pBase = alloc_memory(totalSize);
+    if (pBase == NULL) {
+        error("sp̃mۂł܂");
+    }
+
+    // ZNV̓eށi.bss͊mێ_Ń[߂Ăj
+    for (i = 0; i < pObj->sectionCount; ++i) {
+        const ObjSection* pSection = &pObj->pSections[i];
+        if (!(pSection->flags & SECTION_FLAG_ALLOC) || pSection->isNoBits || pSection->size == 0) continue;
+
+        memcpy(pBase + pSectionOffsets[i], pSection->data, pSection->size);
+    }
+
+    // O֐̒pR[h
+    for (i = 0; i < pObj->symbolCount; ++i) {
+        const ObjSymbol* pSym = &pObj->pSymbols[i];
+        if (pSym->section >= 0) continue;
+
+        void* pAddr = find_external_symbol(pSym->name);
+        if (pAddr == NULL) {
+            error("`̃V{ł: %s", pSym->name);
+        }
+
+        uint8_t* pStub = pBase + pStubOffsets[i];
+        const uint8_t jmpCode[] = { 0xFF, 0x25, 0x00, 0x00, 0x00, 0x00 };
+        memcpy(pStub, jmpCode, sizeof(jmpCode));
+        memcpy(pStub + sizeof(jmpCode), &pAddr, sizeof(pAddr));
+    }
+
+    // ĔzuKp
+    for (i = 0; i < pObj->sectionCount; ++i) {
+        const ObjSection* pSection = &pObj->pSections[i];
+        if (!(pSection->flags & SECTION_FLAG_ALLOC)) continue;
+
+        for (int j = 0; j < pSection->relocCount; ++j) {
+            const ObjReloc* pReloc = &pSection->pRelocs[j];
+            const ObjSymbol* pSym = &pObj->pSymbols[pReloc->symbol];
+            uint8_t* pPlace = pBase + pSectionOffsets[i] + pReloc->offset;
+
+            uint64_t symAddr;
+            if (pSym->section >= 0) {
+                symAddr = (uint64_t)(uintptr_t)(pBase + pSectionOffsets[pSym->section] + pSym->offset);
+            }
+            else if (pReloc->kind == RELOC_PLT32) {
+                symAddr = (uint64_t)(uintptr_t)(pBase + pStubOffsets[pReloc->symbol]);
+            }
+            else {
+                symAddr = (uint64_t)(uintptr_t)find_external_symbol(pSym->name);
+            }
+
+            if (pReloc->kind == RELOC_ABS64) {
+                const uint64_t value = symAddr + pReloc->addend;
+                memcpy(pPlace, &value, sizeof(value));
+            }
+            else {
+                const int64_t value = (int64_t)(symAddr + pReloc->addend - (uint64_t)(uintptr_t)pPlace);
+                if (value < INT32_MIN || INT32_MAX < value) {
+                    error("V{'%s'邽ߎQƂł܂", pSym->name);
+                }
+                const int32_t value32 = (int32_t)value;
+                memcpy(pPlace, &value32, sizeof(value32));
+            }
+        }
+    }
+
+    // main֐TĒpR[hpӂ
+    void* pMain = NULL;
+    for (i = 0; i < pObj->symbolCount; ++i) {
+        const ObjSymbol* pSym = &pObj->pSymbols[i];
+        if (pSym->section >= 0 && strcmp(pSym->name, "main") == 0) {
+            pMain = pBase + pSectionOffsets[pSym->section] + pSym->offset;
+        }
+    }
+    if (pMain == NULL) {
+        error("main֐`Ă܂");
+    }
+    memcpy(pBase + entryOffset, JIT_ENTRY_CODE, sizeof(JIT_ENTRY_CODE));
+    memcpy(pBase + entryOffset + align_to(sizeof(JIT_ENTRY_CODE), 8), &pMain, sizeof(pMain));
+
+    if (!make_executable(pBase, execSize)) {
+        error("sp̃Ɏst܂");
+    }
+
+    const JitMainFunc pEntry = (JitMainFunc)(pBase + entryOffset);
+    const int exitCode = pEntry(argc, argv);
+
+    fflush(stdout);
+    free_memory(pBase, totalSize);
+    free(pStubOffsets);
+    free(pSectionOffsets);
+    return exitCode;
+}
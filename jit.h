@@ -0,0 +1,7 @@
+#pragma once
+
+typedef struct ObjFile ObjFile;
+
+// Ĕzu\IuWFNgs\ɓWJAmain֐ĂяoĂ̖߂lԂ
+// `V{͎s̃vZXɓǂݍ܂Ă郉CuT
+int jit_run(const ObjFile* pObj, int argc, char** argv);
@@ -7,6 +7,8 @@
 
 #include "lexer.h"
 #include "error.h"
+#include "arena.h"
+#include "time_trace.h"
 
 // ̃g[N҂ĂL̂Ƃɂ́Ag[N1ǂݐi߂
 // ^ԂBȊȌꍇɂ͋UԂB
@@ -50,7 +52,7 @@ void expect(Token** ppToken, const char* op) {
         strlen(op) != (*ppToken)->len ||
         memcmp((*ppToken)->str, op, (*ppToken)->len))
     {
-        error_at((*ppToken)->filename, (*ppToken)->user_input, (*ppToken)->str, "'%s'ł͂܂", op);
+        error_at((*ppToken)->loc, "'%s'ł͂܂", op);
     }
     *ppToken = (*ppToken)->next;
 }
@@ -59,7 +61,7 @@ void expect(Token** ppToken, const char* op) {
 // ȊȌꍇɂ̓G[񍐂B
 int expect_number(Token** ppToken) {
     if ((*ppToken)->kind != TK_NUM) {
-        error_at((*ppToken)->filename, (*ppToken)->user_input, (*ppToken)->str, "ł͂܂");
+        error_at((*ppToken)->loc, "ł͂܂");
     }
     int val = (*ppToken)->val;
     *ppToken = (*ppToken)->next;
@@ -72,13 +74,12 @@ bool at_eof(Token* pToken) {
 }
 
 // Vg[N쐬curɌq
-static Token* new_token(TokenKind kind, Token* cur, const char* str, int len, const char* filename, const char* user_input) {
-    Token* tok = calloc(1, sizeof(Token));
+static Token* new_token(TokenKind kind, Token* cur, const char* str, int len, const SourceFile* pFile) {
+    Token* tok = arena_calloc(1, sizeof(Token));
     tok->kind = kind;
     tok->str = str;
     tok->len = len;
-    tok->filename = filename;
-    tok->user_input = user_input;
+    tok->loc = get_source_loc(pFile, str);
     cur->next = tok;
     return tok;
 }
@@ -104,34 +105,51 @@ static const char* read_file(const char* path) {
     }
 
     // t@Ceǂݍ
-    char* buf = calloc(1, size + 1);
+    char* buf = arena_calloc(1, size + 1);
     fread(buf, size, 1, fp);
 
     fclose(fp);
     return buf;
 }
 
-// ͕pg[NiCYĂԂ
-Token* tokenize(const char* filename, StringLiteral** ppStrLiterals) {
+// o^\[Xg[NiCYĂԂ
+// ͂ȂA\[X̍s̕\
+Token* tokenize_source(SourceFile* pFile) {
     Token head;
     head.next = NULL;
     Token* cur = &head;
-    StringLiteral* pCurStrLiterals = NULL;
-    int strLiteralCount = 0;
+    bool isLineHead = true;
 
-    const char* user_input = read_file(filename);
+    const char* user_input = pFile->pText;
     const char* p = user_input;
+    pFile->lineCount = 0;
+    add_line_start(pFile, 0);
     while (*p) {
+        // s̎̃g[N͍s̐擪ivvZbTfBNeBu̔Ɏgj
+        if (*p == '\n') {
+            isLineHead = true;
+            p++;
+            add_line_start(pFile, (uint32_t)(p - user_input));
+            continue;
+        }
+
         // 󔒕XLbv
         if (isspace(*p)) {
             p++;
             continue;
         }
 
+        // s'\'ɂšp
+        if (*p == '\\' && (*(p + 1) == '\n' || (*(p + 1) == '\r' && *(p + 2) == '\n'))) {
+            p += (*(p + 1) == '\n') ? 2 : 3;
+            add_line_start(pFile, (uint32_t)(p - user_input));
+            continue;
+        }
+
         // sRgXLbv
         if (strncmp(p, "//", 2) == 0) {
             p += 2;
-            while (*p != '\n') {
+            while (*p && *p != '\n') {
                 p++;
             }
             continue;
@@ -141,113 +159,225 @@ Token* tokenize(const char* filename, StringLiteral** ppStrLiterals) {
         if (strncmp(p, "/*", 2) == 0) {
             char* q = strstr(p + 2, "*/");
             if (!q) {
-                error_at(filename, user_input, p, "RgĂ܂");
+                error_at(get_source_loc(pFile, p), "RgĂ܂");
+            }
+            for (; p < q; ++p) {
+                if (*p == '\n') add_line_start(pFile, (uint32_t)(p + 1 - user_input));
             }
             p = q + 2;
             continue;
         }
 
+        const Token* pPrev = cur;
+
         // ʎq
-        if ('a' <= *p && *p <= 'z' || 'A' <= *p && *p <= 'Z') {
+        if (('a' <= *p && *p <= 'z') || ('A' <= *p && *p <= 'Z') || *p == '_') {
             const char* pEnd = p;
             do { pEnd++; } while ('a' <= *pEnd && *pEnd <= 'z' || 'A' <= *pEnd && *pEnd <= 'Z' || '0' <= *pEnd && *pEnd <= '9' || *pEnd == '_');
 
             if ((int)(pEnd - p) == 6 && strncmp(p, "return", 6) == 0) {
-                cur = new_token(TK_RETURN, cur, p, (int)(pEnd - p), filename, user_input);
+                cur = new_token(TK_RETURN, cur, p, (int)(pEnd - p), pFile);
             }
             else if ((int)(pEnd - p) == 2 && strncmp(p, "if", 2) == 0) {
-                cur = new_token(TK_IF, cur, p, (int)(pEnd - p), filename, user_input);
+                cur = new_token(TK_IF, cur, p, (int)(pEnd - p), pFile);
             }
             else if ((int)(pEnd - p) == 4 && strncmp(p, "else", 4) == 0) {
-                cur = new_token(TK_ELSE, cur, p, (int)(pEnd - p), filename, user_input);
+                cur = new_token(TK_ELSE, cur, p, (int)(pEnd - p), pFile);
             }
             else if ((int)(pEnd - p) == 5 && strncmp(p, "while", 5) == 0) {
-                cur = new_token(TK_WHILE, cur, p, (int)(pEnd - p), filename, user_input);
+                cur = new_token(TK_WHILE, cur, p, (int)(pEnd - p), pFile);
             }
             else if ((int)(pEnd - p) == 3 && strncmp(p, "for", 3) == 0) {
-                cur = new_token(TK_FOR, cur, p, (int)(pEnd - p), filename, user_input);
+                cur = new_token(TK_FOR, cur, p, (int)(pEnd - p), pFile);
+            }
+            else if ((int)(pEnd - p) == 6 && strncmp(p, "switch", 6) == 0) {
+                cur = new_token(TK_SWITCH, cur, p, (int)(pEnd - p), pFile);
+            }
+            else if ((int)(pEnd - p) == 4 && strncmp(p, "case", 4) == 0) {
+                cur = new_token(TK_CASE, cur, p, (int)(pEnd - p), pFile);
+            }
+            else if ((int)(pEnd - p) == 7 && strncmp(p, "default", 7) == 0) {
+                cur = new_token(TK_DEFAULT, cur, p, (int)(pEnd - p), pFile);
+            }
+            else if ((int)(pEnd - p) == 5 && strncmp(p, "break", 5) == 0) {
+                cur = new_token(TK_BREAK, cur, p, (int)(pEnd - p), pFile);
             }
             else if ((int)(pEnd - p) == 4 && strncmp(p, "char", 4) == 0) {
-                cur = new_token(TK_CHAR, cur, p, (int)(pEnd - p), filename, user_input);
+                cur = new_token(TK_CHAR, cur, p, (int)(pEnd - p), pFile);
             }
             else if ((int)(pEnd - p) == 3 && strncmp(p, "int", 3) == 0) {
-                cur = new_token(TK_INT, cur, p, (int)(pEnd - p), filename, user_input);
+                cur = new_token(TK_INT, cur, p, (int)(pEnd - p), pFile);
             }
             else if ((int)(pEnd - p) == 6 && strncmp(p, "sizeof", 6) == 0) {
-                cur = new_token(TK_SIZEOF, cur, p, (int)(pEnd - p), filename, user_input);
+                cur = new_token(TK_SIZEOF, cur, p, (int)(pEnd - p), pFile);
             }
             else {
-                cur = new_token(TK_IDENT, cur, p, (int)(pEnd - p), filename, user_input);
+                cur = new_token(TK_IDENT, cur, p, (int)(pEnd - p), pFile);
             }
             p = pEnd;
-            continue;
         }
-
+        // OL
+        else if (strncmp(p, "...", 3) == 0) {
+            cur = new_token(TK_RESERVED, cur, p, 3, pFile);
+            p += 3;
+        }
+        // ƃCNgEfNg̋L
+        else if ((*p == '+' || *p == '-' || *p == '*' || *p == '/') &&
+                 (*(p + 1) == '=' || (*(p + 1) == *p && (*p == '+' || *p == '-')))) {
+            cur = new_token(TK_RESERVED, cur, p, 2, pFile);
+            p += 2;
+        }
         // ꕶL
-        if (*p == '+' || *p == '-' || *p == '*' || *p == '/' || *p == '(' || *p == ')' || *p == '{' || *p == '}' || *p == '[' || *p == ']' || *p == ';' || *p == ',') {
-            cur = new_token(TK_RESERVED, cur, p++, 1, filename, user_input);
-            continue;
+        else if (*p == '+' || *p == '-' || *p == '*' || *p == '/' || *p == '(' || *p == ')' || *p == '{' || *p == '}' || *p == '[' || *p == ']' || *p == ';' || *p == ',' ||
+                 *p == '%' || *p == '~' || *p == '^' || *p == '?' || *p == ':' || *p == '.') {
+            cur = new_token(TK_RESERVED, cur, p++, 1, pFile);
         }
-
         // 񕶎ɂȂ蓾L
-        if (*p == '=' || *p == '!' || *p == '<' || *p == '>' || *p == '&') {
-            if (*(p + 1) == '=' ||
-                (*(p + 1) == *p && (*p == '&'))) {
-                cur = new_token(TK_RESERVED, cur, p, 2, filename, user_input);
+        else if (*p == '=' || *p == '!' || *p == '<' || *p == '>' || *p == '&' || *p == '|' || *p == '#') {
+            if ((*(p + 1) == '=' && *p != '#') ||
+                (*(p + 1) == *p && (*p == '&' || *p == '|' || *p == '<' || *p == '>' || *p == '#'))) {
+                cur = new_token(TK_RESERVED, cur, p, 2, pFile);
                 p += 2;
             }
             else {
-                //TODO: _ł͘_NOT('!')͍\͂ΉĂȂ
-                cur = new_token(TK_RESERVED, cur, p++, 1, filename, user_input);
+                cur = new_token(TK_RESERVED, cur, p++, 1, pFile);
             }
-            continue;
         }
-
         // le
-        if (isdigit(*p)) {
+        else if (isdigit(*p)) {
             const char* pEnd = p;
             int val = strtol(p, &pEnd, 10);
 
-            cur = new_token(TK_NUM, cur, p, (int)(pEnd - p), filename, user_input);
+            cur = new_token(TK_NUM, cur, p, (int)(pEnd - p), pFile);
             cur->val = val;
             p = pEnd;
-            continue;
         }
-
         // 񃊃e
-        if (*p == '"') {
+        else if (*p == '"') {
             const char* pEnd = p;
             while (*(++pEnd) != '"') {
                 if (*pEnd == '\0' || *pEnd == '\n') {
-                    error_at(filename, user_input, p, "񃊃eĂ܂");
+                    error_at(get_source_loc(pFile, p), "񃊃eĂ܂");
+                }
+                // GXP[vꂽi'\"'Ȃǁj͓ǂݔ΂
+                if (*pEnd == '\\' && *(pEnd + 1) != '\0') {
+                    ++pEnd;
                 }
             }
             ++pEnd;
 
-            if (pCurStrLiterals == NULL) {
-                *ppStrLiterals = calloc(1, sizeof(StringLiteral));
-                pCurStrLiterals = *ppStrLiterals;
-            }
-            else {
-                pCurStrLiterals->pNext = calloc(1, sizeof(StringLiteral));
-                pCurStrLiterals = pCurStrLiterals->pNext;
-            }
+            cur = new_token(TK_STRING, cur, p, (int)(pEnd - p), pFile);
+            p = pEnd;
+        }
+        else {
+            error_at(get_source_loc(pFile, p), "g[NiCYł܂");
+        }
 
-            int len = (int)(pEnd - p);
+        if (cur != pPrev) {
+            cur->isLineHead = isLineHead;
+            isLineHead = false;
+        }
+    }
 
-            pCurStrLiterals->pszText = calloc(len + 1, sizeof(char));
-            strncpy_s(pCurStrLiterals->pszText, len + 1, p, len);
+    new_token(TK_EOF, cur, p, 0, pFile)->isLineHead = true;
+    pFile->hasLines = true;
+    return head.next;
+}
 
-            cur = new_token(TK_STRING, cur, p, (int)(pEnd - p), filename, user_input);
-            cur->val = strLiteralCount++;
-            p = pEnd;
-            continue;
+// ͕user_input\[XƂēo^ăg[NiCYAԂ
+// o^̓RpC̏Iɉ̂ŁAuser_input͂܂ŗLłȂ΂ȂȂ
+Token* tokenize_text(const char* filename, const char* user_input) {
+    return tokenize_source(add_source_file(filename, user_input, false));
+}
+
+// w肳ꂽt@CǂݍŃg[NiCYAԂ
+Token* tokenize(const char* filename) {
+    TimeSpan span;
+    time_trace_begin(&span, "read_file", filename, -1);
+    const char* user_input = read_file(filename);
+    time_trace_end(&span);
+
+    time_trace_begin(&span, "tokenize", filename, -1);
+    Token* pToken = tokenize_text(filename, user_input);
+    time_trace_end(&span);
+    return pToken;
+}
+
+static unsigned int hash_text(const char* str, int len) {
+    // FNV-1a
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < len; ++i) {
+        hash = (hash ^ (unsigned char)str[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// 񃊃e̕\iԂ肩ԍAJԒn@̃nbV\j
+typedef struct {
+    const Token** ppSlots;  // eԍ̃eŏɌg[Ni󂫂NULLj
+    int* pIds;              // ppSlotsƓʒũe̔ԍ
+    int cap;                // \̑傫i2ׂ̂j
+} StrLiteralTable;
 
+static void rehash_str_literals(StrLiteralTable* pTable, int newCap) {
+    const StrLiteralTable old = *pTable;
+    pTable->ppSlots = calloc(newCap, sizeof(const Token*));
+    pTable->pIds = calloc(newCap, sizeof(int));
+    pTable->cap = newCap;
+
+    for (int i = 0; i < old.cap; ++i) {
+        if (old.ppSlots[i] == NULL) continue;
+
+        unsigned int pos = hash_text(old.ppSlots[i]->str, old.ppSlots[i]->len) & (newCap - 1);
+        while (pTable->ppSlots[pos]) {
+            pos = (pos + 1) & (newCap - 1);
         }
+        pTable->ppSlots[pos] = old.ppSlots[i];
+        pTable->pIds[pos] = old.pIds[i];
+    }
+    free(old.ppSlots);
+    free(old.pIds);
+}
 
-        error_at(filename, user_input, p, "g[NiCYł܂");
+// g[NɊ܂܂镶񃊃eɒʂԍUÄꗗԂ
+// CN[ht@C}NWJŌꂽ̂܂߁AŏIIȃg[N̏ɔԍU
+// Ԃ̃eɂ͓ԍUiȌȂǁA񂪉xĂ1o͂Ȃj
+StringLiteral* collect_string_literals(Token* pToken) {
+    StringLiteral head;
+    head.pNext = NULL;
+    StringLiteral* pCur = &head;
+    int strLiteralCount = 0;
+    StrLiteralTable table = { 0 };
+    rehash_str_literals(&table, 64);
+
+    for (; pToken; pToken = pToken->next) {
+        if (pToken->kind != TK_STRING) continue;
+
+        unsigned int pos = hash_text(pToken->str, pToken->len) & (table.cap - 1);
+        for (; table.ppSlots[pos]; pos = (pos + 1) & (table.cap - 1)) {
+            if (table.ppSlots[pos]->len == pToken->len && memcmp(table.ppSlots[pos]->str, pToken->str, pToken->len) == 0) break;
+        }
+        if (table.ppSlots[pos]) {
+            pToken->val = table.pIds[pos];
+            continue;
+        }
+
+        pCur->pNext = arena_calloc(1, sizeof(StringLiteral));
+        pCur = pCur->pNext;
+        pCur->str = pToken->str;
+        pCur->len = pToken->len;
+
+        table.ppSlots[pos] = pToken;
+        table.pIds[pos] = strLiteralCount;
+        pToken->val = strLiteralCount++;
+
+        // ח1/2𒴂\L
+        if (table.cap < strLiteralCount * 2) {
+            rehash_str_literals(&table, table.cap * 2);
+        }
     }
 
-    new_token(TK_EOF, cur, p, 0, filename, user_input);
-    return head.next;
+    free(table.ppSlots);
+    free(table.pIds);
+    return head.pNext;
 }
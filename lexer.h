@@ -1,5 +1,9 @@
 #pragma once
 
+#include <stdbool.h>
+
+#include "source.h"
+
 // g[N̎
 typedef enum {
     TK_RESERVED, // L
@@ -8,6 +12,10 @@ typedef enum {
     TK_ELSE,     // else
     TK_WHILE,    // while
     TK_FOR,      // for
+    TK_SWITCH,   // switch
+    TK_CASE,     // case
+    TK_DEFAULT,  // default
+    TK_BREAK,    // break
     TK_CHAR,     // char
     TK_INT,      // int
     TK_SIZEOF,   // sizeof
@@ -19,22 +27,27 @@ typedef enum {
 
 typedef struct Token Token;
 typedef struct StringLiteral StringLiteral;
+typedef struct HideSet HideSet;
 
 // g[N^
+// locstr̎ẅʒuŁAt@Cƍsԍloc狁߂i\؂̂߂ɍl̃g[NȂǂ0j
 struct Token {
     TokenKind kind;             // g[Ň^
-    Token* next;                // ̓̓g[N
     int val;                    // kindTK_NUM̏ꍇA̐l
+    Token* next;                // ̓̓g[N
     const char* str;            // g[N
     int len;                    // g[N̒
-    const char* filename;       // ̓t@C
-    const char* user_input;     // [U[͕
+    SourceLoc loc;              // \[Ẍʒu
+    const HideSet* pHideSet;    // }NWJōꂽg[NȂAWJς݂̃}N̏W
+    bool isLineHead;            // s̐擪̃g[NȂtrue
 };
 
 // 񃊃e
+// Ԃ̃e1ɂ܂Ƃ߁Ae͕Ƀg[N̎w\[X͈̔͂̂܂܎w
 struct StringLiteral {
     StringLiteral* pNext;
-    char* pszText;
+    const char* str;    // ['"'܂ރe̒Ԃi'\0'I[ł͂Ȃj
+    int len;            // Ԃ̒
 };
 
 // ̃g[N҂ĂL̂Ƃɂ́Ag[N1ǂݐi߂
@@ -60,5 +73,17 @@ int expect_number(Token** ppToken);
 // ̃g[NEOFȂ^ԂBȊȌꍇɂ͋UԂB
 bool at_eof(Token* pToken);
 
-// ͕pg[NiCYĂԂ
-Token* tokenize(const char* filename, StringLiteral** ppStrLiterals);
+// o^\[Xg[NiCYĂԂ
+// ͂ȂA\[X̍s̕\
+Token* tokenize_source(SourceFile* pFile);
+
+// ͕user_input\[XƂēo^ăg[NiCYAԂ
+// o^̓RpC̏Iɉ̂ŁAuser_input͂܂ŗLłȂ΂ȂȂ
+Token* tokenize_text(const char* filename, const char* user_input);
+
+// w肳ꂽt@CǂݍŃg[NiCYAԂ
+Token* tokenize(const char* filename);
+
+// g[NɊ܂܂镶񃊃eɒʂԍUÄꗗԂ
+// Ԃ̃eɂ͓ԍU
+StringLiteral* collect_string_literals(Token* pToken);
@@ -1,4 +1,5 @@
 ﻿#include <ctype.h>
+#include <setjmp.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -8,24 +9,818 @@
 #include "lexer.h"
 #include "parser.h"
 #include "asm_gen.h"
+#include "asm_encoder.h"
+#include "elf_writer.h"
+#include "jit.h"
 #include "error.h"
+#include "strbuf.h"
+#include "arena.h"
+#include "thread.h"
+#include "server.h"
+#include "cache.h"
+#include "incremental.h"
+#include "preprocess.h"
+#include "pch.h"
+#include "ast_file.h"
+#include "time_trace.h"
+#include "profile.h"
 
-int main(int argc, char** argv) {
-    if (argc != 2) {
+// キャッシュ全体の大きさの既定の上限（MB）
+#define DEFAULT_CACHE_MAX_MB    (1024)
+
+typedef struct CompileJob CompileJob;
+
+// 1つの入力ファイルのコンパイル
+struct CompileJob {
+    const char* pszInput;   // 入力ファイル名
+    const char* pszOutput;  // 出力ファイル名（NULLなら標準出力）
+    bool isObjMode;         // アセンブリではなく再配置可能オブジェクトを出力するならtrue
+    bool isDumpAstMode;     // アセンブリではなく構文木を出力するならtrue
+    bool isAstInput;        // 入力ファイルが-dump-astで出力した構文木ならtrue
+    int genThreadCount;     // 関数ごとのコード生成に使うスレッドの数
+    const PreprocessOptions* pPPOptions; // プリプロセッサの設定
+    const PchFile* pPch;    // 先頭に読み込むプリコンパイル済みヘッダー（NULLなら使わない）
+    const CompileCache* pCache; // コンパイル結果のキャッシュ（NULLなら使わない）
+    bool isCacheStored;     // コンパイル結果をキャッシュに保存したならtrue
+    bool isIncremental;     // 変更があった関数だけを生成し直すならtrue
+    const ProfileOptions* pProfile; // プロファイルの扱い
+    bool isDebugInfo;       // ソース上の行との対応と呼び出しフレームの情報を出力するならtrue
+    bool isStream;          // トップレベルの宣言1つずつ構文解析とコード生成をするならtrue
+    bool isWholeProgram;    // 翻訳単位をプログラム全体と見なし、mainから届かない関数を出力しないならtrue
+    StrBuf asmText;         // 生成したアセンブリ
+    StrBuf errors;          // このファイルのコンパイル中に報告されたエラー
+    bool isFailed;          // コンパイルに失敗したならtrue
+};
+
+// 文字列を複製する
+static char* copy_string(const char* str, size_t len) {
+    char* pszCopy = calloc(len + 1, sizeof(char));
+    memcpy(pszCopy, str, len);
+    return pszCopy;
+}
+
+// 入力ファイル名から既定の出力ファイル名（カレントディレクトリの"*.o"や"*.s"）を作る
+static char* default_output_filename(const char* pszInput, const char* pszNewExt) {
+    const char* pszBase = pszInput;
+    for (const char* p = pszInput; *p; ++p) {
+        if (*p == '/' || *p == '\\') pszBase = p + 1;
+    }
+
+    const char* pszExt = strrchr(pszBase, '.');
+    const size_t baseLen = pszExt ? (size_t)(pszExt - pszBase) : strlen(pszBase);
+    const size_t extLen = strlen(pszNewExt);
+
+    char* pszOutput = calloc(baseLen + extLen + 1, sizeof(char));
+    memcpy(pszOutput, pszBase, baseLen);
+    memcpy(pszOutput + baseLen, pszNewExt, extLen);
+    return pszOutput;
+}
+
+// ヘッダーファイルのトークン列のキャッシュ
+// コンパイルサーバーでは要求をまたいで使い続ける
+static HeaderCache* s_pHeaderCache = NULL;
+
+// 文字列の配列の末尾に追加する
+static void add_string(const char*** pppStrings, int* pCount, const char* str) {
+    *pppStrings = realloc(*pppStrings, (*pCount + 1) * sizeof(const char*));
+    (*pppStrings)[(*pCount)++] = str;
+}
+
+// コンパイルするファイルを追加する
+static void add_job(CompileJob** ppJobs, int* pJobCount, const char* pszInput, const char* pszOutput) {
+    *ppJobs = realloc(*ppJobs, (*pJobCount + 1) * sizeof(CompileJob));
+    CompileJob* pJob = &(*ppJobs)[(*pJobCount)++];
+    memset(pJob, 0, sizeof(CompileJob));
+    pJob->pszInput = pszInput;
+    pJob->pszOutput = pszOutput;
+}
+
+// マニフェストファイルに書かれたファイルを追加する
+// 1行に1つ「入力ファイル名 [出力ファイル名]」を書く（空行と'#'で始まる行は無視する）
+static void read_manifest(const char* pszManifest, CompileJob** ppJobs, int* pJobCount) {
+    FILE* fp = fopen(pszManifest, "r");
+    if (!fp) {
+        error("cannot open %s", pszManifest);
+    }
+
+    char line[4096];
+    while (fgets(line, sizeof(line), fp)) {
+        const char* pszNames[2] = { NULL, NULL };
+        int nameCount = 0;
+
+        char* p = line;
+        while (*p && *p != '#') {
+            if (isspace((unsigned char)*p)) {
+                ++p;
+                continue;
+            }
+
+            const char* pStart = p;
+            while (*p && !isspace((unsigned char)*p)) ++p;
+            if (2 <= nameCount) {
+                error("%s: 1行に書けるファイル名は2つまでです", pszManifest);
+            }
+            pszNames[nameCount++] = copy_string(pStart, p - pStart);
+        }
+
+        if (nameCount) {
+            add_job(ppJobs, pJobCount, pszNames[0], pszNames[1]);
+        }
+    }
+    fclose(fp);
+}
+
+// 入力ファイルをトークナイズし、プリプロセスしたトークン列を返す
+// pPchがNULLでなければ、プリコンパイル済みヘッダーを処理し終えた状態から始め、そのトークン列を先頭に繋げる
+static Token* preprocess_file(const char* pszInput, const PreprocessOptions* pPPOptions, const PchFile* pPch) {
+    Token* pToken = tokenize(pszInput);
+
+    TimeSpan span;
+    time_trace_begin(&span, "preprocess", pszInput, -1);
+    if (pPch == NULL) {
+        pToken = preprocess(pToken, pPPOptions, NULL);
+    }
+    else {
+        PreprocessState state;
+        load_pch_state(pPch, &state);
+        pToken = load_pch_tokens(pPch, preprocess(pToken, pPPOptions, &state));
+    }
+    time_trace_end(&span);
+    return pToken;
+}
+
+// キャッシュキーを求めるため、プリプロセス後のトークン列を文字列にする
+static void serialize_tokens(const Token* pToken, StrBuf* pOut) {
+    for (; pToken->kind != TK_EOF; pToken = pToken->next) {
+        strbuf_append(pOut, pToken->isLineHead ? "\n" : " ", 1);
+        strbuf_append(pOut, pToken->str, pToken->len);
+    }
+}
+
+// プリプロセス後のトークン列をアセンブリに変換する
+// pFuncCacheがNULLでなければ、関数本体の構文解析は変更があった関数だけ行う
+static void compile_to_asm(Token* pToken, StrBuf* pAsmText, int genThreadCount, FuncCodeCache* pFuncCache, const ProfileOptions* pProfile, bool isDebugInfo, bool isWholeProgram) {
+    TimeSpan span;
+    time_trace_begin(&span, "parse", NULL, 0);
+    StringLiteral* pStrLiterals = collect_string_literals(pToken);
+
+    // 構文木を作成する
+    Node* pNode = parse(pToken, pStrLiterals, pFuncCache != NULL);
+    time_trace_end(&span);
+
+    // 構文木からアセンブリを生成
+    gen(pNode, pStrLiterals, pAsmText, genThreadCount, pFuncCache, pProfile, isDebugInfo, isWholeProgram);
+}
+
+// 前回の関数ごとの結果を使い回してアセンブリに変換する（-incremental）
+// 関数本体の構文解析を後回しにするので、エラーがあると最初に解析した本体の分しか報告できない
+// その場合は報告を取り消して後回しにせずにコンパイルし直し、通常と同じ全てのエラーを同じ順番で報告する
+static void compile_to_asm_incremental(CompileJob* pJob, Token* pToken, FuncCodeCache* pFuncCache) {
+    jmp_buf* pOldJmpBuf;
+    StrBuf* pErrorOut;
+    get_error_handler(&pOldJmpBuf, &pErrorOut);
+    const size_t errorLen = pErrorOut->len;
+
+    jmp_buf jmpBuf;
+    if (setjmp(jmpBuf) == 0) {
+        set_error_handler(&jmpBuf, pErrorOut);
+        compile_to_asm(pToken, &pJob->asmText, pJob->genThreadCount, pFuncCache, pJob->pProfile, pJob->isDebugInfo, pJob->isWholeProgram);
+        set_error_handler(pOldJmpBuf, pErrorOut);
+        return;
+    }
+    set_error_handler(pOldJmpBuf, pErrorOut);
+
+    // 取り消した報告は、コンパイルし直して成功してしまったときのために残しておく
+    StrBuf errors = { 0 };
+    strbuf_append(&errors, pErrorOut->data + errorLen, pErrorOut->len - errorLen);
+    pErrorOut->len = errorLen;
+    if (pErrorOut->data) pErrorOut->data[errorLen] = '\0';
+    pJob->asmText.len = 0;
+
+    compile_to_asm(pToken, &pJob->asmText, pJob->genThreadCount, NULL, pJob->pProfile, pJob->isDebugInfo, pJob->isWholeProgram);
+    strbuf_append(pErrorOut, errors.data, errors.len);
+    strbuf_free(&errors);
+    abort_compile();
+}
+
+// -dump-astで出力した構文木のファイルを読み込み、構文解析をせずにアセンブリに変換する
+static void compile_ast_to_asm(const char* pszInput, StrBuf* pAsmText, int genThreadCount, const ProfileOptions* pProfile, bool isDebugInfo, bool isWholeProgram) {
+    TimeSpan span;
+    time_trace_begin(&span, "load_ast", pszInput, -1);
+    AstFile* pAst = open_ast(pszInput);
+    StringLiteral* pStrLiterals;
+    const Node* pNode = load_ast(pAst, &pStrLiterals);
+    time_trace_end(&span);
+    gen(pNode, pStrLiterals, pAsmText, genThreadCount, NULL, pProfile, isDebugInfo, isWholeProgram);
+    close_ast(pAst);
+}
+
+// プリプロセス後のトークン列を、トップレベルの宣言1つずつアセンブリに変換する（-stream）
+// -Sで出力ファイルがあれば、生成した分から順にファイルへ書き出し、メモリにはためない
+// それ以外はpJob->asmTextに追加する
+static void compile_to_asm_stream(CompileJob* pJob, Token* pToken) {
+    TimeSpan span;
+    time_trace_begin(&span, "parse", NULL, 0);
+    StringLiteral* pStrLiterals = collect_string_literals(pToken);
+    time_trace_end(&span);
+
+    if (pJob->isObjMode || pJob->pszOutput == NULL) {
+        gen_stream(pToken, pStrLiterals, &pJob->asmText, NULL, pJob->pProfile);
+        return;
+    }
+
+    FILE* fp = fopen(pJob->pszOutput, "w");
+    if (!fp) {
+        error("cannot open %s", pJob->pszOutput);
+    }
+
+    // 途中でエラーになったら、書きかけの出力ファイルを消してから中止する
+    jmp_buf* pOldJmpBuf;
+    StrBuf* pOldErrorOut;
+    get_error_handler(&pOldJmpBuf, &pOldErrorOut);
+    jmp_buf jmpBuf;
+    if (setjmp(jmpBuf) == 0) {
+        set_error_handler(&jmpBuf, pOldErrorOut);
+        gen_stream(pToken, pStrLiterals, &pJob->asmText, fp, pJob->pProfile);
+        set_error_handler(pOldJmpBuf, pOldErrorOut);
+        fclose(fp);
+    }
+    else {
+        set_error_handler(pOldJmpBuf, pOldErrorOut);
+        fclose(fp);
+        remove(pJob->pszOutput);
+        abort_compile();
+    }
+}
+
+// 出力ファイルに書き込む
+static void write_output_file(const char* pszOutput, const char* pData, size_t len, bool isBinary) {
+    FILE* fp = fopen(pszOutput, isBinary ? "wb" : "w");
+    if (!fp) {
+        error("cannot open %s", pszOutput);
+    }
+    fwrite(pData, 1, len, fp);
+    fclose(fp);
+}
+
+// 生成したアセンブリを出力する（-cなら再配置可能オブジェクトに変換して出力する）
+static void write_asm_output(CompileJob* pJob) {
+    TimeSpan span;
+    if (pJob->isObjMode) {
+        // アセンブラを介さず、直接ELFの再配置可能オブジェクトを出力
+        time_trace_begin(&span, "assemble", NULL, 0);
+        ObjFile* pObj = assemble(pJob->asmText.data);
+        time_trace_end(&span);
+
+        time_trace_begin(&span, "write_output", pJob->pszOutput, -1);
+        FILE* fp = fopen(pJob->pszOutput, "wb");
+        if (!fp) {
+            error("cannot open %s", pJob->pszOutput);
+        }
+        write_elf(pObj, fp);
+        fclose(fp);
+        free_obj(pObj);
+        time_trace_end(&span);
+        return;
+    }
+
+    if (pJob->pszOutput) {
+        time_trace_begin(&span, "write_output", pJob->pszOutput, -1);
+        write_output_file(pJob->pszOutput, pJob->asmText.data, pJob->asmText.len, false);
+        time_trace_end(&span);
+    }
+    // 出力先がなければ標準出力に出すので、全てのファイルを処理し終えるまで残しておく
+}
+
+// 1つのファイルをコンパイルして出力する
+static void compile_file(CompileJob* pJob) {
+    if (pJob->isDumpAstMode) {
+        Token* pToken = preprocess_file(pJob->pszInput, pJob->pPPOptions, pJob->pPch);
+        StringLiteral* pStrLiterals = collect_string_literals(pToken);
+        StrBuf ast = { 0 };
+        dump_ast(parse(pToken, pStrLiterals, false), pStrLiterals, &ast);
+        write_output_file(pJob->pszOutput, ast.data, ast.len, true);
+        strbuf_free(&ast);
+        return;
+    }
+
+    if (pJob->isAstInput) {
+        compile_ast_to_asm(pJob->pszInput, &pJob->asmText, pJob->genThreadCount, pJob->pProfile, pJob->isDebugInfo, pJob->isWholeProgram);
+        write_asm_output(pJob);
+        return;
+    }
+
+    Token* pToken = preprocess_file(pJob->pszInput, pJob->pPPOptions, pJob->pPch);
+
+    // 出力はプリプロセス後のソースコードとアセンブリ/オブジェクトの別、-fwhole-programの有無だけで決まる
+    char key[CACHE_KEY_LEN + 1];
+    const bool canCache = pJob->pCache != NULL;
+    if (canCache) {
+        StrBuf source = { 0 };
+        serialize_tokens(pToken, &source);
+        const char* pszVariant = pJob->isObjMode ? (pJob->isWholeProgram ? "-c -fwhole-program" : "-c") : (pJob->isWholeProgram ? "-S -fwhole-program" : "-S");
+        cache_make_key(pJob->pCache, source.data ? source.data : "", source.len, pszVariant, key);
+        strbuf_free(&source);
+    }
+
+    // 同じ入力を以前にコンパイルしていれば、その結果をそのまま出力する
+    StrBuf cached = { 0 };
+    if (canCache && cache_load(pJob->pCache, key, &cached)) {
+        if (pJob->pszOutput) {
+            write_output_file(pJob->pszOutput, cached.data, cached.len, pJob->isObjMode);
+            strbuf_free(&cached);
+        }
+        else {
+            pJob->asmText = cached;
+        }
+        return;
+    }
+
+    if (pJob->isStream) {
+        compile_to_asm_stream(pJob, pToken);
+        if (!pJob->isObjMode) return;
+    }
+    else if (pJob->isIncremental) {
+        // 関数ごとの前回の結果は出力ファイル（無ければ入力ファイル）の隣の状態ファイルに置く
+        StrBuf statePath = { 0 };
+        strbuf_printf(&statePath, "%s.fnstate", pJob->pszOutput ? pJob->pszOutput : pJob->pszInput);
+
+        FuncCodeCache funcCache;
+        load_func_code_cache(&funcCache, statePath.data);
+        compile_to_asm_incremental(pJob, pToken, &funcCache);
+        save_func_code_cache(&funcCache, statePath.data);
+
+        free_func_code_cache(&funcCache);
+        strbuf_free(&statePath);
+    }
+    else {
+        compile_to_asm(pToken, &pJob->asmText, pJob->genThreadCount, NULL, pJob->pProfile, pJob->isDebugInfo, pJob->isWholeProgram);
+    }
+
+    write_asm_output(pJob);
+
+    if (canCache && pJob->isObjMode) {
+        if (read_binary_file(pJob->pszOutput, &cached)) {
+            cache_store(pJob->pCache, key, cached.data, cached.len);
+            pJob->isCacheStored = true;
+            strbuf_free(&cached);
+        }
+    }
+    else if (canCache) {
+        cache_store(pJob->pCache, key, pJob->asmText.data, pJob->asmText.len);
+        pJob->isCacheStored = true;
+    }
+}
+
+// ワーカースレッドで1つのファイルをコンパイルする
+// エラーはファイルごとに記録し、他のファイルのコンパイルは続ける
+static void compile_job(void* pContext, int index) {
+    CompileJob* pJob = (CompileJob*)pContext + index;
+
+    // 呼び出し元のスレッドもワーカーになるので、エラーの報告先は元に戻す
+    jmp_buf* pOldJmpBuf;
+    StrBuf* pOldErrorOut;
+    get_error_handler(&pOldJmpBuf, &pOldErrorOut);
+    const ArenaMark mark = arena_mark();
+
+    TimeSpan span;
+    time_trace_begin(&span, "file", pJob->pszInput, -1);
+
+    jmp_buf jmpBuf;
+    if (setjmp(jmpBuf) == 0) {
+        set_error_handler(&jmpBuf, &pJob->errors);
+        compile_file(pJob);
+    }
+    else {
+        pJob->isFailed = true;
+    }
+    set_error_handler(pOldJmpBuf, pOldErrorOut);
+    time_trace_end(&span);
+
+    // このファイルのために確保したトークンや構文木をまとめて解放する
+    if (pJob->pszOutput) {
+        strbuf_free(&pJob->asmText);
+    }
+    arena_release_to(mark);
+}
+
+// -ftime-reportと-ftime-traceで指定された計測結果を出力し、計測を終える
+static void finish_time_trace(bool isTimeReportMode, const char* pszTimeTrace, StrBuf* pErr) {
+    if (isTimeReportMode) {
+        time_trace_report(pErr);
+    }
+    const bool isWritten = pszTimeTrace == NULL || time_trace_write_json(pszTimeTrace);
+    time_trace_stop();
+    if (!isWritten) {
+        error("cannot open %s", pszTimeTrace);
+    }
+}
+
+// コンパイラのドライバ
+// 標準出力に出すアセンブリをpOutに、コンパイルエラーをpErrに書き込み、終了コードを返す
+// コマンドラインの誤りはerrorで報告する
+static int compile_main(int argc, char** argv, StrBuf* pOut, StrBuf* pErr, bool isServer) {
+    CompileJob* pJobs = NULL;
+    int jobCount = 0;
+    const char* pszOutput = NULL;
+    bool isObjMode = false;
+    bool isRunMode = false;
+    bool hasManifest = false;
+    bool isCacheStatsMode = false;
+    bool isIncremental = false;
+    bool isEmitPchMode = false;
+    bool isDumpAstMode = false;
+    bool isLoadAstMode = false;
+    bool isTimeReportMode = false;
+    bool isDebugInfo = false;
+    bool isStream = false;
+    bool isWholeProgram = false;
+    const char* pszTimeTrace = NULL;
+    const char* pszIncludePch = NULL;
+    const char* pszProfileUse = NULL;
+    ProfileOptions profile = { 0 };
+    const char* pszCacheDir = getenv("CHIBICC_CACHE_DIR");
+    uint64_t cacheMaxSize = DEFAULT_CACHE_MAX_MB * 1024 * 1024;
+    int threadCount = 0;
+    int programArgIndex = argc;
+    PreprocessOptions ppOptions = { 0 };
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-c") == 0) {
+            isObjMode = true;
+        }
+        else if (strcmp(argv[i], "-run") == 0) {
+            isRunMode = true;
+        }
+        else if (strcmp(argv[i], "-o") == 0) {
+            if (argc <= ++i) {
+                error("-oには出力ファイル名が必要です");
+            }
+            pszOutput = argv[i];
+        }
+        else if (strcmp(argv[i], "-j") == 0) {
+            if (argc <= ++i || (threadCount = atoi(argv[i])) <= 0) {
+                error("-jには1以上のスレッド数が必要です");
+            }
+        }
+        else if (strcmp(argv[i], "-manifest") == 0) {
+            if (argc <= ++i) {
+                error("-manifestにはファイル名が必要です");
+            }
+            read_manifest(argv[i], &pJobs, &jobCount);
+            hasManifest = true;
+        }
+        else if (strcmp(argv[i], "-cache-dir") == 0) {
+            if (argc <= ++i) {
+                error("-cache-dirにはディレクトリ名が必要です");
+            }
+            pszCacheDir = argv[i];
+        }
+        else if (strcmp(argv[i], "-cache-max-size") == 0) {
+            const long long sizeMB = (++i < argc) ? atoll(argv[i]) : 0;
+            if (sizeMB <= 0) {
+                error("-cache-max-sizeには1以上の大きさ（MB単位）が必要です");
+            }
+            cacheMaxSize = (uint64_t)sizeMB * 1024 * 1024;
+        }
+        else if (strcmp(argv[i], "-cache-stats") == 0) {
+            isCacheStatsMode = true;
+        }
+        else if (strcmp(argv[i], "-incremental") == 0) {
+            isIncremental = true;
+        }
+        else if (strcmp(argv[i], "-emit-pch") == 0) {
+            isEmitPchMode = true;
+        }
+        else if (strcmp(argv[i], "-dump-ast") == 0) {
+            isDumpAstMode = true;
+        }
+        else if (strcmp(argv[i], "-load-ast") == 0) {
+            isLoadAstMode = true;
+        }
+        else if (strcmp(argv[i], "-stream") == 0) {
+            isStream = true;
+        }
+        else if (strcmp(argv[i], "-g") == 0) {
+            isDebugInfo = true;
+        }
+        else if (strcmp(argv[i], "-fwhole-program") == 0) {
+            isWholeProgram = true;
+        }
+        else if (strcmp(argv[i], "-ftime-report") == 0) {
+            isTimeReportMode = true;
+        }
+        else if (strncmp(argv[i], "-ftime-trace=", 13) == 0) {
+            pszTimeTrace = argv[i] + 13;
+            if (*pszTimeTrace == '\0') {
+                error("-ftime-traceには出力ファイル名が必要です");
+            }
+        }
+        else if (strcmp(argv[i], "-fprofile-generate") == 0 || strncmp(argv[i], "-fprofile-generate=", 19) == 0) {
+            // 計測結果はプログラムを実行したときのカレントディレクトリからの相対パスに書き出す
+            profile.pszGenerateFile = argv[i][18] ? argv[i] + 19 : DEFAULT_PROFILE_FILE;
+            if (*profile.pszGenerateFile == '\0') {
+                error("-fprofile-generate=には出力ファイル名が必要です");
+            }
+        }
+        else if (strcmp(argv[i], "-fprofile-use") == 0 || strncmp(argv[i], "-fprofile-use=", 14) == 0) {
+            pszProfileUse = argv[i][13] ? argv[i] + 14 : DEFAULT_PROFILE_FILE;
+            if (*pszProfileUse == '\0') {
+                error("-fprofile-use=にはプロファイルのファイル名が必要です");
+            }
+        }
+        else if (strcmp(argv[i], "-include-pch") == 0) {
+            if (argc <= ++i) {
+                error("-include-pchにはファイル名が必要です");
+            }
+            pszIncludePch = argv[i];
+        }
+        else if (strncmp(argv[i], "-I", 2) == 0 || strncmp(argv[i], "-D", 2) == 0) {
+            // "-I dir"と"-Idir"のどちらの形式も受け付ける
+            const bool isInclude = argv[i][1] == 'I';
+            const char* pszValue = argv[i][2] ? argv[i] + 2 : (++i < argc ? argv[i] : NULL);
+            if (pszValue == NULL) {
+                error(isInclude ? "-Iにはディレクトリ名が必要です" : "-Dにはマクロ名が必要です");
+            }
+            if (isInclude) {
+                add_string(&ppOptions.ppIncludeDirs, &ppOptions.includeDirCount, pszValue);
+            }
+            else {
+                add_string(&ppOptions.ppDefines, &ppOptions.defineCount, pszValue);
+            }
+        }
+        else if (argv[i][0] == '-') {
+            error("不明なオプションです: %s", argv[i]);
+        }
+        else {
+            add_job(&pJobs, &jobCount, argv[i], NULL);
+
+            // -runでは入力ファイル以降の引数を実行するプログラムに渡す
+            if (isRunMode) {
+                programArgIndex = i;
+                break;
+            }
+        }
+    }
+
+    // 環境変数CHIBICC_CACHE_DIRか-cache-dirが指定されていれば、コンパイル結果をキャッシュする
+    CompileCache cache = { 0 };
+    const bool useCache = pszCacheDir && *pszCacheDir;
+    if (useCache) {
+        cache_open(&cache, pszCacheDir, cacheMaxSize);
+    }
+
+    if (isCacheStatsMode) {
+        if (!useCache) {
+            error("-cache-statsにはキャッシュディレクトリの指定が必要です");
+        }
+        cache_print_stats(&cache, pOut);
+        return 0;
+    }
+
+    if (jobCount == 0) {
         error("引数の個数が正しくありません");
         return 1;
     }
 
-    StringLiteral* pStrLiterals = NULL;
+    if (threadCount == 0) {
+        threadCount = get_processor_count();
+    }
 
-    // トークナイズする
-    Token* pToken = tokenize(argv[1], &pStrLiterals);
+    if (s_pHeaderCache == NULL) {
+        s_pHeaderCache = create_header_cache();
+    }
+    init_source_files();
+    ppOptions.pHeaderCache = s_pHeaderCache;
 
-    // 構文木を作成する
-    Node* pNode = parse(pToken, pStrLiterals);
+    if (isEmitPchMode) {
+        if (hasManifest || 1 < jobCount || isRunMode || isObjMode || pszIncludePch) {
+            error("-emit-pchには1つのヘッダーファイルだけを指定してください");
+        }
+
+        // 出力先の既定はヘッダーファイル名に".pch"を付けたもの
+        StrBuf pchPath = { 0 };
+        strbuf_printf(&pchPath, "%s.pch", pJobs[0].pszInput);
+        StrBuf pch = { 0 };
+        build_pch(pJobs[0].pszInput, &ppOptions, &pch);
+        write_output_file(pszOutput ? pszOutput : pchPath.data, pch.data, pch.len, true);
 
-    // 構文木からアセンブリを出力
-    gen(pNode, pStrLiterals);
+        strbuf_free(&pch);
+        strbuf_free(&pchPath);
+        free(pJobs);
+        free(ppOptions.ppIncludeDirs);
+        free(ppOptions.ppDefines);
+        return 0;
+    }
+
+    if (isDumpAstMode && (isObjMode || isRunMode || isIncremental || isLoadAstMode)) {
+        error("-dump-astは-c、-run、-incremental、-load-astと同時に指定できません");
+    }
+    if (isIncremental && (profile.pszGenerateFile || pszProfileUse)) {
+        error("-incrementalは-fprofile-generate、-fprofile-useと同時に指定できません");
+    }
+    if (isIncremental && isDebugInfo) {
+        // 前回の生成結果を使い回すと、関数の位置がずれたときに行番号が古いままになる
+        error("-incrementalは-gと同時に指定できません");
+    }
+    if (isStream && (isIncremental || isDumpAstMode || isLoadAstMode || isDebugInfo || profile.pszGenerateFile || isWholeProgram)) {
+        // 関数を1つずつ生成して捨てるので、ファイル全体の構文木や関数の一覧を必要とする機能とは併用できない
+        error("-streamは-incremental、-dump-ast、-load-ast、-g、-fprofile-generate、-fwhole-programと同時に指定できません");
+    }
+    if (isLoadAstMode && (isIncremental || pszIncludePch || ppOptions.includeDirCount || ppOptions.defineCount)) {
+        error("-load-astでは構文解析をしないので、-incremental、-include-pch、-I、-Dは指定できません");
+    }
+
+    // 計測していなければ、各段階での計測の処理はフラグを見るだけで何もしない
+    const bool isTimeTraceMode = isTimeReportMode || pszTimeTrace;
+    if (isTimeTraceMode) {
+        time_trace_start();
+    }
+
+    // プロファイルは全ての入力ファイルで共有する
+    ProfileData* pProfileData = NULL;
+    if (pszProfileUse) {
+        pProfileData = load_profile(pszProfileUse);
+        profile.pUseData = pProfileData;
+    }
+
+    // プリコンパイル済みヘッダーは全ての入力ファイルで共有する
+    TimeSpan span;
+    PchFile* pPch = NULL;
+    if (pszIncludePch) {
+        time_trace_begin(&span, "load_pch", pszIncludePch, -1);
+        pPch = open_pch(pszIncludePch, &ppOptions);
+        time_trace_end(&span);
+    }
+
+    if (isRunMode) {
+        if (isServer) {
+            error("コンパイルサーバーでは-runは使えません");
+        }
+        if (hasManifest || 1 < jobCount) {
+            error("-runで実行できるファイルは1つだけです");
+        }
+
+        // ファイルを介さず、メモリ上で機械語に変換してそのまま実行する
+        StrBuf asmText = { 0 };
+        if (isLoadAstMode) {
+            compile_ast_to_asm(pJobs[0].pszInput, &asmText, threadCount, &profile, isDebugInfo, isWholeProgram);
+        }
+        else if (isStream) {
+            Token* pToken = preprocess_file(pJobs[0].pszInput, &ppOptions, pPch);
+            gen_stream(pToken, collect_string_literals(pToken), &asmText, NULL, &profile);
+        }
+        else {
+            compile_to_asm(preprocess_file(pJobs[0].pszInput, &ppOptions, pPch), &asmText, threadCount, NULL, &profile, isDebugInfo, isWholeProgram);
+        }
+        if (pPch) close_pch(pPch);
+        if (pProfileData) free_profile(pProfileData);
+        time_trace_begin(&span, "assemble", NULL, 0);
+        ObjFile* pObj = assemble(asmText.data);
+        time_trace_end(&span);
+
+        // プログラムの実行時間は計測に含めない
+        if (isTimeTraceMode) {
+            finish_time_trace(isTimeReportMode, pszTimeTrace, pErr);
+        }
+        return jit_run(pObj, argc - programArgIndex, argv + programArgIndex);
+    }
+
+    if (pszOutput && 1 < jobCount) {
+        error("複数の入力ファイルに-oは指定できません");
+    }
+
+    // 出力先を決める
+    // 入力ファイルが1つでアセンブリを出力する場合に限り、既定の出力先は標準出力とする
+    for (int i = 0; i < jobCount; ++i) {
+        CompileJob* pJob = &pJobs[i];
+        pJob->isObjMode = isObjMode;
+        pJob->isDumpAstMode = isDumpAstMode;
+        pJob->isAstInput = isLoadAstMode;
+        pJob->pPPOptions = &ppOptions;
+        pJob->pPch = pPch;
+
+        // 構文木の入出力はプリプロセス後のソースコードをキーにできないので、キャッシュしない
+        // プロファイルを使う場合も、出力がプロファイルの内容で変わるのでキャッシュしない
+        // -gの場合は、出力が行番号やファイル名で変わるのでキャッシュしない
+        const bool isProfiling = profile.pszGenerateFile || pszProfileUse;
+        // -streamの場合は、キャッシュキーを求めるためにトークン列全体を文字列にしたくないのでキャッシュしない
+        pJob->pCache = (useCache && !isDumpAstMode && !isLoadAstMode && !isProfiling && !isDebugInfo && !isStream) ? &cache : NULL;
+        pJob->isIncremental = isIncremental;
+        pJob->pProfile = &profile;
+        pJob->isDebugInfo = isDebugInfo;
+        pJob->isStream = isStream;
+        pJob->isWholeProgram = isWholeProgram;
+
+        // 複数のファイルはファイル単位で並列にコンパイルするので、ファイル内では並列にしない
+        pJob->genThreadCount = (jobCount == 1) ? threadCount : 1;
+        if (pJob->pszOutput) continue;
+
+        if (pszOutput) {
+            pJob->pszOutput = pszOutput;
+        }
+        else if (isDumpAstMode) {
+            pJob->pszOutput = default_output_filename(pJob->pszInput, ".ast");
+        }
+        else if (isObjMode) {
+            pJob->pszOutput = default_output_filename(pJob->pszInput, ".o");
+        }
+        else if (1 < jobCount || hasManifest) {
+            pJob->pszOutput = default_output_filename(pJob->pszInput, ".s");
+        }
+    }
+
+    // 複数のファイルはワーカースレッドで並列にコンパイルする
+    run_jobs(compile_job, pJobs, jobCount, threadCount);
+
+    // 新しく保存した分で上限を超えていれば、古いキャッシュを削除する
+    int storedCount = 0;
+    for (int i = 0; i < jobCount; ++i) {
+        if (pJobs[i].isCacheStored) ++storedCount;
+    }
+    if (storedCount) {
+        cache_evict(&cache);
+    }
+
+    // 出力とエラーは入力ファイルの順に報告する
+    int failedCount = 0;
+    for (int i = 0; i < jobCount; ++i) {
+        if (pJobs[i].pszOutput == NULL && !pJobs[i].isFailed) {
+            strbuf_append(pOut, pJobs[i].asmText.data, pJobs[i].asmText.len);
+        }
+        if (pJobs[i].errors.len) {
+            strbuf_append(pErr, pJobs[i].errors.data, pJobs[i].errors.len);
+        }
+        if (pJobs[i].isFailed) {
+            ++failedCount;
+        }
+        strbuf_free(&pJobs[i].asmText);
+        strbuf_free(&pJobs[i].errors);
+    }
+    if (1 < jobCount && failedCount) {
+        strbuf_printf(pErr, "%d個中%d個のファイルのコンパイルに失敗しました\n", jobCount, failedCount);
+    }
+    if (isTimeTraceMode) {
+        finish_time_trace(isTimeReportMode, pszTimeTrace, pErr);
+    }
+
+    if (pPch) {
+        close_pch(pPch);
+    }
+    if (pProfileData) {
+        free_profile(pProfileData);
+    }
+    free(pJobs);
+    free(cache.pszDir);
+    free(ppOptions.ppIncludeDirs);
+    free(ppOptions.ppDefines);
+    return failedCount ? 1 : 0;
+}
+
+// コンパイルサーバーで1つの要求を処理する
+// コマンドラインの誤りなどでエラーになってもサーバーは終了させない
+static int serve_compile_request(int argc, char** argv, StrBuf* pOut, StrBuf* pErr) {
+    int exitCode;
+    jmp_buf jmpBuf;
+    if (setjmp(jmpBuf) == 0) {
+        set_error_handler(&jmpBuf, pErr);
+        exitCode = compile_main(argc, argv, pOut, pErr, true);
+    }
+    else {
+        exitCode = 1;
+    }
+    set_error_handler(NULL, NULL);
+
+    // 要求ごとに登録したソースの位置を次の要求で使い回す（ヘッダーキャッシュのソースは残る）
+    release_source_files();
+    return exitCode;
+}
+
+int main(int argc, char** argv) {
+    // --server <ソケットのパス>: コンパイルサーバーとして常駐する
+    if (2 <= argc && strcmp(argv[1], "--server") == 0) {
+        if (argc != 3) {
+            error("--serverにはソケットのパスが必要です");
+        }
+        return run_server(argv[2], serve_compile_request);
+    }
+
+    // 環境変数CHIBICC_SERVERにソケットのパスがあれば、コンパイルをサーバーに任せる
+    // -runはこのプロセスで実行する必要があるので対象外とし、サーバーに接続できなければ自分でコンパイルする
+    const char* pszServer = getenv("CHIBICC_SERVER");
+    bool canUseServer = pszServer && *pszServer;
+    for (int i = 1; canUseServer && i < argc; ++i) {
+        if (strcmp(argv[i], "-run") == 0) canUseServer = false;
+    }
+    int exitCode;
+    if (canUseServer && request_compile(pszServer, argc, argv, &exitCode)) {
+        return exitCode;
+    }
 
-    return 0;
+    StrBuf out = { 0 };
+    StrBuf err = { 0 };
+    exitCode = compile_main(argc, argv, &out, &err, false);
+    if (out.len) fputs(out.data, stdout);
+    if (err.len) fputs(err.data, stderr);
+    return exitCode;
 }
@@ -8,6 +8,16 @@
 #include "lexer.h"
 #include "parser.h"
 #include "error.h"
+#include "arena.h"
+#include "thread.h"
+
+// \G[痧ĉ͂𑱂ꍇɁA񍐂G[̐̏
+#define MAX_ERROR_COUNT (20)
+
+static THREAD_LOCAL int s_errorCount;   // ݂̍\͂ŕ񍐂G[̐
+static THREAD_LOCAL bool s_isGivingUp;  // ̂߂Ē~ƂȂtrueiOłȂj
+static THREAD_LOCAL int s_breakableDepth; // ͒͂̕ރ[vswitch̐ibreak邩j
+static THREAD_LOCAL int s_switchDepth;  // ͒͂̕switch̐icasedefault邩j
 
 static Node* primary(Token** ppToken);
 static Node* postfix(Token** ppToken);
@@ -16,21 +26,27 @@ static Node* mul(Token** ppToken);
 static Node* add(Token** ppToken);
 static Node* relational(Token** ppToken);
 static Node* equality(Token** ppToken);
+static Node* logand(Token** ppToken);
+static Node* logor(Token** ppToken);
 static Node* assign(Token** ppToken);
 static Node* expr(Token** ppToken);
-static Node* if_stmt(Token** ppToken);
-static Node* while_stmt(Token** ppToken);
-static Node* for_stmt(Token** ppToken);
+static Node* if_stmt(Token** ppToken, const Token* pIfToken);
+static Node* while_stmt(Token** ppToken, const Token* pWhileToken);
+static Node* for_stmt(Token** ppToken, const Token* pForToken);
+static Node* switch_stmt(Token** ppToken, const Token* pSwitchToken);
+static Node* loop_body(Token** ppToken);
 static Node* compound_stmt(Token** ppToken);
 static Node* stmt(Token** ppToken);
+static Node* stmt_or_recover(Token** ppToken);
 static Node* decl_var(Token** ppToken, Node* pTypeNode, const Token* pVarNameToken);
-static Node* def_func(Token** ppToken, Node* pTypeNode, const Token* pFuncNameToken);
-static Node* def_func_or_var(Token** ppToken);
+static Node* def_func(Token** ppToken, Node* pTypeNode, const Token* pFuncNameToken, bool isBodyDeferred);
+static Node* def_func_or_var(Token** ppToken, bool isBodyDeferred);
 static Node* type(Token** ppToken);
-static Node* program(Token** ppToken);
+static Node* program(Token** ppToken, bool isBodyDeferred);
+static Node* top_level_or_recover(Token** ppToken, bool isBodyDeferred);
 
 static Node* new_node(const Token* pToken, NodeKind kind, Node* lhs, Node* rhs) {
-    Node* node = calloc(1, sizeof(Node));
+    Node* node = arena_calloc(1, sizeof(Node));
     node->kind = kind;
     node->lhs = lhs;
     node->rhs = rhs;
@@ -39,10 +55,10 @@ static Node* new_node(const Token* pToken, NodeKind kind, Node* lhs, Node* rhs)
 }
 
 static Node* new_node_num(int val) {
-    Token* tok = calloc(1, sizeof(Token));
+    Token* tok = arena_calloc(1, sizeof(Token));
     tok->val = val;
 
-    Node* node = calloc(1, sizeof(Node));
+    Node* node = arena_calloc(1, sizeof(Node));
     node->kind = ND_NUM;
     node->pToken = tok;
     return node;
@@ -59,7 +75,7 @@ static Node* primary(Token** ppToken) {
     // ̃g[NʎqȂVARm[h𐶐
     const Token* pIdentToken = consume_ident(ppToken);
     if (pIdentToken) {
-        Node* node = calloc(1, sizeof(Node));
+        Node* node = arena_calloc(1, sizeof(Node));
         node->kind = ND_VAR;
         node->pToken = pIdentToken;
         return node;
@@ -85,7 +101,7 @@ static Node* postfix(Token** ppToken) {
         if (consume(ppToken, "(")) {
             //NOTE:AړIȊ֐Ăяoɂ̂ݑΉĂ
             if (pNode->kind != ND_VAR) {
-                error_at(pNode->pToken->filename, pNode->pToken->user_input, pNode->pToken->str, "Ή̊֐Ăяo`ł");
+                error_at(pNode->pToken->loc, "Ή̊֐Ăяo`ł");
             }
 
             Node* pInvokeNode = new_node(pNode->pToken, ND_INVOKE, NULL, NULL);
@@ -93,7 +109,7 @@ static Node* postfix(Token** ppToken) {
             int argCount = 0;
             while (!consume(ppToken, ")")) {
                 if (maxParam <= argCount) {
-                    error_at((*ppToken)->filename, (*ppToken)->user_input, (*ppToken)->str, "̐%dȏ゠֐Ăяo͔Ήł", maxParam);
+                    error_at((*ppToken)->loc, "̐%dȏ゠֐Ăяo͔Ήł", maxParam);
                 }
                 if (0 < argCount) {
                     expect(ppToken, ",");
@@ -108,6 +124,12 @@ static Node* postfix(Token** ppToken) {
             pNode = new_node(pCurToken, ND_DEREF, pNode, NULL);
             expect(ppToken, "]");
         }
+        else if (consume(ppToken, "++")) {
+            pNode = new_node(pCurToken, ND_POST_INC, pNode, NULL);
+        }
+        else if (consume(ppToken, "--")) {
+            pNode = new_node(pCurToken, ND_POST_DEC, pNode, NULL);
+        }
         else {
             break;
         }
@@ -119,6 +141,10 @@ static Node* postfix(Token** ppToken) {
 static Node* unary(Token** ppToken) {
     const Token* pCurToken = *ppToken;
 
+    if (consume(ppToken, "++"))
+        return new_node(pCurToken, ND_ADD_ASSIGN, unary(ppToken), new_node_num(1));
+    if (consume(ppToken, "--"))
+        return new_node(pCurToken, ND_SUB_ASSIGN, unary(ppToken), new_node_num(1));
     if (consume(ppToken, "+"))
         return unary(ppToken);
     if (consume(ppToken, "-"))
@@ -127,6 +153,8 @@ static Node* unary(Token** ppToken) {
         return new_node(pCurToken, ND_ADDR, unary(ppToken), NULL);
     if (consume(ppToken, "*"))
         return new_node(pCurToken, ND_DEREF, unary(ppToken), NULL);
+    if (consume(ppToken, "!"))
+        return new_node(pCurToken, ND_NOT, unary(ppToken), NULL);
     if (consume_reserved_word(ppToken, TK_SIZEOF))
         return new_node(pCurToken, ND_SIZEOF, unary(ppToken), NULL);
     return postfix(ppToken);
@@ -196,12 +224,46 @@ static Node* equality(Token** ppToken) {
     }
 }
 
-static Node* assign(Token** ppToken) {
+static Node* logand(Token** ppToken) {
     Node* node = equality(ppToken);
 
+    for (;;) {
+        const Token* pCurToken = *ppToken;
+
+        if (consume(ppToken, "&&"))
+            node = new_node(pCurToken, ND_LOGAND, node, equality(ppToken));
+        else
+            return node;
+    }
+}
+
+static Node* logor(Token** ppToken) {
+    Node* node = logand(ppToken);
+
+    for (;;) {
+        const Token* pCurToken = *ppToken;
+
+        if (consume(ppToken, "||"))
+            node = new_node(pCurToken, ND_LOGOR, node, logand(ppToken));
+        else
+            return node;
+    }
+}
+
+static Node* assign(Token** ppToken) {
+    Node* node = logor(ppToken);
+
     const Token* pCurToken = *ppToken;
     if (consume(ppToken, "="))
         return new_node(pCurToken, ND_ASSIGN, node, assign(ppToken));
+    else if (consume(ppToken, "+="))
+        return new_node(pCurToken, ND_ADD_ASSIGN, node, assign(ppToken));
+    else if (consume(ppToken, "-="))
+        return new_node(pCurToken, ND_SUB_ASSIGN, node, assign(ppToken));
+    else if (consume(ppToken, "*="))
+        return new_node(pCurToken, ND_MUL_ASSIGN, node, assign(ppToken));
+    else if (consume(ppToken, "/="))
+        return new_node(pCurToken, ND_DIV_ASSIGN, node, assign(ppToken));
     else
         return node;
 }
@@ -210,13 +272,12 @@ static Node* expr(Token** ppToken) {
     return assign(ppToken);
 }
 
-static Node* if_stmt(Token** ppToken)
+static Node* if_stmt(Token** ppToken, const Token* pIfToken)
 {
     Node* pIfNode = NULL;
     Node* pConditionExpr = NULL;
     Node* pIfBranchStmt = NULL;
     Node* pElseBranchStmt = NULL;
-    const Token* pIfToken = *(ppToken - 1);
 
     expect(ppToken, "(");
     pConditionExpr = expr(ppToken);
@@ -233,25 +294,23 @@ static Node* if_stmt(Token** ppToken)
     return pIfNode;
 }
 
-static Node* while_stmt(Token** ppToken)
+static Node* while_stmt(Token** ppToken, const Token* pWhileToken)
 {
     Node* pConditionExpr = NULL;
-    const Token* pWhileToken = *(ppToken - 1);
 
     expect(ppToken, "(");
     pConditionExpr = expr(ppToken);
     expect(ppToken, ")");
 
-    return new_node(pWhileToken, ND_WHILE, pConditionExpr, stmt(ppToken));
+    return new_node(pWhileToken, ND_WHILE, pConditionExpr, loop_body(ppToken));
 }
 
-static Node* for_stmt(Token** ppToken)
+static Node* for_stmt(Token** ppToken, const Token* pForToken)
 {
     Node* pForExpr = NULL;
     Node* pInitExpr = NULL;
     Node* pCondExpr = NULL;
     Node* pLoopExpr = NULL;
-    const Token* pForToken = *(ppToken - 1);
 
     expect(ppToken, "(");
     if (!consume(ppToken, ";")) {
@@ -267,19 +326,46 @@ static Node* for_stmt(Token** ppToken)
         expect(ppToken, ")");
     }
 
-    pForExpr = new_node(pForToken, ND_FOR, NULL, stmt(ppToken));
+    pForExpr = new_node(pForToken, ND_FOR, NULL, loop_body(ppToken));
     pForExpr->children[0] = pInitExpr;
     pForExpr->children[1] = pCondExpr;
     pForExpr->children[2] = pLoopExpr;
     return pForExpr;
 }
 
+// [vΏۂ͂̕iłbreakj
+static Node* loop_body(Token** ppToken) {
+    ++s_breakableDepth;
+    Node* pBodyStmt = stmt(ppToken);
+    --s_breakableDepth;
+    return pBodyStmt;
+}
+
+// switch͂
+// casedefault̃x́A{̂̂̕ǂɏĂĂiqswitch̒jswitcĥ̂ɂȂ
+static Node* switch_stmt(Token** ppToken, const Token* pSwitchToken)
+{
+    expect(ppToken, "(");
+    Node* pConditionExpr = expr(ppToken);
+    expect(ppToken, ")");
+
+    ++s_breakableDepth;
+    ++s_switchDepth;
+    Node* pBodyStmt = stmt(ppToken);
+    --s_switchDepth;
+    --s_breakableDepth;
+
+    return new_node(pSwitchToken, ND_SWITCH, pConditionExpr, pBodyStmt);
+}
+
 static Node* compound_stmt(Token** ppToken) {
     Node* pRoot = NULL;
     Node* pCur = NULL;
 
     while (!consume(ppToken, "}")) {
-        Node* pNode = new_node(NULL, ND_BLOCK, stmt(ppToken), NULL);
+        Node* pStmtNode = stmt_or_recover(ppToken);
+        if (pStmtNode == NULL) continue;
+        Node* pNode = new_node(NULL, ND_BLOCK, pStmtNode, NULL);
 
         if (pRoot == NULL) {
             pRoot = pNode;
@@ -299,22 +385,52 @@ static Node* compound_stmt(Token** ppToken) {
 
 static Node* stmt(Token** ppToken) {
     Node* node = NULL;
+    const Token* pStmtToken = *ppToken;
 
     if (consume_reserved_word(ppToken, TK_RETURN)) {
-        node = calloc(1, sizeof(Node));
+        node = arena_calloc(1, sizeof(Node));
         node->kind = ND_RETURN;
         node->lhs = expr(ppToken);
 
         expect(ppToken, ";");
     }
     else if (consume_reserved_word(ppToken, TK_IF)) {
-        node = if_stmt(ppToken);
+        node = if_stmt(ppToken, pStmtToken);
     }
     else if (consume_reserved_word(ppToken, TK_WHILE)) {
-        node = while_stmt(ppToken);
+        node = while_stmt(ppToken, pStmtToken);
     }
     else if (consume_reserved_word(ppToken, TK_FOR)) {
-        node = for_stmt(ppToken);
+        node = for_stmt(ppToken, pStmtToken);
+    }
+    else if (consume_reserved_word(ppToken, TK_SWITCH)) {
+        node = switch_stmt(ppToken, pStmtToken);
+    }
+    else if (consume_reserved_word(ppToken, TK_CASE)) {
+        if (s_switchDepth == 0) {
+            error_at(pStmtToken->loc, "switch̊Ocasex܂");
+        }
+        const bool isNegative = consume(ppToken, "-");
+        const int val = expect_number(ppToken);
+        expect(ppToken, ":");
+
+        // case̒l͕̑OɒuxȂ̂ŁAlhsɎ
+        node = new_node(pStmtToken, ND_CASE, stmt(ppToken), NULL);
+        node->children[0] = new_node_num(isNegative ? -val : val);
+    }
+    else if (consume_reserved_word(ppToken, TK_DEFAULT)) {
+        if (s_switchDepth == 0) {
+            error_at(pStmtToken->loc, "switch̊Odefaultx܂");
+        }
+        expect(ppToken, ":");
+        node = new_node(pStmtToken, ND_DEFAULT, stmt(ppToken), NULL);
+    }
+    else if (consume_reserved_word(ppToken, TK_BREAK)) {
+        if (s_breakableDepth == 0) {
+            error_at(pStmtToken->loc, "[vswitch̊Ołbreakg܂");
+        }
+        node = new_node(pStmtToken, ND_BREAK, NULL, NULL);
+        expect(ppToken, ";");
     }
     else if (consume(ppToken, "{")) {
         node = compound_stmt(ppToken);
@@ -327,7 +443,7 @@ static Node* stmt(Token** ppToken) {
         else {
             const Token* pVarNameToken = consume_ident(ppToken);
             if (pVarNameToken == NULL) {
-                error_at((*ppToken)->filename, (*ppToken)->user_input, (*ppToken)->str, "ϐKvł");
+                error_at((*ppToken)->loc, "ϐKvł");
             }
             node = decl_var(ppToken, pTypeNode, pVarNameToken);
         }
@@ -338,6 +454,79 @@ static Node* stmt(Token** ppToken) {
     return node;
 }
 
+// G[̌A錾̋؂܂Ńg[Nǂݔ΂
+// ';'̎Aǂݔ΂rŊJ'{'ɑΉ'}'̎܂Ői
+// Ή'{'̖'}'̎OƁAEOFł͎~܂
+static void skip_to_sync_point(Token** ppToken) {
+    int depth = 0;
+    while (!at_eof(*ppToken)) {
+        Token* pToken = *ppToken;
+        if (pToken->kind != TK_RESERVED || pToken->len != 1) {
+            *ppToken = pToken->next;
+            continue;
+        }
+
+        const char c = pToken->str[0];
+        if (c == '}' && depth == 0) return;
+        *ppToken = pToken->next;
+        if (c == '{') {
+            ++depth;
+        }
+        else if ((c == '}' && --depth == 0) || (c == ';' && depth == 0)) {
+            return;
+        }
+    }
+}
+
+// 񍐂G[𐔂iƂ̓RpC𒆎~j
+static void count_error(void) {
+    if (s_isGivingUp) {
+        abort_compile();
+    }
+    if (MAX_ERROR_COUNT <= ++s_errorCount) {
+        s_isGivingUp = true;
+        error("G[܂");
+    }
+}
+
+// G[񍐂ɌĂсA͂ł悤ɋ؂܂œǂݔ΂
+// ǂރg[NƂ́ARpC𒆎~
+static void recover_from_error(Token** ppToken) {
+    count_error();
+    if (at_eof(*ppToken)) {
+        s_isGivingUp = true;
+        abort_compile();
+    }
+    skip_to_sync_point(ppToken);
+}
+
+// 1͂
+// G[񍐂玟͂̕𑱂悤ɓǂݔ΂ANULLԂ
+static Node* stmt_or_recover(Token** ppToken) {
+    jmp_buf* pOldJmpBuf;
+    StrBuf* pOut;
+    get_error_handler(&pOldJmpBuf, &pOut);
+
+    // G[œr̕甲ĂA͂ł镶͉̐͂n߂Ƃɖ߂
+    const int breakableDepth = s_breakableDepth;
+    const int switchDepth = s_switchDepth;
+
+    jmp_buf jmpBuf;
+    Node* pNode = NULL;
+    if (setjmp(jmpBuf) == 0) {
+        set_error_handler(&jmpBuf, pOut);
+        pNode = stmt(ppToken);
+        set_error_handler(pOldJmpBuf, pOut);
+    }
+    else {
+        set_error_handler(pOldJmpBuf, pOut);
+        s_breakableDepth = breakableDepth;
+        s_switchDepth = switchDepth;
+        recover_from_error(ppToken);
+    }
+    return pNode;
+}
+
 static Node* decl_var(Token** ppToken, Node* pTypeNode, const Token* pVarNameToken) {
     if (consume(ppToken, "[")) {
         Node* pCurNode = pTypeNode;
@@ -348,7 +537,7 @@ static Node* decl_var(Token** ppToken, Node* pTypeNode, const Token* pVarNameTok
             const Token* pToken = *ppToken;
             const int size = expect_number(ppToken);
             if (size <= 0) {
-                error_at(pToken->filename, pToken->user_input, pToken->str, "'%d' ͔z̃TCYƂĕsł", size);
+                error_at(pToken->loc, "'%d' ͔z̃TCYƂĕsł", size);
             }
             pCurNode->rhs = new_node_num(size);
             pCurNode = (Node*)pCurNode->rhs;
@@ -359,7 +548,27 @@ static Node* decl_var(Token** ppToken, Node* pTypeNode, const Token* pVarNameTok
     return new_node(pVarNameToken, ND_DECL_VAR, pTypeNode, NULL);
 }
 
-static Node* def_func(Token** ppToken, Node* pTypeNode, const Token* pFuncNameToken) {
+// ֐{̂Ή'}'܂œǂݔ΂A'}'̃g[NԂ
+static const Token* skip_func_body(Token** ppToken) {
+    int depth = 1;
+    for (;;) {
+        Token* pToken = *ppToken;
+        if (at_eof(pToken)) {
+            error_at(pToken->loc, "'}'ł͂܂");
+        }
+        *ppToken = pToken->next;
+
+        if (pToken->kind != TK_RESERVED || pToken->len != 1) continue;
+        if (pToken->str[0] == '{') {
+            ++depth;
+        }
+        else if (pToken->str[0] == '}' && --depth == 0) {
+            return pToken;
+        }
+    }
+}
+
+static Node* def_func(Token** ppToken, Node* pTypeNode, const Token* pFuncNameToken, bool isBodyDeferred) {
     Node* pDefFuncNode = new_node(pFuncNameToken, ND_DEF_FUNC, pTypeNode, NULL);
 
     const int maxParam = sizeof(pDefFuncNode->children) / sizeof(pDefFuncNode->children[0]);
@@ -367,7 +576,7 @@ static Node* def_func(Token** ppToken, Node* pTypeNode, const Token* pFuncNameTo
 
     while (!consume(ppToken, ")")) {
         if (maxParam <= argCount) {
-            error_at((*ppToken)->filename, (*ppToken)->user_input, (*ppToken)->str, "̐%dȏ゠֐`͔Ήł", maxParam);
+            error_at((*ppToken)->loc, "̐%dȏ゠֐`͔Ήł", maxParam);
         }
         if (0 < argCount) {
             expect(ppToken, ",");
@@ -375,36 +584,46 @@ static Node* def_func(Token** ppToken, Node* pTypeNode, const Token* pFuncNameTo
 
         Node* pTypeNode = type(ppToken);
         if (pTypeNode == NULL) {
-            error_at((*ppToken)->filename, (*ppToken)->user_input, (*ppToken)->str, "̌^Kvł");
+            error_at((*ppToken)->loc, "̌^Kvł");
         }
 
         const Token* pParamNameToken = consume_ident(ppToken);
         if (pParamNameToken == NULL) {
-            error_at((*ppToken)->filename, (*ppToken)->user_input, (*ppToken)->str, "Kvł");
+            error_at((*ppToken)->loc, "Kvł");
         }
 
         pDefFuncNode->children[argCount++] = decl_var(ppToken, pTypeNode, pParamNameToken);
     }
 
+    const Token* pBodyToken = *ppToken;
     expect(ppToken, "{");
-    pDefFuncNode->rhs = compound_stmt(ppToken);
+    if (isBodyDeferred) {
+        // {͓̂ǂݔ΂Aō\͂邽߂'{''}'̃g[NoĂ
+        Node* pEndNode = new_node(skip_func_body(ppToken), ND_NOP, NULL, NULL);
+        pDefFuncNode->rhs = new_node(pBodyToken, ND_DEFERRED_BODY, pEndNode, NULL);
+    }
+    else {
+        s_breakableDepth = 0;
+        s_switchDepth = 0;
+        pDefFuncNode->rhs = compound_stmt(ppToken);
+    }
 
     return pDefFuncNode;
 }
 
-static Node* def_func_or_var(Token** ppToken) {
+static Node* def_func_or_var(Token** ppToken, bool isBodyDeferred) {
     Node* pTypeNode = type(ppToken);
     if (pTypeNode == NULL) {
-        error_at((*ppToken)->filename, (*ppToken)->user_input, (*ppToken)->str, "^Kvł");
+        error_at((*ppToken)->loc, "^Kvł");
     }
 
     const Token* pNameToken = consume_ident(ppToken);
     if (pNameToken == NULL) {
-        error_at((*ppToken)->filename, (*ppToken)->user_input, (*ppToken)->str, "ʎqKvł");
+        error_at((*ppToken)->loc, "ʎqKvł");
     }
 
     if (consume(ppToken, "(")) {
-        return def_func(ppToken, pTypeNode, pNameToken);
+        return def_func(ppToken, pTypeNode, pNameToken, isBodyDeferred);
     }
     else {
         Node* pNode = decl_var(ppToken, pTypeNode, pNameToken);
@@ -442,12 +661,14 @@ static Node* type(Token** ppToken) {
     return pTypeNode;
 }
 
-static Node* program(Token** ppToken) {
+static Node* program(Token** ppToken, bool isBodyDeferred) {
     Node* pRoot = NULL;
     Node* pCur = NULL;
 
     while (!at_eof(*ppToken)) {
-        Node* pNode = new_node(NULL, ND_TOP_LEVEL, def_func_or_var(ppToken), NULL);
+        Node* pDefNode = top_level_or_recover(ppToken, isBodyDeferred);
+        if (pDefNode == NULL) continue;
+        Node* pNode = new_node(NULL, ND_TOP_LEVEL, pDefNode, NULL);
 
         if (pRoot == NULL) {
             pRoot = pNode;
@@ -461,6 +682,81 @@ static Node* program(Token** ppToken) {
     return pRoot;
 }
 
-Node* parse(Token* pToken, const StringLiteral* pStrLiterals) {
-    return program(&pToken);
+// ֐`O[oϐ̐錾1͂
+// G[񍐂玟̐錾͂𑱂悤ɓǂݔ΂ANULLԂ
+static Node* top_level_or_recover(Token** ppToken, bool isBodyDeferred) {
+    jmp_buf* pOldJmpBuf;
+    StrBuf* pOut;
+    get_error_handler(&pOldJmpBuf, &pOut);
+
+    jmp_buf jmpBuf;
+    Node* pNode = NULL;
+    if (setjmp(jmpBuf) == 0) {
+        set_error_handler(&jmpBuf, pOut);
+        pNode = def_func_or_var(ppToken, isBodyDeferred);
+        set_error_handler(pOldJmpBuf, pOut);
+    }
+    else {
+        set_error_handler(pOldJmpBuf, pOut);
+
+        // š^Ŏ~܂ȂA';'YꂽƂ݂ȂĂ玟̐錾͂
+        // i錾̐擪̌^ł̓G[ɂȂȂ̂ŁAKǂݐiłj
+        const Token* pToken = *ppToken;
+        if (pToken->isLineHead && (pToken->kind == TK_INT || pToken->kind == TK_CHAR)) {
+            count_error();
+        }
+        else {
+            recover_from_error(ppToken);
+
+            // ֐̊Oł́AΉ'{'̖'}'ǂݔ΂
+            consume(ppToken, "}");
+        }
+    }
+    return pNode;
+}
+
+// g[N񂩂\؂쐬
+// isBodyDeferred^ȂA֐{̂͑Ή'}'܂œǂݔ΂ɂč\͂񂵂ɂ
+// ̏ꍇ̊֐`rhśA{̂̈ʒuND_DEFERRED_BODỸm[hɂȂ
+// \G[ĂŌ܂ŉ͂đSẴG[񍐂AꂩRpC𒆎~
+Node* parse(Token* pToken, const StringLiteral* pStrLiterals, bool isBodyDeferred) {
+    s_errorCount = 0;
+    s_isGivingUp = false;
+    Node* pNode = program(&pToken, isBodyDeferred);
+    if (s_errorCount) {
+        abort_compile();
+    }
+    return pNode;
+}
+
+// gbvx̐錾i֐`O[oϐ̐錾j1\͂ĕԂi͂̏IȂNULLj
+// G[̐͌Ăяo܂Ő̂ŁAĂяo
+Node* parse_top_level(Token** ppToken, int* pErrorCount) {
+    s_errorCount = *pErrorCount;
+    s_isGivingUp = false;
+
+    Node* pNode = NULL;
+    while (pNode == NULL && !at_eof(*ppToken)) {
+        pNode = top_level_or_recover(ppToken, false);
+    }
+    *pErrorCount = s_errorCount;
+
+    if (pNode == NULL && s_errorCount) {
+        abort_compile();
+    }
+    return pNode;
+}
+
+// \͂񂵂ɂ֐{̂̍\؂쐬ĕԂ
+Node* parse_func_body(const Node* pDefFuncNode) {
+    Token* pToken = pDefFuncNode->rhs->pToken->next;
+    s_errorCount = 0;
+    s_isGivingUp = false;
+    s_breakableDepth = 0;
+    s_switchDepth = 0;
+    Node* pNode = compound_stmt(&pToken);
+    if (s_errorCount) {
+        abort_compile();
+    }
+    return pNode;
 }
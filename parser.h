@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stdbool.h>
+
 // ۍ\؂̃m[h̎
 typedef enum {
     ND_NOP,         // Ȃvf
@@ -29,6 +31,20 @@ typedef enum {
     ND_IF,          // if
     ND_WHILE,       // while
     ND_FOR,         // for
+    ND_SWITCH,      // switch
+    ND_CASE,        // casex
+    ND_DEFAULT,     // defaultx
+    ND_BREAK,       // break
+    ND_LOGAND,      // &&
+    ND_LOGOR,       // ||
+    ND_NOT,         // !
+    ND_ADD_ASSIGN,  // +=iOu++x += 1Ƃĕ\j
+    ND_SUB_ASSIGN,  // -=iOu--x -= 1Ƃĕ\j
+    ND_MUL_ASSIGN,  // *=
+    ND_DIV_ASSIGN,  // /=
+    ND_POST_INC,    // u++
+    ND_POST_DEC,    // u--
+    ND_DEFERRED_BODY,   // \͂񂵂ɂ֐{́ipToken͖{̂'{'AlhspToken͖{̂'}'j
 } NodeKind;
 
 typedef struct Token Token;
@@ -44,4 +60,15 @@ struct Node {
     const Token* pToken;    // g[N
 };
 
-Node* parse(Token* pToken, const StringLiteral* pStrLiterals);
+// g[N񂩂\؂쐬
+// isBodyDeferred^ȂA֐{̂͑Ή'}'܂œǂݔ΂ɂč\͂񂵂ɂ
+// ̏ꍇ̊֐`rhśA{̂̈ʒuND_DEFERRED_BODỸm[hɂȂ
+Node* parse(Token* pToken, const StringLiteral* pStrLiterals, bool isBodyDeferred);
+
+// \͂񂵂ɂ֐{̂̍\؂쐬ĕԂ
+Node* parse_func_body(const Node* pDefFuncNode);
+
+// gbvx̐錾i֐`O[oϐ̐錾j1\͂ĕԂi͂̏IȂNULLj
+// \G[̂錾͓ǂݔ΂Ď̐錾ԂAG[̐*pErrorCountɑĂ
+// ͂̏IɒBƂA*pErrorCount0łȂ΃RpC𒆎~
+Node* parse_top_level(Token** ppToken, int* pErrorCount);
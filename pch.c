@@ -0,0 +1,432 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lexer.h"
+#include "preprocess.h"
+#include "pch.h"
+#include "cache.h"
+#include "sha256.h"
+#include "strbuf.h"
+#include "arena.h"
+#include "error.h"
+
+// vRpCς݃wb_[̐擪̎ʎqƏ̔
+#define PCH_MAGIC           "CPCH"
+#define PCH_VERSION         (1)
+
+// t@C̏il͑SăgGfBAAʒu̓t@C擪̃oCgj
+//     wb_[     ʎqAŁARpC̃nbVlAIvṼnbVlAPchField̊el
+//     t@C\   ipXA傫AXVj~t@C̐          ̃t@CύXĂȂ̊mFp
+//     obt@\   it@CAej~obt@̐                g[Nw̌
+//     g[N\   iށAtOAobt@AʒuAAlj~g[N̐
+//     once\       ipXj~#pragma onceꂽt@C̐
+//     \     '\0'I[ׂ́̕i̕\̃pXe͂̈ʒuŕ\j
+// |C^܂܂Ȃ̂ŁAǂ̃AhXɃ}bvĂ̂܂ܓǂݏo
+typedef enum {
+    PCH_FIELD_FILE_COUNT,
+    PCH_FIELD_FILE_OFFSET,
+    PCH_FIELD_BUFFER_COUNT,
+    PCH_FIELD_BUFFER_OFFSET,
+    PCH_FIELD_TOKEN_COUNT,
+    PCH_FIELD_STREAM_TOKEN_COUNT,   // g[N\̂Awb_[vvZXʂ̐ic̓}N#define̍sj
+    PCH_FIELD_TOKEN_OFFSET,
+    PCH_FIELD_ONCE_COUNT,
+    PCH_FIELD_ONCE_OFFSET,
+    PCH_FIELD_POOL_SIZE,
+    PCH_FIELD_POOL_OFFSET,
+    PCH_FIELD_COUNT,
+} PchField;
+
+#define PCH_FIELDS_OFFSET       (4 + 4 + SHA256_DIGEST_SIZE * 2)
+#define PCH_HEADER_SIZE         (PCH_FIELDS_OFFSET + 4 * PCH_FIELD_COUNT)
+#define PCH_FILE_RECORD_SIZE    (4 + 8 + 8)
+#define PCH_BUFFER_RECORD_SIZE  (4 + 4)
+#define PCH_TOKEN_RECORD_SIZE   (4 * 5)
+#define PCH_ONCE_RECORD_SIZE    (4)
+
+// g[ÑtO
+#define PCH_TOKEN_LINE_HEAD     (1 << 0)    // s̐擪
+#define PCH_TOKEN_EXPANDED      (1 << 1)    // }NWJōꂽ
+
+typedef struct PchWriter PchWriter;
+typedef struct BufferSlot BufferSlot;
+
+// obt@ig[Nw̌j̔ԍ߂̃nbV\̗vf
+struct BufferSlot {
+    const SourceFile* pFile;
+    uint32_t index;
+};
+
+// vRpCς݃wb_[̏ȍ
+struct PchWriter {
+    StrBuf pool;            // \̓e
+    StrBuf buffers;         // obt@\̓e
+    StrBuf tokens;          // g[N\̓e
+    BufferSlot* pSlots;     // obt@̔ԍ߂̃nbV\̗vf
+    uint32_t slotCount;     // pSlots̑傫i2ׂ̂j
+    uint32_t bufferCount;   // obt@̐
+    const SourceFile* pLastFile;    // OɈobt@̃\[Xi\[X̃g[N̂ŁAnbV\ɍς܂j
+    uint32_t lastIndex;     // pLastFile̔ԍ
+};
+
+// JvRpCς݃wb_[
+struct PchFile {
+    const uint8_t* pData;       // }bve
+    size_t size;                // ȇ傫
+    SourceFile** ppBufferFiles; // obt@\[XƂēo^
+    const uint8_t* pTokens;     // g[N\̐擪
+    uint32_t tokenCount;        // g[N̐
+    uint32_t streamTokenCount;  // wb_[vvZXʂ̃g[N̐
+    const uint8_t* pOnceFiles;  // once\̐擪
+    uint32_t onceCount;         // #pragma onceꂽt@C̐
+    const char* pPool;          // \̐擪
+};
+
+static void append_u32(StrBuf* pBuf, uint32_t value) {
+    strbuf_append(pBuf, (const char*)&value, sizeof(value));
+}
+
+static void append_u64(StrBuf* pBuf, uint64_t value) {
+    strbuf_append(pBuf, (const char*)&value, sizeof(value));
+}
+
+static uint32_t read_u32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint64_t read_u64(const uint8_t* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// -I-D̓ẽnbVl߂iႤIvVōꂽ̂gȂ߁j
+static void hash_options(const PreprocessOptions* pOptions, uint8_t digest[SHA256_DIGEST_SIZE]) {
+    Sha256 ctx;
+    sha256_init(&ctx);
+    for (int i = 0; i < pOptions->includeDirCount; ++i) {
+        sha256_update(&ctx, "I", 1);
+        sha256_update(&ctx, pOptions->ppIncludeDirs[i], strlen(pOptions->ppIncludeDirs[i]) + 1);
+    }
+    for (int i = 0; i < pOptions->defineCount; ++i) {
+        sha256_update(&ctx, "D", 1);
+        sha256_update(&ctx, pOptions->ppDefines[i], strlen(pOptions->ppDefines[i]) + 1);
+    }
+    sha256_final(&ctx, digest);
+}
+
+// \ɕǉÄʒuԂ
+static uint32_t add_pool_string(PchWriter* pWriter, const char* str, size_t len) {
+    const uint32_t offset = (uint32_t)pWriter->pool.len;
+    strbuf_append(&pWriter->pool, str, len);
+    strbuf_append(&pWriter->pool, "", 1);
+    return offset;
+}
+
+// g[Nwobt@̔ԍԂi߂Ẵobt@Ȃobt@\ɒǉj
+static uint32_t get_buffer_index(PchWriter* pWriter, const SourceFile* pFile) {
+    if (pFile == pWriter->pLastFile) {
+        return pWriter->lastIndex;
+    }
+
+    if (pWriter->slotCount <= pWriter->bufferCount * 2) {
+        // \Lē꒼
+        const uint32_t newCount = pWriter->slotCount ? pWriter->slotCount * 2 : 256;
+        BufferSlot* pNewSlots = calloc(newCount, sizeof(BufferSlot));
+        for (uint32_t i = 0; i < pWriter->slotCount; ++i) {
+            if (pWriter->pSlots[i].pFile == NULL) continue;
+            uint32_t j = (uint32_t)((uintptr_t)pWriter->pSlots[i].pFile >> 4) & (newCount - 1);
+            while (pNewSlots[j].pFile) j = (j + 1) & (newCount - 1);
+            pNewSlots[j] = pWriter->pSlots[i];
+        }
+        free(pWriter->pSlots);
+        pWriter->pSlots = pNewSlots;
+        pWriter->slotCount = newCount;
+    }
+
+    uint32_t i = (uint32_t)((uintptr_t)pFile >> 4) & (pWriter->slotCount - 1);
+    while (pWriter->pSlots[i].pFile) {
+        if (pWriter->pSlots[i].pFile == pFile) {
+            pWriter->pLastFile = pFile;
+            pWriter->lastIndex = pWriter->pSlots[i].index;
+            return pWriter->lastIndex;
+        }
+        i = (i + 1) & (pWriter->slotCount - 1);
+    }
+
+    const uint32_t index = pWriter->bufferCount++;
+    pWriter->pSlots[i].pFile = pFile;
+    pWriter->pSlots[i].index = index;
+    pWriter->pLastFile = pFile;
+    pWriter->lastIndex = index;
+
+    append_u32(&pWriter->buffers, add_pool_string(pWriter, pFile->pszName, strlen(pFile->pszName)));
+    append_u32(&pWriter->buffers, add_pool_string(pWriter, pFile->pText, pFile->size));
+    return index;
+}
+
+// g[Ng[N\ɒǉ
+static void add_token(PchWriter* pWriter, const Token* pToken) {
+    const SourceFile* pFile = pWriter->pLastFile;
+    if (pFile == NULL || !source_file_contains(pFile, pToken->loc)) {
+        pFile = find_source_file(pToken->loc);
+    }
+    if (pFile == NULL || pFile->size < (pToken->loc - pFile->base) + pToken->len) {
+        error("Internal Error. g[N̊̕OwĂ܂");
+    }
+    const uint32_t buffer = get_buffer_index(pWriter, pFile);
+    const uint32_t offset = pToken->loc - pFile->base;
+
+    const uint32_t flags = (pToken->isLineHead ? PCH_TOKEN_LINE_HEAD : 0) | (pToken->pHideSet ? PCH_TOKEN_EXPANDED : 0);
+    append_u32(&pWriter->tokens, (uint32_t)pToken->kind | (flags << 8));
+    append_u32(&pWriter->tokens, buffer);
+    append_u32(&pWriter->tokens, offset);
+    append_u32(&pWriter->tokens, (uint32_t)pToken->len);
+    append_u32(&pWriter->tokens, (uint32_t)pToken->val);
+}
+
+// wb_[t@CvvZXAvRpCς݃wb_[̓epOutɏo
+void build_pch(const char* pszHeader, const PreprocessOptions* pOptions, StrBuf* pOut) {
+    uint64_t headerSize, headerMTime;
+    if (!get_file_stamp(pszHeader, &headerSize, &headerMTime)) {
+        error("cannot open %s", pszHeader);
+    }
+
+    PreprocessState state = { 0 };
+    const Token* pToken = preprocess(tokenize(pszHeader), pOptions, &state);
+
+    PchWriter writer = { 0 };
+    StrBuf files = { 0 };
+    StrBuf onceFiles = { 0 };
+    uint32_t tokenCount = 0;
+    uint32_t streamTokenCount = 0;
+    int i;
+
+    // ̃t@Ciwb_[gƃCN[ht@Cj
+    append_u32(&files, add_pool_string(&writer, pszHeader, strlen(pszHeader)));
+    append_u64(&files, headerSize);
+    append_u64(&files, headerMTime);
+    for (i = 0; i < state.includedFileCount; ++i) {
+        const IncludedFile* pFile = &state.pIncludedFiles[i];
+        append_u32(&files, add_pool_string(&writer, pFile->pszPath, strlen(pFile->pszPath)));
+        append_u64(&files, pFile->size);
+        append_u64(&files, pFile->mtime);
+    }
+
+    // vvZXʁiTK_EOF͏jƁA}N#define̍siTK_EOF܂ށj
+    for (; pToken->kind != TK_EOF; pToken = pToken->next) {
+        add_token(&writer, pToken);
+        ++streamTokenCount;
+    }
+    tokenCount = streamTokenCount;
+    for (pToken = state.pMacroLines; pToken; pToken = pToken->next) {
+        add_token(&writer, pToken);
+        ++tokenCount;
+    }
+
+    for (i = 0; i < state.onceFileCount; ++i) {
+        append_u32(&onceFiles, add_pool_string(&writer, state.ppOnceFiles[i], strlen(state.ppOnceFiles[i])));
+    }
+
+    // e\̈ʒu߂ăwb_[
+    uint32_t fields[PCH_FIELD_COUNT];
+    fields[PCH_FIELD_FILE_COUNT] = 1 + state.includedFileCount;
+    fields[PCH_FIELD_FILE_OFFSET] = PCH_HEADER_SIZE;
+    fields[PCH_FIELD_BUFFER_COUNT] = writer.bufferCount;
+    fields[PCH_FIELD_BUFFER_OFFSET] = fields[PCH_FIELD_FILE_OFFSET] + (uint32_t)files.len;
+    fields[PCH_FIELD_TOKEN_COUNT] = tokenCount;
+    fields[PCH_FIELD_STREAM_TOKEN_COUNT] = streamTokenCount;
+    fields[PCH_FIELD_TOKEN_OFFSET] = fields[PCH_FIELD_BUFFER_OFFSET] + (uint32_t)writer.buffers.len;
+    fields[PCH_FIELD_ONCE_COUNT] = state.onceFileCount;
+    fields[PCH_FIELD_ONCE_OFFSET] = fields[PCH_FIELD_TOKEN_OFFSET] + (uint32_t)writer.tokens.len;
+    fields[PCH_FIELD_POOL_SIZE] = (uint32_t)writer.pool.len;
+    fields[PCH_FIELD_POOL_OFFSET] = fields[PCH_FIELD_ONCE_OFFSET] + (uint32_t)onceFiles.len;
+
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    strbuf_append(pOut, PCH_MAGIC, 4);
+    append_u32(pOut, PCH_VERSION);
+    get_compiler_id(digest);
+    strbuf_append(pOut, (const char*)digest, SHA256_DIGEST_SIZE);
+    hash_options(pOptions, digest);
+    strbuf_append(pOut, (const char*)digest, SHA256_DIGEST_SIZE);
+    for (i = 0; i < PCH_FIELD_COUNT; ++i) {
+        append_u32(pOut, fields[i]);
+    }
+
+    strbuf_append(pOut, files.data, files.len);
+    strbuf_append(pOut, writer.buffers.data, writer.buffers.len);
+    strbuf_append(pOut, writer.tokens.data, writer.tokens.len);
+    strbuf_append(pOut, onceFiles.data, onceFiles.len);
+    strbuf_append(pOut, writer.pool.data, writer.pool.len);
+
+    strbuf_free(&files);
+    strbuf_free(&onceFiles);
+    strbuf_free(&writer.pool);
+    strbuf_free(&writer.buffers);
+    strbuf_free(&writer.tokens);
+    free(writer.pSlots);
+}
+
+// \e͈̔͂Ɏ܂ĂtrueԂ
+static bool is_in_range(const PchFile* pPch, uint32_t offset, uint32_t count, uint32_t recordSize) {
+    return offset <= pPch->size && count <= (pPch->size - offset) / recordSize;
+}
+
+// vRpCς݃wb_[Ƀ}bvĊJ
+// ʂ̃RpCIvVōꂽ́Ãt@CύXꂽ̂̓G[Ƃċۂ
+PchFile* open_pch(const char* pszPath, const PreprocessOptions* pOptions) {
+    PchFile* pPch = calloc(1, sizeof(PchFile));
+    pPch->pData = map_file(pszPath, &pPch->size);
+    if (pPch->pData == NULL) {
+        error("cannot open %s", pszPath);
+    }
+
+    const uint8_t* pData = pPch->pData;
+    if (pPch->size < PCH_HEADER_SIZE || memcmp(pData, PCH_MAGIC, 4) != 0 || read_u32(pData + 4) != PCH_VERSION) {
+        error("vRpCς݃wb_[ł͂܂: %s", pszPath);
+    }
+
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    get_compiler_id(digest);
+    if (memcmp(pData + 8, digest, SHA256_DIGEST_SIZE) != 0) {
+        error("vRpCς݃wb_[ʂ̃RpCōĂ܂: %s", pszPath);
+    }
+    hash_options(pOptions, digest);
+    if (memcmp(pData + 8 + SHA256_DIGEST_SIZE, digest, SHA256_DIGEST_SIZE) != 0) {
+        error("vRpCς݃wb_[ʂ-I/-DIvVōĂ܂: %s", pszPath);
+    }
+
+    uint32_t fields[PCH_FIELD_COUNT];
+    for (int i = 0; i < PCH_FIELD_COUNT; ++i) {
+        fields[i] = read_u32(pData + PCH_FIELDS_OFFSET + 4 * i);
+    }
+
+    // \͈͓ɂA\'\0'ŏIĂ邱Ƃm߂
+    const uint32_t poolSize = fields[PCH_FIELD_POOL_SIZE];
+    if (!is_in_range(pPch, fields[PCH_FIELD_FILE_OFFSET], fields[PCH_FIELD_FILE_COUNT], PCH_FILE_RECORD_SIZE) ||
+        !is_in_range(pPch, fields[PCH_FIELD_BUFFER_OFFSET], fields[PCH_FIELD_BUFFER_COUNT], PCH_BUFFER_RECORD_SIZE) ||
+        !is_in_range(pPch, fields[PCH_FIELD_TOKEN_OFFSET], fields[PCH_FIELD_TOKEN_COUNT], PCH_TOKEN_RECORD_SIZE) ||
+        !is_in_range(pPch, fields[PCH_FIELD_ONCE_OFFSET], fields[PCH_FIELD_ONCE_COUNT], PCH_ONCE_RECORD_SIZE) ||
+        !is_in_range(pPch, fields[PCH_FIELD_POOL_OFFSET], poolSize, 1) || poolSize == 0 ||
+        pData[fields[PCH_FIELD_POOL_OFFSET] + poolSize - 1] != '\0' ||
+        fields[PCH_FIELD_TOKEN_COUNT] <= fields[PCH_FIELD_STREAM_TOKEN_COUNT])
+    {
+        error("vRpCς݃wb_[Ă܂: %s", pszPath);
+    }
+    pPch->pPool = (const char*)pData + fields[PCH_FIELD_POOL_OFFSET];
+
+    // ̃t@C쐬ςĂȂƂm߂
+    const uint8_t* pRecord = pData + fields[PCH_FIELD_FILE_OFFSET];
+    for (uint32_t i = 0; i < fields[PCH_FIELD_FILE_COUNT]; ++i, pRecord += PCH_FILE_RECORD_SIZE) {
+        const uint32_t pathOffset = read_u32(pRecord);
+        if (poolSize <= pathOffset) {
+            error("vRpCς݃wb_[Ă܂: %s", pszPath);
+        }
+        const char* pszFile = pPch->pPool + pathOffset;
+        uint64_t size, mtime;
+        if (!get_file_stamp(pszFile, &size, &mtime) || size != read_u64(pRecord + 4) || mtime != read_u64(pRecord + 12)) {
+            error("vRpCς݃wb_[ÂȂĂ܂i%sύXĂ܂j: %s", pszFile, pszPath);
+        }
+    }
+
+    // obt@̕悤ɂ
+    const uint32_t bufferCount = fields[PCH_FIELD_BUFFER_COUNT];
+    uint32_t* pBufferLens = calloc(bufferCount ? bufferCount : 1, sizeof(uint32_t));
+    pPch->ppBufferFiles = calloc(bufferCount ? bufferCount : 1, sizeof(SourceFile*));
+    pRecord = pData + fields[PCH_FIELD_BUFFER_OFFSET];
+    for (uint32_t i = 0; i < bufferCount; ++i, pRecord += PCH_BUFFER_RECORD_SIZE) {
+        const uint32_t nameOffset = read_u32(pRecord);
+        const uint32_t textOffset = read_u32(pRecord + 4);
+        if (poolSize <= nameOffset || poolSize <= textOffset) {
+            error("vRpCς݃wb_[Ă܂: %s", pszPath);
+        }
+        // }bvê܂܃\[XƂēo^is̕\̓G[񍐂Ƃɍj
+        pPch->ppBufferFiles[i] = add_source_file(pPch->pPool + nameOffset, pPch->pPool + textOffset, false);
+        pBufferLens[i] = pPch->ppBufferFiles[i]->size;
+    }
+
+    // SẴg[Nobt@͈͓̔wĂ邱Ƃm߂ĂAƂɂ͊m߂Ȃ
+    pPch->pTokens = pData + fields[PCH_FIELD_TOKEN_OFFSET];
+    pPch->tokenCount = fields[PCH_FIELD_TOKEN_COUNT];
+    pPch->streamTokenCount = fields[PCH_FIELD_STREAM_TOKEN_COUNT];
+    for (uint32_t i = 0; i < pPch->tokenCount; ++i) {
+        const uint8_t* p = pPch->pTokens + i * PCH_TOKEN_RECORD_SIZE;
+        const uint32_t buffer = read_u32(p + 4);
+        const uint32_t offset = read_u32(p + 8);
+        const uint32_t len = read_u32(p + 12);
+        if (TK_EOF < (read_u32(p) & 0xFF) || bufferCount <= buffer || pBufferLens[buffer] < offset || pBufferLens[buffer] - offset < len) {
+            error("vRpCς݃wb_[Ă܂: %s", pszPath);
+        }
+    }
+    if ((read_u32(pPch->pTokens + (pPch->tokenCount - 1) * PCH_TOKEN_RECORD_SIZE) & 0xFF) != TK_EOF) {
+        error("vRpCς݃wb_[Ă܂: %s", pszPath);
+    }
+    free(pBufferLens);
+
+    pPch->pOnceFiles = pData + fields[PCH_FIELD_ONCE_OFFSET];
+    pPch->onceCount = fields[PCH_FIELD_ONCE_COUNT];
+    for (uint32_t i = 0; i < pPch->onceCount; ++i) {
+        if (poolSize <= read_u32(pPch->pOnceFiles + i * PCH_ONCE_RECORD_SIZE)) {
+            error("vRpCς݃wb_[Ă܂: %s", pszPath);
+        }
+    }
+
+    return pPch;
+}
+
+// vRpCς݃wb_[
+void close_pch(PchFile* pPch) {
+    unmap_file(pPch->pData, pPch->size);
+    free(pPch->ppBufferFiles);
+    free(pPch);
+}
+
+// g[N\startԖڂcount̃g[NApRestɌq
+// ̓}bvê܂܎ŵŁA͂̕Ȃ
+static Token* build_tokens(const PchFile* pPch, uint32_t start, uint32_t count, Token* pRest) {
+    if (count == 0) {
+        return pRest;
+    }
+
+    Token* pTokens = arena_calloc(count, sizeof(Token));
+    const uint8_t* p = pPch->pTokens + start * PCH_TOKEN_RECORD_SIZE;
+    for (uint32_t i = 0; i < count; ++i, p += PCH_TOKEN_RECORD_SIZE) {
+        Token* pToken = &pTokens[i];
+        const uint32_t kindAndFlags = read_u32(p);
+        const uint32_t buffer = read_u32(p + 4);
+
+        pToken->kind = (TokenKind)(kindAndFlags & 0xFF);
+        const SourceFile* pFile = pPch->ppBufferFiles[buffer];
+        const uint32_t offset = read_u32(p + 8);
+        pToken->loc = pFile->base + offset;
+        pToken->str = pFile->pText + offset;
+        pToken->len = (int)read_u32(p + 12);
+        pToken->val = (int)read_u32(p + 16);
+        pToken->isLineHead = ((kindAndFlags >> 8) & PCH_TOKEN_LINE_HEAD) != 0;
+        pToken->pHideSet = ((kindAndFlags >> 8) & PCH_TOKEN_EXPANDED) ? get_expanded_hideset() : NULL;
+        pToken->next = (i + 1 < count) ? &pTokens[i + 1] : pRest;
+    }
+    return pTokens;
+}
+
+// vRpCς݃wb_[̃g[NpRest̑OɌq̂Ԃi͂͂Ȃj
+Token* load_pch_tokens(const PchFile* pPch, Token* pRest) {
+    return build_tokens(pPch, 0, pPch->streamTokenCount, pRest);
+}
+
+// vRpCς݃wb_[I_̃vvZbT̏Ԃ𕜌
+void load_pch_state(const PchFile* pPch, PreprocessState* pState) {
+    memset(pState, 0, sizeof(PreprocessState));
+    pState->pMacroLines = build_tokens(pPch, pPch->streamTokenCount, pPch->tokenCount - pPch->streamTokenCount, NULL);
+
+    pState->ppOnceFiles = arena_calloc(pPch->onceCount ? pPch->onceCount : 1, sizeof(const char*));
+    pState->onceFileCount = (int)pPch->onceCount;
+    for (uint32_t i = 0; i < pPch->onceCount; ++i) {
+        pState->ppOnceFiles[i] = pPch->pPool + read_u32(pPch->pOnceFiles + i * PCH_ONCE_RECORD_SIZE);
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+typedef struct Token Token;
+typedef struct StrBuf StrBuf;
+typedef struct PreprocessOptions PreprocessOptions;
+typedef struct PreprocessState PreprocessState;
+typedef struct PchFile PchFile;
+
+// wb_[t@CvvZXAvRpCς݃wb_[̓epOutɏo
+void build_pch(const char* pszHeader, const PreprocessOptions* pOptions, StrBuf* pOut);
+
+// vRpCς݃wb_[Ƀ}bvĊJ
+// ʂ̃RpCIvVōꂽ́Ãt@CύXꂽ̂̓G[Ƃċۂ
+PchFile* open_pch(const char* pszPath, const PreprocessOptions* pOptions);
+
+// vRpCς݃wb_[
+void close_pch(PchFile* pPch);
+
+// vRpCς݃wb_[̃g[NpRest̑OɌq̂Ԃi͂͂Ȃj
+Token* load_pch_tokens(const PchFile* pPch, Token* pRest);
+
+// vRpCς݃wb_[I_̃vvZbT̏Ԃ𕜌
+void load_pch_state(const PchFile* pPch, PreprocessState* pState);
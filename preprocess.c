@@ -0,0 +1,1481 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lexer.h"
+#include "preprocess.h"
+#include "error.h"
+#include "arena.h"
+#include "strbuf.h"
+#include "thread.h"
+#include "cache.h"
+
+// }N̕\̃oPbg
+#define MACRO_BUCKET_COUNT  (1024)
+
+// CN[h̓q̏igCN[hꍇ̒~pj
+#define MAX_INCLUDE_DEPTH   (200)
+
+typedef struct Macro Macro;
+typedef struct MacroArg MacroArg;
+typedef struct CondIncl CondIncl;
+typedef struct OnceFile OnceFile;
+typedef struct HeaderEntry HeaderEntry;
+typedef struct Preprocessor Preprocessor;
+
+// __FILE____LINE__̂悤ɁAgꂽꏊɂēWJʂς}N̏
+typedef Token* (*MacroHandler)(const Token* pToken);
+
+// }N
+struct Macro {
+    Macro* pNext;           // oPbg̎̃}N
+    const char* name;       // }N
+    int len;                // }N̒
+    const Token* pName;     // #definẽ}Ñg[Nigݍ݂̃}NłNULLj
+    bool isFuncLike;        // ֐`}NȂtrue
+    bool isVariadic;        // ϒiŌ̈__VA_ARGS__jȂtrue
+    const Token** ppParams; // ֐`}N̈
+    int paramCount;         // ֐`}N̈̐i__VA_ARGS__܂ށj
+    const Token* pBody;     // uXgiTK_EOFŏIj
+    MacroHandler pfnHandler;// NULLłȂ΁AuXg̑ɂ̊֐œWJ
+};
+
+// WJς݂̃}N̏Wihide-setj
+// vfǉƂ͐擪Ɍq邾ɂāAc͌̏̕WƋL
+struct HideSet {
+    const HideSet* pNext;
+    const Macro* pMacro;
+};
+
+// ֐`}N̎
+struct MacroArg {
+    Token* pTokens;         // ̃g[NiTK_EOFŏIj
+    Token* pExpanded;       // }NWJig܂ōȂj
+};
+
+// tRpC̏
+typedef enum {
+    IN_THEN,    // #ifA#ifdefA#ifndef̒
+    IN_ELIF,    // #elif̒
+    IN_ELSE,    // #else̒
+} CondContext;
+
+// #if`#endif̓q
+struct CondIncl {
+    CondIncl* pNext;        // O#if
+    CondContext ctx;        // ǂ̕
+    const Token* pToken;    // #ifȂǂ̃fBNeBũg[N
+    bool isIncluded;        // ꂩ̕ɗLɂȂȂtrue
+};
+
+// #pragma onceꂽt@C
+struct OnceFile {
+    OnceFile* pNext;
+    const char* pszPath;
+};
+
+// LbVwb_[t@C̃g[N
+// x쐬珑Ȃ̂ŁAbNɕ̃Xbhǂݏo
+struct HeaderEntry {
+    HeaderEntry* pNext;     // ̃Gg
+    char* pszPath;          // t@C̃pX
+    uint64_t size;          // ǂݍ񂾂Ƃ̃t@C̑傫
+    uint64_t mtime;         // ǂݍ񂾂Ƃ̃t@C̍XV
+    Token* pTokens;         // g[NizƂĕׁATK_EOFj
+    int tokenCount;         // TK_EOF܂ރg[N̐
+    const Token* pGuard;    // CN[hK[h̃}NiNULLj
+};
+
+// wb_[t@C̃g[ÑLbV
+struct HeaderCache {
+    Mutex* pLock;           // pEntries郍bN
+    HeaderEntry* pEntries;  // Vǂݍ񂾂̂擪
+};
+
+// |P1̃vvZbT̏
+struct Preprocessor {
+    const PreprocessOptions* pOptions;
+    Macro* pMacros[MACRO_BUCKET_COUNT];     // `ς݂̃}N
+    CondIncl* pCondIncl;                    // #if
+    OnceFile* pOnceFiles;                   // #pragma onceꂽt@C
+    int includeDepth;                       // CN[h̓q̐[
+    IncludedFile* pIncludedFiles;           // CN[ht@CiԂ߂ꍇL^j
+    int includedFileCount;                  // pIncludedFileš
+    int includedFileCap;                    // pIncludedFiles̗e
+    bool isRecordingFiles;                  // CN[ht@CL^Ȃtrue
+};
+
+// #define̍s邽߂̕
+//     '#'0ځA"define"1ځA'('7ځA','8ځA')'9ځA"..."10ڂ
+static const char MACRO_LINE_TEXT[] = "#define(,)...";
+
+// }NWJōꂽƂ\W
+static const HideSet s_expandedHideSet = { NULL, NULL };
+
+static Token* expand_all(Preprocessor* pPP, Token* pToken);
+
+// ʎqi\܂ށjȂtrueԂ
+// \̃g[N̎ނTK_RETURNTK_IDENT̊Ԃɕł
+static bool is_ident_like(const Token* pToken) {
+    return TK_RETURN <= pToken->kind && pToken->kind <= TK_IDENT;
+}
+
+// g[N̕strƈvtrueԂ
+static bool equal(const Token* pToken, const char* str) {
+    return pToken->kind != TK_EOF && strlen(str) == pToken->len && memcmp(pToken->str, str, pToken->len) == 0;
+}
+
+// 2̃g[N̕񂪈vtrueԂ
+static bool equal_token(const Token* pLhs, const Token* pRhs) {
+    return pLhs->len == pRhs->len && memcmp(pLhs->str, pRhs->str, pLhs->len) == 0;
+}
+
+// L̃g[NopƈvtrueԂ
+static bool is_punct(const Token* pToken, const char* op) {
+    return pToken->kind == TK_RESERVED && equal(pToken, op);
+}
+
+// fBNeBu̎n܂'#'ȂtrueԂi}NWJōꂽ'#'͑ΏۊOj
+static bool is_hash(const Token* pToken) {
+    return pToken->isLineHead && !pToken->pHideSet && is_punct(pToken, "#");
+}
+
+// fBNeBunamẽfBNeBuȂtrueԂ
+static bool is_directive(const Token* pHash, const char* name) {
+    return is_hash(pHash) && !pHash->next->isLineHead && equal(pHash->next, name);
+}
+
+// ̍s̐擪̃g[NԂ
+static Token* skip_line(Token* pToken) {
+    while (!pToken->isLineHead) {
+        pToken = pToken->next;
+    }
+    return pToken;
+}
+
+// g[N𕡐
+static Token* copy_token(const Token* pToken) {
+    Token* pCopy = arena_calloc(1, sizeof(Token));
+    *pCopy = *pToken;
+    pCopy->next = NULL;
+    return pCopy;
+}
+
+// pTokenƓʒuwTK_EOF̃g[N
+static Token* new_eof(const Token* pToken) {
+    Token* pEof = copy_token(pToken);
+    pEof->kind = TK_EOF;
+    pEof->len = 0;
+    pEof->isLineHead = true;
+    return pEof;
+}
+
+// TK_EOFŏIg[N𕡐
+static Token* copy_token_list(const Token* pToken) {
+    Token head;
+    head.next = NULL;
+    Token* cur = &head;
+    for (; pToken->kind != TK_EOF; pToken = pToken->next) {
+        cur = cur->next = copy_token(pToken);
+    }
+    cur->next = new_eof(pToken);
+    return head.next;
+}
+
+// s܂ł̃g[N𕡐TK_EOFŏIg[Nɂ
+// *ppRestɂ͎̍s̐擪̃g[NԂ
+static Token* copy_line(Token** ppRest, Token* pToken) {
+    Token head;
+    head.next = NULL;
+    Token* cur = &head;
+    for (; !pToken->isLineHead; pToken = pToken->next) {
+        cur = cur->next = copy_token(pToken);
+    }
+    cur->next = new_eof(pToken);
+    *ppRest = pToken;
+    return head.next;
+}
+
+// g[N̍sԍԂ
+static int get_line_number(const Token* pToken) {
+    const char* pLine;
+    return get_source_line(pToken->loc, &pLine);
+}
+
+//
+// WJς݂̃}N̏Wihide-setj
+//
+
+static bool hideset_contains(const HideSet* pHideSet, const Macro* pMacro) {
+    for (; pHideSet; pHideSet = pHideSet->pNext) {
+        if (pHideSet->pMacro == pMacro) return true;
+    }
+    return false;
+}
+
+// WɃ}NiɊ܂܂ĂΌ̏Ŵ܂ܕԂj
+static const HideSet* hideset_add(const HideSet* pHideSet, const Macro* pMacro) {
+    if (hideset_contains(pHideSet, pMacro)) {
+        return pHideSet;
+    }
+    HideSet* pNew = arena_calloc(1, sizeof(HideSet));
+    pNew->pNext = pHideSet;
+    pNew->pMacro = pMacro;
+    return pNew;
+}
+
+static const HideSet* hideset_union(const HideSet* pLhs, const HideSet* pRhs) {
+    for (; pRhs; pRhs = pRhs->pNext) {
+        pLhs = hideset_add(pLhs, pRhs->pMacro);
+    }
+    return pLhs;
+}
+
+// ʕԂiقƂǂ̏ꍇpLhspRhsɊ܂܂̂ŁAVȊmۂ͂Ȃj
+static const HideSet* hideset_intersection(const HideSet* pLhs, const HideSet* pRhs) {
+    const HideSet* p;
+    for (p = pLhs; p; p = p->pNext) {
+        if (!hideset_contains(pRhs, p->pMacro)) break;
+    }
+    if (p == NULL) {
+        return pLhs;
+    }
+
+    const HideSet* pResult = NULL;
+    for (p = pLhs; p; p = p->pNext) {
+        if (hideset_contains(pRhs, p->pMacro)) {
+            pResult = hideset_add(pResult, p->pMacro);
+        }
+    }
+    return pResult;
+}
+
+//
+// }N̓o^ƌ
+//
+
+static unsigned int hash_name(const char* name, int len) {
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < len; ++i) {
+        hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+    }
+    return hash % MACRO_BUCKET_COUNT;
+}
+
+static Macro* find_macro(const Preprocessor* pPP, const Token* pToken) {
+    if (!is_ident_like(pToken)) {
+        return NULL;
+    }
+    for (Macro* pMacro = pPP->pMacros[hash_name(pToken->str, pToken->len)]; pMacro; pMacro = pMacro->pNext) {
+        if (pMacro->len == pToken->len && memcmp(pMacro->name, pToken->str, pToken->len) == 0) {
+            return pMacro;
+        }
+    }
+    return NULL;
+}
+
+static void undef_macro(Preprocessor* pPP, const char* name, int len) {
+    for (Macro** ppMacro = &pPP->pMacros[hash_name(name, len)]; *ppMacro; ppMacro = &(*ppMacro)->pNext) {
+        if ((*ppMacro)->len == len && memcmp((*ppMacro)->name, name, len) == 0) {
+            *ppMacro = (*ppMacro)->pNext;
+            return;
+        }
+    }
+}
+
+// }N`ĩ}NΒuj
+static Macro* add_macro(Preprocessor* pPP, const char* name, int len) {
+    undef_macro(pPP, name, len);
+
+    Macro* pMacro = arena_calloc(1, sizeof(Macro));
+    pMacro->name = name;
+    pMacro->len = len;
+
+    const unsigned int hash = hash_name(name, len);
+    pMacro->pNext = pPP->pMacros[hash];
+    pPP->pMacros[hash] = pMacro;
+    return pMacro;
+}
+
+// ֐`}N̈Ȃ炻̔ԍAłȂ-1Ԃ
+static int find_param(const Macro* pMacro, const Token* pToken) {
+    if (!is_ident_like(pToken)) {
+        return -1;
+    }
+    for (int i = 0; i < pMacro->paramCount; ++i) {
+        if (equal_token(pMacro->ppParams[i], pToken)) return i;
+    }
+    return -1;
+}
+
+//
+// }NWJ
+//
+
+// 𕶎񃊃eɂi#Zqj
+static Token* stringize(const Token* pHash, const Token* pArg) {
+    StrBuf text = { 0 };
+    strbuf_append(&text, "\"", 1);
+    for (const Token* pToken = pArg; pToken->kind != TK_EOF; pToken = pToken->next) {
+        // ̃\[XR[hŊԂɋ󔒂g[N̊Ԃɂ͋󔒂1
+        if (pToken != pArg && !(pArg->loc && pArg->loc + pArg->len == pToken->loc)) {
+            strbuf_append(&text, " ", 1);
+        }
+        for (int i = 0; i < pToken->len; ++i) {
+            if (pToken->kind == TK_STRING && (pToken->str[i] == '"' || pToken->str[i] == '\\')) {
+                strbuf_append(&text, "\\", 1);
+            }
+            strbuf_append(&text, &pToken->str[i], 1);
+        }
+        pArg = pToken;
+    }
+    strbuf_append(&text, "\"", 1);
+
+    char* buf = arena_calloc(text.len + 1, sizeof(char));
+    memcpy(buf, text.data, text.len);
+    strbuf_free(&text);
+
+    Token* pString = tokenize_text(get_source_name(pHash->loc), buf);
+    pString->next = NULL;
+    return pString;
+}
+
+// 2̃g[NA1̃g[Nɂi##Zqj
+static Token* paste(const Token* pLhs, const Token* pRhs) {
+    char* buf = arena_calloc(pLhs->len + pRhs->len + 1, sizeof(char));
+    memcpy(buf, pLhs->str, pLhs->len);
+    memcpy(buf + pLhs->len, pRhs->str, pRhs->len);
+
+    Token* pToken = tokenize_text(get_source_name(pLhs->loc), buf);
+    if (pToken->next->kind != TK_EOF) {
+        error_at(pLhs->loc, "'%s'1̃g[NɂȂ܂", buf);
+    }
+    pToken->next = NULL;
+    return pToken;
+}
+
+// uXg̉Œug[N
+static Token* subst(Preprocessor* pPP, const Macro* pMacro, MacroArg* pArgs) {
+    Token head;
+    head.next = NULL;
+    Token* cur = &head;
+
+    const Token* pToken = pMacro->pBody;
+    while (pToken->kind != TK_EOF) {
+        // "#"͎𕶎񃊃eɂ
+        if (pMacro->isFuncLike && is_punct(pToken, "#")) {
+            const int index = find_param(pMacro, pToken->next);
+            if (index < 0) {
+                error_at(pToken->loc, "'#'̌ɂ̓}N̈Kvł");
+            }
+            cur = cur->next = stringize(pToken, pArgs[index].pTokens);
+            pToken = pToken->next->next;
+            continue;
+        }
+
+        // "##"͒Õg[Nƒ̃g[NiȂWJO̐擪jA
+        if (is_punct(pToken, "##")) {
+            if (cur == &head) {
+                error_at(pToken->loc, "'##'͒uXg̐擪ɂ͒u܂");
+            }
+            if (pToken->next->kind == TK_EOF) {
+                error_at(pToken->loc, "'##'͒uXg̖ɂ͒u܂");
+            }
+
+            const int index = find_param(pMacro, pToken->next);
+            if (index >= 0) {
+                const Token* pArg = pArgs[index].pTokens;
+                if (pArg->kind != TK_EOF) {
+                    *cur = *paste(cur, pArg);
+                    for (pArg = pArg->next; pArg->kind != TK_EOF; pArg = pArg->next) {
+                        cur = cur->next = copy_token(pArg);
+                    }
+                }
+            }
+            else {
+                *cur = *paste(cur, pToken->next);
+            }
+            pToken = pToken->next->next;
+            continue;
+        }
+
+        const int index = find_param(pMacro, pToken);
+
+        // "##"͓̈WJɎg
+        if (index >= 0 && is_punct(pToken->next, "##")) {
+            const Token* pRhs = pToken->next->next;
+            const Token* pArg = pArgs[index].pTokens;
+
+            // Ȃ"##"̉Ê܂܎g
+            if (pArg->kind == TK_EOF) {
+                const int rhsIndex = find_param(pMacro, pRhs);
+                if (rhsIndex >= 0) {
+                    for (pArg = pArgs[rhsIndex].pTokens; pArg->kind != TK_EOF; pArg = pArg->next) {
+                        cur = cur->next = copy_token(pArg);
+                    }
+                }
+                else if (pRhs->kind != TK_EOF) {
+                    cur = cur->next = copy_token(pRhs);
+                }
+                pToken = (pRhs->kind != TK_EOF) ? pRhs->next : pRhs;
+                continue;
+            }
+
+            for (; pArg->kind != TK_EOF; pArg = pArg->next) {
+                cur = cur->next = copy_token(pArg);
+            }
+            pToken = pToken->next;
+            continue;
+        }
+
+        // ȊÖ̓}NWJĂu
+        if (index >= 0) {
+            if (pArgs[index].pExpanded == NULL) {
+                pArgs[index].pExpanded = expand_all(pPP, copy_token_list(pArgs[index].pTokens));
+            }
+            for (const Token* pArg = pArgs[index].pExpanded; pArg->kind != TK_EOF; pArg = pArg->next) {
+                cur = cur->next = copy_token(pArg);
+            }
+            pToken = pToken->next;
+            continue;
+        }
+
+        cur = cur->next = copy_token(pToken);
+        pToken = pToken->next;
+    }
+
+    return head.next;
+}
+
+// ֐`}N̎1ǂݍ
+// isRest^ȂA','܂߂')'܂ł1̎ɂi__VA_ARGS__pj
+static Token* read_macro_arg(Token** ppRest, Token* pToken, bool isRest) {
+    Token head;
+    head.next = NULL;
+    Token* cur = &head;
+    int depth = 0;
+
+    for (;;) {
+        if (pToken->kind == TK_EOF) {
+            error_at(pToken->loc, "}N̈Ă܂");
+        }
+        if (depth == 0 && (is_punct(pToken, ")") || (!isRest && is_punct(pToken, ",")))) {
+            break;
+        }
+        if (is_punct(pToken, "(")) {
+            ++depth;
+        }
+        else if (is_punct(pToken, ")")) {
+            --depth;
+        }
+        cur = cur->next = copy_token(pToken);
+        pToken = pToken->next;
+    }
+
+    cur->next = new_eof(pToken);
+    *ppRest = pToken;
+    return head.next;
+}
+
+// ֐`}N̎Sēǂݍ
+// pToken'('wB*ppRParenɂ')'Ԃ
+static MacroArg* read_macro_args(const Macro* pMacro, const Token* pMacroToken, Token* pToken, Token** ppRParen) {
+    MacroArg* pArgs = arena_calloc(pMacro->paramCount ? pMacro->paramCount : 1, sizeof(MacroArg));
+    const int fixedCount = pMacro->isVariadic ? pMacro->paramCount - 1 : pMacro->paramCount;
+    pToken = pToken->next;
+
+    for (int i = 0; i < fixedCount; ++i) {
+        if (0 < i) {
+            if (!is_punct(pToken, ",")) {
+                error_at(pMacroToken->loc, "}N̈܂");
+            }
+            pToken = pToken->next;
+        }
+        pArgs[i].pTokens = read_macro_arg(&pToken, pToken, false);
+    }
+
+    if (pMacro->isVariadic) {
+        if (0 < fixedCount && is_punct(pToken, ",")) {
+            pToken = pToken->next;
+        }
+        pArgs[fixedCount].pTokens = is_punct(pToken, ")") ? new_eof(pToken) : read_macro_arg(&pToken, pToken, true);
+    }
+
+    if (!is_punct(pToken, ")")) {
+        error_at(pMacroToken->loc, "}N̈܂");
+    }
+    *ppRParen = pToken;
+    return pArgs;
+}
+
+// *ppToken}NȂWJāAWJʂ擪Ɍqg[N*ppTokenɕԂ
+// }NłȂΉɋUԂ
+static bool expand_macro(Preprocessor* pPP, Token** ppToken) {
+    Token* pToken = *ppToken;
+    Macro* pMacro = find_macro(pPP, pToken);
+    if (pMacro == NULL || hideset_contains(pToken->pHideSet, pMacro)) {
+        return false;
+    }
+
+    if (pMacro->pfnHandler) {
+        Token* pResult = pMacro->pfnHandler(pToken);
+        pResult->isLineHead = false;
+        pResult->pHideSet = hideset_add(pToken->pHideSet, pMacro);
+        pResult->next = pToken->next;
+        *ppToken = pResult;
+        return true;
+    }
+
+    // ֐`}ŃA'('ΓWJȂ
+    const HideSet* pHideSet;
+    MacroArg* pArgs = NULL;
+    Token* pRest;
+    if (pMacro->isFuncLike) {
+        if (!is_punct(pToken->next, "(")) {
+            return false;
+        }
+        Token* pRParen;
+        pArgs = read_macro_args(pMacro, pToken, pToken->next, &pRParen);
+        pHideSet = hideset_add(hideset_intersection(pToken->pHideSet, pRParen->pHideSet), pMacro);
+        pRest = pRParen->next;
+    }
+    else {
+        pHideSet = hideset_add(pToken->pHideSet, pMacro);
+        pRest = pToken->next;
+    }
+
+    Token* pBody = subst(pPP, pMacro, pArgs);
+    if (pBody == NULL) {
+        *ppToken = pRest;
+        return true;
+    }
+
+    Token* pLast = pBody;
+    for (Token* p = pBody; p; p = p->next) {
+        p->isLineHead = false;
+        p->pHideSet = hideset_union(p->pHideSet, pHideSet);
+        pLast = p;
+    }
+    pLast->next = pRest;
+    *ppToken = pBody;
+    return true;
+}
+
+// TK_EOFŏIg[Ñ}NSēWJ
+static Token* expand_all(Preprocessor* pPP, Token* pToken) {
+    Token head;
+    head.next = NULL;
+    Token* cur = &head;
+    while (pToken->kind != TK_EOF) {
+        if (expand_macro(pPP, &pToken)) continue;
+        cur = cur->next = pToken;
+        pToken = pToken->next;
+    }
+    cur->next = pToken;
+    return head.next;
+}
+
+static Token* file_macro(const Token* pToken) {
+    StrBuf text = { 0 };
+    strbuf_append(&text, "\"", 1);
+    for (const char* p = get_source_name(pToken->loc); *p; ++p) {
+        if (*p == '\\' || *p == '"') strbuf_append(&text, "\\", 1);
+        strbuf_append(&text, p, 1);
+    }
+    strbuf_append(&text, "\"", 1);
+
+    char* buf = arena_calloc(text.len + 1, sizeof(char));
+    memcpy(buf, text.data, text.len);
+    strbuf_free(&text);
+    return tokenize_text(get_source_name(pToken->loc), buf);
+}
+
+static Token* line_macro(const Token* pToken) {
+    char* buf = arena_calloc(16, sizeof(char));
+    snprintf(buf, 16, "%d", get_line_number(pToken));
+    return tokenize_text(get_source_name(pToken->loc), buf);
+}
+
+//
+// #define#if
+//
+
+// #defineBpToken̓}Nw
+static Token* read_macro_definition(Preprocessor* pPP, Token* pToken) {
+    if (pToken->isLineHead || !is_ident_like(pToken)) {
+        error_at(pToken->loc, "}NKvł");
+    }
+    const Token* pName = pToken;
+    pToken = pToken->next;
+
+    // }N̒ɋ󔒂܂'('Ί֐`}N
+    bool isFuncLike = false;
+    bool isVariadic = false;
+    const Token** ppParams = NULL;
+    int paramCount = 0;
+    if (!pToken->isLineHead && is_punct(pToken, "(") && pName->str + pName->len == pToken->str) {
+        isFuncLike = true;
+        pToken = pToken->next;
+
+        while (!is_punct(pToken, ")")) {
+            if (pToken->isLineHead) {
+                error_at(pToken->loc, "')'ł͂܂");
+            }
+            if (0 < paramCount) {
+                if (!is_punct(pToken, ",")) {
+                    error_at(pToken->loc, "','ł͂܂");
+                }
+                pToken = pToken->next;
+            }
+
+            const Token** ppNewParams = arena_calloc(paramCount + 1, sizeof(Token*));
+            if (paramCount) memcpy(ppNewParams, ppParams, paramCount * sizeof(Token*));
+            ppParams = ppNewParams;
+            if (is_punct(pToken, "...")) {
+                // __VA_ARGS__ƂÖƂĈ
+                Token* pVaArgs = tokenize_text(get_source_name(pToken->loc), "__VA_ARGS__");
+                pVaArgs->isLineHead = false;
+                pVaArgs->next = NULL;
+                ppParams[paramCount++] = pVaArgs;
+                isVariadic = true;
+                pToken = pToken->next;
+                if (!is_punct(pToken, ")")) {
+                    error_at(pToken->loc, "')'ł͂܂");
+                }
+                break;
+            }
+            if (pToken->isLineHead || !is_ident_like(pToken)) {
+                error_at(pToken->loc, "Kvł");
+            }
+            ppParams[paramCount++] = pToken;
+            pToken = pToken->next;
+        }
+        pToken = pToken->next;
+    }
+
+    Token* pRest;
+    const Token* pBody = copy_line(&pRest, pToken);
+
+    Macro* pMacro = add_macro(pPP, pName->str, pName->len);
+    pMacro->pName = pName;
+    pMacro->isFuncLike = isFuncLike;
+    pMacro->isVariadic = isVariadic;
+    pMacro->ppParams = ppParams;
+    pMacro->paramCount = paramCount;
+    pMacro->pBody = pBody;
+    return pRest;
+}
+
+// "defined O""defined(O)"10ɒu
+static Token* replace_defined(const Preprocessor* pPP, Token* pToken) {
+    Token head;
+    head.next = NULL;
+    Token* cur = &head;
+
+    while (pToken->kind != TK_EOF) {
+        if (!equal(pToken, "defined")) {
+            cur = cur->next = pToken;
+            pToken = pToken->next;
+            continue;
+        }
+
+        Token* pStart = pToken;
+        pToken = pToken->next;
+        const bool hasParen = is_punct(pToken, "(");
+        if (hasParen) {
+            pToken = pToken->next;
+        }
+        if (!is_ident_like(pToken)) {
+            error_at(pToken->loc, "}NKvł");
+        }
+        const bool isDefined = find_macro(pPP, pToken) != NULL;
+        pToken = pToken->next;
+        if (hasParen) {
+            if (!is_punct(pToken, ")")) {
+                error_at(pToken->loc, "')'ł͂܂");
+            }
+            pToken = pToken->next;
+        }
+
+        pStart->kind = TK_NUM;
+        pStart->val = isDefined ? 1 : 0;
+        cur = cur->next = pStart;
+    }
+    cur->next = pToken;
+    return head.next;
+}
+
+static long long eval_cond(Token** ppToken);
+
+static long long eval_primary(Token** ppToken) {
+    Token* pToken = *ppToken;
+    if (is_punct(pToken, "(")) {
+        *ppToken = pToken->next;
+        const long long val = eval_cond(ppToken);
+        if (!is_punct(*ppToken, ")")) {
+            error_at((*ppToken)->loc, "')'ł͂܂");
+        }
+        *ppToken = (*ppToken)->next;
+        return val;
+    }
+    if (pToken->kind != TK_NUM) {
+        error_at(pToken->loc, "萔Kvł");
+    }
+    *ppToken = pToken->next;
+    return pToken->val;
+}
+
+static long long eval_unary(Token** ppToken) {
+    Token* pToken = *ppToken;
+    if (is_punct(pToken, "+")) { *ppToken = pToken->next; return eval_unary(ppToken); }
+    if (is_punct(pToken, "-")) { *ppToken = pToken->next; return -eval_unary(ppToken); }
+    if (is_punct(pToken, "!")) { *ppToken = pToken->next; return !eval_unary(ppToken); }
+    if (is_punct(pToken, "~")) { *ppToken = pToken->next; return ~eval_unary(ppToken); }
+    return eval_primary(ppToken);
+}
+
+static long long eval_mul(Token** ppToken) {
+    long long val = eval_unary(ppToken);
+    for (;;) {
+        Token* pOp = *ppToken;
+        if (!is_punct(pOp, "*") && !is_punct(pOp, "/") && !is_punct(pOp, "%")) {
+            return val;
+        }
+        *ppToken = pOp->next;
+        const long long rhs = eval_unary(ppToken);
+        if (is_punct(pOp, "*")) {
+            val *= rhs;
+            continue;
+        }
+        if (rhs == 0) {
+            error_at(pOp->loc, "0ŏZĂ܂");
+        }
+        val = is_punct(pOp, "/") ? val / rhs : val % rhs;
+    }
+}
+
+static long long eval_add(Token** ppToken) {
+    long long val = eval_mul(ppToken);
+    for (;;) {
+        if (is_punct(*ppToken, "+")) { *ppToken = (*ppToken)->next; val += eval_mul(ppToken); }
+        else if (is_punct(*ppToken, "-")) { *ppToken = (*ppToken)->next; val -= eval_mul(ppToken); }
+        else return val;
+    }
+}
+
+static long long eval_shift(Token** ppToken) {
+    long long val = eval_add(ppToken);
+    for (;;) {
+        if (is_punct(*ppToken, "<<")) { *ppToken = (*ppToken)->next; val <<= eval_add(ppToken); }
+        else if (is_punct(*ppToken, ">>")) { *ppToken = (*ppToken)->next; val >>= eval_add(ppToken); }
+        else return val;
+    }
+}
+
+static long long eval_relational(Token** ppToken) {
+    long long val = eval_shift(ppToken);
+    for (;;) {
+        if (is_punct(*ppToken, "<")) { *ppToken = (*ppToken)->next; val = val < eval_shift(ppToken); }
+        else if (is_punct(*ppToken, "<=")) { *ppToken = (*ppToken)->next; val = val <= eval_shift(ppToken); }
+        else if (is_punct(*ppToken, ">")) { *ppToken = (*ppToken)->next; val = val > eval_shift(ppToken); }
+        else if (is_punct(*ppToken, ">=")) { *ppToken = (*ppToken)->next; val = val >= eval_shift(ppToken); }
+        else return val;
+    }
+}
+
+static long long eval_equality(Token** ppToken) {
+    long long val = eval_relational(ppToken);
+    for (;;) {
+        if (is_punct(*ppToken, "==")) { *ppToken = (*ppToken)->next; val = val == eval_relational(ppToken); }
+        else if (is_punct(*ppToken, "!=")) { *ppToken = (*ppToken)->next; val = val != eval_relational(ppToken); }
+        else return val;
+    }
+}
+
+static long long eval_bitand(Token** ppToken) {
+    long long val = eval_equality(ppToken);
+    while (is_punct(*ppToken, "&")) {
+        *ppToken = (*ppToken)->next;
+        val &= eval_equality(ppToken);
+    }
+    return val;
+}
+
+static long long eval_bitxor(Token** ppToken) {
+    long long val = eval_bitand(ppToken);
+    while (is_punct(*ppToken, "^")) {
+        *ppToken = (*ppToken)->next;
+        val ^= eval_bitand(ppToken);
+    }
+    return val;
+}
+
+static long long eval_bitor(Token** ppToken) {
+    long long val = eval_bitxor(ppToken);
+    while (is_punct(*ppToken, "|")) {
+        *ppToken = (*ppToken)->next;
+        val |= eval_bitxor(ppToken);
+    }
+    return val;
+}
+
+static long long eval_logand(Token** ppToken) {
+    long long val = eval_bitor(ppToken);
+    while (is_punct(*ppToken, "&&")) {
+        *ppToken = (*ppToken)->next;
+        const long long rhs = eval_bitor(ppToken);
+        val = val && rhs;
+    }
+    return val;
+}
+
+static long long eval_logor(Token** ppToken) {
+    long long val = eval_logand(ppToken);
+    while (is_punct(*ppToken, "||")) {
+        *ppToken = (*ppToken)->next;
+        const long long rhs = eval_logand(ppToken);
+        val = val || rhs;
+    }
+    return val;
+}
+
+static long long eval_cond(Token** ppToken) {
+    const long long cond = eval_logor(ppToken);
+    if (!is_punct(*ppToken, "?")) {
+        return cond;
+    }
+    *ppToken = (*ppToken)->next;
+    const long long thenVal = eval_cond(ppToken);
+    if (!is_punct(*ppToken, ":")) {
+        error_at((*ppToken)->loc, "':'ł͂܂");
+    }
+    *ppToken = (*ppToken)->next;
+    const long long elseVal = eval_cond(ppToken);
+    return cond ? thenVal : elseVal;
+}
+
+// #if#elif̏]BpToken̓fBNeBuw
+static long long eval_const_expr(Preprocessor* pPP, Token** ppRest, Token* pToken) {
+    Token* pExpr = copy_line(ppRest, pToken->next);
+    if (pExpr->kind == TK_EOF) {
+        error_at(pToken->loc, "Kvł");
+    }
+
+    pExpr = expand_all(pPP, replace_defined(pPP, pExpr));
+
+    // WJɎcʎq0ƂĈ
+    for (Token* p = pExpr; p->kind != TK_EOF; p = p->next) {
+        if (is_ident_like(p)) {
+            p->kind = TK_NUM;
+            p->val = 0;
+        }
+    }
+
+    const long long val = eval_cond(&pExpr);
+    if (pExpr->kind != TK_EOF) {
+        error_at(pExpr->loc, "̌ɗ]ȃg[N܂");
+    }
+    return val;
+}
+
+static void push_cond_incl(Preprocessor* pPP, const Token* pToken, bool isIncluded) {
+    CondIncl* pCondIncl = arena_calloc(1, sizeof(CondIncl));
+    pCondIncl->pNext = pPP->pCondIncl;
+    pCondIncl->ctx = IN_THEN;
+    pCondIncl->pToken = pToken;
+    pCondIncl->isIncluded = isIncluded;
+    pPP->pCondIncl = pCondIncl;
+}
+
+// qɂȂ#if`#endifǂݔ΂A#endif̎̍s̐擪Ԃ
+static Token* skip_nested_cond_incl(Token* pToken) {
+    while (pToken->kind != TK_EOF) {
+        if (is_directive(pToken, "if") || is_directive(pToken, "ifdef") || is_directive(pToken, "ifndef")) {
+            pToken = skip_nested_cond_incl(pToken->next->next);
+            continue;
+        }
+        if (is_directive(pToken, "endif")) {
+            return skip_line(pToken->next->next);
+        }
+        pToken = pToken->next;
+    }
+    return pToken;
+}
+
+// ɂȂǂݔ΂AΉ#elifA#elseA#endif'#'Ԃ
+static Token* skip_cond_incl(Token* pToken) {
+    while (pToken->kind != TK_EOF) {
+        if (is_directive(pToken, "if") || is_directive(pToken, "ifdef") || is_directive(pToken, "ifndef")) {
+            pToken = skip_nested_cond_incl(pToken->next->next);
+            continue;
+        }
+        if (is_directive(pToken, "elif") || is_directive(pToken, "else") || is_directive(pToken, "endif")) {
+            break;
+        }
+        pToken = pToken->next;
+    }
+    return pToken;
+}
+
+//
+// wb_[t@C
+//
+
+// dCN[hh~̒^
+//     #ifndef O
+//     #define O
+//     ...
+//     #endif
+// Ńt@CŜ͂܂Ă΁A̖Õg[NԂ
+static const Token* detect_include_guard(const Token* pTokens, int count) {
+    if (count < 9 ||
+        !is_directive(&pTokens[0], "ifndef") || pTokens[2].isLineHead || !is_ident_like(&pTokens[2]) ||
+        !is_directive(&pTokens[3], "define") || pTokens[5].isLineHead || !equal_token(&pTokens[5], &pTokens[2]))
+    {
+        return NULL;
+    }
+
+    int last = count - 2;
+    while (0 < last && !pTokens[last].isLineHead) --last;
+    if (!is_directive(&pTokens[last], "endif")) {
+        return NULL;
+    }
+
+    // 擪#ifndefɑΉ#endifŌ̍słA#elseȂǂƂm߂
+    int depth = 1;
+    for (int i = 3; i < last; ++i) {
+        if (is_directive(&pTokens[i], "if") || is_directive(&pTokens[i], "ifdef") || is_directive(&pTokens[i], "ifndef")) {
+            ++depth;
+        }
+        else if (is_directive(&pTokens[i], "endif")) {
+            if (--depth == 0) return NULL;
+        }
+        else if (depth == 1 && (is_directive(&pTokens[i], "elif") || is_directive(&pTokens[i], "else"))) {
+            return NULL;
+        }
+    }
+    return &pTokens[2];
+}
+
+// wb_[t@Cǂݍ݁AvZXI܂Ŏc郁Ƀg[N
+static HeaderEntry* load_header(const char* pszPath, uint64_t size, uint64_t mtime) {
+    StrBuf text = { 0 };
+    if (!read_binary_file(pszPath, &text)) {
+        error("cannot open %s", pszPath);
+    }
+
+    HeaderEntry* pEntry = calloc(1, sizeof(HeaderEntry));
+    pEntry->pszPath = calloc(strlen(pszPath) + 1, sizeof(char));
+    strcpy(pEntry->pszPath, pszPath);
+    pEntry->size = size;
+    pEntry->mtime = mtime;
+
+    // ꎞIɃA[iɍg[NzɎʂAA[i͌ɖ߂
+    const ArenaMark mark = arena_mark();
+    const Token* pToken = tokenize_source(add_source_file(pEntry->pszPath, text.data ? text.data : "", true));
+    for (const Token* p = pToken; p; p = p->next) {
+        ++pEntry->tokenCount;
+    }
+    pEntry->pTokens = calloc(pEntry->tokenCount, sizeof(Token));
+    for (int i = 0; pToken; pToken = pToken->next, ++i) {
+        pEntry->pTokens[i] = *pToken;
+        pEntry->pTokens[i].next = (pToken->next) ? &pEntry->pTokens[i + 1] : NULL;
+    }
+    arena_release_to(mark);
+
+    pEntry->pGuard = detect_include_guard(pEntry->pTokens, pEntry->tokenCount);
+    return pEntry;
+}
+
+// wb_[t@C̃g[NLbVoiΓǂݍŃLbVj
+// RpCT[o[̂悤ɒvZXłAt@CύXĂΓǂݍݒ
+static const HeaderEntry* get_header(HeaderCache* pCache, const char* pszPath) {
+    uint64_t size, mtime;
+    if (!get_file_stamp(pszPath, &size, &mtime)) {
+        return NULL;
+    }
+
+    const HeaderEntry* pFound = NULL;
+    lock_mutex(pCache->pLock);
+    for (const HeaderEntry* pEntry = pCache->pEntries; pEntry; pEntry = pEntry->pNext) {
+        if (strcmp(pEntry->pszPath, pszPath) == 0) {
+            if (pEntry->size == size && pEntry->mtime == mtime) pFound = pEntry;
+            break;
+        }
+    }
+    unlock_mutex(pCache->pLock);
+    if (pFound) {
+        return pFound;
+    }
+
+    // ǂݍݒ̃G[ŃbN܂ܔȂ悤AbN̊Oœǂݍ
+    // ÂGg͑̃XbhgĂ邩Ȃ̂ŉɎc
+    HeaderEntry* pEntry = load_header(pszPath, size, mtime);
+    lock_mutex(pCache->pLock);
+    pEntry->pNext = pCache->pEntries;
+    pCache->pEntries = pEntry;
+    unlock_mutex(pCache->pLock);
+    return pEntry;
+}
+
+// wb_[t@C̃g[ÑLbV쐬
+// LbV̓vZX̑SẴXbhESĂ̖|PʂŋL
+HeaderCache* create_header_cache(void) {
+    HeaderCache* pCache = calloc(1, sizeof(HeaderCache));
+    pCache->pLock = create_mutex();
+    return pCache;
+}
+
+// dirnameqpX̃t@C΁ÃpXԂ
+static char* find_file_in(const char* dir, size_t dirLen, const char* name) {
+    const size_t nameLen = strlen(name);
+    char* pszPath = arena_calloc(dirLen + nameLen + 2, sizeof(char));
+    memcpy(pszPath, dir, dirLen);
+    if (dirLen && dir[dirLen - 1] != '/' && dir[dirLen - 1] != '\\') {
+        pszPath[dirLen++] = '/';
+    }
+    memcpy(pszPath + dirLen, name, nameLen);
+
+    uint64_t size, mtime;
+    return get_file_stamp(pszPath, &size, &mtime) ? pszPath : NULL;
+}
+
+// CN[ht@CT
+// "..."ȂCN[h̃t@CƓfBNgA-ĨfBNg̏ɒTA<...>Ȃ-ĨfBNgT
+static char* find_include_file(const Preprocessor* pPP, const Token* pToken, const char* name, bool isQuoted) {
+    const bool isAbsolute = name[0] == '/' || name[0] == '\\' || (name[0] && name[1] == ':');
+    if (isAbsolute) {
+        return find_file_in("", 0, name);
+    }
+
+    if (isQuoted) {
+        const char* pszFile = get_source_name(pToken->loc);
+        size_t dirLen = 0;
+        for (const char* p = pszFile; *p; ++p) {
+            if (*p == '/' || *p == '\\') dirLen = p - pszFile + 1;
+        }
+        char* pszPath = find_file_in(pszFile, dirLen, name);
+        if (pszPath) return pszPath;
+    }
+
+    for (int i = 0; i < pPP->pOptions->includeDirCount; ++i) {
+        const char* dir = pPP->pOptions->ppIncludeDirs[i];
+        char* pszPath = find_file_in(dir, strlen(dir), name);
+        if (pszPath) return pszPath;
+    }
+    return NULL;
+}
+
+// #includẽt@CǂݍށBpToken̓fBNeBu̎̃g[Nw
+// "..."ŏĂ*pIsQuotedtrueA<...>Ȃfalseɂ
+static char* read_include_filename(Token** ppRest, Token* pToken, bool* pIsQuoted) {
+    if (!pToken->isLineHead && pToken->kind == TK_STRING) {
+        *pIsQuoted = true;
+        *ppRest = skip_line(pToken->next);
+        char* name = arena_calloc(pToken->len - 1, sizeof(char));
+        memcpy(name, pToken->str + 1, pToken->len - 2);
+        return name;
+    }
+
+    if (!pToken->isLineHead && is_punct(pToken, "<")) {
+        const Token* pEnd = pToken->next;
+        while (!pEnd->isLineHead && !is_punct(pEnd, ">")) {
+            pEnd = pEnd->next;
+        }
+        if (pEnd->isLineHead || find_source_file(pEnd->loc) != find_source_file(pToken->loc)) {
+            error_at(pToken->loc, "'>'ł͂܂");
+        }
+        *pIsQuoted = false;
+        *ppRest = skip_line(pEnd->next);
+        const size_t len = pEnd->str - (pToken->str + 1);
+        char* name = arena_calloc(len + 1, sizeof(char));
+        memcpy(name, pToken->str + 1, len);
+        return name;
+    }
+
+    error_at(pToken->loc, "t@CKvł");
+    return NULL;
+}
+
+// CN[ht@CL^it@C1񂾂j
+static void record_included_file(Preprocessor* pPP, const HeaderEntry* pEntry) {
+    for (int i = 0; i < pPP->includedFileCount; ++i) {
+        if (strcmp(pPP->pIncludedFiles[i].pszPath, pEntry->pszPath) == 0) return;
+    }
+    if (pPP->includedFileCap <= pPP->includedFileCount) {
+        pPP->includedFileCap = pPP->includedFileCap ? pPP->includedFileCap * 2 : 16;
+        IncludedFile* pNew = arena_calloc(pPP->includedFileCap, sizeof(IncludedFile));
+        if (pPP->includedFileCount) memcpy(pNew, pPP->pIncludedFiles, pPP->includedFileCount * sizeof(IncludedFile));
+        pPP->pIncludedFiles = pNew;
+    }
+    IncludedFile* pFile = &pPP->pIncludedFiles[pPP->includedFileCount++];
+    pFile->pszPath = pEntry->pszPath;
+    pFile->size = pEntry->size;
+    pFile->mtime = pEntry->mtime;
+}
+
+// CN[ht@C̃g[NpRest̑OɌq̂Ԃ
+// TK_EOFt@C̏I̖ڈƂĎc
+static Token* include_file(Preprocessor* pPP, Token* pRest, const char* pszPath, const Token* pToken) {
+    for (const OnceFile* pOnce = pPP->pOnceFiles; pOnce; pOnce = pOnce->pNext) {
+        if (strcmp(pOnce->pszPath, pszPath) == 0) return pRest;
+    }
+
+    const HeaderEntry* pEntry = get_header(pPP->pOptions->pHeaderCache, pszPath);
+    if (pEntry == NULL) {
+        error_at(pToken->loc, "CN[ht@CJ܂: %s", pszPath);
+    }
+
+    if (pPP->isRecordingFiles) {
+        record_included_file(pPP, pEntry);
+    }
+
+    // CN[hK[h̃}N`ς݂ȂAgɓǂݔ΂
+    if (pEntry->pGuard && find_macro(pPP, pEntry->pGuard)) {
+        return pRest;
+    }
+
+    if (MAX_INCLUDE_DEPTH <= pPP->includeDepth) {
+        error_at(pToken->loc, "CN[h̓q[܂");
+    }
+    ++pPP->includeDepth;
+
+    // LbṼg[N͋LĂ̂ŁA悤ɕ
+    Token* pTokens = arena_calloc(pEntry->tokenCount, sizeof(Token));
+    memcpy(pTokens, pEntry->pTokens, pEntry->tokenCount * sizeof(Token));
+    for (int i = 0; i < pEntry->tokenCount - 1; ++i) {
+        pTokens[i].next = &pTokens[i + 1];
+    }
+    pTokens[pEntry->tokenCount - 1].next = pRest;
+    return pTokens;
+}
+
+//
+// vvZbT{
+//
+
+// gĂȂ#if`#endif΃G[񍐂
+// pFileTokenNULLłȂ΁Ãt@C̒Ŏn܂̂𒲂ׂ
+static void check_cond_incl(const Preprocessor* pPP, const Token* pFileToken) {
+    const CondIncl* pCondIncl = pPP->pCondIncl;
+    if (pCondIncl && (pFileToken == NULL || find_source_file(pCondIncl->pToken->loc) == find_source_file(pFileToken->loc))) {
+        error_at(pCondIncl->pToken->loc, "#endif܂");
+    }
+}
+
+// fBNeBuȂ}NWJ
+static Token* preprocess_tokens(Preprocessor* pPP, Token* pToken) {
+    Token head;
+    head.next = NULL;
+    Token* cur = &head;
+
+    for (;;) {
+        if (pToken->kind == TK_EOF) {
+            if (pToken->next == NULL) break;
+
+            // CN[ht@C̏I
+            check_cond_incl(pPP, pToken);
+            --pPP->includeDepth;
+            pToken = pToken->next;
+            continue;
+        }
+
+        if (expand_macro(pPP, &pToken)) {
+            continue;
+        }
+
+        if (!is_hash(pToken)) {
+            cur = cur->next = pToken;
+            pToken = pToken->next;
+            continue;
+        }
+
+        Token* pHash = pToken;
+        Token* pDir = pToken->next;
+
+        // '#'̍s͉Ȃ
+        if (pDir->isLineHead) {
+            pToken = pDir;
+            continue;
+        }
+
+        if (equal(pDir, "include")) {
+            bool isQuoted = false;
+            const char* name = read_include_filename(&pToken, pDir->next, &isQuoted);
+            const char* pszPath = find_include_file(pPP, pDir->next, name, isQuoted);
+            if (pszPath == NULL) {
+                error_at(pDir->next->loc, "CN[ht@C܂: %s", name);
+            }
+            pToken = include_file(pPP, pToken, pszPath, pDir->next);
+            continue;
+        }
+
+        if (equal(pDir, "define")) {
+            pToken = read_macro_definition(pPP, pDir->next);
+            continue;
+        }
+
+        if (equal(pDir, "undef")) {
+            if (pDir->next->isLineHead || !is_ident_like(pDir->next)) {
+                error_at(pDir->next->loc, "}NKvł");
+            }
+            undef_macro(pPP, pDir->next->str, pDir->next->len);
+            pToken = skip_line(pDir->next->next);
+            continue;
+        }
+
+        if (equal(pDir, "if")) {
+            const long long val = eval_const_expr(pPP, &pToken, pDir);
+            push_cond_incl(pPP, pDir, val != 0);
+            if (!val) {
+                pToken = skip_cond_incl(pToken);
+            }
+            continue;
+        }
+
+        if (equal(pDir, "ifdef") || equal(pDir, "ifndef")) {
+            if (pDir->next->isLineHead || !is_ident_like(pDir->next)) {
+                error_at(pDir->next->loc, "}NKvł");
+            }
+            const bool isDefined = find_macro(pPP, pDir->next) != NULL;
+            const bool isIncluded = equal(pDir, "ifdef") ? isDefined : !isDefined;
+            push_cond_incl(pPP, pDir, isIncluded);
+            pToken = skip_line(pDir->next->next);
+            if (!isIncluded) {
+                pToken = skip_cond_incl(pToken);
+            }
+            continue;
+        }
+
+        if (equal(pDir, "elif")) {
+            if (pPP->pCondIncl == NULL || pPP->pCondIncl->ctx == IN_ELSE) {
+                error_at(pDir->loc, "Ή#if܂");
+            }
+            pPP->pCondIncl->ctx = IN_ELIF;
+
+            // ɗLȕ΁A͕]ɓǂݔ΂
+            if (pPP->pCondIncl->isIncluded) {
+                pToken = skip_cond_incl(skip_line(pDir->next));
+            }
+            else if (eval_const_expr(pPP, &pToken, pDir)) {
+                pPP->pCondIncl->isIncluded = true;
+            }
+            else {
+                pToken = skip_cond_incl(pToken);
+            }
+            continue;
+        }
+
+        if (equal(pDir, "else")) {
+            if (pPP->pCondIncl == NULL || pPP->pCondIncl->ctx == IN_ELSE) {
+                error_at(pDir->loc, "Ή#if܂");
+            }
+            pPP->pCondIncl->ctx = IN_ELSE;
+            pToken = skip_line(pDir->next);
+            if (pPP->pCondIncl->isIncluded) {
+                pToken = skip_cond_incl(pToken);
+            }
+            continue;
+        }
+
+        if (equal(pDir, "endif")) {
+            if (pPP->pCondIncl == NULL) {
+                error_at(pDir->loc, "Ή#if܂");
+            }
+            pPP->pCondIncl = pPP->pCondIncl->pNext;
+            pToken = skip_line(pDir->next);
+            continue;
+        }
+
+        if (equal(pDir, "pragma")) {
+            if (!pDir->next->isLineHead && equal(pDir->next, "once")) {
+                OnceFile* pOnce = arena_calloc(1, sizeof(OnceFile));
+                pOnce->pNext = pPP->pOnceFiles;
+                pOnce->pszPath = get_source_name(pHash->loc);
+                pPP->pOnceFiles = pOnce;
+            }
+            // ̑#pragma͖
+            pToken = skip_line(pDir->next);
+            continue;
+        }
+
+        if (equal(pDir, "line")) {
+            pToken = skip_line(pDir->next);
+            continue;
+        }
+
+        if (equal(pDir, "error")) {
+            const Token* pLast = pDir;
+            while (!pLast->next->isLineHead) pLast = pLast->next;
+            error_at(pDir->loc, "#error %.*s",
+                (pLast == pDir) ? 0 : (int)(pLast->str + pLast->len - pDir->next->str), pDir->next->str);
+        }
+
+        error_at(pDir->loc, "sȃfBNeBuł");
+    }
+
+    check_cond_incl(pPP, NULL);
+    cur->next = pToken;
+    return head.next;
+}
+
+static void define_handler_macro(Preprocessor* pPP, const char* name, MacroHandler pfnHandler) {
+    Macro* pMacro = add_macro(pPP, name, (int)strlen(name));
+    pMacro->pfnHandler = pfnHandler;
+}
+
+// MACRO_LINE_TEXT̈ꕔwg[NcurɌqipFileMACRO_LINE_TEXTo^́j
+static Token* new_line_token(const SourceFile* pFile, Token* cur, int offset, int len) {
+    Token* pToken = arena_calloc(1, sizeof(Token));
+    pToken->kind = TK_RESERVED;
+    pToken->str = MACRO_LINE_TEXT + offset;
+    pToken->len = len;
+    pToken->loc = get_source_loc(pFile, pToken->str);
+    cur->next = pToken;
+    return pToken;
+}
+
+// }N̒`#define̍s̃g[NɂcurɌqAŌ̃g[NԂ
+static Token* append_macro_line(const SourceFile* pFile, const Macro* pMacro, Token* cur) {
+    cur = new_line_token(pFile, cur, 0, 1);
+    cur->isLineHead = true;
+    cur = new_line_token(pFile, cur, 1, 6);
+    cur->kind = TK_IDENT;
+
+    if (!pMacro->isFuncLike) {
+        cur = cur->next = copy_token(pMacro->pName);
+        cur->isLineHead = false;
+    }
+    else {
+        // ֐`}N̓}N̒ɋ󔒂܂'('uKv̂ŁA̕
+        char* buf = arena_calloc(pMacro->len + 2, sizeof(char));
+        memcpy(buf, pMacro->name, pMacro->len);
+        buf[pMacro->len] = '(';
+
+        const SourceFile* pBufFile = add_source_file(get_source_name(pMacro->pName->loc), buf, false);
+        cur = cur->next = copy_token(pMacro->pName);
+        cur->isLineHead = false;
+        cur->str = buf;
+        cur->loc = get_source_loc(pBufFile, buf);
+        cur = cur->next = copy_token(cur);
+        cur->kind = TK_RESERVED;
+        cur->str = buf + pMacro->len;
+        cur->loc = get_source_loc(pBufFile, cur->str);
+        cur->len = 1;
+
+        for (int i = 0; i < pMacro->paramCount; ++i) {
+            if (0 < i) {
+                cur = new_line_token(pFile, cur, 8, 1);
+            }
+            if (pMacro->isVariadic && i == pMacro->paramCount - 1) {
+                cur = new_line_token(pFile, cur, 10, 3);
+            }
+            else {
+                cur = cur->next = copy_token(pMacro->ppParams[i]);
+                cur->isLineHead = false;
+            }
+        }
+        cur = new_line_token(pFile, cur, 9, 1);
+    }
+
+    for (const Token* pToken = pMacro->pBody; pToken->kind != TK_EOF; pToken = pToken->next) {
+        cur = cur->next = copy_token(pToken);
+        cur->isLineHead = false;
+    }
+    return cur;
+}
+
+// I_̏Ԃo
+static void save_state(const Preprocessor* pPP, PreprocessState* pState) {
+    Token head;
+    head.next = NULL;
+    Token* cur = &head;
+    const SourceFile* pFile = add_source_file("<built-in>", MACRO_LINE_TEXT, false);
+    for (int i = 0; i < MACRO_BUCKET_COUNT; ++i) {
+        for (const Macro* pMacro = pPP->pMacros[i]; pMacro; pMacro = pMacro->pNext) {
+            if (pMacro->pName) cur = append_macro_line(pFile, pMacro, cur);
+        }
+    }
+    cur = new_line_token(pFile, cur, (int)sizeof(MACRO_LINE_TEXT) - 1, 0);
+    cur->kind = TK_EOF;
+    cur->isLineHead = true;
+    pState->pMacroLines = head.next;
+
+    int count = 0;
+    for (const OnceFile* pOnce = pPP->pOnceFiles; pOnce; pOnce = pOnce->pNext) ++count;
+    pState->ppOnceFiles = arena_calloc(count ? count : 1, sizeof(const char*));
+    pState->onceFileCount = 0;
+    for (const OnceFile* pOnce = pPP->pOnceFiles; pOnce; pOnce = pOnce->pNext) {
+        pState->ppOnceFiles[pState->onceFileCount++] = pOnce->pszPath;
+    }
+
+    pState->pIncludedFiles = pPP->pIncludedFiles;
+    pState->includedFileCount = pPP->includedFileCount;
+}
+
+// ͂̑O#define̍s̃g[Nq
+static Token* prepend_lines(Token* pLines, Token* pToken) {
+    if (pLines == NULL || pLines->kind == TK_EOF) {
+        return pToken;
+    }
+    Token* pLast = pLines;
+    while (pLast->next->kind != TK_EOF) pLast = pLast->next;
+    pLast->next = pToken;
+    return pLines;
+}
+
+// g[ÑvvZbTfBNeBuA}NWJg[NԂ
+// pStateNULLłȂ΁ȀԂ珈n߁AI_̏Ԃ߂
+Token* preprocess(Token* pToken, const PreprocessOptions* pOptions, PreprocessState* pState) {
+    Preprocessor* pPP = arena_calloc(1, sizeof(Preprocessor));
+    pPP->pOptions = pOptions;
+    pPP->isRecordingFiles = pState != NULL;
+
+    define_handler_macro(pPP, "__FILE__", file_macro);
+    define_handler_macro(pPP, "__LINE__", line_macro);
+
+    // pԂ̃}N#define̍sƂē͂̑Oɒu
+    if (pState) {
+        pToken = prepend_lines(pState->pMacroLines, pToken);
+        for (int i = 0; i < pState->onceFileCount; ++i) {
+            OnceFile* pOnce = arena_calloc(1, sizeof(OnceFile));
+            pOnce->pNext = pPP->pOnceFiles;
+            pOnce->pszPath = pState->ppOnceFiles[i];
+            pPP->pOnceFiles = pOnce;
+        }
+    }
+
+    // -DŎw肳ꂽ}N"#define O l"̍sƂē͂̑Oɒu
+    if (pOptions->defineCount) {
+        StrBuf text = { 0 };
+        for (int i = 0; i < pOptions->defineCount; ++i) {
+            const char* pszDefine = pOptions->ppDefines[i];
+            const char* pEq = strchr(pszDefine, '=');
+            if (pEq) {
+                strbuf_printf(&text, "#define %.*s %s\n", (int)(pEq - pszDefine), pszDefine, pEq + 1);
+            }
+            else {
+                strbuf_printf(&text, "#define %s 1\n", pszDefine);
+            }
+        }
+        char* buf = arena_calloc(text.len + 1, sizeof(char));
+        memcpy(buf, text.data, text.len);
+        strbuf_free(&text);
+
+        pToken = prepend_lines(tokenize_text("<command line>", buf), pToken);
+    }
+
+    Token* pResult = preprocess_tokens(pPP, pToken);
+    if (pState) {
+        save_state(pPP, pState);
+    }
+    return pResult;
+}
+
+// }NWJōꂽƂ\WԂ
+// WJς݂̃g[NۑĕƂɁAhide-set̑Ɏg
+const HideSet* get_expanded_hideset(void) {
+    return &s_expandedHideSet;
+}
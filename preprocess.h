@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+typedef struct Token Token;
+typedef struct HideSet HideSet;
+typedef struct HeaderCache HeaderCache;
+typedef struct PreprocessOptions PreprocessOptions;
+typedef struct IncludedFile IncludedFile;
+typedef struct PreprocessState PreprocessState;
+
+// vvZbT̐ݒ
+struct PreprocessOptions {
+    HeaderCache* pHeaderCache;      // wb_[t@C̃g[ÑLbV
+    const char** ppIncludeDirs;     // -IŎw肳ꂽCN[ht@Č
+    int includeDirCount;            // ppIncludeDirš
+    const char** ppDefines;         // -DŎw肳ꂽ}Ni"O"܂"O=l"j
+    int defineCount;                // ppDefineš
+};
+
+// CN[ht@C
+struct IncludedFile {
+    const char* pszPath;    // t@C̃pX
+    uint64_t size;          // ǂݍ񂾂Ƃ̃t@C̑傫
+    uint64_t mtime;         // ǂݍ񂾂Ƃ̃t@C̍XV
+};
+
+// |PʂI_̃vvZbT̏ԁivRpCς݃wb_[ɕۑj
+struct PreprocessState {
+    Token* pMacroLines;             // `ς݂̃}N#define̍sŕ\g[NiTK_EOFŏIj
+    const char** ppOnceFiles;       // #pragma onceꂽt@C
+    int onceFileCount;              // ppOnceFileš
+    IncludedFile* pIncludedFiles;   // CN[ht@C
+    int includedFileCount;          // pIncludedFileš
+};
+
+// wb_[t@C̃g[ÑLbV쐬
+// LbV̓vZX̑SẴXbhESĂ̖|PʂŋL
+HeaderCache* create_header_cache(void);
+
+// g[ÑvvZbTfBNeBuA}NWJg[NԂ
+// pStateNULLłȂ΁ȀԂ珈n߁AI_̏Ԃ߂
+Token* preprocess(Token* pToken, const PreprocessOptions* pOptions, PreprocessState* pState);
+
+// }NWJōꂽƂ\WԂ
+// WJς݂̃g[NۑĕƂɁAhide-set̑Ɏg
+const HideSet* get_expanded_hideset(void);
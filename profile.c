@@ -0,0 +1,165 @@
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile.h"
+#include "parser.h"
+#include "cache.h"
+#include "error.h"
+#include "sha256.h"
+#include "strbuf.h"
+
+static int compare_func_profile(const void* pLhs, const void* pRhs) {
+    const FuncProfile* pL = (const FuncProfile*)pLhs;
+    const FuncProfile* pR = (const FuncProfile*)pRhs;
+    const int result = strcmp(pL->pszName, pR->pszName);
+    return result ? result : strcmp(pL->hash, pR->hash);
+}
+
+// 󔒂ǂݔ΂Ď̌̐擪ƒԂisȂNULLj
+static const char* next_word(const char** pp, size_t* pLen) {
+    const char* p = *pp;
+    while (*p == ' ' || *p == '\t' || *p == '\r') ++p;
+    if (*p == '\0' || *p == '\n') {
+        *pp = p;
+        return NULL;
+    }
+
+    const char* pStart = p;
+    while (*p && !isspace((unsigned char)*p)) ++p;
+    *pp = p;
+    *pLen = (size_t)(p - pStart);
+    return pStart;
+}
+
+// 𐔒lƂēǂށilłȂfalsej
+static bool parse_count(const char* pWord, size_t len, uint64_t* pValue) {
+    if (len == 0 || !isdigit((unsigned char)*pWord)) return false;
+    char* pEnd;
+    *pValue = strtoull(pWord, &pEnd, 10);
+    return pEnd == pWord + len;
+}
+
+// vt@Cǂݍށit@CAĂꍇ̓G[j
+ProfileData* load_profile(const char* pszPath) {
+    StrBuf text = { 0 };
+    if (!read_binary_file(pszPath, &text)) {
+        error("vt@CJ܂: %s", pszPath);
+    }
+    strbuf_append(&text, "", 1);
+
+    ProfileData* pData = calloc(1, sizeof(ProfileData));
+    int cap = 0;
+    int lineNum = 0;
+    for (const char* p = text.data; *p; ) {
+        ++lineNum;
+        const char* pLineEnd = strchr(p, '\n');
+        pLineEnd = pLineEnd ? pLineEnd : p + strlen(p);
+
+        size_t nameLen, hashLen, len;
+        const char* pName = next_word(&p, &nameLen);
+        if (pName && *pName != '#') {
+            const char* pHash = next_word(&p, &hashLen);
+            const char* pCount = pHash ? next_word(&p, &len) : NULL;
+            uint64_t counterCount = 0;
+            if (pCount == NULL || hashLen != PROFILE_HASH_LEN || !parse_count(pCount, len, &counterCount) || INT32_MAX / 8 < counterCount) {
+                error("%s:%d: vt@CĂ܂", pszPath, lineNum);
+            }
+
+            if (pData->funcCount == cap) {
+                cap = cap ? cap * 2 : 64;
+                pData->pFuncs = realloc(pData->pFuncs, cap * sizeof(FuncProfile));
+            }
+            FuncProfile* pFunc = &pData->pFuncs[pData->funcCount++];
+            pFunc->pszName = calloc(nameLen + 1, sizeof(char));
+            memcpy(pFunc->pszName, pName, nameLen);
+            memcpy(pFunc->hash, pHash, PROFILE_HASH_LEN);
+            pFunc->hash[PROFILE_HASH_LEN] = '\0';
+            pFunc->counterCount = (int)counterCount;
+            pFunc->pCounters = calloc(counterCount ? counterCount : 1, sizeof(uint64_t));
+            for (int i = 0; i < pFunc->counterCount; ++i) {
+                const char* pWord = next_word(&p, &len);
+                if (pWord == NULL || !parse_count(pWord, len, &pFunc->pCounters[i])) {
+                    error("%s:%d: vt@CĂ܂", pszPath, lineNum);
+                }
+            }
+        }
+        p = *pLineEnd ? pLineEnd + 1 : pLineEnd;
+    }
+    strbuf_free(&text);
+
+    // ֐̍sixsĒǋLꂽ́j͍v1ɂ
+    qsort(pData->pFuncs, pData->funcCount, sizeof(FuncProfile), compare_func_profile);
+    int count = 0;
+    for (int i = 0; i < pData->funcCount; ++i) {
+        FuncProfile* pFunc = &pData->pFuncs[i];
+        FuncProfile* pPrev = count ? &pData->pFuncs[count - 1] : NULL;
+        if (pPrev && compare_func_profile(pPrev, pFunc) == 0) {
+            if (pPrev->counterCount != pFunc->counterCount) {
+                error("%s: vt@C%s̃JE^̐sɂĈقȂ܂", pszPath, pFunc->pszName);
+            }
+            for (int j = 0; j < pFunc->counterCount; ++j) {
+                pPrev->pCounters[j] += pFunc->pCounters[j];
+            }
+            free(pFunc->pszName);
+            free(pFunc->pCounters);
+        }
+        else {
+            pData->pFuncs[count++] = *pFunc;
+        }
+    }
+    pData->funcCount = count;
+    return pData;
+}
+
+// ǂݍ񂾃vt@C
+void free_profile(ProfileData* pData) {
+    for (int i = 0; i < pData->funcCount; ++i) {
+        free(pData->pFuncs[i].pszName);
+        free(pData->pFuncs[i].pCounters);
+    }
+    free(pData->pFuncs);
+    free(pData);
+}
+
+// m[h̎ނsɕׂănbVlɊ܂߂iq̖ʒu܂߂Č`ʂj
+static void hash_node(Sha256* pCtx, const Node* pNode) {
+    const uint8_t kind = pNode ? (uint8_t)(pNode->kind + 1) : 0;
+    sha256_update(pCtx, &kind, 1);
+    if (pNode == NULL) return;
+
+    hash_node(pCtx, pNode->lhs);
+    hash_node(pCtx, pNode->rhs);
+    for (int i = 0; i < sizeof(pNode->children) / sizeof(pNode->children[0]); ++i) {
+        hash_node(pCtx, pNode->children[i]);
+    }
+}
+
+// ֐̍\nbV߂
+// \؂̌`狁߂̂ŁÅ֐ύXĂς炸Å֐̌`ςΕς
+void hash_func_structure(const Node* pDefFuncNode, const Node* pBodyNode, char hash[PROFILE_HASH_LEN + 1]) {
+    Sha256 ctx;
+    sha256_init(&ctx);
+    for (int i = 0; i < sizeof(pDefFuncNode->children) / sizeof(pDefFuncNode->children[0]); ++i) {
+        hash_node(&ctx, pDefFuncNode->children[i]);
+    }
+    hash_node(&ctx, pBodyNode);
+
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    sha256_final(&ctx, digest);
+    for (int i = 0; i < PROFILE_HASH_LEN / 2; ++i) {
+        snprintf(hash + i * 2, 3, "%02x", digest[i]);
+    }
+}
+
+// ֐ƍ\nbVvvʂTiNULLj
+const FuncProfile* find_func_profile(const ProfileData* pData, const char* pszName, const char* hash) {
+    FuncProfile key;
+    if (pData->funcCount == 0) return NULL;
+    key.pszName = (char*)pszName;
+    memcpy(key.hash, hash, PROFILE_HASH_LEN + 1);
+    return bsearch(&key, pData->pFuncs, pData->funcCount, sizeof(FuncProfile), compare_func_profile);
+}
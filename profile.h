@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct Node Node;
+typedef struct FuncProfile FuncProfile;
+typedef struct ProfileData ProfileData;
+typedef struct ProfileOptions ProfileOptions;
+
+// \nbV16iŕ\̒
+#define PROFILE_HASH_LEN    (16)
+
+// ̃vt@C̃t@C
+#define DEFAULT_PROFILE_FILE    "chibicc.profdata"
+
+// vR[h𖄂ߍ񂾃vOIɏot@Č`ieLXgA1s1֐j
+//     ֐ \nbV JE^̐ JE^0 JE^1 ...
+// oтɒǋL̂ŁA֐̍s΍vĎg
+
+// 1̊֐̌v
+struct FuncProfile {
+    char* pszName;                      // ֐
+    char hash[PROFILE_HASH_LEN + 1];    // \nbV
+    int counterCount;                   // JE^̐
+    uint64_t* pCounters;                // JE^̒liԍ̓R[hŌv_𕥂oj
+};
+
+// ǂݍ񂾃vt@C
+struct ProfileData {
+    FuncProfile* pFuncs;    // ֐Ƃ̌vʁi֐A\nbV̏ɕׂĂj
+    int funcCount;          // ֐̐
+};
+
+// R[hł̃vt@C̈
+struct ProfileOptions {
+    const char* pszGenerateFile;    // vR[h𖄂ߍ݁Amain߂Ƃɂ̃t@C֏oiNULLȂ疄ߍ܂Ȃj
+    const ProfileData* pUseData;    // ̌ubN̔zuɎgvʁiNULLȂgȂj
+};
+
+// vt@Cǂݍށit@CAĂꍇ̓G[j
+ProfileData* load_profile(const char* pszPath);
+
+// ǂݍ񂾃vt@C
+void free_profile(ProfileData* pData);
+
+// ֐̍\nbV߂
+// \؂̌`狁߂̂ŁÅ֐ύXĂς炸Å֐̌`ςΕς
+void hash_func_structure(const Node* pDefFuncNode, const Node* pBodyNode, char hash[PROFILE_HASH_LEN + 1]);
+
+// ֐ƍ\nbVvvʂTiNULLj
+const FuncProfile* find_func_profile(const ProfileData* pData, const char* pszName, const char* hash);
@@ -0,0 +1,307 @@
+#ifdef _WIN32
+#include <winsock2.h>
+#include <afunix.h>
+#include <direct.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "server.h"
+#include "strbuf.h"
+#include "error.h"
+
+#ifdef _WIN32
+typedef SOCKET Socket;
+#ifndef IO_REPARSE_TAG_AF_UNIX
+#define IO_REPARSE_TAG_AF_UNIX  (0x80000023L)
+#endif
+#define INVALID_SOCKET_VALUE    INVALID_SOCKET
+#define close_socket            closesocket
+#define change_directory        _chdir
+#define get_current_directory   _getcwd
+#define SEND_FLAGS              (0)
+#else
+typedef int Socket;
+#define INVALID_SOCKET_VALUE    (-1)
+#define close_socket            close
+#define change_directory        chdir
+#define get_current_directory   getcwd
+#define SEND_FLAGS              MSG_NOSIGNAL    // 肪ؒfĂSIGPIPEŏIȂ
+#endif
+
+// vƉ̌`il͑SăgGfBA32rbgj
+//     v: ̐ NA ~ NiƃfBNgAFORWARDED_ENV_NAMES̊elAR}hC...j
+//     : IR[hAiWo͂̓ejAiWG[o͂̓ej
+//     : Aei'\0'I[Ȃj
+
+// 󂯕tv̑傫̏
+#define MAX_REQUEST_STRINGS     (65536)
+#define MAX_MESSAGE_STRING_LEN  (256 * 1024 * 1024)
+
+// ڑĂv𑗂I܂ŁA󂯎I܂ł̑҂Ԃ̏ibj
+// rŎ~܂NCAgĂÃNCAg̗v҂Ȃ悤ɂ
+#define CONNECTION_TIMEOUT_SEC  (10)
+
+// RpČʂÊŁANCAg̒lT[o[łgϐ
+// lꍇ͋󕶎𑗂
+static const char* const FORWARDED_ENV_NAMES[] = { "CHIBICC_CACHE_DIR" };
+#define FORWARDED_ENV_COUNT     ((uint32_t)(sizeof(FORWARDED_ENV_NAMES) / sizeof(FORWARDED_ENV_NAMES[0])))
+
+static bool init_socket_library(void) {
+#ifdef _WIN32
+    WSADATA wsaData;
+    return WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+#else
+    return true;
+#endif
+}
+
+static bool make_socket_address(const char* pszSocketPath, struct sockaddr_un* pAddr) {
+    memset(pAddr, 0, sizeof(*pAddr));
+    pAddr->sun_family = AF_UNIX;
+    if (sizeof(pAddr->sun_path) <= strlen(pszSocketPath)) {
+        return false;
+    }
+    memcpy(pAddr->sun_path, pszSocketPath, strlen(pszSocketPath));
+    return true;
+}
+
+// MƑM~܂܂܂ɂȂȂ悤A҂Ԃ̏ݒ肷
+static void set_socket_timeout(Socket sock, int seconds) {
+#ifdef _WIN32
+    const DWORD timeout = seconds * 1000;
+#else
+    struct timeval timeout = { 0 };
+    timeout.tv_sec = seconds;
+#endif
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+}
+
+// ϐݒ肷ilȂ폜j
+static void set_env(const char* pszName, const char* pszValue) {
+#ifdef _WIN32
+    _putenv_s(pszName, pszValue);
+#else
+    if (*pszValue) setenv(pszName, pszValue, 1);
+    else unsetenv(pszName);
+#endif
+}
+
+// ÕT[o[c\Pbgt@C΍폜
+// pXɃ\PbgȊÕt@Cꍇ́AďȂ悤폜falseԂ
+static bool remove_stale_socket(const char* pszSocketPath) {
+#ifdef _WIN32
+    WIN32_FIND_DATAA data;
+    HANDLE hFind = FindFirstFileA(pszSocketPath, &data);
+    if (hFind == INVALID_HANDLE_VALUE) return true;
+    FindClose(hFind);
+
+    // Windows̃\Pbgt@ĆAAF_UNIX̃^Otp[X|CgɂȂĂ
+    const bool isSocket = (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) && data.dwReserved0 == IO_REPARSE_TAG_AF_UNIX;
+    return isSocket && DeleteFileA(pszSocketPath);
+#else
+    struct stat st;
+    if (lstat(pszSocketPath, &st) != 0) return true;
+    return S_ISSOCK(st.st_mode) && unlink(pszSocketPath) == 0;
+#endif
+}
+
+static bool send_all(Socket sock, const void* pData, size_t len) {
+    const char* p = pData;
+    while (len) {
+        const int sent = send(sock, p, (int)len, SEND_FLAGS);
+        if (sent <= 0) return false;
+        p += sent;
+        len -= sent;
+    }
+    return true;
+}
+
+static bool recv_all(Socket sock, void* pData, size_t len) {
+    char* p = pData;
+    while (len) {
+        const int received = recv(sock, p, (int)len, 0);
+        if (received <= 0) return false;
+        p += received;
+        len -= received;
+    }
+    return true;
+}
+
+static bool send_u32(Socket sock, uint32_t value) {
+    const uint8_t bytes[4] = { value & 0xFF, (value >> 8) & 0xFF, (value >> 16) & 0xFF, (value >> 24) & 0xFF };
+    return send_all(sock, bytes, sizeof(bytes));
+}
+
+static bool recv_u32(Socket sock, uint32_t* pValue) {
+    uint8_t bytes[4];
+    if (!recv_all(sock, bytes, sizeof(bytes))) return false;
+    *pValue = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+    return true;
+}
+
+static bool send_string(Socket sock, const char* str, size_t len) {
+    return send_u32(sock, (uint32_t)len) && send_all(sock, str, len);
+}
+
+// 󂯎A'\0'I[Ԃ
+static char* recv_string(Socket sock, uint32_t* pLen) {
+    uint32_t len;
+    if (!recv_u32(sock, &len) || MAX_MESSAGE_STRING_LEN < len) return NULL;
+
+    char* str = calloc(len + 1, sizeof(char));
+    if (!recv_all(sock, str, len)) {
+        free(str);
+        return NULL;
+    }
+    if (pLen) *pLen = len;
+    return str;
+}
+
+// 1̐ڑv󂯎ďAԂ
+static void serve_connection(Socket sock, CompileRequestFunc pfnCompile) {
+    uint32_t count;
+    if (!recv_u32(sock, &count) || count <= FORWARDED_ENV_COUNT || MAX_REQUEST_STRINGS < count) return;
+
+    // 擪͍ƃfBNgAɊϐ̒lAc̓R}hCiargv[0]͕₤j
+    char** ppStrings = calloc(count + 1, sizeof(char*));
+    uint32_t received = 0;
+    while (received < count && (ppStrings[received] = recv_string(sock, NULL)) != NULL) {
+        ++received;
+    }
+
+    if (received == count) {
+        StrBuf out = { 0 };
+        StrBuf err = { 0 };
+        int exitCode = 1;
+
+        // ΃pX̓NCAg̍ƃfBNgɂAϐNCAg̒lg
+        // v1̂ŁAvZXŜ̍ƃfBNgϐ؂ւĂ悢
+        for (uint32_t i = 0; i < FORWARDED_ENV_COUNT; ++i) {
+            set_env(FORWARDED_ENV_NAMES[i], ppStrings[1 + i]);
+        }
+        if (change_directory(ppStrings[0]) == 0) {
+            // Ō̊ϐ̒l̈ʒuargv[0]ɎgǍR}hCƂ
+            char** ppArgs = ppStrings + FORWARDED_ENV_COUNT;
+            char* pszArg0 = ppArgs[0];
+            ppArgs[0] = "chibicc";
+            exitCode = pfnCompile((int)(count - FORWARDED_ENV_COUNT), ppArgs, &out, &err);
+            ppArgs[0] = pszArg0;
+        }
+        else {
+            strbuf_printf(&err, "cannot change directory to %s\n", ppStrings[0]);
+        }
+
+        send_u32(sock, (uint32_t)exitCode);
+        send_string(sock, out.data ? out.data : "", out.len);
+        send_string(sock, err.data ? err.data : "", err.len);
+        strbuf_free(&out);
+        strbuf_free(&err);
+    }
+
+    for (uint32_t i = 0; i < received; ++i) {
+        free(ppStrings[i]);
+    }
+    free(ppStrings);
+}
+
+// [J\Pbgő҂󂯁A󂯎RpCvpfnCompileŏɏ
+// vƂɃvZXNȂčςނ̂ŁAvZXɕێ̗vłėpł
+int run_server(const char* pszSocketPath, CompileRequestFunc pfnCompile) {
+    struct sockaddr_un addr;
+    if (!init_socket_library() || !make_socket_address(pszSocketPath, &addr)) {
+        error("T[o[̒ʐMł܂: %s", pszSocketPath);
+    }
+
+    const Socket listenSock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenSock == INVALID_SOCKET_VALUE) {
+        error("҂󂯗p̐ڑ쐬ł܂: %s", pszSocketPath);
+    }
+
+    if (!remove_stale_socket(pszSocketPath)) {
+        error("ʐMpł͂Ȃt@Cɂ̂ŁA҂󂯂ł܂: %s", pszSocketPath);
+    }
+    if (bind(listenSock, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenSock, 16) != 0) {
+        error("ڑ҂󂯂ł܂: %s", pszSocketPath);
+    }
+
+    for (;;) {
+        const Socket sock = accept(listenSock, NULL, NULL);
+        if (sock == INVALID_SOCKET_VALUE) continue;
+
+        set_socket_timeout(sock, CONNECTION_TIMEOUT_SEC);
+        serve_connection(sock, pfnCompile);
+        close_socket(sock);
+    }
+}
+
+// T[o[ɃRpCvAԂĂo͂ƃG[Wo͂ƕWG[o͂ɏo
+// ƃfBNgƁARpČʂEϐiCHIBICC_CACHE_DIRj̒lꏏɑ
+// T[o[ɐڑłȂꍇfalseԂ
+bool request_compile(const char* pszSocketPath, int argc, char** argv, int* pExitCode) {
+    struct sockaddr_un addr;
+    if (!init_socket_library() || !make_socket_address(pszSocketPath, &addr)) {
+        return false;
+    }
+
+    const Socket sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock == INVALID_SOCKET_VALUE) {
+        return false;
+    }
+    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close_socket(sock);
+        return false;
+    }
+
+    char cwd[4096];
+    if (!get_current_directory(cwd, sizeof(cwd))) {
+        close_socket(sock);
+        return false;
+    }
+
+    // argv[0]̑ɍƃfBNg𑗂AĊϐ̒l𑗂
+    bool isOk = send_u32(sock, (uint32_t)argc + FORWARDED_ENV_COUNT) && send_string(sock, cwd, strlen(cwd));
+    for (uint32_t i = 0; isOk && i < FORWARDED_ENV_COUNT; ++i) {
+        const char* pszValue = getenv(FORWARDED_ENV_NAMES[i]);
+        isOk = send_string(sock, pszValue ? pszValue : "", pszValue ? strlen(pszValue) : 0);
+    }
+    for (int i = 1; isOk && i < argc; ++i) {
+        isOk = send_string(sock, argv[i], strlen(argv[i]));
+    }
+
+    uint32_t exitCode = 1;
+    uint32_t outLen = 0;
+    uint32_t errLen = 0;
+    char* pszOut = NULL;
+    char* pszErr = NULL;
+    isOk = isOk && recv_u32(sock, &exitCode)
+        && (pszOut = recv_string(sock, &outLen)) != NULL
+        && (pszErr = recv_string(sock, &errLen)) != NULL;
+    close_socket(sock);
+
+    if (isOk) {
+        fwrite(pszOut, 1, outLen, stdout);
+        fwrite(pszErr, 1, errLen, stderr);
+        *pExitCode = (int)exitCode;
+    }
+    free(pszOut);
+    free(pszErr);
+
+    // Mɐڑ؂ꂽꍇ́AT[o[ǂȂ̂ŃG[Ƃ
+    if (!isOk) {
+        error("RpCT[o[Ƃ̒ʐMɎs܂: %s", pszSocketPath);
+    }
+    return true;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdbool.h>
+
+typedef struct StrBuf StrBuf;
+
+// RpCv֐
+// argv̓R}hCƓ`iargv[0]̓vOj
+// Wo͂ɏoepOutɁAG[pErrɏ݁AIR[hԂ
+typedef int (*CompileRequestFunc)(int argc, char** argv, StrBuf* pOut, StrBuf* pErr);
+
+// [J\Pbgő҂󂯁A󂯎RpCvpfnCompileŏɏ
+// vƂɃvZXNȂčςނ̂ŁAvZXɕێ̗vłėpł
+int run_server(const char* pszSocketPath, CompileRequestFunc pfnCompile);
+
+// T[o[ɃRpCvAԂĂo͂ƃG[Wo͂ƕWG[o͂ɏo
+// ƃfBNgƁARpČʂEϐiCHIBICC_CACHE_DIRj̒lꏏɑ
+// T[o[ɐڑłȂꍇfalseԂ
+bool request_compile(const char* pszSocketPath, int argc, char** argv, int* pExitCode);
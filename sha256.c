@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "sha256.h"
+
+// FIPS 180-4Œ߂ꂽ萔
+static const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static uint32_t rotr(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+// 64oCg̃ubN1
+static void sha256_block(Sha256* pCtx, const uint8_t* p) {
+    uint32_t w[64];
+    int i;
+
+    for (i = 0; i < 16; ++i) {
+        w[i] = ((uint32_t)p[i * 4] << 24) | ((uint32_t)p[i * 4 + 1] << 16) | ((uint32_t)p[i * 4 + 2] << 8) | p[i * 4 + 3];
+    }
+    for (i = 16; i < 64; ++i) {
+        const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = pCtx->state[0], b = pCtx->state[1], c = pCtx->state[2], d = pCtx->state[3];
+    uint32_t e = pCtx->state[4], f = pCtx->state[5], g = pCtx->state[6], h = pCtx->state[7];
+    for (i = 0; i < 64; ++i) {
+        const uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+        const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    pCtx->state[0] += a;
+    pCtx->state[1] += b;
+    pCtx->state[2] += c;
+    pCtx->state[3] += d;
+    pCtx->state[4] += e;
+    pCtx->state[5] += f;
+    pCtx->state[6] += g;
+    pCtx->state[7] += h;
+}
+
+// vZJn
+void sha256_init(Sha256* pCtx) {
+    static const uint32_t INITIAL_STATE[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    memcpy(pCtx->state, INITIAL_STATE, sizeof(INITIAL_STATE));
+    pCtx->totalLen = 0;
+    pCtx->blockLen = 0;
+}
+
+// f[^ǉ
+void sha256_update(Sha256* pCtx, const void* pData, size_t len) {
+    const uint8_t* p = pData;
+    pCtx->totalLen += len;
+
+    while (len) {
+        size_t n = sizeof(pCtx->block) - pCtx->blockLen;
+        if (len < n) n = len;
+
+        memcpy(pCtx->block + pCtx->blockLen, p, n);
+        pCtx->blockLen += n;
+        p += n;
+        len -= n;
+
+        if (pCtx->blockLen == sizeof(pCtx->block)) {
+            sha256_block(pCtx, pCtx->block);
+            pCtx->blockLen = 0;
+        }
+    }
+}
+
+// vZIănbVlԂ
+void sha256_final(Sha256* pCtx, uint8_t digest[SHA256_DIGEST_SIZE]) {
+    const uint64_t bitLen = pCtx->totalLen * 8;
+    uint8_t padding[72] = { 0x80 };
+
+    // 0x800l߂Ďc肪8oCgɂȂ悤ɂAŌɃrbgǉ
+    const size_t padLen = (pCtx->blockLen < 56) ? (56 - pCtx->blockLen) : (120 - pCtx->blockLen);
+    for (int i = 0; i < 8; ++i) {
+        padding[padLen + i] = (uint8_t)(bitLen >> (56 - i * 8));
+    }
+    sha256_update(pCtx, padding, padLen + 8);
+
+    for (int i = 0; i < 8; ++i) {
+        digest[i * 4] = (uint8_t)(pCtx->state[i] >> 24);
+        digest[i * 4 + 1] = (uint8_t)(pCtx->state[i] >> 16);
+        digest[i * 4 + 2] = (uint8_t)(pCtx->state[i] >> 8);
+        digest[i * 4 + 3] = (uint8_t)pCtx->state[i];
+    }
+}
+
+// nbVl16i̕i65oCgA'\0'I[jɕϊ
+void sha256_to_hex(const uint8_t digest[SHA256_DIGEST_SIZE], char* pszHex) {
+    for (int i = 0; i < SHA256_DIGEST_SIZE; ++i) {
+        snprintf(pszHex + i * 2, 3, "%02x", digest[i]);
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHA256_DIGEST_SIZE  (32)
+
+typedef struct Sha256 Sha256;
+
+// SHA-256̌vZȑ
+struct Sha256 {
+    uint32_t state[8];      // nbVl
+    uint64_t totalLen;      // ܂łɓ͂oCg
+    uint8_t block[64];      // ҂̓
+    size_t blockLen;        // blockɗ܂ĂoCg
+};
+
+// vZJn
+void sha256_init(Sha256* pCtx);
+
+// f[^ǉ
+void sha256_update(Sha256* pCtx, const void* pData, size_t len);
+
+// vZIănbVlԂ
+void sha256_final(Sha256* pCtx, uint8_t digest[SHA256_DIGEST_SIZE]);
+
+// nbVl16i̕i65oCgA'\0'I[jɕϊ
+void sha256_to_hex(const uint8_t digest[SHA256_DIGEST_SIZE], char* pszHex);
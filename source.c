@@ -0,0 +1,158 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "source.h"
+#include "error.h"
+#include "thread.h"
+
+// o^\[Ẍꗗibasȅj
+// ͕͂̃XbhœɍŝŁAꗗ̓bNŎ
+static Mutex* s_pLock = NULL;
+static SourceFile** s_ppFiles = NULL;
+static int s_fileCount = 0;
+static int s_fileCap = 0;
+static SourceLoc s_nextBase = 1;    // ɓo^\[Xbasei0͈ʒuɎgj
+
+// \[Ẍꗗg悤ɂi[J[XbhOɌĂԁB2ڈȍ~͉Ȃj
+void init_source_files(void) {
+    if (s_pLock == NULL) {
+        s_pLock = create_mutex();
+    }
+}
+
+static void lock_files(void) {
+    // 1̃XbhŎgꍇ́Ainit_source_filesĂ΂ȂĂ悢
+    init_source_files();
+    lock_mutex(s_pLock);
+}
+
+// \[Xo^
+// pszNamepText́Ao^܂ŁiisPersistentȂɁjLłȂ΂ȂȂ
+SourceFile* add_source_file(const char* pszName, const char* pText, bool isPersistent) {
+    SourceFile* pFile = calloc(1, sizeof(SourceFile));
+    pFile->pszName = pszName;
+    pFile->pText = pText;
+    pFile->size = (uint32_t)strlen(pText);
+    pFile->isPersistent = isPersistent;
+
+    lock_files();
+    if (UINT32_MAX - s_nextBase <= pFile->size) {
+        unlock_mutex(s_pLock);
+        error("t@C傫āAʒu32rbgɎ܂܂: %s", pszName);
+    }
+    pFile->base = s_nextBase;
+    s_nextBase += pFile->size + 1;
+    if (s_fileCount == s_fileCap) {
+        s_fileCap = s_fileCap ? s_fileCap * 2 : 64;
+        s_ppFiles = realloc(s_ppFiles, s_fileCap * sizeof(SourceFile*));
+    }
+    s_ppFiles[s_fileCount++] = pFile;
+    unlock_mutex(s_pLock);
+    return pFile;
+}
+
+// \[X̒̈̕ʒuԂ
+SourceLoc get_source_loc(const SourceFile* pFile, const char* p) {
+    return pFile->base + (SourceLoc)(p - pFile->pText);
+}
+
+// ʒu܂ރ\[X񕪒TibNlĂĂԁj
+static SourceFile* search_file(SourceLoc loc) {
+    int lo = 0;
+    int hi = s_fileCount;
+    while (lo < hi) {
+        const int mid = lo + (hi - lo) / 2;
+        if (s_ppFiles[mid]->base <= loc) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == 0) return NULL;
+    SourceFile* pFile = s_ppFiles[lo - 1];
+    return source_file_contains(pFile, loc) ? pFile : NULL;
+}
+
+// ʒu܂ރ\[XԂiʒuNULLj
+const SourceFile* find_source_file(SourceLoc loc) {
+    if (loc == 0) return NULL;
+    lock_files();
+    const SourceFile* pFile = search_file(loc);
+    unlock_mutex(s_pLock);
+    return pFile;
+}
+
+// ʒu\[XɊ܂܂ĂtrueԂ
+bool source_file_contains(const SourceFile* pFile, SourceLoc loc) {
+    return pFile->base <= loc && loc <= pFile->base + pFile->size;
+}
+
+// ʒu܂ރ\[X̃t@CԂiʒu΋󕶎j
+const char* get_source_name(SourceLoc loc) {
+    const SourceFile* pFile = find_source_file(loc);
+    return pFile ? pFile->pszName : "";
+}
+
+// s̐擪̃ItZbgL^i͂sǂݐi߂邽тɌĂԁj
+void add_line_start(SourceFile* pFile, uint32_t offset) {
+    if (pFile->lineCount == pFile->lineCap) {
+        pFile->lineCap = pFile->lineCap ? pFile->lineCap * 2 : 256;
+        pFile->pLineStarts = realloc(pFile->pLineStarts, pFile->lineCap * sizeof(uint32_t));
+    }
+    pFile->pLineStarts[pFile->lineCount++] = offset;
+}
+
+// ʒu܂ރ\[Xł̍sԍi1jԂAppLineɍs̐擪ށiʒu0Ԃj
+int get_source_line(SourceLoc loc, const char** ppLine) {
+    if (loc == 0) return 0;
+    lock_files();
+    SourceFile* pFile = search_file(loc);
+    if (pFile == NULL) {
+        unlock_mutex(s_pLock);
+        return 0;
+    }
+
+    // ͂ĂȂ\[XivRpCς݃wb_[Ȃǂǂݍ񂾂́jA
+    // ͂̓rŃG[ɂȂ\[X́Aōs̕\
+    if (!pFile->hasLines) {
+        pFile->lineCount = 0;
+        add_line_start(pFile, 0);
+        for (uint32_t i = 0; i < pFile->size; ++i) {
+            if (pFile->pText[i] == '\n') add_line_start(pFile, i + 1);
+        }
+        pFile->hasLines = true;
+    }
+
+    // offsetȉōő̍s̐擪񕪒T
+    const uint32_t offset = loc - pFile->base;
+    int lo = 0;
+    int hi = pFile->lineCount;
+    while (lo < hi) {
+        const int mid = lo + (hi - lo) / 2;
+        if (pFile->pLineStarts[mid] <= offset) lo = mid + 1;
+        else hi = mid;
+    }
+    *ppLine = pFile->pText + pFile->pLineStarts[lo - 1];
+    unlock_mutex(s_pLock);
+    return lo;
+}
+
+// isPersistentłȂ\[X̓o^SĉÄʒuĂюg悤ɂ
+// o^\[Ẍʒug[NcĂȂ_iRpC̏IjŌĂ
+void release_source_files(void) {
+    lock_files();
+    int count = 0;
+    s_nextBase = 1;
+    for (int i = 0; i < s_fileCount; ++i) {
+        SourceFile* pFile = s_ppFiles[i];
+        if (pFile->isPersistent) {
+            s_ppFiles[count++] = pFile;
+            s_nextBase = pFile->base + pFile->size + 1;
+        }
+        else {
+            free(pFile->pLineStarts);
+            free(pFile);
+        }
+    }
+    s_fileCount = count;
+    unlock_mutex(s_pLock);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// \[Ẍʒu
+// o^SẴ\[X̓e1̋ԂɕׂƂ̒ʂԍŁA0͈ʒuƂ\
+// \[XƂbasebase+sizei'\0'̈ʒuj܂łĝŁAׂ荇\[ẌʒuA邱Ƃ͂Ȃ
+typedef uint32_t SourceLoc;
+
+typedef struct SourceFile SourceFile;
+
+// o^\[Xit@C̓eA}NWJōj
+struct SourceFile {
+    const char* pszName;    // t@C
+    const char* pText;      // ei'\0'I[j
+    uint32_t size;          // e̒
+    SourceLoc base;         // 擪̈̕ʒu
+    uint32_t* pLineStarts;  // es̐擪̃ItZbgi͂ōj
+    int lineCount;          // L^s̐
+    int lineCap;            // pLineStarts̗e
+    bool hasLines;          // SĂ̍sL^IĂtrue
+    bool isPersistent;      // release_source_filesœo^ȂȂtrue
+};
+
+// \[Ẍꗗg悤ɂi[J[XbhOɌĂԁB2ڈȍ~͉Ȃj
+void init_source_files(void);
+
+// \[Xo^
+// pszNamepText́Ao^܂ŁiisPersistentȂɁjLłȂ΂ȂȂ
+SourceFile* add_source_file(const char* pszName, const char* pText, bool isPersistent);
+
+// \[X̒̈̕ʒuԂ
+SourceLoc get_source_loc(const SourceFile* pFile, const char* p);
+
+// ʒu܂ރ\[XԂiʒuNULLj
+const SourceFile* find_source_file(SourceLoc loc);
+
+// ʒu\[XɊ܂܂ĂtrueԂ
+bool source_file_contains(const SourceFile* pFile, SourceLoc loc);
+
+// ʒu܂ރ\[X̃t@CԂiʒu΋󕶎j
+const char* get_source_name(SourceLoc loc);
+
+// ʒu܂ރ\[Xł̍sԍi1jԂAppLineɍs̐擪ށiʒu0Ԃj
+int get_source_line(SourceLoc loc, const char** ppLine);
+
+// s̐擪̃ItZbgL^i͂sǂݐi߂邽тɌĂԁj
+void add_line_start(SourceFile* pFile, uint32_t offset);
+
+// isPersistentłȂ\[X̓o^SĉÄʒuĂюg悤ɂ
+// o^\[Ẍʒug[NcĂȂ_iRpC̏IjŌĂ
+void release_source_files(void);
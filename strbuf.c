@@ -0,0 +1,71 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "strbuf.h"
+#include "error.h"
+
+// ŒłnewLen+1oCgi[ł悤ɗeʂg
+static void strbuf_reserve(StrBuf* pBuf, size_t newLen) {
+    if (newLen + 1 <= pBuf->cap) {
+        return;
+    }
+
+    size_t newCap = pBuf->cap ? pBuf->cap : 256;
+    while (newCap < newLen + 1) {
+        newCap *= 2;
+    }
+
+    char* pNewData = realloc(pBuf->data, newCap);
+    if (pNewData == NULL) {
+        error("Internal Error. Out of memory.");
+    }
+    pBuf->data = pNewData;
+    pBuf->cap = newCap;
+}
+
+// obt@̖Ɏw肳ꂽ̕ǉ
+void strbuf_append(StrBuf* pBuf, const char* str, size_t len) {
+    strbuf_reserve(pBuf, pBuf->len + len);
+    memcpy(pBuf->data + pBuf->len, str, len);
+    pBuf->len += len;
+    pBuf->data[pBuf->len] = '\0';
+}
+
+// obt@̖vprintfƓŕǉ
+void strbuf_vprintf(StrBuf* pBuf, const char* fmt, va_list ap) {
+    va_list apCopy;
+
+    // ܂͎ceʂ֒ڏ݁AȂΊgĂ珑
+    strbuf_reserve(pBuf, pBuf->len + 64);
+    va_copy(apCopy, ap);
+    int len = vsnprintf(pBuf->data + pBuf->len, pBuf->cap - pBuf->len, fmt, apCopy);
+    va_end(apCopy);
+
+    if (len < 0) {
+        error("Internal Error. Invalid format '%s'.", fmt);
+    }
+
+    if (pBuf->cap - pBuf->len <= (size_t)len) {
+        strbuf_reserve(pBuf, pBuf->len + len);
+        vsnprintf(pBuf->data + pBuf->len, pBuf->cap - pBuf->len, fmt, ap);
+    }
+    pBuf->len += len;
+}
+
+// obt@̖printfƓŕǉ
+void strbuf_printf(StrBuf* pBuf, const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    strbuf_vprintf(pBuf, fmt, ap);
+    va_end(ap);
+}
+
+// obt@mۂĂ郁
+void strbuf_free(StrBuf* pBuf) {
+    free(pBuf->data);
+    pBuf->data = NULL;
+    pBuf->len = 0;
+    pBuf->cap = 0;
+}
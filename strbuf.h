@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdarg.h>
+#include <stddef.h>
+
+// L\ȕobt@
+typedef struct StrBuf StrBuf;
+struct StrBuf {
+    char* data;     // ei'\0'I[j
+    size_t len;     // e̒
+    size_t cap;     // mۍς݂̗e
+};
+
+// obt@̖Ɏw肳ꂽ̕ǉ
+void strbuf_append(StrBuf* pBuf, const char* str, size_t len);
+
+// obt@̖vprintfƓŕǉ
+void strbuf_vprintf(StrBuf* pBuf, const char* fmt, va_list ap);
+
+// obt@̖printfƓŕǉ
+void strbuf_printf(StrBuf* pBuf, const char* fmt, ...);
+
+// obt@mۂĂ郁
+void strbuf_free(StrBuf* pBuf);
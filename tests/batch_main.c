@@ -0,0 +1,41 @@
+// まとめてリンクしたテストを順に実行する（run_testsがバッチごとに生成する表と一緒にリンクする）
+//
+// 各テストのmainはシンボルの先頭に"t<番号>_"を付けて名前を変えてあり、g_testsから呼ぶ
+// テストごとにforkした子プロセスで呼ぶので、グローバル変数は毎回初期状態に戻り、
+// クラッシュや無限ループも他のテストに影響しない
+// 結果は1テスト1行で"番号 exit 終了コード"か"番号 signal シグナル番号"として標準出力に書く
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// 1つのテストに許す時間（秒）
+#define TEST_TIMEOUT    (10)
+
+extern int (*g_tests[])();
+extern int g_testIds[];
+extern int g_testCount;
+
+int main(void) {
+    for (int i = 0; i < g_testCount; ++i) {
+        fflush(stdout);
+        const pid_t pid = fork();
+        if (pid < 0) {
+            printf("%d fork\n", g_testIds[i]);
+            continue;
+        }
+        if (pid == 0) {
+            alarm(TEST_TIMEOUT);
+            _exit(g_tests[i]() & 0xff);
+        }
+
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (WIFEXITED(status)) {
+            printf("%d exit %d\n", g_testIds[i], WEXITSTATUS(status));
+        }
+        else {
+            printf("%d signal %d\n", g_testIds[i], WTERMSIG(status));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,980 @@
+// chibiccのテストをLinux上でまとめて実行する
+//
+// 使い方: run_tests [-c chibicc] [-d batch_main.o] [-j 並列数] [-b バッチの大きさ] [-w 作業ディレクトリ] [-m モード,...] cases/*.txt
+//
+// テストケースはデータファイルに次の形式で書く（最初の"==="より前の行はコメント）
+//   === exit 42        終了コードが42になる（"exit nonzero"なら0以外になる）
+//   ソース
+//   --- other          （省略可）gccでコンパイルして一緒にリンクするソース
+//   ソース
+//   === error          コンパイルエラーになる
+//   ソース
+//   --- stderr         chibiccが標準エラー出力に書く内容（ソースはtest.cという名前でコンパイルする）
+//   診断メッセージ
+//
+// 全テストを-mで選んだモード（既定はall）ごとに実行する（モードの一覧はMODESを参照）
+// モードはtest.oを作るまでの手順と、手順の後で一致を確かめるファイルを決める
+// 例えばastモードでは-dump-astと-load-astを経たtest.oが、直接コンパイルしたref.oと一致しなければならない
+// コンパイルエラーのテストは、どのモードでも同じ診断メッセージでコンパイルに失敗することを確かめる
+//
+// テストを1つずつ処理するのではなく、段階ごとに全テストをまとめて並列に処理する
+//   1. 全テストをモードの手順に従ってchibiccでコンパイルする（--- otherはgccでコンパイルする）
+//      -runのように手順の中でテストを実行するモードは、その終了コードを確かめて終わる
+//   2. 他のソースを必要としないテストは、objcopyでシンボルの先頭に"t<番号>_"を付けてバッチにまとめ、
+//      batch_main.oと一緒に1つの実行ファイルにリンクする
+//      --- otherのあるテストと、リンクに失敗したバッチのテストは、1つずつ実行ファイルにする
+//   3. 実行ファイルを並列に実行し、終了コードを確かめる
+// 失敗したテストと段階ごとの時間を表示し、失敗があれば1を返す
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// 1つずつ実行するテストに許すCPU時間（秒）
+#define TEST_TIMEOUT    (10)
+
+typedef struct Text Text;
+typedef struct Step Step;
+typedef struct Mode Mode;
+typedef struct TestCase TestCase;
+typedef struct Command Command;
+typedef struct CommandList CommandList;
+
+// 伸長する文字列
+struct Text {
+    char* data;
+    size_t len;
+    size_t cap;
+};
+
+// 期待する結果
+typedef enum {
+    EXPECT_EXIT,        // 終了コードがexitCodeになる
+    EXPECT_NONZERO,     // 終了コードが0以外になる
+    EXPECT_ERROR,       // コンパイルエラーになり、診断メッセージがstderrTextと一致する
+} ExpectKind;
+
+// 手順の種類
+typedef enum {
+    STEP_COMPILE,       // コマンドが成功しなければならない
+    STEP_RUN,           // テストのプログラムを実行し、終了コードを確かめる
+} StepKind;
+
+// test.oを作るまでの手順の1つ
+// 引数の"$CC"はchibicc、"$OTHER"は--- otherのオブジェクトファイルに置き換える（--- otherが無ければ省く）
+struct Step {
+    StepKind kind;
+    const char* ppArgs[10];     // NULL終端
+};
+
+// テストを実行するモード
+struct Mode {
+    const char* pszName;
+    Step steps[4];
+    const char* pszCompare;     // 手順の後でtest.oと一致しなければならないファイル（NULLなら比べない）
+    const char* pszExtraFile;   // 手順の前に各テストの作業ディレクトリに書き出すファイル
+    const char* pszExtraText;
+    bool isServer;              // コンパイルサーバーを起動し、環境変数CHIBICC_SERVERで使わせる
+    bool isRunOnly;             // 手順の中でテストを実行するので、リンクと実行をしない（--- otherのあるテストは除く）
+};
+
+#define CC  "$CC"
+
+static const Mode MODES[] = {
+    { "default", { { STEP_COMPILE, { CC, "-c", "-o", "test.o", "test.c" } } } },
+    { "g", { { STEP_COMPILE, { CC, "-g", "-c", "-o", "test.o", "test.c" } } } },
+    { "stream", { { STEP_COMPILE, { CC, "-stream", "-c", "-o", "test.o", "test.c" } } } },
+    { "whole-program", { { STEP_COMPILE, { CC, "-fwhole-program", "-c", "-o", "test.o", "test.c" } } } },
+    { "run", { { STEP_RUN, { CC, "-run", "test.c" } } }, .isRunOnly = true },
+    // 関数単位で並列に生成しても、1スレッドで生成したものと一致する
+    { "jobs", {
+        { STEP_COMPILE, { CC, "-j", "8", "-c", "-o", "test.o", "test.c" } },
+        { STEP_COMPILE, { CC, "-j", "1", "-c", "-o", "ref.o", "test.c" } } },
+        "ref.o" },
+    { "manifest", {
+        { STEP_COMPILE, { CC, "-j", "8", "-c", "-manifest", "manifest.txt" } },
+        { STEP_COMPILE, { CC, "-c", "-o", "ref.o", "test.c" } } },
+        "ref.o", "manifest.txt", "test.c test.o\n" },
+    { "server", { { STEP_COMPILE, { CC, "-c", "-o", "test.o", "test.c" } } }, .isServer = true },
+    // 2回目はキャッシュから取り出したものになる
+    { "cache", {
+        { STEP_COMPILE, { CC, "-cache-dir", "cache", "-cache-max-size", "1", "-c", "-o", "ref.o", "test.c" } },
+        { STEP_COMPILE, { CC, "-cache-dir", "cache", "-cache-max-size", "1", "-c", "-o", "test.o", "test.c" } } },
+        "ref.o" },
+    // 2回目は前回の生成結果を使い回したものになる
+    { "incremental", {
+        { STEP_COMPILE, { CC, "-incremental", "-c", "-o", "test.o", "test.c" } },
+        { STEP_COMPILE, { CC, "-incremental", "-c", "-o", "test.o", "test.c" } },
+        { STEP_COMPILE, { CC, "-c", "-o", "ref.o", "test.c" } } },
+        "ref.o" },
+    { "pch", {
+        { STEP_COMPILE, { CC, "-emit-pch", "-o", "pch.h.pch", "pch.h" } },
+        { STEP_COMPILE, { CC, "-include-pch", "pch.h.pch", "-c", "-o", "test.o", "test.c" } },
+        { STEP_COMPILE, { CC, "-c", "-o", "ref.o", "test.c" } } },
+        "ref.o", "pch.h", "#define RUN_TESTS_PCH 1\n" },
+    { "ast", {
+        { STEP_COMPILE, { CC, "-dump-ast", "-o", "test.ast", "test.c" } },
+        { STEP_COMPILE, { CC, "-load-ast", "-c", "-o", "test.o", "test.ast" } },
+        { STEP_COMPILE, { CC, "-c", "-o", "ref.o", "test.c" } } },
+        "ref.o" },
+    // 計測用のプログラムも期待どおりに終了し、その計測結果を使ってコンパイルしたtest.oをいつもどおりに実行する
+    { "profile", {
+        { STEP_COMPILE, { CC, "-fprofile-generate=test.prof", "-c", "-o", "gen.o", "test.c" } },
+        { STEP_COMPILE, { "gcc", "-o", "gen", "gen.o", "$OTHER" } },
+        { STEP_RUN, { "./gen" } },
+        { STEP_COMPILE, { CC, "-fprofile-use=test.prof", "-c", "-o", "test.o", "test.c" } } } },
+};
+
+#define MODE_COUNT      ((int)(sizeof(MODES) / sizeof(MODES[0])))
+#define MAX_STEP_COUNT  ((int)(sizeof(MODES[0].steps) / sizeof(MODES[0].steps[0])))
+
+// テストケース
+struct TestCase {
+    const char* pszFile;    // データファイルの名前
+    int line;               // データファイルでの行番号
+    ExpectKind expect;
+    int exitCode;
+    Text source;            // chibiccでコンパイルするソース
+    Text other;             // gccでコンパイルするソース（lenが0なら無し）
+    Text stderrText;        // 期待する診断メッセージ
+    const Mode* pMode;
+    char* pszDir;           // 作業ディレクトリ
+    int batch;              // まとめてリンクしたバッチの番号（-1なら1つずつ実行する）
+    bool isSingle;          // 1つずつリンクしたならtrue
+    bool isFinished;        // 期待どおりのコンパイルエラーになり、残りの手順を省いたならtrue
+    bool isFailed;
+    char* pszMessage;       // 失敗の理由
+};
+
+// 実行するコマンド
+struct Command {
+    char** ppArgs;          // 引数（NULL終端）
+    int argCount;
+    int argCap;
+    char* pszDir;           // 作業ディレクトリ
+    char* pszStdout;        // 標準出力の書き込み先（NULLなら捨てる）
+    char* pszStderr;        // 標準エラー出力の書き込み先（NULLなら捨てる）
+    char* pszEnv;           // 追加する環境変数（"名前=値"、NULLなら無し）
+    bool isTest;            // テストの実行ならtrue（CPU時間を制限する）
+    int owner;              // コマンドを作った側で使う番号
+    int status;             // waitpidで得た終了状態（起動できなければ-1）
+};
+
+// 段階ごとにまとめて実行するコマンド
+struct CommandList {
+    Command* pCommands;
+    int count;
+    int cap;
+};
+
+static char* s_pszChibicc;      // chibiccの絶対パス
+static char* s_pszDriver;       // batch_main.oの絶対パス
+static int s_jobCount;          // 同時に実行するコマンドの数
+static pid_t s_serverPid;       // コンパイルサーバーのプロセス（起動していなければ0）
+static char* s_pszServerEnv;    // コンパイルサーバーを使わせる環境変数（"CHIBICC_SERVER=ソケットのパス"）
+static bool s_isServerExited;   // コンパイルサーバーが途中で終了したならtrue
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void fatal(const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    fprintf(stderr, "run_tests: ");
+    vfprintf(stderr, fmt, ap);
+    fprintf(stderr, "\n");
+    va_end(ap);
+    exit(2);
+}
+
+// printfと同じ書式で文字列を作る（mallocで確保する）
+static char* format(const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    char* psz = NULL;
+    if (vasprintf(&psz, fmt, ap) < 0) {
+        fatal("out of memory");
+    }
+    va_end(ap);
+    return psz;
+}
+
+static void text_append(Text* pText, const char* p, size_t len) {
+    if (pText->cap < pText->len + len + 1) {
+        pText->cap = (pText->len + len + 1) * 2;
+        pText->data = realloc(pText->data, pText->cap);
+    }
+    memcpy(pText->data + pText->len, p, len);
+    pText->len += len;
+    pText->data[pText->len] = '\0';
+}
+
+static const char* text_str(const Text* pText) {
+    return pText->data ? pText->data : "";
+}
+
+// ファイル全体を読む（読めなければNULLを返す）
+static char* read_file(const char* pszPath) {
+    FILE* fp = fopen(pszPath, "rb");
+    if (!fp) return NULL;
+    Text text = { 0 };
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) != 0) {
+        text_append(&text, buf, n);
+    }
+    fclose(fp);
+    return text.data ? text.data : calloc(1, 1);
+}
+
+static void write_file(const char* pszPath, const char* pData) {
+    FILE* fp = fopen(pszPath, "wb");
+    if (!fp || fputs(pData, fp) < 0 || fclose(fp) != 0) {
+        fatal("cannot write %s", pszPath);
+    }
+}
+
+// 2つのファイルの内容が一致すればtrueを返す（どちらかが読めなければfalse）
+static bool is_same_file(const char* pszPath1, const char* pszPath2) {
+    FILE* fp1 = fopen(pszPath1, "rb");
+    FILE* fp2 = fopen(pszPath2, "rb");
+    bool isSame = fp1 && fp2;
+    while (isSame) {
+        char buf1[4096];
+        char buf2[4096];
+        const size_t n1 = fread(buf1, 1, sizeof(buf1), fp1);
+        const size_t n2 = fread(buf2, 1, sizeof(buf2), fp2);
+        isSame = n1 == n2 && memcmp(buf1, buf2, n1) == 0;
+        if (n1 == 0) break;
+    }
+    if (fp1) fclose(fp1);
+    if (fp2) fclose(fp2);
+    return isSame;
+}
+
+static void make_dir(const char* pszPath) {
+    if (mkdir(pszPath, 0777) != 0 && errno != EEXIST) {
+        fatal("cannot create %s", pszPath);
+    }
+}
+
+static char* absolute_path(const char* pszPath) {
+    char* psz = realpath(pszPath, NULL);
+    if (!psz) {
+        fatal("%s not found", pszPath);
+    }
+    return psz;
+}
+
+// データファイルを読み、テストケースを追加する
+static void load_cases(const char* pszFile, TestCase** ppCases, int* pCount) {
+    char* pData = read_file(pszFile);
+    if (!pData) {
+        fatal("cannot read %s", pszFile);
+    }
+
+    TestCase* pCase = NULL;
+    Text* pSection = NULL;
+    int line = 0;
+    for (char* p = pData; *p; ) {
+        char* pEnd = strchr(p, '\n');
+        const size_t len = pEnd ? (size_t)(pEnd - p) : strlen(p);
+        ++line;
+
+        if (strncmp(p, "=== ", 4) == 0) {
+            *ppCases = realloc(*ppCases, (*pCount + 1) * sizeof(TestCase));
+            pCase = &(*ppCases)[(*pCount)++];
+            memset(pCase, 0, sizeof(TestCase));
+            pCase->pszFile = pszFile;
+            pCase->line = line;
+            pSection = &pCase->source;
+
+            char* pszHeader = format("%.*s", (int)(len - 4), p + 4);
+            char* pNumEnd = NULL;
+            if (strcmp(pszHeader, "error") == 0) {
+                pCase->expect = EXPECT_ERROR;
+            }
+            else if (strcmp(pszHeader, "exit nonzero") == 0) {
+                pCase->expect = EXPECT_NONZERO;
+            }
+            else if (strncmp(pszHeader, "exit ", 5) == 0 && (pCase->exitCode = (int)strtol(pszHeader + 5, &pNumEnd, 10), *pNumEnd == '\0') && pNumEnd != pszHeader + 5) {
+                pCase->expect = EXPECT_EXIT;
+            }
+            else {
+                fatal("%s:%d: unknown expectation '%s'", pszFile, line, pszHeader);
+            }
+            free(pszHeader);
+        }
+        else if (pCase && len == 9 && strncmp(p, "--- other", 9) == 0 && pCase->expect != EXPECT_ERROR) {
+            pSection = &pCase->other;
+        }
+        else if (pCase && len == 10 && strncmp(p, "--- stderr", 10) == 0 && pCase->expect == EXPECT_ERROR) {
+            pSection = &pCase->stderrText;
+        }
+        else if (pSection) {
+            text_append(pSection, p, len);
+            text_append(pSection, "\n", 1);
+        }
+
+        p += len + (pEnd ? 1 : 0);
+    }
+    free(pData);
+}
+
+static Command* add_command(CommandList* pList, const char* pszDir, int owner) {
+    if (pList->count == pList->cap) {
+        pList->cap = pList->cap ? pList->cap * 2 : 64;
+        pList->pCommands = realloc(pList->pCommands, pList->cap * sizeof(Command));
+    }
+    Command* pCommand = &pList->pCommands[pList->count++];
+    memset(pCommand, 0, sizeof(Command));
+    pCommand->pszDir = strdup(pszDir);
+    pCommand->owner = owner;
+    return pCommand;
+}
+
+// 引数を1つ追加する（pszArgは複製する）
+static void add_arg(Command* pCommand, const char* pszArg) {
+    if (pCommand->argCap < pCommand->argCount + 2) {
+        pCommand->argCap = pCommand->argCap ? pCommand->argCap * 2 : 8;
+        pCommand->ppArgs = realloc(pCommand->ppArgs, pCommand->argCap * sizeof(char*));
+    }
+    pCommand->ppArgs[pCommand->argCount++] = strdup(pszArg);
+    pCommand->ppArgs[pCommand->argCount] = NULL;
+}
+
+static void add_args(Command* pCommand, ...) {
+    va_list ap;
+    va_start(ap, pCommand);
+    const char* pszArg;
+    while ((pszArg = va_arg(ap, const char*)) != NULL) {
+        add_arg(pCommand, pszArg);
+    }
+    va_end(ap);
+}
+
+static void free_commands(CommandList* pList) {
+    for (int i = 0; i < pList->count; ++i) {
+        Command* pCommand = &pList->pCommands[i];
+        for (int j = 0; j < pCommand->argCount; ++j) {
+            free(pCommand->ppArgs[j]);
+        }
+        free(pCommand->ppArgs);
+        free(pCommand->pszDir);
+        free(pCommand->pszStdout);
+        free(pCommand->pszStderr);
+        free(pCommand->pszEnv);
+    }
+    free(pList->pCommands);
+    memset(pList, 0, sizeof(CommandList));
+}
+
+// 子プロセスの標準出力か標準エラー出力をファイルにつなぐ
+static void redirect(int fd, const char* pszPath) {
+    const int file = open(pszPath ? pszPath : "/dev/null", O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (file < 0 || dup2(file, fd) < 0) {
+        _exit(127);
+    }
+    close(file);
+}
+
+static pid_t spawn_command(const Command* pCommand) {
+    const pid_t pid = fork();
+    if (pid != 0) {
+        return pid;
+    }
+
+    if (chdir(pCommand->pszDir) != 0) {
+        _exit(127);
+    }
+    redirect(STDOUT_FILENO, pCommand->pszStdout);
+    redirect(STDERR_FILENO, pCommand->pszStderr);
+    if (pCommand->pszEnv) {
+        putenv(pCommand->pszEnv);
+    }
+    if (pCommand->isTest) {
+        // 無限ループするテストは、CPU時間の上限で止める
+        struct rlimit limit = { TEST_TIMEOUT, TEST_TIMEOUT + 1 };
+        setrlimit(RLIMIT_CPU, &limit);
+    }
+    execvp(pCommand->ppArgs[0], pCommand->ppArgs);
+    _exit(127);
+}
+
+// 全コマンドを、同時にs_jobCount個まで実行する
+// 段階の名前と所要時間を表示する
+static void run_commands(CommandList* pList, const char* pszPhase) {
+    const double startTime = now_seconds();
+    pid_t* pPids = calloc(pList->count + 1, sizeof(pid_t));
+    int next = 0;
+    int running = 0;
+
+    while (next < pList->count || running) {
+        while (next < pList->count && running < s_jobCount) {
+            pPids[next] = spawn_command(&pList->pCommands[next]);
+            if (pPids[next] < 0) {
+                pList->pCommands[next].status = -1;
+            }
+            else {
+                ++running;
+            }
+            ++next;
+        }
+        if (running == 0) continue;
+
+        int status = 0;
+        const pid_t pid = wait(&status);
+        if (pid < 0) {
+            fatal("wait failed");
+        }
+        if (pid == s_serverPid) {
+            s_isServerExited = true;
+            continue;
+        }
+        for (int i = 0; i < next; ++i) {
+            if (pPids[i] == pid) {
+                pList->pCommands[i].status = status;
+                pPids[i] = 0;
+                --running;
+                break;
+            }
+        }
+    }
+
+    free(pPids);
+    printf("  %-10s %8.3fs  %d commands\n", pszPhase, now_seconds() - startTime, pList->count);
+}
+
+static bool succeeded(const Command* pCommand) {
+    return pCommand->status >= 0 && WIFEXITED(pCommand->status) && WEXITSTATUS(pCommand->status) == 0;
+}
+
+// リンクして実行するテストならtrue
+static bool needs_link(const TestCase* pCase) {
+    return !pCase->isFailed && pCase->expect != EXPECT_ERROR && !pCase->pMode->isRunOnly;
+}
+
+static void fail(TestCase* pCase, char* pszMessage) {
+    if (pCase->isFailed) {
+        free(pszMessage);
+        return;
+    }
+    pCase->isFailed = true;
+    pCase->pszMessage = pszMessage;
+}
+
+// 終了状態が期待どおりか確かめる
+static void check_exit(TestCase* pCase, bool isExited, int value) {
+    if (!isExited && (value == SIGXCPU || value == SIGALRM)) {
+        fail(pCase, format("timed out"));
+    }
+    else if (!isExited) {
+        fail(pCase, format("killed by signal %d", value));
+    }
+    else if (pCase->expect == EXPECT_EXIT && value != (pCase->exitCode & 0xff)) {
+        fail(pCase, format("expected exit code %d, got %d", pCase->exitCode, value));
+    }
+    else if (pCase->expect == EXPECT_NONZERO && value == 0) {
+        fail(pCase, format("expected nonzero exit code, got 0"));
+    }
+}
+
+// コマンドが終了した状態を、テストの実行結果として確かめる
+static void check_status(TestCase* pCase, const Command* pCommand) {
+    if (pCommand->status < 0) {
+        fail(pCase, format("cannot run the test"));
+    }
+    else if (WIFEXITED(pCommand->status)) {
+        check_exit(pCase, true, WEXITSTATUS(pCommand->status));
+    }
+    else {
+        check_exit(pCase, false, WTERMSIG(pCommand->status));
+    }
+}
+
+// モードのstep番目の手順のコマンドを追加する（手順が無ければNULLを返す）
+static Command* add_step_command(CommandList* pList, TestCase* pCase, int index, int step) {
+    const Step* pStep = &pCase->pMode->steps[step];
+    if (pStep->ppArgs[0] == NULL) {
+        return NULL;
+    }
+
+    Command* pCommand = add_command(pList, pCase->pszDir, index);
+    for (int i = 0; pStep->ppArgs[i]; ++i) {
+        if (strcmp(pStep->ppArgs[i], CC) == 0) {
+            add_arg(pCommand, s_pszChibicc);
+        }
+        else if (strcmp(pStep->ppArgs[i], "$OTHER") == 0) {
+            if (pCase->other.len) add_arg(pCommand, "other.o");
+        }
+        else {
+            add_arg(pCommand, pStep->ppArgs[i]);
+        }
+    }
+    pCommand->pszStderr = format("%s/stderr%d.txt", pCase->pszDir, step);
+    pCommand->isTest = pStep->kind == STEP_RUN;
+    if (pCase->pMode->isServer) {
+        pCommand->pszEnv = strdup(s_pszServerEnv);
+    }
+    return pCommand;
+}
+
+// 手順の結果を確かめる
+// コンパイルエラーのテストは、chibiccが最初に失敗した手順で診断メッセージを比べ、残りの手順を省く
+static void check_step(TestCase* pCase, const Command* pCommand, int step) {
+    char* pszStderr = read_file(pCommand->pszStderr);
+    const char* pszActual = pszStderr ? pszStderr : "";
+    const bool isChibicc = strcmp(pCommand->ppArgs[0], s_pszChibicc) == 0;
+    if (pCase->expect == EXPECT_ERROR && isChibicc && !succeeded(pCommand)) {
+        if (strcmp(pszActual, text_str(&pCase->stderrText)) != 0) {
+            fail(pCase, format("diagnostic mismatch\n--- expected\n%s--- actual\n%s", text_str(&pCase->stderrText), pszActual));
+        }
+        pCase->isFinished = true;
+    }
+    else if (pCase->pMode->steps[step].kind == STEP_RUN) {
+        check_status(pCase, pCommand);
+    }
+    else if (!succeeded(pCommand) || (isChibicc && *pszActual)) {
+        fail(pCase, format("%s failed\n%s", isChibicc ? "compile" : pCommand->ppArgs[0], pszActual));
+    }
+    free(pszStderr);
+}
+
+// コンパイルサーバーを起動し、ソケットができるまで待つ
+static void start_server(const char* pszWorkDir) {
+    char* pszSocket = format("%s/server.sock", pszWorkDir);
+    char* pszLog = format("%s/server.txt", pszWorkDir);
+    unlink(pszSocket);
+    s_pszServerEnv = format("CHIBICC_SERVER=%s", pszSocket);
+
+    s_serverPid = fork();
+    if (s_serverPid < 0) {
+        fatal("cannot start the compile server");
+    }
+    if (s_serverPid == 0) {
+        redirect(STDOUT_FILENO, pszLog);
+        redirect(STDERR_FILENO, pszLog);
+        execl(s_pszChibicc, s_pszChibicc, "--server", pszSocket, (char*)NULL);
+        _exit(127);
+    }
+
+    struct stat st;
+    const double startTime = now_seconds();
+    while (stat(pszSocket, &st) != 0 || !S_ISSOCK(st.st_mode)) {
+        if (waitpid(s_serverPid, NULL, WNOHANG) != 0 || now_seconds() - startTime > TEST_TIMEOUT) {
+            fatal("the compile server did not start (see %s)", pszLog);
+        }
+        const struct timespec wait = { 0, 10 * 1000 * 1000 };
+        nanosleep(&wait, NULL);
+    }
+    free(pszSocket);
+    free(pszLog);
+}
+
+// コンパイルサーバーを止める（途中で終了していたらfalseを返す）
+static bool stop_server(void) {
+    const bool isAlive = !s_isServerExited && waitpid(s_serverPid, NULL, WNOHANG) == 0;
+    if (isAlive) {
+        kill(s_serverPid, SIGTERM);
+        waitpid(s_serverPid, NULL, 0);
+    }
+    s_serverPid = 0;
+    free(s_pszServerEnv);
+    s_pszServerEnv = NULL;
+    return isAlive;
+}
+
+// モードの名前の並び（","区切り、"all"なら全て）から、使うモードに印を付ける
+static void select_modes(const char* pszModes, bool* pIsSelected) {
+    for (const char* p = pszModes; *p; ) {
+        const char* pEnd = strchr(p, ',');
+        const size_t len = pEnd ? (size_t)(pEnd - p) : strlen(p);
+        bool isFound = false;
+        for (int i = 0; i < MODE_COUNT; ++i) {
+            if ((len == 3 && strncmp(p, "all", 3) == 0) || (strlen(MODES[i].pszName) == len && strncmp(p, MODES[i].pszName, len) == 0)) {
+                pIsSelected[i] = true;
+                isFound = true;
+            }
+        }
+        if (!isFound) {
+            fatal("unknown mode '%.*s'", (int)len, p);
+        }
+        p += len + (pEnd ? 1 : 0);
+    }
+}
+
+// 1つずつ実行するテストをリンクするコマンドを追加する
+static void add_single_link(CommandList* pList, TestCase* pCase, int index) {
+    pCase->isSingle = true;
+    Command* pCommand = add_command(pList, pCase->pszDir, index);
+    add_args(pCommand, "gcc", "-o", "test", "test.o", NULL);
+    if (pCase->other.len) {
+        add_arg(pCommand, "other.o");
+    }
+    pCommand->pszStderr = format("%s/link.txt", pCase->pszDir);
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: run_tests [-c chibicc] [-d batch_main.o] [-j jobs] [-b batch-size] [-w workdir] [-m mode,...] cases...\n");
+    fprintf(stderr, "modes: all");
+    for (int i = 0; i < MODE_COUNT; ++i) {
+        fprintf(stderr, " %s", MODES[i].pszName);
+    }
+    fprintf(stderr, "\n");
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    const char* pszChibicc = "../chibicc";
+    const char* pszDriver = "batch_main.o";
+    const char* pszWork = "out";
+    const char* pszModes = "all";
+    int batchSize = 64;
+    s_jobCount = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (s_jobCount <= 0) s_jobCount = 1;
+
+    int i;
+    for (i = 1; i < argc && argv[i][0] == '-'; ++i) {
+        if (argc <= i + 1) usage();
+        if (strcmp(argv[i], "-c") == 0) pszChibicc = argv[++i];
+        else if (strcmp(argv[i], "-d") == 0) pszDriver = argv[++i];
+        else if (strcmp(argv[i], "-w") == 0) pszWork = argv[++i];
+        else if (strcmp(argv[i], "-m") == 0) pszModes = argv[++i];
+        else if (strcmp(argv[i], "-j") == 0) { if ((s_jobCount = atoi(argv[++i])) <= 0) usage(); }
+        else if (strcmp(argv[i], "-b") == 0) { if ((batchSize = atoi(argv[++i])) <= 0) usage(); }
+        else usage();
+    }
+    if (argc <= i) usage();
+
+    bool isSelected[MODE_COUNT] = { false };
+    select_modes(pszModes, isSelected);
+
+    // 呼び出し元の環境でサーバーやキャッシュが指定されていても、モードで指定したものだけを使う
+    unsetenv("CHIBICC_SERVER");
+    unsetenv("CHIBICC_CACHE_DIR");
+
+    const double startTime = now_seconds();
+    TestCase* pSources = NULL;
+    int sourceCount = 0;
+    for (; i < argc; ++i) {
+        load_cases(argv[i], &pSources, &sourceCount);
+    }
+
+    // データファイルのテストケースを、選んだモードの数だけ複製する（ソースなどの内容は共有する）
+    TestCase* pCases = calloc((size_t)sourceCount * MODE_COUNT + 1, sizeof(TestCase));
+    int caseCount = 0;
+    int modeCount = 0;
+    bool useServer = false;
+    for (int mode = 0; mode < MODE_COUNT; ++mode) {
+        if (!isSelected[mode]) continue;
+        ++modeCount;
+        useServer |= MODES[mode].isServer;
+        for (int j = 0; j < sourceCount; ++j) {
+            if (MODES[mode].isRunOnly && pSources[j].other.len) continue;
+            pCases[caseCount] = pSources[j];
+            pCases[caseCount++].pMode = &MODES[mode];
+        }
+    }
+
+    // コマンドは各テストの作業ディレクトリで実行するので、パスは絶対パスにしておく
+    s_pszChibicc = absolute_path(pszChibicc);
+    s_pszDriver = absolute_path(pszDriver);
+    make_dir(pszWork);
+    char* pszWorkDir = absolute_path(pszWork);
+
+    // 前回のキャッシュや関数ごとの生成結果が残っていると、各モードの最初のコンパイルが使い回しになるので消しておく
+    CommandList commands = { 0 };
+    add_args(add_command(&commands, "/", 0), "rm", "-rf", pszWorkDir, NULL);
+    run_commands(&commands, "clean");
+    if (!succeeded(&commands.pCommands[0])) {
+        fatal("cannot clean %s", pszWorkDir);
+    }
+    free_commands(&commands);
+    make_dir(pszWorkDir);
+
+    for (i = 0; i < caseCount; ++i) {
+        TestCase* pCase = &pCases[i];
+        pCase->pszDir = format("%s/%d", pszWorkDir, i);
+        pCase->batch = -1;
+        make_dir(pCase->pszDir);
+        char* pszPath = format("%s/test.c", pCase->pszDir);
+        write_file(pszPath, text_str(&pCase->source));
+        free(pszPath);
+        if (pCase->other.len) {
+            pszPath = format("%s/other.c", pCase->pszDir);
+            write_file(pszPath, text_str(&pCase->other));
+            free(pszPath);
+        }
+        if (pCase->pMode->pszExtraFile) {
+            pszPath = format("%s/%s", pCase->pszDir, pCase->pMode->pszExtraFile);
+            write_file(pszPath, pCase->pMode->pszExtraText);
+            free(pszPath);
+        }
+    }
+    printf("%d tests in %d modes, %d jobs\n", caseCount, modeCount, s_jobCount);
+
+    // 1. コンパイル
+    // 各モードの手順を1つずつ、全テスト分まとめて実行する（--- otherは最初の手順と一緒にコンパイルする）
+    if (useServer) {
+        start_server(pszWorkDir);
+    }
+    for (int step = 0; step < MAX_STEP_COUNT; ++step) {
+        for (i = 0; i < caseCount; ++i) {
+            TestCase* pCase = &pCases[i];
+            if (pCase->isFailed || pCase->isFinished) continue;
+            add_step_command(&commands, pCase, i, step);
+            if (step == 0 && pCase->other.len) {
+                Command* pCommand = add_command(&commands, pCase->pszDir, i);
+                add_args(pCommand, "gcc", "-c", "-o", "other.o", "other.c", NULL);
+                pCommand->pszStderr = format("%s/other_stderr.txt", pCase->pszDir);
+            }
+        }
+        if (commands.count == 0) break;
+
+        char* pszPhase = step ? format("compile%d", step + 1) : format("compile");
+        run_commands(&commands, pszPhase);
+        free(pszPhase);
+
+        for (i = 0; i < commands.count; ++i) {
+            const Command* pCommand = &commands.pCommands[i];
+            TestCase* pCase = &pCases[pCommand->owner];
+            if (strcmp(pCommand->ppArgs[0], "gcc") == 0 && strcmp(pCommand->ppArgs[2], "other.o") == 0) {
+                if (!succeeded(pCommand)) {
+                    char* pszStderr = read_file(pCommand->pszStderr);
+                    fail(pCase, format("gcc failed to compile the other source\n%s", pszStderr ? pszStderr : ""));
+                    free(pszStderr);
+                }
+            }
+            else {
+                check_step(pCase, pCommand, step);
+            }
+        }
+        free_commands(&commands);
+    }
+    if (useServer && !stop_server()) {
+        for (i = 0; i < caseCount; ++i) {
+            if (pCases[i].pMode->isServer) fail(&pCases[i], format("the compile server exited"));
+        }
+    }
+
+    for (i = 0; i < caseCount; ++i) {
+        TestCase* pCase = &pCases[i];
+        if (pCase->isFailed || pCase->isFinished) continue;
+        if (pCase->expect == EXPECT_ERROR) {
+            fail(pCase, format("expected a compile error, but compiled successfully"));
+        }
+        else if (pCase->pMode->pszCompare) {
+            char* pszPath1 = format("%s/test.o", pCase->pszDir);
+            char* pszPath2 = format("%s/%s", pCase->pszDir, pCase->pMode->pszCompare);
+            if (!is_same_file(pszPath1, pszPath2)) {
+                fail(pCase, format("test.o differs from %s", pCase->pMode->pszCompare));
+            }
+            free(pszPath1);
+            free(pszPath2);
+        }
+    }
+
+    // 2. リンク
+    // 他のソースを必要としないテストは、シンボル名が重ならないよう番号を付けてからまとめる
+    for (i = 0; i < caseCount; ++i) {
+        TestCase* pCase = &pCases[i];
+        if (!needs_link(pCase) || pCase->other.len) continue;
+        Command* pCommand = add_command(&commands, pCase->pszDir, i);
+        char* pszPrefix = format("--prefix-symbols=t%d_", i);
+        add_args(pCommand, "objcopy", pszPrefix, "test.o", "batch.o", NULL);
+        free(pszPrefix);
+    }
+    run_commands(&commands, "rename");
+
+    int batchCount = 0;
+    int batchedCount = 0;   // バッチに割り当てたテストの数
+    for (i = 0; i < commands.count; ++i) {
+        const Command* pCommand = &commands.pCommands[i];
+        if (!succeeded(pCommand)) continue;
+        if (batchedCount % batchSize == 0) {
+            ++batchCount;
+        }
+        pCases[pCommand->owner].batch = batchCount - 1;
+        ++batchedCount;
+    }
+    free_commands(&commands);
+
+    // バッチごとに、テストのmainを並べた表を書き出してリンクする
+    for (int batch = 0; batch < batchCount; ++batch) {
+        Text table = { 0 };
+        Text ids = { 0 };
+        Text decls = { 0 };
+        int count = 0;
+        Command* pCommand = add_command(&commands, pszWorkDir, batch);
+        char* pszExe = format("batch%d", batch);
+        char* pszTable = format("batch%d.c", batch);
+        add_args(pCommand, "gcc", "-o", pszExe, pszTable, s_pszDriver, NULL);
+        pCommand->pszStderr = format("%s/batch%d_link.txt", pszWorkDir, batch);
+        for (i = 0; i < caseCount; ++i) {
+            if (pCases[i].batch != batch) continue;
+            char* psz = format("int t%d_main();\n", i);
+            text_append(&decls, psz, strlen(psz));
+            free(psz);
+            psz = format("%st%d_main", count ? ", " : "", i);
+            text_append(&table, psz, strlen(psz));
+            free(psz);
+            psz = format("%s%d", count ? ", " : "", i);
+            text_append(&ids, psz, strlen(psz));
+            free(psz);
+            psz = format("%d/batch.o", i);
+            add_arg(pCommand, psz);
+            free(psz);
+            ++count;
+        }
+        char* pszSource = format("%s\nint (*g_tests[])() = { %s };\nint g_testIds[] = { %s };\nint g_testCount = %d;\n",
+            text_str(&decls), text_str(&table), text_str(&ids), count);
+        char* pszPath = format("%s/%s", pszWorkDir, pszTable);
+        write_file(pszPath, pszSource);
+        free(pszPath);
+        free(pszSource);
+        free(pszExe);
+        free(pszTable);
+        free(table.data);
+        free(ids.data);
+        free(decls.data);
+    }
+    const int batchLinkCount = commands.count;
+    for (i = 0; i < caseCount; ++i) {
+        TestCase* pCase = &pCases[i];
+        if (!needs_link(pCase) || pCase->batch >= 0) continue;
+        add_single_link(&commands, pCase, i);
+    }
+    run_commands(&commands, "link");
+
+    // リンクに失敗したバッチのテストは、原因のテストを特定できるよう1つずつリンクし直す
+    CommandList relinks = { 0 };
+    for (i = 0; i < commands.count; ++i) {
+        const Command* pCommand = &commands.pCommands[i];
+        if (i < batchLinkCount) {
+            if (succeeded(pCommand)) continue;
+            for (int j = 0; j < caseCount; ++j) {
+                if (pCases[j].batch == pCommand->owner) {
+                    pCases[j].batch = -1;
+                    add_single_link(&relinks, &pCases[j], j);
+                }
+            }
+        }
+        else if (!succeeded(pCommand)) {
+            char* pszStderr = read_file(pCommand->pszStderr);
+            fail(&pCases[pCommand->owner], format("link failed\n%s", pszStderr ? pszStderr : ""));
+            free(pszStderr);
+        }
+    }
+    if (relinks.count) {
+        run_commands(&relinks, "relink");
+        for (i = 0; i < relinks.count; ++i) {
+            const Command* pCommand = &relinks.pCommands[i];
+            if (!succeeded(pCommand)) {
+                char* pszStderr = read_file(pCommand->pszStderr);
+                fail(&pCases[pCommand->owner], format("link failed\n%s", pszStderr ? pszStderr : ""));
+                free(pszStderr);
+            }
+        }
+    }
+    free_commands(&relinks);
+    free_commands(&commands);
+
+    // 3. 実行
+    // バッチはowner = -1 - バッチ番号、1つずつのテストはowner = テストの番号とする
+    for (int batch = 0; batch < batchCount; ++batch) {
+        bool isUsed = false;
+        for (i = 0; i < caseCount && !isUsed; ++i) {
+            isUsed = pCases[i].batch == batch;
+        }
+        if (!isUsed) continue;
+        Command* pCommand = add_command(&commands, pszWorkDir, -1 - batch);
+        char* pszExe = format("./batch%d", batch);
+        add_arg(pCommand, pszExe);
+        free(pszExe);
+        pCommand->pszStdout = format("%s/batch%d.out", pszWorkDir, batch);
+    }
+    for (i = 0; i < caseCount; ++i) {
+        TestCase* pCase = &pCases[i];
+        if (!needs_link(pCase) || pCase->batch >= 0) continue;
+        Command* pCommand = add_command(&commands, pCase->pszDir, i);
+        add_arg(pCommand, "./test");
+        pCommand->isTest = true;
+    }
+    run_commands(&commands, "run");
+
+    for (i = 0; i < commands.count; ++i) {
+        const Command* pCommand = &commands.pCommands[i];
+        if (0 <= pCommand->owner) {
+            check_status(&pCases[pCommand->owner], pCommand);
+            continue;
+        }
+
+        // バッチの結果は1テスト1行で書かれている
+        const int batch = -1 - pCommand->owner;
+        bool* pReported = calloc(caseCount, sizeof(bool));
+        char* pszOutput = read_file(pCommand->pszStdout);
+        for (char* p = pszOutput; p && *p; ) {
+            int id = -1;
+            int value = 0;
+            char kind[16] = "";
+            if (sscanf(p, "%d %15s %d", &id, kind, &value) == 3 && 0 <= id && id < caseCount && pCases[id].batch == batch) {
+                pReported[id] = true;
+                check_exit(&pCases[id], strcmp(kind, "exit") == 0, value);
+            }
+            char* pEnd = strchr(p, '\n');
+            p = pEnd ? pEnd + 1 : p + strlen(p);
+        }
+        for (int j = 0; j < caseCount; ++j) {
+            if (pCases[j].batch == batch && !pReported[j]) {
+                fail(&pCases[j], format("no result from batch%d", batch));
+            }
+        }
+        free(pszOutput);
+        free(pReported);
+    }
+    free_commands(&commands);
+
+    // 結果の表示
+    int failedCount = 0;
+    int singleCount = 0;
+    batchedCount = 0;
+    for (i = 0; i < caseCount; ++i) {
+        TestCase* pCase = &pCases[i];
+        if (pCase->batch >= 0) ++batchedCount;
+        if (pCase->isSingle) ++singleCount;
+        if (!pCase->isFailed) continue;
+        ++failedCount;
+        printf("FAIL %s:%d [%s]: %s\n", pCase->pszFile, pCase->line, pCase->pMode->pszName, pCase->pszMessage);
+        printf("--- source\n%s", text_str(&pCase->source));
+    }
+    printf("%d passed, %d failed (%d batched, %d linked separately) in %.3fs\n",
+        caseCount - failedCount, failedCount, batchedCount, singleCount, now_seconds() - startTime);
+
+    for (i = 0; i < caseCount; ++i) {
+        free(pCases[i].pszDir);
+        free(pCases[i].pszMessage);
+    }
+    for (i = 0; i < sourceCount; ++i) {
+        free(pSources[i].source.data);
+        free(pSources[i].other.data);
+        free(pSources[i].stderrText.data);
+    }
+    free(pCases);
+    free(pSources);
+    free(pszWorkDir);
+    free(s_pszChibicc);
+    free(s_pszDriver);
+    return failedCount ? 1 : 0;
+}
@@ -0,0 +1,158 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include <stdlib.h>
+
+#include "thread.h"
+#include "error.h"
+
+typedef struct JobQueue JobQueue;
+
+// [J[XbhԂŋL鏈҂̗
+struct JobQueue {
+    ThreadJobFunc pfnJob;   // s鏈
+    void* pContext;         // ɓnl
+    int jobCount;           // ̑
+    int nextIndex;          // Ɏo̔ԍ
+#ifdef _WIN32
+    CRITICAL_SECTION lock;
+#else
+    pthread_mutex_t lock;
+#endif
+};
+
+// Ɏs鏈̔ԍoicĂȂ-1j
+static int take_job(JobQueue* pQueue) {
+    int index = -1;
+#ifdef _WIN32
+    EnterCriticalSection(&pQueue->lock);
+#else
+    pthread_mutex_lock(&pQueue->lock);
+#endif
+    if (pQueue->nextIndex < pQueue->jobCount) {
+        index = pQueue->nextIndex++;
+    }
+#ifdef _WIN32
+    LeaveCriticalSection(&pQueue->lock);
+#else
+    pthread_mutex_unlock(&pQueue->lock);
+#endif
+    return index;
+}
+
+// Ȃ܂ŎoĎs
+static void work(JobQueue* pQueue) {
+    int index;
+    while ((index = take_job(pQueue)) >= 0) {
+        pQueue->pfnJob(pQueue->pContext, index);
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI worker_main(LPVOID pParam) {
+    work(pParam);
+    return 0;
+}
+#else
+static void* worker_main(void* pParam) {
+    work(pParam);
+    return NULL;
+}
+#endif
+
+// _vZbT̐Ԃ
+int get_processor_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    const long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count < 1) ? 1 : (int)count;
+#endif
+}
+
+// jobCount̏threadCount̃[J[XbhŕSĎsASďI܂ő҂
+// ĂяõXbh[J[1Ƃē
+void run_jobs(ThreadJobFunc pfnJob, void* pContext, int jobCount, int threadCount) {
+    JobQueue queue = { pfnJob, pContext, jobCount, 0 };
+    if (jobCount < threadCount) threadCount = jobCount;
+
+    if (threadCount <= 1) {
+        work(&queue);
+        return;
+    }
+
+#ifdef _WIN32
+    InitializeCriticalSection(&queue.lock);
+    HANDLE* pThreads = calloc(threadCount - 1, sizeof(HANDLE));
+    for (int i = 0; i < threadCount - 1; ++i) {
+        pThreads[i] = CreateThread(NULL, 0, worker_main, &queue, 0, NULL);
+        if (pThreads[i] == NULL) {
+            error("Internal Error. Cannot create thread.");
+        }
+    }
+    work(&queue);
+    for (int i = 0; i < threadCount - 1; ++i) {
+        WaitForSingleObject(pThreads[i], INFINITE);
+        CloseHandle(pThreads[i]);
+    }
+    DeleteCriticalSection(&queue.lock);
+#else
+    pthread_mutex_init(&queue.lock, NULL);
+    pthread_t* pThreads = calloc(threadCount - 1, sizeof(pthread_t));
+    for (int i = 0; i < threadCount - 1; ++i) {
+        if (pthread_create(&pThreads[i], NULL, worker_main, &queue) != 0) {
+            error("Internal Error. Cannot create thread.");
+        }
+    }
+    work(&queue);
+    for (int i = 0; i < threadCount - 1; ++i) {
+        pthread_join(pThreads[i], NULL);
+    }
+    pthread_mutex_destroy(&queue.lock);
+#endif
+    free(pThreads);
+}
+
+// XbhԂŋLf[^邽߂̃bN
+struct Mutex {
+#ifdef _WIN32
+    CRITICAL_SECTION lock;
+#else
+    pthread_mutex_t lock;
+#endif
+};
+
+// bN쐬
+Mutex* create_mutex(void) {
+    Mutex* pMutex = calloc(1, sizeof(Mutex));
+#ifdef _WIN32
+    InitializeCriticalSection(&pMutex->lock);
+#else
+    pthread_mutex_init(&pMutex->lock, NULL);
+#endif
+    return pMutex;
+}
+
+// bNlĩXbhlĂΉ܂ő҂j
+void lock_mutex(Mutex* pMutex) {
+#ifdef _WIN32
+    EnterCriticalSection(&pMutex->lock);
+#else
+    pthread_mutex_lock(&pMutex->lock);
+#endif
+}
+
+// bN
+void unlock_mutex(Mutex* pMutex) {
+#ifdef _WIN32
+    LeaveCriticalSection(&pMutex->lock);
+#else
+    pthread_mutex_unlock(&pMutex->lock);
+#endif
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+// XbhƂɕʁX̎̂ϐ̋Lwq
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
+// [J[XbhŎs鏈
+// indexɂ0jobCount-1܂ł̔ԍ1񂸂n
+typedef void (*ThreadJobFunc)(void* pContext, int index);
+
+// _vZbT̐Ԃ
+int get_processor_count(void);
+
+// jobCount̏threadCount̃[J[XbhŕSĎsASďI܂ő҂
+void run_jobs(ThreadJobFunc pfnJob, void* pContext, int jobCount, int threadCount);
+
+// XbhԂŋLf[^邽߂̃bN
+typedef struct Mutex Mutex;
+
+// bN쐬
+Mutex* create_mutex(void);
+
+// bNlĩXbhlĂΉ܂ő҂j
+void lock_mutex(Mutex* pMutex);
+
+// bN
+void unlock_mutex(Mutex* pMutex);
@@ -0,0 +1,255 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "time_trace.h"
+#include "strbuf.h"
+#include "thread.h"
+
+// -ftime-reportŌʂɕ\֐̐iԂ̂̂j
+#define REPORT_FUNC_COUNT   (20)
+
+typedef struct TimeEvent TimeEvent;
+typedef struct PhaseTotal PhaseTotal;
+
+// L^
+struct TimeEvent {
+    const char* pszName;    // Ԃ̖O
+    char* pszDetail;        // Ԃ̏ڍׁiNULLȂ疳j
+    int threadId;           // vXbh̔ԍi1j
+    int64_t startNs;        // vJn̊Jniimbj
+    int64_t wallNs;         // ԁiimbj
+    int64_t cpuNs;          // XbhCPUԁiimbj
+};
+
+// iKƂ̏Wv
+struct PhaseTotal {
+    const char* pszName;
+    int64_t wallNs;
+    int64_t cpuNs;
+    int count;
+};
+
+// vȂtrueivĂȂƂ́AԂ̊JnƏIł邾ɂj
+static volatile bool s_isEnabled = false;
+static int64_t s_originNs;          // vJn
+static Mutex* s_pLock = NULL;       // ȉ̋L^郍bN
+static TimeEvent* s_pEvents = NULL;
+static int s_eventCount = 0;
+static int s_eventCap = 0;
+static int s_threadCount = 0;       // ԍUXbh̐
+static THREAD_LOCAL int s_threadId = 0; // ̃Xbh̔ԍi0Ȃ疢蓖āj
+
+// P鎞imbŕԂ
+static int64_t get_wall_ns(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER s_frequency;
+    if (s_frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&s_frequency);
+    }
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (int64_t)(counter.QuadPart / s_frequency.QuadPart * 1000000000 + counter.QuadPart % s_frequency.QuadPart * 1000000000 / s_frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+// ݂̃XbhgCPUԂimbŕԂ
+static int64_t get_thread_cpu_ns(void) {
+#ifdef _WIN32
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime)) {
+        return 0;
+    }
+    const uint64_t kernel = ((uint64_t)kernelTime.dwHighDateTime << 32) | kernelTime.dwLowDateTime;
+    const uint64_t user = ((uint64_t)userTime.dwHighDateTime << 32) | userTime.dwLowDateTime;
+    return (int64_t)(kernel + user) * 100;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+static void clear_events(void) {
+    for (int i = 0; i < s_eventCount; ++i) {
+        free(s_pEvents[i].pszDetail);
+    }
+    free(s_pEvents);
+    s_pEvents = NULL;
+    s_eventCount = 0;
+    s_eventCap = 0;
+}
+
+// vJni܂ł̋L^͔jj
+void time_trace_start(void) {
+    if (s_pLock == NULL) {
+        s_pLock = create_mutex();
+    }
+    clear_events();
+    s_originNs = get_wall_ns();
+    s_isEnabled = true;
+}
+
+// vIAL^j
+void time_trace_stop(void) {
+    s_isEnabled = false;
+    clear_events();
+}
+
+// Ԃ̌vn߂ivłȂΉȂ̂ŁAɌĂł悢j
+// pDetailtime_trace_endĂԂ܂ŗLłȂ΂ȂȂBdetailLenȂ'\0'I[Ƃ݂Ȃ
+void time_trace_begin(TimeSpan* pSpan, const char* pszName, const char* pDetail, int detailLen) {
+    pSpan->isActive = s_isEnabled;
+    if (!pSpan->isActive) return;
+
+    pSpan->pszName = pszName;
+    pSpan->pDetail = pDetail;
+    pSpan->detailLen = (pDetail && detailLen < 0) ? (int)strlen(pDetail) : detailLen;
+    pSpan->startCpuNs = get_thread_cpu_ns();
+    pSpan->startNs = get_wall_ns();
+}
+
+// Ԃ̌vIċL^
+void time_trace_end(TimeSpan* pSpan) {
+    if (!pSpan->isActive) return;
+    pSpan->isActive = false;
+
+    const int64_t endNs = get_wall_ns();
+    const int64_t endCpuNs = get_thread_cpu_ns();
+
+    // ڍׂ̓̕A[iɂ邱Ƃ̂ŁAbN̊OŕĂ
+    char* pszDetail = NULL;
+    if (pSpan->pDetail) {
+        pszDetail = calloc(pSpan->detailLen + 1, sizeof(char));
+        memcpy(pszDetail, pSpan->pDetail, pSpan->detailLen);
+    }
+
+    lock_mutex(s_pLock);
+    if (s_threadId == 0) {
+        s_threadId = ++s_threadCount;
+    }
+    if (s_eventCount == s_eventCap) {
+        s_eventCap = s_eventCap ? s_eventCap * 2 : 256;
+        s_pEvents = realloc(s_pEvents, s_eventCap * sizeof(TimeEvent));
+    }
+    TimeEvent* pEvent = &s_pEvents[s_eventCount++];
+    pEvent->pszName = pSpan->pszName;
+    pEvent->pszDetail = pszDetail;
+    pEvent->threadId = s_threadId;
+    pEvent->startNs = pSpan->startNs - s_originNs;
+    pEvent->wallNs = endNs - pSpan->startNs;
+    pEvent->cpuNs = endCpuNs - pSpan->startCpuNs;
+    unlock_mutex(s_pLock);
+}
+
+// Ԃ̒ɕׂ
+static int compare_event_wall(const void* a, const void* b) {
+    const int64_t x = (*(const TimeEvent* const*)a)->wallNs;
+    const int64_t y = (*(const TimeEvent* const*)b)->wallNs;
+    return (x < y) - (x > y);
+}
+
+// L^ԂiKƁE֐ƂɏWvAԂCPUԂpOutɏo
+void time_trace_report(StrBuf* pOut) {
+    PhaseTotal* pTotals = calloc(s_eventCount + 1, sizeof(PhaseTotal));
+    const TimeEvent** ppFuncs = calloc(s_eventCount + 1, sizeof(TimeEvent*));
+    int totalCount = 0;
+    int funcCount = 0;
+    int i, j;
+
+    // iK͍ŏɌꂽɕׂiԂ͏IɋL^̂ŁAq̊O̕ɂȂj
+    for (i = 0; i < s_eventCount; ++i) {
+        const TimeEvent* pEvent = &s_pEvents[i];
+        for (j = 0; j < totalCount; ++j) {
+            if (strcmp(pTotals[j].pszName, pEvent->pszName) == 0) break;
+        }
+        if (j == totalCount) {
+            pTotals[totalCount++].pszName = pEvent->pszName;
+        }
+        pTotals[j].wallNs += pEvent->wallNs;
+        pTotals[j].cpuNs += pEvent->cpuNs;
+        ++pTotals[j].count;
+
+        if (strcmp(pEvent->pszName, "function") == 0) {
+            ppFuncs[funcCount++] = pEvent;
+        }
+    }
+
+    strbuf_printf(pOut, "===== time report =====\n");
+    strbuf_printf(pOut, "  %-16s %12s %12s %8s\n", "phase", "wall(ms)", "cpu(ms)", "count");
+    for (i = 0; i < totalCount; ++i) {
+        strbuf_printf(pOut, "  %-16s %12.3f %12.3f %8d\n",
+            pTotals[i].pszName, pTotals[i].wallNs / 1e6, pTotals[i].cpuNs / 1e6, pTotals[i].count);
+    }
+
+    if (funcCount) {
+        qsort(ppFuncs, funcCount, sizeof(TimeEvent*), compare_event_wall);
+        strbuf_printf(pOut, "  slowest functions (top %d of %d)\n", funcCount < REPORT_FUNC_COUNT ? funcCount : REPORT_FUNC_COUNT, funcCount);
+        for (i = 0; i < funcCount && i < REPORT_FUNC_COUNT; ++i) {
+            strbuf_printf(pOut, "  %-16s %12.3f %12.3f\n",
+                ppFuncs[i]->pszDetail ? ppFuncs[i]->pszDetail : "", ppFuncs[i]->wallNs / 1e6, ppFuncs[i]->cpuNs / 1e6);
+        }
+    }
+
+    free(pTotals);
+    free(ppFuncs);
+}
+
+// JSON̕Ƃďo
+static void write_json_string(FILE* fp, const char* str) {
+    fputc('"', fp);
+    for (const char* p = str; *p; ++p) {
+        if (*p == '"' || *p == '\\') {
+            fprintf(fp, "\\%c", *p);
+        }
+        else if ((unsigned char)*p < 0x20) {
+            fprintf(fp, "\\u%04x", (unsigned char)*p);
+        }
+        else {
+            fputc(*p, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+// L^ԂChromẽg[XCxg`iJSONjŃt@Cɏo
+// ߂ȂfalseԂ
+bool time_trace_write_json(const char* pszPath) {
+    FILE* fp = fopen(pszPath, "w");
+    if (!fp) {
+        return false;
+    }
+
+    // Cxgi"ph":"X"jŏoƁAXbh̋Ԃ͎qƂĕ\
+    fprintf(fp, "{\"traceEvents\":[\n");
+    for (int i = 0; i < s_eventCount; ++i) {
+        const TimeEvent* pEvent = &s_pEvents[i];
+        fprintf(fp, "%s{\"name\":", i ? ",\n" : "");
+        write_json_string(fp, pEvent->pszName);
+        fprintf(fp, ",\"cat\":\"chibicc\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+            pEvent->threadId, pEvent->startNs / 1e3, pEvent->wallNs / 1e3);
+        fprintf(fp, ",\"args\":{\"cpu_ms\":%.3f", pEvent->cpuNs / 1e6);
+        if (pEvent->pszDetail) {
+            fprintf(fp, ",\"detail\":");
+            write_json_string(fp, pEvent->pszDetail);
+        }
+        fprintf(fp, "}}");
+    }
+    fprintf(fp, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+    const bool isOk = !ferror(fp);
+    fclose(fp);
+    return isOk;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct StrBuf StrBuf;
+typedef struct TimeSpan TimeSpan;
+
+// v̋ԁiĂяõX^bNɒuAtime_trace_begintime_trace_endŋށj
+// G[time_trace_end܂œBȂԂ͋L^ȂŁAn͗vȂ
+struct TimeSpan {
+    const char* pszName;    // Ԃ̖OiiKB񃊃enj
+    const char* pDetail;    // Ԃ̏ڍׁit@C֐BNULLȂ疳j
+    int detailLen;          // pDetail̒
+    int64_t startNs;        // Jniimbj
+    int64_t startCpuNs;     // JñXbhCPUԁiimbj
+    bool isActive;          // vȂtrue
+};
+
+// vJni܂ł̋L^͔jj
+void time_trace_start(void);
+
+// vIAL^j
+void time_trace_stop(void);
+
+// Ԃ̌vn߂ivłȂΉȂ̂ŁAɌĂł悢j
+// pDetailtime_trace_endĂԂ܂ŗLłȂ΂ȂȂBdetailLenȂ'\0'I[Ƃ݂Ȃ
+void time_trace_begin(TimeSpan* pSpan, const char* pszName, const char* pDetail, int detailLen);
+
+// Ԃ̌vIċL^
+void time_trace_end(TimeSpan* pSpan);
+
+// L^ԂiKƁE֐ƂɏWvAԂCPUԂpOutɏo
+void time_trace_report(StrBuf* pOut);
+
+// L^ԂChromẽg[XCxg`iJSONjŃt@Cɏo
+// ߂ȂfalseԂ
+bool time_trace_write_json(const char* pszPath);